@@ -0,0 +1,50 @@
+#!/bin/bash -e
+
+# Compares the time taken to compile (syntax check only) the source files that
+# use the MCU_PSD family of macros with the C++ 11 implementation of
+# progmem_string_data.h vs. the C++ 20 (FixedString) implementation.
+#
+# Usage: benchmark_psd_compile_time.sh [extra compiler flags...]
+#
+# The extra flags are typically -I flags for finding gtest, absl, etc. The
+# compiler may be specified via the CXX environment variable.
+
+SCRIPT_DIR="$( cd "$( dirname "${BASH_SOURCE[0]}" )" &> /dev/null && pwd )"
+
+if [[ "$(basename "${SCRIPT_DIR}")" != "dev_tools" ]]
+then
+  echo "The script is not in the expected directory"
+  exit 1
+fi
+
+cd "${SCRIPT_DIR}/../.."
+
+if [[ ! -f src/McuCore.h ]]
+then
+  echo "Expected to find McuCore.h in the src directory."
+  exit 1
+fi
+
+CXX="${CXX:-g++}"
+COMMON_FLAGS=(-std=gnu++20 -fsyntax-only -Isrc -I. "$@")
+
+FILES=($(egrep -l -r --include='*.cpp' --include='*.cc' \
+           'MCU_(PSD|FLASHSTR|BASENAME|PSV|LOG|VLOG|CHECK|DCHECK)' \
+           src extras/tests | sort))
+
+echo "Compiling ${#FILES[@]} files with ${CXX}"
+
+function compile_all() {
+  for F in "${FILES[@]}"
+  do
+    "${CXX}" "${COMMON_FLAGS[@]}" "$@" "${F}"
+  done
+}
+
+TIMEFORMAT="%R seconds"
+
+echo -n "C++ 11 implementation (fragments):   "
+time compile_all -DMCU_DISABLE_PSD_FIXED_STRING
+
+echo -n "C++ 20 implementation (FixedString): "
+time compile_all
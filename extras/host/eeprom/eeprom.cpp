@@ -1,5 +1,7 @@
 #include "extras/host/eeprom/eeprom.h"
 
+#include <string.h>
+
 #include "absl/log/check.h"
 
 namespace internal {
@@ -14,7 +16,32 @@ void eeprom_write_byte(EEPROMClass& eeprom, int index, uint8_t value) {
 
 }  // namespace internal
 
-EEPROMClass::EEPROMClass(uint16_t length) : data_(length, 0) {
+EEPROMClass::EEPROMClass(uint16_t length) : data_(length, 0), length_(length) {
+  CHECK_NE(length, 0);
+}
+
+EEPROMClass::EEPROMClass(ExternalStorage, uint16_t length) : length_(length) {
   CHECK_NE(length, 0);
 }
+
+void EEPROMClass::read_block(void* dst, int idx, size_t n) {
+  CHECK_GE(idx, 0);
+  CHECK_LE(idx + n, data_.size());
+  memcpy(dst, data_.data() + idx, n);
+}
+
+void EEPROMClass::update_block(const void* src, int idx, size_t n) {
+  CHECK_GE(idx, 0);
+  CHECK_LE(idx + n, data_.size());
+  memcpy(data_.data() + idx, src, n);
+}
+
+void EEPROMClass::move_block(int from_idx, int to_idx, size_t n) {
+  CHECK_GE(from_idx, 0);
+  CHECK_GE(to_idx, 0);
+  CHECK_LE(from_idx + n, data_.size());
+  CHECK_LE(to_idx + n, data_.size());
+  memmove(data_.data() + to_idx, data_.data() + from_idx, n);
+}
+
 EEPROMClass EEPROM;  // NOLINT
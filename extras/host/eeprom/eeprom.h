@@ -2,11 +2,10 @@
 #define MCUCORE_EXTRAS_HOST_EEPROM_EEPROM_H_
 
 // A totally fake implementation of Arduino's EEPROM API. Just stores in RAM,
-// and has no persistence. IFF we really wanted to, we could use mmap to read
-// and write from a file, and thus provide persistence from run to run... which
-// would complicate testing; if appropriate to add this feature this, we could
-// make that configurable.
+// and has no persistence. For persistence from run to run, MappedEepromClass
+// (see mapped_eeprom.h) stores the contents in a memory mapped file instead.
 
+#include <stddef.h>
 #include <stdint.h>
 
 #include <vector>
@@ -78,36 +77,50 @@ class EEPROMClass {
   // in test fixtures.
   virtual uint8_t read(int idx) { return data_[idx]; }
   virtual void write(int idx, uint8_t val) { data_[idx] = val; }
-  void update(int idx, uint8_t val) { write(idx, val); }
+  // As on the Arduino, only writes if the value is changing.
+  void update(int idx, uint8_t val) {
+    if (read(idx) != val) {
+      write(idx, val);
+    }
+  }
+
+  // Block access methods, which don't exist in the normal Arduino library, but
+  // correspond to avr-libc's eeprom_read_block and eeprom_update_block, plus a
+  // memmove equivalent. These use memcpy and memmove, rather than calling read
+  // and write for each byte; they are virtual so that test fixtures which need
+  // to intercept all accesses can override them too.
+  virtual void read_block(void* dst, int idx, size_t n);
+  virtual void update_block(const void* src, int idx, size_t n);
+  virtual void move_block(int from_idx, int to_idx, size_t n);
 
   EERef operator[](const int idx) { return EERef(*this, idx); }
 
-  uint16_t length() { return static_cast<uint16_t>(data_.size()); }
+  uint16_t length() { return length_; }
 
   // Functionality to 'get' and 'put' objects to and from EEPROM.
   template <typename T>
   T& get(int idx, T& t) {
-    uint8_t* ptr = reinterpret_cast<uint8_t*>(&t);
-    int limit = idx + sizeof(T);
-    while (idx < limit) {
-      *ptr++ = read(idx++);
-    }
+    read_block(&t, idx, sizeof(T));
     return t;
   }
 
   template <typename T>
   const T& put(int idx, const T& t) {
-    const uint8_t* ptr = reinterpret_cast<const uint8_t*>(&t);
-    int limit = idx + sizeof(T);
-    while (idx < limit) {
-      update(idx++, *ptr++);
-    }
+    update_block(&t, idx, sizeof(T));
     return t;
   }
 
+ protected:
+  // For subclasses which store the contents elsewhere (e.g. MappedEepromClass),
+  // and thus override all of the access methods above: doesn't allocate the
+  // contents.
+  struct ExternalStorage {};
+  EEPROMClass(ExternalStorage, uint16_t length);
+
  private:
   // Initializes to zeroes.
   std::vector<uint8_t> data_;
+  uint16_t length_;
 };
 
 extern EEPROMClass EEPROM;
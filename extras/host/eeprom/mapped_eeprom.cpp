@@ -0,0 +1,133 @@
+#include "extras/host/eeprom/mapped_eeprom.h"
+
+#include <fcntl.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <cerrno>
+#include <string>
+
+#include "absl/log/check.h"
+#include "extras/host/eeprom/eeprom.h"
+#include "extras/host/posix_errno.h"
+
+MappedEepromClass::MappedEepromClass(const std::string& path, uint16_t length)
+    : EEPROMClass(ExternalStorage(), length),
+      path_(path),
+      fd_(-1),
+      mapped_(nullptr),
+      power_cut_pending_(false),
+      bytes_until_power_cut_(0) {
+  fd_ = open(path.c_str(), O_RDWR | O_CREAT, 0644);
+  CHECK_GE(fd_, 0) << "Unable to open " << path << ": "
+                   << mcucore_host::ErrnoToString(errno);
+  struct stat file_stat;
+  CHECK_EQ(fstat(fd_, &file_stat), 0)
+      << "Unable to stat " << path << ": "
+      << mcucore_host::ErrnoToString(errno);
+  if (file_stat.st_size < length) {
+    // Extends the file with zeroes, matching the initial contents of the
+    // EEPROMClass.
+    CHECK_EQ(ftruncate(fd_, length), 0)
+        << "Unable to extend " << path << ": "
+        << mcucore_host::ErrnoToString(errno);
+  }
+  void* addr =
+      mmap(nullptr, length, PROT_READ | PROT_WRITE, MAP_SHARED, fd_, 0);
+  CHECK_NE(addr, MAP_FAILED) << "Unable to map " << path << ": "
+                             << mcucore_host::ErrnoToString(errno);
+  mapped_ = static_cast<uint8_t*>(addr);
+}
+
+MappedEepromClass::~MappedEepromClass() {
+  munmap(mapped_, length());
+  close(fd_);
+}
+
+uint8_t MappedEepromClass::read(int idx) {
+  CheckRange(idx, 1);
+  return mapped_[idx];
+}
+
+void MappedEepromClass::write(int idx, uint8_t val) {
+  CheckRange(idx, 1);
+  if (BytesToStore(1) > 0) {
+    mapped_[idx] = val;
+  }
+}
+
+void MappedEepromClass::read_block(void* dst, int idx, size_t n) {
+  CheckRange(idx, n);
+  memcpy(dst, mapped_ + idx, n);
+}
+
+void MappedEepromClass::update_block(const void* src, int idx, size_t n) {
+  CheckRange(idx, n);
+  const auto* bytes = static_cast<const uint8_t*>(src);
+  for (size_t ndx = 0; ndx < n; ++ndx) {
+    UpdateByte(idx + ndx, bytes[ndx]);
+  }
+}
+
+void MappedEepromClass::move_block(int from_idx, int to_idx, size_t n) {
+  CheckRange(from_idx, n);
+  CheckRange(to_idx, n);
+  // As with memmove, copy from the start when moving down, else from the end,
+  // so that overlapping bytes are read before they're overwritten.
+  if (to_idx < from_idx) {
+    for (size_t ndx = 0; ndx < n; ++ndx) {
+      UpdateByte(to_idx + ndx, mapped_[from_idx + ndx]);
+    }
+  } else {
+    for (size_t ndx = n; ndx > 0; --ndx) {
+      UpdateByte(to_idx + ndx - 1, mapped_[from_idx + ndx - 1]);
+    }
+  }
+}
+
+void MappedEepromClass::Sync() {
+  CHECK_EQ(msync(mapped_, length(), MS_SYNC), 0)
+      << "Unable to sync " << path_ << ": "
+      << mcucore_host::ErrnoToString(errno);
+}
+
+void MappedEepromClass::CutPowerAfter(size_t bytes) {
+  power_cut_pending_ = true;
+  bytes_until_power_cut_ = bytes;
+}
+
+size_t MappedEepromClass::CutPowerAtRandomByte(size_t max_bytes) {
+  CHECK_GT(max_bytes, 0);
+  std::uniform_int_distribution<size_t> distribution(0, max_bytes - 1);
+  const size_t bytes = distribution(rng_);
+  CutPowerAfter(bytes);
+  return bytes;
+}
+
+void MappedEepromClass::RestorePower() {
+  power_cut_pending_ = false;
+  bytes_until_power_cut_ = 0;
+}
+
+size_t MappedEepromClass::BytesToStore(size_t n) {
+  if (!power_cut_pending_) {
+    return n;
+  }
+  n = std::min(n, bytes_until_power_cut_);
+  bytes_until_power_cut_ -= n;
+  return n;
+}
+
+void MappedEepromClass::UpdateByte(int idx, uint8_t val) {
+  if (mapped_[idx] != val && BytesToStore(1) > 0) {
+    mapped_[idx] = val;
+  }
+}
+
+void MappedEepromClass::CheckRange(int idx, size_t n) {
+  CHECK_GE(idx, 0);
+  CHECK_LE(idx + n, length());
+}
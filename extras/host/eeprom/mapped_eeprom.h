@@ -0,0 +1,88 @@
+#ifndef MCUCORE_EXTRAS_HOST_EEPROM_MAPPED_EEPROM_H_
+#define MCUCORE_EXTRAS_HOST_EEPROM_MAPPED_EEPROM_H_
+
+// MappedEepromClass is an EEPROMClass whose contents are stored in a file that
+// is memory mapped (i.e. using mmap), thus persist from run to run of a host
+// program, such as a simulation of a device. The file is created if it doesn't
+// exist, and extended with zeroes if it is shorter than the EEPROM. Changes
+// are written back to the file whenever the OS chooses; Sync flushes them
+// immediately (i.e. using msync).
+//
+// For testing the recovery from a power loss, CutPowerAfter and
+// CutPowerAtRandomByte truncate the writes at a chosen byte: that byte, and
+// all bytes written after it, are discarded until RestorePower is called, as
+// if the power had failed while the device was writing to the EEPROM. As on a
+// device, update_block and move_block only write the bytes which are changing,
+// so only those bytes count towards the power cut.
+//
+// The contents are only in the mapped file; unlike EEPROMClass, there is no
+// copy in RAM.
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include <random>
+#include <string>
+
+#include "extras/host/eeprom/eeprom.h"
+
+class MappedEepromClass : public EEPROMClass {
+ public:
+  // Maps the first `length` bytes of the file at `path`. Dies if the file
+  // can't be opened, extended or mapped.
+  explicit MappedEepromClass(const std::string& path,
+                             uint16_t length = kDefaultSize);
+  ~MappedEepromClass() override;
+
+  MappedEepromClass(const MappedEepromClass&) = delete;
+  MappedEepromClass& operator=(const MappedEepromClass&) = delete;
+
+  uint8_t read(int idx) override;
+  void write(int idx, uint8_t val) override;
+  void read_block(void* dst, int idx, size_t n) override;
+  void update_block(const void* src, int idx, size_t n) override;
+  void move_block(int from_idx, int to_idx, size_t n) override;
+
+  // Writes the changes to the file, returning once they've been written.
+  void Sync();
+
+  // Stores only the next `bytes` bytes written (by write, or the changed bytes
+  // of update_block or move_block, in the order in which they're written),
+  // then discards all later writes until RestorePower is called.
+  void CutPowerAfter(size_t bytes);
+
+  // As CutPowerAfter, with the number of bytes chosen at random from the range
+  // [0, max_bytes). Returns the chosen number. The random number generator has
+  // a fixed seed, so the choices are repeatable from run to run.
+  size_t CutPowerAtRandomByte(size_t max_bytes);
+
+  // Returns true if a power cut has happened (i.e. writes are being discarded).
+  bool power_is_cut() const {
+    return power_cut_pending_ && bytes_until_power_cut_ == 0;
+  }
+
+  // Cancels any pending power cut, and resumes storing all writes.
+  void RestorePower();
+
+ private:
+  // Returns the number of the next n bytes written which are to be stored,
+  // counting them towards the pending power cut, if any.
+  size_t BytesToStore(size_t n);
+
+  // Stores val at idx if it differs from the stored value, counting it towards
+  // the pending power cut, if any.
+  void UpdateByte(int idx, uint8_t val);
+
+  // Dies if the n bytes starting at idx aren't within the EEPROM.
+  void CheckRange(int idx, size_t n);
+
+  std::string path_;
+  int fd_;
+  uint8_t* mapped_;
+
+  bool power_cut_pending_;
+  size_t bytes_until_power_cut_;
+  std::mt19937 rng_;
+};
+
+#endif  // MCUCORE_EXTRAS_HOST_EEPROM_MAPPED_EEPROM_H_
@@ -134,4 +134,26 @@ TEST_F(EepromTest, PutDoubles) {
   }
 }
 
+TEST_F(EepromTest, BlockAccess) {
+  std::vector<uint8_t> expected_bytes(eeprom_.length(), 0);
+  const uint8_t src[] = {1, 2, 3, 4, 5, 6, 7, 8};
+  eeprom_.update_block(src, 100, sizeof src);
+  std::memcpy(expected_bytes.data() + 100, src, sizeof src);
+  EXPECT_EQ(ReadAllBytesAllWaysAndVerify(eeprom_), expected_bytes);
+
+  uint8_t dst[sizeof src] = {};
+  eeprom_.read_block(dst, 100, sizeof dst);
+  EXPECT_EQ(std::memcmp(dst, src, sizeof src), 0);
+
+  // Overlapping moves, in both directions.
+  eeprom_.move_block(100, 103, sizeof src);
+  std::memmove(expected_bytes.data() + 103, expected_bytes.data() + 100,
+               sizeof src);
+  EXPECT_EQ(ReadAllBytesAllWaysAndVerify(eeprom_), expected_bytes);
+  eeprom_.move_block(103, 98, sizeof src);
+  std::memmove(expected_bytes.data() + 98, expected_bytes.data() + 103,
+               sizeof src);
+  EXPECT_EQ(ReadAllBytesAllWaysAndVerify(eeprom_), expected_bytes);
+}
+
 }  // namespace
@@ -0,0 +1,160 @@
+#include "extras/host/eeprom/mapped_eeprom.h"
+
+#include <stdio.h>
+
+#include <cstdint>
+#include <cstring>
+#include <string>
+#include <vector>
+
+#include "extras/host/eeprom/eeprom.h"
+#include "extras/test_tools/eeprom_test_utils.h"
+#include "gtest/gtest.h"
+
+namespace {
+using ::mcucore::test::AddressToValueMap;
+using ::mcucore::test::GenerateByteValues;
+using ::mcucore::test::ReadAllBytesAllWaysAndVerify;
+
+class MappedEepromTest : public testing::Test {
+ protected:
+  MappedEepromTest()
+      : path_(testing::TempDir() + "/" +
+              testing::UnitTest::GetInstance()->current_test_info()->name() +
+              ".eeprom") {
+    remove(path_.c_str());
+  }
+  ~MappedEepromTest() override { remove(path_.c_str()); }
+
+  const std::string path_;
+};
+
+TEST_F(MappedEepromTest, StartsZeroedOut) {
+  MappedEepromClass eeprom(path_);
+  EXPECT_EQ(eeprom.length(), EEPROMClass::kDefaultSize);
+  const std::vector<uint8_t> zeroes(eeprom.length());
+  EXPECT_EQ(ReadAllBytesAllWaysAndVerify(eeprom), zeroes);
+}
+
+TEST_F(MappedEepromTest, PersistsAcrossInstances) {
+  std::vector<uint8_t> expected_bytes(100, 0);
+  {
+    MappedEepromClass eeprom(path_, 100);
+    AddressToValueMap values = GenerateByteValues(1.5, eeprom.length());
+    for (const auto [address, value] : values) {
+      eeprom.write(address, value);
+      expected_bytes[address] = value;
+    }
+    eeprom.Sync();
+    EXPECT_EQ(ReadAllBytesAllWaysAndVerify(eeprom), expected_bytes);
+  }
+  MappedEepromClass eeprom(path_, 100);
+  EXPECT_EQ(ReadAllBytesAllWaysAndVerify(eeprom), expected_bytes);
+
+  // A longer EEPROM keeps the existing contents, followed by zeroes.
+  MappedEepromClass longer_eeprom(path_, 200);
+  expected_bytes.resize(200, 0);
+  EXPECT_EQ(ReadAllBytesAllWaysAndVerify(longer_eeprom), expected_bytes);
+}
+
+TEST_F(MappedEepromTest, BlockAccess) {
+  MappedEepromClass eeprom(path_);
+  std::vector<uint8_t> expected_bytes(eeprom.length(), 0);
+  const uint8_t src[] = {1, 2, 3, 4, 5, 6, 7, 8};
+  eeprom.update_block(src, 100, sizeof src);
+  std::memcpy(expected_bytes.data() + 100, src, sizeof src);
+  EXPECT_EQ(ReadAllBytesAllWaysAndVerify(eeprom), expected_bytes);
+
+  uint8_t dst[sizeof src] = {};
+  eeprom.read_block(dst, 100, sizeof dst);
+  EXPECT_EQ(std::memcmp(dst, src, sizeof src), 0);
+
+  // Overlapping moves, in both directions.
+  eeprom.move_block(100, 103, sizeof src);
+  std::memmove(expected_bytes.data() + 103, expected_bytes.data() + 100,
+               sizeof src);
+  EXPECT_EQ(ReadAllBytesAllWaysAndVerify(eeprom), expected_bytes);
+  eeprom.move_block(103, 98, sizeof src);
+  std::memmove(expected_bytes.data() + 98, expected_bytes.data() + 103,
+               sizeof src);
+  EXPECT_EQ(ReadAllBytesAllWaysAndVerify(eeprom), expected_bytes);
+}
+
+TEST_F(MappedEepromTest, CutPowerAfter) {
+  MappedEepromClass eeprom(path_);
+  std::vector<uint8_t> expected_bytes(eeprom.length(), 0);
+  const uint8_t src[] = {1, 2, 3, 4, 5, 6, 7, 8};
+
+  // Only the first 5 bytes written are stored: 2 by write, 3 by update_block.
+  eeprom.CutPowerAfter(5);
+  eeprom.write(10, 10);
+  eeprom.write(11, 11);
+  EXPECT_FALSE(eeprom.power_is_cut());
+  eeprom.update_block(src, 20, sizeof src);
+  EXPECT_TRUE(eeprom.power_is_cut());
+  eeprom.write(12, 12);
+  eeprom.move_block(20, 30, sizeof src);
+  expected_bytes[10] = 10;
+  expected_bytes[11] = 11;
+  std::memcpy(expected_bytes.data() + 20, src, 3);
+  EXPECT_EQ(ReadAllBytesAllWaysAndVerify(eeprom), expected_bytes);
+
+  eeprom.RestorePower();
+  EXPECT_FALSE(eeprom.power_is_cut());
+  eeprom.write(12, 12);
+  eeprom.move_block(20, 30, sizeof src);
+  expected_bytes[12] = 12;
+  std::memcpy(expected_bytes.data() + 30, expected_bytes.data() + 20,
+              sizeof src);
+  EXPECT_EQ(ReadAllBytesAllWaysAndVerify(eeprom), expected_bytes);
+}
+
+TEST_F(MappedEepromTest, CutPowerCountsOnlyChangedBytes) {
+  MappedEepromClass eeprom(path_);
+  std::vector<uint8_t> expected_bytes(eeprom.length(), 0);
+  const uint8_t src[] = {0, 1, 0, 2, 3, 0, 4};
+
+  // The zeroes aren't changing, so aren't written.
+  eeprom.CutPowerAfter(3);
+  eeprom.update_block(src, 20, sizeof src);
+  EXPECT_TRUE(eeprom.power_is_cut());
+  expected_bytes[21] = 1;
+  expected_bytes[23] = 2;
+  expected_bytes[24] = 3;
+  EXPECT_EQ(ReadAllBytesAllWaysAndVerify(eeprom), expected_bytes);
+
+  eeprom.RestorePower();
+  eeprom.update_block(src, 20, sizeof src);
+  expected_bytes[26] = 4;
+  EXPECT_EQ(ReadAllBytesAllWaysAndVerify(eeprom), expected_bytes);
+
+  // Moving up by one writes from the end: 4 to 27, and 0 to 26.
+  eeprom.CutPowerAfter(2);
+  eeprom.move_block(20, 21, sizeof src);
+  EXPECT_TRUE(eeprom.power_is_cut());
+  expected_bytes[27] = 4;
+  expected_bytes[26] = 0;
+  EXPECT_EQ(ReadAllBytesAllWaysAndVerify(eeprom), expected_bytes);
+}
+
+TEST_F(MappedEepromTest, CutPowerAtRandomByte) {
+  MappedEepromClass eeprom(path_);
+  const std::vector<uint8_t> src(64, 0xAB);
+  bool chose_a_middle_byte = false;
+  for (int trial = 0; trial < 20; ++trial) {
+    std::vector<uint8_t> expected_bytes(eeprom.length(), 0);
+    eeprom.RestorePower();
+    eeprom.update_block(expected_bytes.data(), 0, expected_bytes.size());
+
+    const size_t stored = eeprom.CutPowerAtRandomByte(src.size());
+    ASSERT_LT(stored, src.size());
+    chose_a_middle_byte = chose_a_middle_byte || stored > 0;
+    eeprom.update_block(src.data(), 50, src.size());
+    EXPECT_TRUE(eeprom.power_is_cut());
+    std::memcpy(expected_bytes.data() + 50, src.data(), stored);
+    EXPECT_EQ(ReadAllBytesAllWaysAndVerify(eeprom), expected_bytes);
+  }
+  EXPECT_TRUE(chose_a_middle_byte);
+}
+
+}  // namespace
@@ -124,5 +124,35 @@ void ExpectHasValues(const std::vector<uint8_t>& actual,
                 << absl::StrJoin(errors, "\n");
 }
 
+void ByteWritingEeprom::update_block(const void* src, int idx, size_t n) {
+  const auto* bytes = static_cast<const uint8_t*>(src);
+  for (size_t ndx = 0; ndx < n; ++ndx) {
+    update(idx + ndx, bytes[ndx]);
+  }
+}
+
+void ByteWritingEeprom::move_block(int from_idx, int to_idx, size_t n) {
+  // As with memmove, copy from the start when moving down, else from the end,
+  // so that overlapping bytes are read before they're overwritten.
+  if (to_idx < from_idx) {
+    for (size_t ndx = 0; ndx < n; ++ndx) {
+      update(to_idx + ndx, read(from_idx + ndx));
+    }
+  } else {
+    for (size_t ndx = n; ndx > 0; --ndx) {
+      update(to_idx + ndx - 1, read(from_idx + ndx - 1));
+    }
+  }
+}
+
+void PowerLossEeprom::write(int idx, uint8_t val) {
+  if (writes_remaining == 0) {
+    throw PowerLoss();
+  } else if (writes_remaining > 0) {
+    --writes_remaining;
+  }
+  EEPROMClass::write(idx, val);
+}
+
 }  // namespace test
 }  // namespace mcucore
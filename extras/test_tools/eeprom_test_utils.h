@@ -80,6 +80,37 @@ void ExpectHasValues(EEPROMClass& eeprom, const AddressToValueMap& expected);
 void ExpectHasValues(const std::vector<uint8_t>& actual,
                      const AddressToValueMap& expected);
 
+// The block methods of EEPROMClass use memcpy and memmove, so don't call write.
+// For test fixtures which override write to intercept every byte written, this
+// class overrides update_block and move_block to update one byte at a time.
+class ByteWritingEeprom : public EEPROMClass {
+ public:
+  explicit ByteWritingEeprom(uint16_t length = kDefaultSize)
+      : EEPROMClass(length) {}
+
+  void update_block(const void* src, int idx, size_t n) override;
+  void move_block(int from_idx, int to_idx, size_t n) override;
+};
+
+////////////////////////////////////////////////////////////////////////////////
+// Support for testing recovery from a power loss part way through a sequence
+// of writes.
+
+// Thrown by PowerLossEeprom in place of performing a write.
+struct PowerLoss {};
+
+// Simulates a power loss by throwing PowerLoss instead of performing the write
+// after the first writes_remaining writes, if writes_remaining isn't negative.
+class PowerLossEeprom : public ByteWritingEeprom {
+ public:
+  explicit PowerLossEeprom(uint16_t length = kDefaultSize)
+      : ByteWritingEeprom(length) {}
+
+  void write(int idx, uint8_t val) override;
+
+  int writes_remaining = -1;
+};
+
 }  // namespace test
 }  // namespace mcucore
 
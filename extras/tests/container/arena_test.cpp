@@ -0,0 +1,143 @@
+#include "container/arena.h"
+
+#include <stdint.h>
+
+#include "gtest/gtest.h"
+#include "strings/string_view.h"
+#include "strings/tiny_string.h"
+
+namespace mcucore {
+namespace test {
+namespace {
+
+struct Point {
+  Point() : x(1), y(2) {}
+  Point(int16_t x, int16_t y) : x(x), y(y) {}
+  int16_t x;
+  int16_t y;
+};
+
+bool IsAligned(const void* ptr, size_t alignment) {
+  return (reinterpret_cast<uintptr_t>(ptr) % alignment) == 0;
+}
+
+TEST(ArenaTest, Empty) {
+  uint8_t buffer[16];
+  Arena arena(buffer);
+  EXPECT_EQ(arena.max_size(), 16);
+  EXPECT_EQ(arena.used(), 0);
+  EXPECT_EQ(arena.available(), 16);
+  EXPECT_EQ(arena.high_water_mark(), 0);
+  EXPECT_EQ(arena.num_failures(), 0);
+}
+
+TEST(ArenaTest, AllocateUntilFull) {
+  uint8_t buffer[16];
+  Arena arena(buffer);
+  EXPECT_EQ(arena.Allocate(10), buffer);
+  EXPECT_EQ(arena.Allocate(6), buffer + 10);
+  EXPECT_EQ(arena.available(), 0);
+  EXPECT_EQ(arena.Allocate(1), nullptr);
+  EXPECT_EQ(arena.num_failures(), 1);
+  // A zero size allocation is possible even when full.
+  EXPECT_NE(arena.Allocate(0), nullptr);
+  EXPECT_EQ(arena.used(), 16);
+  EXPECT_EQ(arena.high_water_mark(), 16);
+}
+
+TEST(ArenaTest, Alignment) {
+  alignas(8) uint8_t buffer[64];
+  Arena arena(buffer);
+  EXPECT_EQ(arena.Allocate(1), buffer);
+  void* ptr = arena.Allocate(4, 4);
+  EXPECT_EQ(ptr, buffer + 4);
+  EXPECT_EQ(arena.used(), 8);
+  EXPECT_EQ(arena.Allocate(1, 2), buffer + 8);
+  EXPECT_EQ(arena.Allocate(8, 8), buffer + 16);
+  EXPECT_EQ(arena.used(), 24);
+  // Not enough room once padded.
+  EXPECT_NE(arena.Allocate(33), nullptr);
+  EXPECT_EQ(arena.used(), 57);
+  EXPECT_EQ(arena.Allocate(1, 8), nullptr);
+  EXPECT_EQ(arena.used(), 57);
+  EXPECT_NE(arena.Allocate(7, 1), nullptr);
+}
+
+TEST(ArenaTest, NewArray) {
+  uint8_t buffer[32];
+  Arena arena(buffer);
+  arena.Allocate(1);
+  Point* points = arena.NewArray<Point>(3);
+  ASSERT_NE(points, nullptr);
+  EXPECT_TRUE(IsAligned(points, alignof(Point)));
+  for (int ndx = 0; ndx < 3; ++ndx) {
+    EXPECT_EQ(points[ndx].x, 1);
+    EXPECT_EQ(points[ndx].y, 2);
+  }
+  EXPECT_EQ(arena.NewArray<Point>(10), nullptr);
+  // Overflow of count * sizeof(T) must be detected.
+  EXPECT_EQ(arena.NewArray<Point>(SIZE_MAX / 2), nullptr);
+  EXPECT_EQ(arena.num_failures(), 2);
+
+  Point* point = arena.New<Point>(7, 8);
+  ASSERT_NE(point, nullptr);
+  EXPECT_EQ(point->x, 7);
+  EXPECT_EQ(point->y, 8);
+}
+
+TEST(ArenaTest, CopyString) {
+  uint8_t buffer[10];
+  Arena arena(buffer);
+  char text[] = "abcdef";
+  StringView copy;
+  EXPECT_TRUE(arena.CopyString(StringView(text, 6), copy));
+  text[0] = 'z';
+  EXPECT_EQ(copy, StringView("abcdef"));
+  EXPECT_EQ(static_cast<const void*>(copy.data()), buffer);
+
+  TinyString<8> tiny;
+  tiny.Set("xyz", 3);
+  StringView tiny_copy;
+  EXPECT_TRUE(arena.CopyString(tiny, tiny_copy));
+  tiny.Clear();
+  EXPECT_EQ(tiny_copy, StringView("xyz"));
+
+  // No room for this one, so copy is unchanged.
+  EXPECT_FALSE(arena.CopyString(StringView("12"), copy));
+  EXPECT_EQ(copy, StringView("abcdef"));
+}
+
+TEST(ArenaTest, ScopesRollBack) {
+  uint8_t buffer[32];
+  Arena arena(buffer);
+  arena.Allocate(4);
+  {
+    ArenaScope outer(arena);
+    arena.Allocate(8);
+    {
+      ArenaScope inner(arena);
+      arena.Allocate(16);
+      EXPECT_EQ(arena.used(), 28);
+    }
+    EXPECT_EQ(arena.used(), 12);
+    // The space freed by the inner scope is reused.
+    EXPECT_EQ(arena.Allocate(1), buffer + 12);
+  }
+  EXPECT_EQ(arena.used(), 4);
+  EXPECT_EQ(arena.high_water_mark(), 28);
+
+  auto marker = arena.Mark();
+  arena.Allocate(2);
+  arena.Rollback(marker);
+  EXPECT_EQ(arena.used(), 4);
+
+  arena.ResetStats();
+  EXPECT_EQ(arena.high_water_mark(), 4);
+  arena.Reset();
+  EXPECT_EQ(arena.used(), 0);
+  EXPECT_EQ(arena.Allocate(1), buffer);
+}
+
+}  // namespace
+}  // namespace test
+}  // namespace mcucore
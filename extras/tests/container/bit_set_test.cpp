@@ -0,0 +1,144 @@
+#include "container/bit_set.h"
+
+#include <bitset>
+#include <vector>
+
+#include "absl/random/random.h"
+#include "gmock/gmock.h"
+#include "gtest/gtest.h"
+
+namespace mcucore {
+namespace test {
+namespace {
+
+using ::testing::ElementsAre;
+using ::testing::IsEmpty;
+
+template <size_t N>
+std::vector<size_t> SetBits(const BitSet<N>& bits) {
+  std::vector<size_t> result;
+  bits.for_each_set([&result](size_t pos) { result.push_back(pos); });
+  return result;
+}
+
+TEST(BitSetTest, NibbleTables) {
+  for (int b = 0; b < 256; ++b) {
+    const auto byte = static_cast<uint8_t>(b);
+    EXPECT_EQ(bit_set_internal::PopCountByNibbles(byte),
+              std::bitset<8>(b).count());
+    if (b != 0) {
+      EXPECT_EQ(bit_set_internal::CountTrailingZerosByNibbles(byte),
+                __builtin_ctz(b));
+    }
+  }
+}
+
+TEST(BitSetTest, Empty) {
+  BitSet<12> bits;
+  EXPECT_EQ(bits.size(), 12);
+  EXPECT_EQ(bits.count(), 0);
+  EXPECT_FALSE(bits.any());
+  EXPECT_TRUE(bits.none());
+  EXPECT_EQ(bits.find_first(), 12);
+  EXPECT_THAT(SetBits(bits), IsEmpty());
+  EXPECT_LE(sizeof bits, 4);
+}
+
+TEST(BitSetTest, SetAndReset) {
+  BitSet<40> bits;
+  bits.set(0);
+  bits.set(9);
+  bits.set(31);
+  bits.set(32);
+  bits.set(39);
+  bits.set(40);  // Ignored.
+  EXPECT_EQ(bits.count(), 5);
+  EXPECT_TRUE(bits.test(9));
+  EXPECT_FALSE(bits.test(10));
+  EXPECT_FALSE(bits.test(40));
+  EXPECT_THAT(SetBits(bits), ElementsAre(0, 9, 31, 32, 39));
+  EXPECT_EQ(bits.find_first(), 0);
+  EXPECT_EQ(bits.find_next(1), 9);
+  EXPECT_EQ(bits.find_next(10), 31);
+  EXPECT_EQ(bits.find_next(33), 39);
+  EXPECT_EQ(bits.find_next(40), 40);
+
+  bits.reset(0);
+  bits.set(9, false);
+  bits.set(10, true);
+  EXPECT_THAT(SetBits(bits), ElementsAre(10, 31, 32, 39));
+  bits.reset();
+  EXPECT_TRUE(bits.none());
+}
+
+TEST(BitSetTest, Constexpr) {
+  constexpr auto kBits = BitSet<20>::Of(1, 3, 19, 25);
+  static_assert(kBits.test(1), "");
+  static_assert(kBits.test(19), "");
+  static_assert(!kBits.test(2), "");
+  static_assert(!kBits.test(25), "");
+  constexpr auto kOther = BitSet<20>::Of(3, 4);
+  static_assert((kBits | kOther).test(4), "");
+  static_assert(!(kBits & kOther).test(1), "");
+  static_assert((kBits & kOther).test(3), "");
+  static_assert(!(kBits - kOther).test(3), "");
+  static_assert(!(kBits ^ kOther).test(3), "");
+  static_assert(BitSet<20>::All().test(19), "");
+  static_assert(!(~kBits).test(1), "");
+  EXPECT_THAT(SetBits(kBits), ElementsAre(1, 3, 19));
+  EXPECT_EQ(BitSet<20>::All().count(), 20);
+  EXPECT_EQ((~kBits).count(), 17);
+}
+
+TEST(BitSetTest, SetAlgebra) {
+  const auto a = BitSet<10>::Of(1, 2, 3);
+  const auto b = BitSet<10>::Of(3, 4);
+  EXPECT_THAT(SetBits(a | b), ElementsAre(1, 2, 3, 4));
+  EXPECT_THAT(SetBits(a & b), ElementsAre(3));
+  EXPECT_THAT(SetBits(a ^ b), ElementsAre(1, 2, 4));
+  EXPECT_THAT(SetBits(a - b), ElementsAre(1, 2));
+  EXPECT_THAT(SetBits(~a), ElementsAre(0, 4, 5, 6, 7, 8, 9));
+  EXPECT_TRUE((a & b).IsSubsetOf(a));
+  EXPECT_FALSE(a.IsSubsetOf(b));
+  EXPECT_EQ(a, BitSet<10>::Of(3, 2, 1));
+  EXPECT_NE(a, b);
+
+  auto c = a;
+  c |= b;
+  EXPECT_EQ(c, a | b);
+  c -= a;
+  EXPECT_EQ(c, BitSet<10>::Of(4));
+  c ^= b;
+  EXPECT_EQ(c, BitSet<10>::Of(3));
+  c &= a;
+  EXPECT_EQ(c, BitSet<10>::Of(3));
+}
+
+TEST(BitSetTest, MatchesStdBitset) {
+  absl::BitGen bitgen;
+  BitSet<100> bits;
+  std::bitset<100> model;
+  for (int i = 0; i < 2000; ++i) {
+    const auto pos = absl::Uniform<size_t>(bitgen, 0, 100);
+    if (absl::Bernoulli(bitgen, 0.6)) {
+      bits.set(pos);
+      model.set(pos);
+    } else {
+      bits.reset(pos);
+      model.reset(pos);
+    }
+    ASSERT_EQ(bits.count(), model.count());
+    std::vector<size_t> expected;
+    for (size_t ndx = 0; ndx < 100; ++ndx) {
+      if (model.test(ndx)) {
+        expected.push_back(ndx);
+      }
+    }
+    ASSERT_EQ(SetBits(bits), expected);
+    ASSERT_EQ(bits.find_first(), expected.empty() ? 100 : expected[0]);
+  }
+}
+
+}  // namespace
+}  // namespace test
+}  // namespace mcucore
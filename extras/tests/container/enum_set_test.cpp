@@ -0,0 +1,79 @@
+#include "container/enum_set.h"
+
+#include <vector>
+
+#include "gmock/gmock.h"
+#include "gtest/gtest.h"
+#include "http1/request_decoder_constants.h"
+
+namespace mcucore {
+namespace test {
+namespace {
+
+using ::testing::ElementsAre;
+using ::testing::IsEmpty;
+
+using ::mcucore::http1::EToken;
+using ETokenSet = EnumSet<EToken, EToken::kHeaderValue>;
+
+std::vector<EToken> Members(const ETokenSet& set) {
+  std::vector<EToken> result;
+  set.for_each([&result](EToken token) { result.push_back(token); });
+  return result;
+}
+
+TEST(EnumSetTest, Empty) {
+  ETokenSet set;
+  EXPECT_TRUE(set.empty());
+  EXPECT_EQ(set.count(), 0);
+  EXPECT_FALSE(set.contains(EToken::kHttpMethod));
+  EXPECT_THAT(Members(set), IsEmpty());
+  EXPECT_LE(sizeof set, 4);
+}
+
+TEST(EnumSetTest, InsertAndErase) {
+  ETokenSet seen;
+  seen.insert(EToken::kHeaderName);
+  seen.insert(EToken::kHttpMethod);
+  seen.insert(EToken::kHeaderName);
+  EXPECT_EQ(seen.count(), 2);
+  EXPECT_TRUE(seen.contains(EToken::kHeaderName));
+  EXPECT_THAT(Members(seen),
+              ElementsAre(EToken::kHttpMethod, EToken::kHeaderName));
+  seen.erase(EToken::kHttpMethod);
+  EXPECT_THAT(Members(seen), ElementsAre(EToken::kHeaderName));
+  seen.clear();
+  EXPECT_TRUE(seen.empty());
+}
+
+TEST(EnumSetTest, ConstexprAndSetAlgebra) {
+  constexpr auto kRequired =
+      ETokenSet::Of(EToken::kHttpMethod, EToken::kPathSegment);
+  static_assert(kRequired.contains(EToken::kPathSegment), "");
+  static_assert(!kRequired.contains(EToken::kParamName), "");
+  static_assert(ETokenSet::All().contains(EToken::kHeaderValue), "");
+
+  ETokenSet seen;
+  seen.insert(EToken::kHttpMethod);
+  EXPECT_FALSE(kRequired.IsSubsetOf(seen));
+  EXPECT_THAT(Members(kRequired - seen), ElementsAre(EToken::kPathSegment));
+  seen.insert(EToken::kPathSegment);
+  seen.insert(EToken::kParamName);
+  EXPECT_TRUE(kRequired.IsSubsetOf(seen));
+  EXPECT_EQ(seen & kRequired, kRequired);
+  EXPECT_THAT(Members(seen ^ kRequired), ElementsAre(EToken::kParamName));
+  EXPECT_EQ((~seen).count(), 3);
+  EXPECT_EQ(seen | ~seen, ETokenSet::All());
+
+  seen -= kRequired;
+  EXPECT_EQ(seen, ETokenSet::Of(EToken::kParamName));
+  seen |= kRequired;
+  EXPECT_EQ(seen.count(), 3);
+  seen &= kRequired;
+  EXPECT_EQ(seen, kRequired);
+  EXPECT_NE(seen, ETokenSet());
+}
+
+}  // namespace
+}  // namespace test
+}  // namespace mcucore
@@ -0,0 +1,218 @@
+#include "container/flat_hash_map.h"
+
+#include <map>
+
+#include "absl/random/random.h"
+#include "extras/test_tools/status_test_utils.h"
+#include "gmock/gmock.h"
+#include "gtest/gtest.h"
+#include "status/status.h"
+#include "status/status_code.h"
+
+namespace mcucore {
+namespace test {
+namespace {
+
+// Sends all keys with the same value mod 4 to the same home slot, so that
+// there are many collisions.
+struct CollidingHasher {
+  constexpr uint32_t operator()(const int& key) const {
+    return static_cast<uint32_t>(key) & 3;
+  }
+};
+
+enum class EColor : uint8_t { kRed, kGreen, kBlue, kCyan, kMagenta, kYellow };
+
+template <typename MAP>
+void ExpectMatchesModel(const MAP& map, const std::map<int, int>& model) {
+  EXPECT_EQ(map.size(), model.size());
+  for (const auto& [key, value] : model) {
+    auto* found = map.Find(key);
+    ASSERT_NE(found, nullptr) << "key=" << key;
+    EXPECT_EQ(*found, value) << "key=" << key;
+  }
+  size_t count = 0;
+  map.ForEach([&](const int& key, const int& value) {
+    ++count;
+    auto it = model.find(key);
+    ASSERT_NE(it, model.end()) << "key=" << key;
+    EXPECT_EQ(it->second, value);
+  });
+  EXPECT_EQ(count, model.size());
+}
+
+TEST(Fnv1aHasherTest, MatchesFnv1a) {
+  Fnv1a fnv1a;
+  fnv1a.appendByte(0x34);
+  fnv1a.appendByte(0x12);
+  EXPECT_EQ(Fnv1aHasher<uint16_t>()(0x1234), fnv1a.value());
+  static_assert(Fnv1aHasher<uint16_t>()(0x1234) != 0, "Should be constexpr");
+  EXPECT_NE(Fnv1aHasher<EColor>()(EColor::kRed),
+            Fnv1aHasher<EColor>()(EColor::kGreen));
+}
+
+TEST(FlatHashMapTest, Empty) {
+  FlatHashMap<int, int, 8> map;
+  EXPECT_EQ(map.size(), 0);
+  EXPECT_EQ(map.capacity(), 8);
+  EXPECT_TRUE(map.empty());
+  EXPECT_FALSE(map.full());
+  EXPECT_EQ(map.Find(1), nullptr);
+  EXPECT_FALSE(map.Contains(1));
+  EXPECT_FALSE(map.Remove(1));
+}
+
+TEST(FlatHashMapTest, InsertFindRemove) {
+  FlatHashMap<EColor, int, 4> map;
+  EXPECT_THAT(map.Insert(EColor::kRed, 1), IsOk());
+  EXPECT_THAT(map.Insert(EColor::kGreen, 2), IsOk());
+  EXPECT_THAT(map.Insert(EColor::kRed, 3),
+              StatusIs(StatusCode::kAlreadyExists));
+  EXPECT_EQ(map.size(), 2);
+  EXPECT_EQ(*map.Find(EColor::kRed), 1);
+  EXPECT_EQ(*map.Find(EColor::kGreen), 2);
+  EXPECT_EQ(map.Find(EColor::kBlue), nullptr);
+
+  EXPECT_THAT(map.InsertOrAssign(EColor::kRed, 3), IsOk());
+  EXPECT_EQ(*map.Find(EColor::kRed), 3);
+  *map.Find(EColor::kGreen) = 4;
+  EXPECT_EQ(*map.Find(EColor::kGreen), 4);
+
+  EXPECT_THAT(map.Insert(EColor::kBlue, 5), IsOk());
+  EXPECT_THAT(map.Insert(EColor::kCyan, 6), IsOk());
+  EXPECT_TRUE(map.full());
+  EXPECT_THAT(map.Insert(EColor::kMagenta, 7),
+              StatusIs(StatusCode::kResourceExhausted));
+  EXPECT_THAT(map.InsertOrAssign(EColor::kMagenta, 7),
+              StatusIs(StatusCode::kResourceExhausted));
+  // Assigning to an existing key is still possible when full.
+  EXPECT_THAT(map.InsertOrAssign(EColor::kCyan, 8), IsOk());
+  EXPECT_EQ(*map.Find(EColor::kCyan), 8);
+
+  EXPECT_TRUE(map.Remove(EColor::kRed));
+  EXPECT_FALSE(map.Remove(EColor::kRed));
+  EXPECT_EQ(map.size(), 3);
+  EXPECT_THAT(map.Insert(EColor::kMagenta, 7), IsOk());
+  EXPECT_EQ(*map.Find(EColor::kMagenta), 7);
+
+  map.Clear();
+  EXPECT_TRUE(map.empty());
+  EXPECT_FALSE(map.Contains(EColor::kMagenta));
+}
+
+TEST(FlatHashMapTest, CollidingKeys) {
+  // Keys 0, 4, 8 and 12 all have the same home slot, as do 1, 5, 9 and 13.
+  FlatHashMap<int, int, 8, CollidingHasher> map;
+  std::map<int, int> model;
+  for (int key : {0, 4, 1, 8, 5, 12, 9, 13}) {
+    ASSERT_THAT(map.Insert(key, key * 10), IsOk());
+    model[key] = key * 10;
+    ExpectMatchesModel(map, model);
+  }
+  EXPECT_TRUE(map.full());
+  EXPECT_FALSE(map.Contains(16));
+  EXPECT_FALSE(map.Contains(2));
+
+  // Removing entries from the start of a probe sequence must shift back the
+  // following entries, else they won't be found.
+  for (int key : {0, 5, 12, 1, 4, 13, 8, 9}) {
+    ASSERT_TRUE(map.Remove(key));
+    model.erase(key);
+    ExpectMatchesModel(map, model);
+    EXPECT_FALSE(map.Contains(key));
+  }
+  EXPECT_TRUE(map.empty());
+}
+
+TEST(FlatHashMapTest, MatchesStdMap) {
+  absl::BitGen bitgen;
+  FlatHashMap<int, int, 32> map;
+  std::map<int, int> model;
+  for (int i = 0; i < 10000; ++i) {
+    const int key = absl::Uniform<int>(bitgen, 0, 64);
+    const int value = absl::Uniform<int>(bitgen, 0, 1000);
+    switch (absl::Uniform<int>(bitgen, 0, 3)) {
+      case 0:
+        if (model.count(key)) {
+          EXPECT_THAT(map.Insert(key, value),
+                      StatusIs(StatusCode::kAlreadyExists));
+        } else if (model.size() >= map.capacity()) {
+          EXPECT_THAT(map.Insert(key, value),
+                      StatusIs(StatusCode::kResourceExhausted));
+        } else {
+          EXPECT_THAT(map.Insert(key, value), IsOk());
+          model[key] = value;
+        }
+        break;
+      case 1:
+        if (model.count(key) || model.size() < map.capacity()) {
+          EXPECT_THAT(map.InsertOrAssign(key, value), IsOk());
+          model[key] = value;
+        } else {
+          EXPECT_THAT(map.InsertOrAssign(key, value),
+                      StatusIs(StatusCode::kResourceExhausted));
+        }
+        break;
+      case 2:
+        EXPECT_EQ(map.Remove(key), model.erase(key) == 1);
+        break;
+    }
+    ExpectMatchesModel(map, model);
+    if (::testing::Test::HasFailure()) {
+      FAIL() << "i=" << i;
+    }
+  }
+}
+
+struct ColorTable {
+  static constexpr FlatHashMapEntry<EColor, uint8_t> kEntries[] = {
+      {EColor::kRed, 1},
+      {EColor::kGreen, 2},
+      {EColor::kBlue, 3},
+      {EColor::kYellow, 4},
+  };
+};
+constexpr FlatHashMapEntry<EColor, uint8_t> ColorTable::kEntries[];
+
+struct CollidingTable {
+  static constexpr FlatHashMapEntry<int, int> kEntries[] = {
+      {0, 100}, {4, 104}, {1, 101}, {8, 108}, {3, 103}, {7, 107},
+  };
+};
+constexpr FlatHashMapEntry<int, int> CollidingTable::kEntries[];
+
+TEST(ProgmemFlatHashMapTest, FindsEntries) {
+  using ColorMap = ProgmemFlatHashMap<EColor, uint8_t, ColorTable, 4>;
+  EXPECT_EQ(ColorMap::size(), 4);
+  EXPECT_EQ(ColorMap::capacity(), 4);
+  uint8_t value = 0;
+  EXPECT_TRUE(ColorMap::Find(EColor::kRed, value));
+  EXPECT_EQ(value, 1);
+  EXPECT_TRUE(ColorMap::Find(EColor::kGreen, value));
+  EXPECT_EQ(value, 2);
+  EXPECT_TRUE(ColorMap::Find(EColor::kBlue, value));
+  EXPECT_EQ(value, 3);
+  EXPECT_TRUE(ColorMap::Find(EColor::kYellow, value));
+  EXPECT_EQ(value, 4);
+  // The table is full, so a missing key requires probing every slot.
+  EXPECT_FALSE(ColorMap::Find(EColor::kCyan, value));
+  EXPECT_FALSE(ColorMap::Contains(EColor::kMagenta));
+  EXPECT_TRUE(ColorMap::Contains(EColor::kYellow));
+}
+
+TEST(ProgmemFlatHashMapTest, CollidingKeys) {
+  using Map = ProgmemFlatHashMap<int, int, CollidingTable, 8, CollidingHasher>;
+  EXPECT_EQ(Map::size(), 6);
+  for (const auto& entry : CollidingTable::kEntries) {
+    int value = 0;
+    EXPECT_TRUE(Map::Find(entry.key, value)) << entry.key;
+    EXPECT_EQ(value, entry.value);
+  }
+  for (int key : {2, 5, 6, 9, 12, 16}) {
+    EXPECT_FALSE(Map::Contains(key)) << key;
+  }
+}
+
+}  // namespace
+}  // namespace test
+}  // namespace mcucore
@@ -0,0 +1,157 @@
+#include "container/flat_map.h"
+
+#include <stdint.h>
+
+#include <map>
+#include <vector>
+
+#include "absl/random/random.h"
+#include "extras/test_tools/status_test_utils.h"
+#include "gmock/gmock.h"
+#include "gtest/gtest.h"
+#include "mcucore_platform.h"
+#include "status/status_code.h"
+
+namespace mcucore {
+namespace test {
+namespace {
+
+using ::testing::ElementsAre;
+
+template <typename MAP>
+std::vector<int> Keys(const MAP& map) {
+  std::vector<int> keys;
+  for (size_t ndx = 0; ndx < map.size(); ++ndx) {
+    keys.push_back(map.key_at(ndx));
+  }
+  return keys;
+}
+
+TEST(FlatMapTest, Empty) {
+  FlatMap<int, int, 4> map;
+  EXPECT_EQ(map.size(), 0);
+  EXPECT_EQ(map.capacity(), 4);
+  EXPECT_TRUE(map.empty());
+  EXPECT_FALSE(map.full());
+  EXPECT_EQ(map.lower_bound(1), 0);
+  EXPECT_EQ(map.Find(1), nullptr);
+  EXPECT_FALSE(map.Remove(1));
+}
+
+TEST(FlatMapTest, InsertSorted) {
+  FlatMap<int, char, 5> map;
+  EXPECT_THAT(map.InsertSorted(5, 'e'), IsOk());
+  EXPECT_THAT(map.InsertSorted(1, 'a'), IsOk());
+  EXPECT_THAT(map.InsertSorted(9, 'i'), IsOk());
+  EXPECT_THAT(map.InsertSorted(3, 'c'), IsOk());
+  EXPECT_THAT(map.InsertSorted(3, 'x'), StatusIs(StatusCode::kAlreadyExists));
+  EXPECT_THAT(Keys(map), ElementsAre(1, 3, 5, 9));
+  EXPECT_EQ(map.lower_bound(0), 0);
+  EXPECT_EQ(map.lower_bound(3), 1);
+  EXPECT_EQ(map.lower_bound(4), 2);
+  EXPECT_EQ(map.lower_bound(10), 4);
+  EXPECT_EQ(*map.Find(3), 'c');
+  EXPECT_EQ(*map.Find(9), 'i');
+  EXPECT_EQ(map.Find(4), nullptr);
+  EXPECT_TRUE(map.Contains(1));
+
+  EXPECT_THAT(map.InsertSorted(7, 'g'), IsOk());
+  EXPECT_TRUE(map.full());
+  EXPECT_THAT(map.InsertSorted(2, 'b'),
+              StatusIs(StatusCode::kResourceExhausted));
+  EXPECT_THAT(Keys(map), ElementsAre(1, 3, 5, 7, 9));
+
+  EXPECT_TRUE(map.Remove(1));
+  EXPECT_TRUE(map.Remove(7));
+  EXPECT_FALSE(map.Remove(7));
+  EXPECT_THAT(Keys(map), ElementsAre(3, 5, 9));
+  EXPECT_EQ(map.value_at(2), 'i');
+  *map.Find(5) = 'E';
+  EXPECT_EQ(map.value_at(1), 'E');
+}
+
+TEST(FlatMapTest, BuildFromUnsorted) {
+  const int kKeys[] = {8, 2, 6, 4};
+  const char kValues[] = {'h', 'b', 'f', 'd'};
+  FlatMap<int, char, 4> map;
+  EXPECT_THAT(map.BuildFromUnsorted(kKeys, kValues), IsOk());
+  EXPECT_THAT(Keys(map), ElementsAre(2, 4, 6, 8));
+  EXPECT_EQ(*map.Find(2), 'b');
+  EXPECT_EQ(*map.Find(8), 'h');
+
+  const int kDuplicateKeys[] = {1, 2, 1};
+  const char kThreeValues[] = {'a', 'b', 'c'};
+  EXPECT_THAT(map.BuildFromUnsorted(kDuplicateKeys, kThreeValues),
+              StatusIs(StatusCode::kInvalidArgument));
+  EXPECT_TRUE(map.empty());
+
+  FlatMap<int, char, 2> small_map;
+  EXPECT_THAT(small_map.BuildFromUnsorted(kKeys, kValues),
+              StatusIs(StatusCode::kResourceExhausted));
+}
+
+// Checks both the insertion sort and heapsort paths against std::map.
+TEST(FlatMapTest, BuildFromUnsortedMatchesStdMap) {
+  absl::BitGen bitgen;
+  for (size_t count : {0, 1, 2, 5, 16, 17, 30, 100, 200}) {
+    std::map<uint16_t, uint32_t> model;
+    while (model.size() < count) {
+      model[absl::Uniform<uint16_t>(bitgen)] = absl::Uniform<uint32_t>(bitgen);
+    }
+    std::vector<uint16_t> keys;
+    std::vector<uint32_t> values;
+    for (const auto& [key, value] : model) {
+      keys.push_back(key);
+      values.push_back(value);
+    }
+    // Shuffle the entries, keeping the keys and values paired.
+    for (size_t ndx = count; ndx > 1; --ndx) {
+      const size_t other = absl::Uniform<size_t>(bitgen, 0, ndx);
+      std::swap(keys[ndx - 1], keys[other]);
+      std::swap(values[ndx - 1], values[other]);
+    }
+    FlatMap<uint16_t, uint32_t, 200> map;
+    ASSERT_THAT(map.BuildFromUnsorted(keys.data(), values.data(), count),
+                IsOk());
+    ASSERT_EQ(map.size(), count);
+    size_t ndx = 0;
+    for (const auto& [key, value] : model) {
+      EXPECT_EQ(map.key_at(ndx), key);
+      EXPECT_EQ(map.value_at(ndx), value);
+      ++ndx;
+    }
+  }
+}
+
+constexpr uint8_t kProgmemKeys[] AVR_PROGMEM = {1, 7, 9, 20, 21};
+constexpr int16_t kProgmemValues[] AVR_PROGMEM = {-1, 700, 9, 2000, -21};
+static_assert(IsStrictlySorted(kProgmemKeys), "kProgmemKeys must be sorted");
+
+constexpr int kUnsortedKeys[] = {1, 3, 3};
+static_assert(!IsStrictlySorted(kUnsortedKeys), "Duplicates are not sorted");
+
+TEST(ProgmemFlatMapTest, Find) {
+  const ProgmemFlatMap<uint8_t, int16_t> map(kProgmemKeys, kProgmemValues);
+  EXPECT_EQ(map.size(), 5);
+  EXPECT_FALSE(map.empty());
+  int16_t value = 0;
+  EXPECT_TRUE(map.Find(7, value));
+  EXPECT_EQ(value, 700);
+  EXPECT_TRUE(map.Find(21, value));
+  EXPECT_EQ(value, -21);
+  EXPECT_TRUE(map.Find(1, value));
+  EXPECT_EQ(value, -1);
+  EXPECT_FALSE(map.Find(0, value));
+  EXPECT_FALSE(map.Find(8, value));
+  EXPECT_FALSE(map.Find(22, value));
+  EXPECT_EQ(value, -1);
+  EXPECT_TRUE(map.Contains(20));
+  EXPECT_FALSE(map.Contains(19));
+  EXPECT_EQ(map.lower_bound(8), 2);
+  EXPECT_EQ(map.key_at(3), 20);
+  EXPECT_EQ(map.value_at(3), 2000);
+}
+
+}  // namespace
+}  // namespace test
+}  // namespace mcucore
@@ -0,0 +1,157 @@
+#include "container/intrusive_heap.h"
+
+#include <set>
+#include <utility>
+#include <vector>
+
+#include "absl/random/random.h"
+#include "gmock/gmock.h"
+#include "gtest/gtest.h"
+
+namespace mcucore {
+namespace test {
+namespace {
+
+struct Timer {
+  bool operator<(const Timer& other) const { return deadline < other.deadline; }
+
+  int deadline;
+  IntrusiveHeapIndex heap_index;
+};
+
+using TimerHeap = IntrusiveHeap<Timer, &Timer::heap_index, 8>;
+
+struct Later {
+  bool operator()(const Timer& a, const Timer& b) const {
+    return a.deadline > b.deadline;
+  }
+};
+
+TEST(IntrusiveHeapTest, Empty) {
+  TimerHeap heap;
+  EXPECT_TRUE(heap.empty());
+  EXPECT_FALSE(heap.full());
+  EXPECT_EQ(heap.size(), 0);
+  EXPECT_EQ(heap.max_size(), 8);
+  EXPECT_EQ(heap.top(), nullptr);
+  EXPECT_EQ(heap.Pop(), nullptr);
+}
+
+TEST(IntrusiveHeapTest, PopsInOrder) {
+  Timer timers[] = {{50, {}}, {10, {}}, {40, {}}, {20, {}}, {30, {}}};
+  TimerHeap heap;
+  for (auto& timer : timers) {
+    EXPECT_FALSE(timer.heap_index.in_heap());
+    EXPECT_TRUE(heap.Push(timer));
+    EXPECT_TRUE(heap.Contains(timer));
+  }
+  EXPECT_EQ(heap.size(), 5);
+  std::vector<int> deadlines;
+  while (Timer* timer = heap.Pop()) {
+    EXPECT_FALSE(timer->heap_index.in_heap());
+    deadlines.push_back(timer->deadline);
+  }
+  EXPECT_THAT(deadlines, ::testing::ElementsAre(10, 20, 30, 40, 50));
+}
+
+TEST(IntrusiveHeapTest, UpdateAndRemove) {
+  Timer a{10, {}}, b{20, {}}, c{30, {}};
+  TimerHeap heap;
+  heap.Push(a);
+  heap.Push(b);
+  heap.Push(c);
+  EXPECT_EQ(heap.top(), &a);
+
+  // Decrease key.
+  c.deadline = 5;
+  heap.Update(c);
+  EXPECT_EQ(heap.top(), &c);
+
+  // Increase key.
+  c.deadline = 25;
+  heap.Update(c);
+  EXPECT_EQ(heap.top(), &a);
+
+  heap.Remove(a);
+  EXPECT_FALSE(heap.Contains(a));
+  EXPECT_EQ(heap.Pop(), &b);
+  EXPECT_EQ(heap.Pop(), &c);
+  EXPECT_TRUE(heap.empty());
+}
+
+TEST(IntrusiveHeapTest, FullAndClear) {
+  Timer timers[9] = {};
+  TimerHeap heap;
+  for (int i = 0; i < 8; ++i) {
+    timers[i].deadline = i;
+    EXPECT_TRUE(heap.Push(timers[i]));
+  }
+  EXPECT_TRUE(heap.full());
+  EXPECT_FALSE(heap.Push(timers[8]));
+  EXPECT_FALSE(timers[8].heap_index.in_heap());
+
+  int count = 0;
+  heap.ForEach([&count](Timer& timer) { ++count; });
+  EXPECT_EQ(count, 8);
+
+  heap.Clear();
+  EXPECT_TRUE(heap.empty());
+  for (const auto& timer : timers) {
+    EXPECT_FALSE(timer.heap_index.in_heap());
+  }
+}
+
+TEST(IntrusiveHeapTest, CustomCompare) {
+  Timer a{10, {}}, b{20, {}};
+  IntrusiveHeap<Timer, &Timer::heap_index, 4, Later> heap;
+  heap.Push(a);
+  heap.Push(b);
+  EXPECT_EQ(heap.Pop(), &b);
+  EXPECT_EQ(heap.Pop(), &a);
+}
+
+TEST(IntrusiveHeapTest, MatchesStdSet) {
+  constexpr int kNumTimers = 100;
+  std::vector<Timer> timers(kNumTimers);
+  IntrusiveHeap<Timer, &Timer::heap_index, 254> heap;
+  // Ordered by deadline, then by index to handle equal deadlines.
+  std::set<std::pair<int, int>> model;
+  absl::BitGen bitgen;
+  for (int i = 0; i < 5000; ++i) {
+    const int ndx = absl::Uniform<int>(bitgen, 0, kNumTimers);
+    Timer& timer = timers[ndx];
+    const int new_deadline = absl::Uniform<int>(bitgen, 0, 1000);
+    if (!heap.Contains(timer)) {
+      timer.deadline = new_deadline;
+      ASSERT_TRUE(heap.Push(timer));
+      model.insert({timer.deadline, ndx});
+    } else if (absl::Bernoulli(bitgen, 0.3)) {
+      heap.Remove(timer);
+      model.erase({timer.deadline, ndx});
+    } else if (absl::Bernoulli(bitgen, 0.6)) {
+      model.erase({timer.deadline, ndx});
+      timer.deadline = new_deadline;
+      heap.Update(timer);
+      model.insert({timer.deadline, ndx});
+    } else {
+      Timer* top = heap.Pop();
+      ASSERT_NE(top, nullptr);
+      ASSERT_EQ(top->deadline, model.begin()->first);
+      model.erase({top->deadline, static_cast<int>(top - timers.data())});
+    }
+    ASSERT_EQ(heap.size(), model.size());
+    if (!model.empty()) {
+      ASSERT_EQ(heap.top()->deadline, model.begin()->first);
+    }
+  }
+}
+
+TEST(IntrusiveHeapDeathTest, RemoveNotInHeap) {
+  Timer a{10, {}};
+  TimerHeap heap;
+  EXPECT_DEBUG_DEATH(heap.Remove(a), "Not in heap");
+}
+
+}  // namespace
+}  // namespace test
+}  // namespace mcucore
@@ -0,0 +1,173 @@
+#include "container/intrusive_list.h"
+
+#include <list>
+#include <vector>
+
+#include "absl/random/random.h"
+#include "gmock/gmock.h"
+#include "gtest/gtest.h"
+
+namespace mcucore {
+namespace test {
+namespace {
+
+using ::testing::ElementsAre;
+using ::testing::IsEmpty;
+
+struct Item {
+  explicit Item(int v) : value(v) {}
+
+  int value;
+  IntrusiveListNode node;
+  IntrusiveListNode other_node;
+};
+
+using ItemList = IntrusiveList<Item, &Item::node>;
+using OtherItemList = IntrusiveList<Item, &Item::other_node>;
+
+template <typename LIST>
+std::vector<int> Values(const LIST& list) {
+  std::vector<int> result;
+  list.ForEach([&result](Item& item) { result.push_back(item.value); });
+  // Walking backwards should produce the same values, reversed.
+  std::vector<int> reversed;
+  for (Item* item = list.back(); item != nullptr; item = list.Prev(*item)) {
+    reversed.insert(reversed.begin(), item->value);
+  }
+  EXPECT_EQ(result, reversed);
+  EXPECT_EQ(result.size(), list.size());
+  return result;
+}
+
+TEST(IntrusiveListTest, Empty) {
+  ItemList list;
+  EXPECT_TRUE(list.empty());
+  EXPECT_EQ(list.size(), 0);
+  EXPECT_EQ(list.front(), nullptr);
+  EXPECT_EQ(list.back(), nullptr);
+  EXPECT_EQ(list.PopFront(), nullptr);
+  EXPECT_EQ(list.PopBack(), nullptr);
+  EXPECT_THAT(Values(list), IsEmpty());
+}
+
+TEST(IntrusiveListTest, PushPopAndRemove) {
+  Item a(1), b(2), c(3), d(4);
+  ItemList list;
+  list.PushBack(b);
+  list.PushFront(a);
+  list.PushBack(d);
+  list.InsertAfter(b, c);
+  EXPECT_TRUE(c.node.linked());
+  EXPECT_THAT(Values(list), ElementsAre(1, 2, 3, 4));
+  EXPECT_EQ(list.front(), &a);
+  EXPECT_EQ(list.back(), &d);
+  EXPECT_EQ(list.Next(b), &c);
+  EXPECT_EQ(list.Next(d), nullptr);
+  EXPECT_EQ(list.Prev(a), nullptr);
+
+  list.Remove(c);
+  EXPECT_FALSE(c.node.linked());
+  EXPECT_THAT(Values(list), ElementsAre(1, 2, 4));
+  EXPECT_EQ(list.PopFront(), &a);
+  EXPECT_EQ(list.PopBack(), &d);
+  EXPECT_THAT(Values(list), ElementsAre(2));
+  list.Clear();
+  EXPECT_TRUE(list.empty());
+  EXPECT_FALSE(b.node.linked());
+}
+
+TEST(IntrusiveListTest, LeastRecentlyUsed) {
+  Item a(1), b(2), c(3);
+  ItemList lru;
+  lru.PushBack(a);
+  lru.PushBack(b);
+  lru.PushBack(c);
+  lru.MoveToBack(a);
+  EXPECT_THAT(Values(lru), ElementsAre(2, 3, 1));
+  lru.MoveToFront(c);
+  EXPECT_THAT(Values(lru), ElementsAre(3, 2, 1));
+  lru.MoveToBack(a);  // Already at the back.
+  EXPECT_THAT(Values(lru), ElementsAre(3, 2, 1));
+}
+
+TEST(IntrusiveListTest, InTwoLists) {
+  Item a(1), b(2), c(3);
+  ItemList list;
+  OtherItemList other;
+  list.PushBack(a);
+  list.PushBack(b);
+  other.PushBack(c);
+  other.PushBack(a);
+  EXPECT_THAT(Values(list), ElementsAre(1, 2));
+  EXPECT_THAT(Values(other), ElementsAre(3, 1));
+  other.Remove(a);
+  EXPECT_TRUE(a.node.linked());
+  EXPECT_FALSE(a.other_node.linked());
+  EXPECT_THAT(Values(list), ElementsAre(1, 2));
+}
+
+TEST(IntrusiveListTest, RemoveDuringForEach) {
+  Item a(1), b(2), c(3), d(4);
+  ItemList list;
+  for (Item* item : {&a, &b, &c, &d}) {
+    list.PushBack(*item);
+  }
+  list.ForEach([&list](Item& item) {
+    if (item.value % 2 == 0) {
+      list.Remove(item);
+    }
+  });
+  EXPECT_THAT(Values(list), ElementsAre(1, 3));
+}
+
+TEST(IntrusiveListTest, DestructorUnlinks) {
+  Item a(1);
+  {
+    ItemList list;
+    list.PushBack(a);
+  }
+  EXPECT_FALSE(a.node.linked());
+  const Item copy = a;
+  EXPECT_FALSE(copy.node.linked());
+}
+
+TEST(IntrusiveListTest, MatchesStdList) {
+  std::vector<Item> items;
+  for (int i = 0; i < 20; ++i) {
+    items.emplace_back(i);
+  }
+  ItemList list;
+  std::list<int> model;
+  absl::BitGen bitgen;
+  for (int i = 0; i < 2000; ++i) {
+    Item& item = items[absl::Uniform<size_t>(bitgen, 0, items.size())];
+    if (item.node.linked()) {
+      if (absl::Bernoulli(bitgen, 0.5)) {
+        list.Remove(item);
+        model.remove(item.value);
+      } else {
+        list.MoveToFront(item);
+        model.remove(item.value);
+        model.push_front(item.value);
+      }
+    } else if (absl::Bernoulli(bitgen, 0.5)) {
+      list.PushBack(item);
+      model.push_back(item.value);
+    } else {
+      list.PushFront(item);
+      model.push_front(item.value);
+    }
+    ASSERT_EQ(Values(list), std::vector<int>(model.begin(), model.end()));
+  }
+}
+
+TEST(IntrusiveListDeathTest, DoubleInsert) {
+  Item a(1);
+  ItemList list;
+  list.PushBack(a);
+  EXPECT_DEBUG_DEATH(list.PushBack(a), "Already in a list");
+}
+
+}  // namespace
+}  // namespace test
+}  // namespace mcucore
@@ -0,0 +1,92 @@
+#include "container/link_time_table.h"
+
+#include <algorithm>
+#include <string>
+#include <type_traits>
+#include <vector>
+
+#include "gmock/gmock.h"
+#include "gtest/gtest.h"
+
+namespace mcucore {
+namespace test {
+
+struct Handler {
+  int id;
+  const char* name;
+  int (*fn)(int);
+};
+
+MCU_DECLARE_TABLE(TestHandlers, Handler);
+MCU_DECLARE_TABLE(TestNumbers, int);
+MCU_DECLARE_TABLE(EmptyTable, int);
+
+MCU_DEFINE_TABLE(TestHandlers);
+MCU_DEFINE_TABLE(TestNumbers);
+MCU_DEFINE_TABLE(EmptyTable);
+
+namespace {
+
+int Double(int v) { return v * 2; }
+int Square(int v) { return v * v; }
+
+MCU_REGISTER_IN_TABLE(TestHandlers, {2, "square", &Square});
+MCU_REGISTER_IN_TABLE(TestNumbers, 7);
+
+}  // namespace
+
+// Registration in a different namespace, as if in another source file.
+namespace other {
+
+int Negate(int v) { return -v; }
+
+MCU_REGISTER_IN_TABLE(TestHandlers, {3, "negate", &Negate});
+MCU_REGISTER_IN_TABLE(TestHandlers, {1, "double", &Double});
+MCU_REGISTER_IN_TABLE(TestNumbers, 11);
+
+}  // namespace other
+
+namespace {
+
+using ::testing::ElementsAre;
+using ::testing::UnorderedElementsAre;
+
+TEST(LinkTimeTableTest, ElementsFromSeveralPlaces) {
+  const auto handlers = TestHandlers::Elements();
+  ASSERT_EQ(handlers.size(), 3);
+  std::vector<Handler> sorted(handlers.begin(), handlers.end());
+  std::sort(sorted.begin(), sorted.end(),
+            [](const Handler& a, const Handler& b) { return a.id < b.id; });
+  EXPECT_EQ(sorted[0].id, 1);
+  EXPECT_EQ(std::string(sorted[0].name), "double");
+  EXPECT_EQ(sorted[0].fn(5), 10);
+  EXPECT_EQ(sorted[1].id, 2);
+  EXPECT_EQ(std::string(sorted[1].name), "square");
+  EXPECT_EQ(sorted[1].fn(5), 25);
+  EXPECT_EQ(sorted[2].id, 3);
+  EXPECT_EQ(std::string(sorted[2].name), "negate");
+  EXPECT_EQ(sorted[2].fn(5), -5);
+}
+
+TEST(LinkTimeTableTest, TablesAreSeparate) {
+  std::vector<int> numbers(TestNumbers::Elements().begin(),
+                           TestNumbers::Elements().end());
+  EXPECT_THAT(numbers, UnorderedElementsAre(7, 11));
+}
+
+TEST(LinkTimeTableTest, SameRangeTypeOnAllPlatforms) {
+  static_assert(std::is_same<decltype(TestNumbers::Elements()),
+                             TableElements<int>>::value);
+  EXPECT_FALSE(TestNumbers::Elements().empty());
+  EXPECT_EQ(TestNumbers::Elements().size(), 2);
+}
+
+TEST(LinkTimeTableTest, EmptyTable) {
+  EXPECT_TRUE(EmptyTable::Elements().empty());
+  EXPECT_EQ(EmptyTable::Elements().size(), 0);
+  EXPECT_EQ(EmptyTable::Elements().begin(), EmptyTable::Elements().end());
+}
+
+}  // namespace
+}  // namespace test
+}  // namespace mcucore
@@ -0,0 +1,134 @@
+#include "container/object_pool.h"
+
+#include <vector>
+
+#include "gmock/gmock.h"
+#include "gtest/gtest.h"
+
+namespace mcucore {
+namespace test {
+namespace {
+
+using ::testing::ElementsAre;
+using ::testing::IsEmpty;
+
+class Connection {
+ public:
+  Connection(int id, int* num_live) : id_(id), num_live_(num_live) {
+    ++*num_live_;
+  }
+  ~Connection() { --*num_live_; }
+
+  int id() const { return id_; }
+
+ private:
+  int id_;
+  int* num_live_;
+};
+
+template <typename POOL>
+std::vector<int> LiveIds(POOL& pool) {
+  std::vector<int> ids;
+  pool.ForEach([&ids](const Connection& conn) { ids.push_back(conn.id()); });
+  return ids;
+}
+
+TEST(ObjectPoolTest, Empty) {
+  ObjectPool<Connection, 3> pool;
+  EXPECT_EQ(pool.size(), 0);
+  EXPECT_EQ(pool.capacity(), 3);
+  EXPECT_EQ(pool.available(), 3);
+  EXPECT_TRUE(pool.empty());
+  EXPECT_FALSE(pool.full());
+  EXPECT_THAT(LiveIds(pool), IsEmpty());
+}
+
+TEST(ObjectPoolTest, AcquireAndRelease) {
+  int num_live = 0;
+  ObjectPool<Connection, 3> pool;
+  Connection* a = pool.Acquire(1, &num_live);
+  Connection* b = pool.Acquire(2, &num_live);
+  Connection* c = pool.Acquire(3, &num_live);
+  ASSERT_NE(a, nullptr);
+  ASSERT_NE(b, nullptr);
+  ASSERT_NE(c, nullptr);
+  EXPECT_EQ(num_live, 3);
+  EXPECT_TRUE(pool.full());
+  EXPECT_EQ(pool.Acquire(4, &num_live), nullptr);
+  EXPECT_EQ(num_live, 3);
+  EXPECT_THAT(LiveIds(pool), ElementsAre(1, 2, 3));
+  EXPECT_TRUE(pool.Contains(b));
+
+  pool.Release(b);
+  EXPECT_EQ(num_live, 2);
+  EXPECT_EQ(pool.size(), 2);
+  EXPECT_FALSE(pool.Contains(b));
+  EXPECT_THAT(LiveIds(pool), ElementsAre(1, 3));
+
+  // The most recently released slot is reused first.
+  Connection* d = pool.Acquire(4, &num_live);
+  EXPECT_EQ(d, b);
+  EXPECT_THAT(LiveIds(pool), ElementsAre(1, 4, 3));
+
+  pool.Release(a);
+  pool.Release(c);
+  EXPECT_THAT(LiveIds(pool), ElementsAre(4));
+  EXPECT_EQ(pool.high_water_mark(), 3);
+  EXPECT_EQ(num_live, 1);
+}
+
+TEST(ObjectPoolTest, DestructorDestroysLiveObjects) {
+  int num_live = 0;
+  {
+    ObjectPool<Connection, 4> pool;
+    pool.Acquire(1, &num_live);
+    pool.Release(pool.Acquire(2, &num_live));
+    pool.Acquire(3, &num_live);
+    EXPECT_EQ(num_live, 2);
+  }
+  EXPECT_EQ(num_live, 0);
+}
+
+TEST(ObjectPoolTest, ManySlots) {
+  // Enough slots for several bytes of bitmap.
+  ObjectPool<uint32_t, 20> pool;
+  uint32_t* ptrs[20];
+  for (uint32_t i = 0; i < 20; ++i) {
+    ptrs[i] = pool.Acquire(i);
+    ASSERT_NE(ptrs[i], nullptr);
+  }
+  EXPECT_EQ(pool.Acquire(99u), nullptr);
+  for (uint32_t i = 0; i < 20; i += 3) {
+    pool.Release(ptrs[i]);
+  }
+  std::vector<uint32_t> values;
+  pool.ForEach([&values](uint32_t& value) { values.push_back(value); });
+  EXPECT_THAT(values, ElementsAre(1, 2, 4, 5, 7, 8, 10, 11, 13, 14, 16, 17,
+                                  19));
+  // Releasing from within ForEach.
+  pool.ForEach([&pool](uint32_t& value) {
+    if (value % 2 == 0) {
+      pool.Release(&value);
+    }
+  });
+  values.clear();
+  pool.ForEach([&values](uint32_t& value) { values.push_back(value); });
+  EXPECT_THAT(values, ElementsAre(1, 5, 7, 11, 13, 17, 19));
+  EXPECT_EQ(pool.size(), 7);
+
+  uint32_t not_in_pool = 0;
+  EXPECT_FALSE(pool.Contains(&not_in_pool));
+}
+
+TEST(ObjectPoolDeathTest, DoubleRelease) {
+  ObjectPool<int, 2> pool;
+  int* ptr = pool.Acquire(1);
+  pool.Release(ptr);
+  EXPECT_DEBUG_DEATH(pool.Release(ptr), "Double release");
+  // In an optimized build the second release is ignored.
+  EXPECT_EQ(pool.size(), 0);
+}
+
+}  // namespace
+}  // namespace test
+}  // namespace mcucore
@@ -1,11 +1,14 @@
 #include "container/serial_map.h"
 
 #include <algorithm>
+#include <map>
 #include <ostream>
 #include <string>
 #include <string_view>
 #include <vector>
 
+#include "absl/random/random.h"
+
 #include "extras/test_tools/print_value_to_std_string.h"
 #include "extras/test_tools/status_or_test_utils.h"
 #include "extras/test_tools/status_test_utils.h"
@@ -61,8 +64,9 @@ bool ContainsKey(const C& collection, const KEY key) {
 
 // Returns a vector, rather than a set or unordered_set, so that we only require
 // operator==, not operator< nor a hash function.
-template <typename KEY, size_t SIZE>
-std::vector<KEY> KeysInSerialMap(const SerialMap<KEY, SIZE>& serial_map) {
+template <typename KEY, size_t SIZE, size_t INDEX_SIZE>
+std::vector<KEY> KeysInSerialMap(
+    const SerialMap<KEY, SIZE, INDEX_SIZE>& serial_map) {
   std::vector<KEY> keys;
   auto* entry = serial_map.First();
   while (entry != nullptr) {
@@ -427,6 +431,77 @@ TEST(SerialMapTest, Full) {
               StatusIs(StatusCode::kResourceExhausted, "Map too full"));
 }
 
+TEST(SerialMapTest, IndexFull) {
+  SerialMap<ProgmemString, 128, 2> serial_map;
+  EXPECT_STATUS_OK(serial_map.Insert<int>(MCU_PSD("key1"), 1));
+  EXPECT_STATUS_OK(serial_map.Insert<int>(MCU_PSD("key2"), 2));
+  EXPECT_THAT(serial_map.Insert<int>(MCU_PSD("key3"), 3),
+              StatusIs(StatusCode::kResourceExhausted, "Map index full"));
+  EXPECT_EQ(serial_map.Find(MCU_PSD("key3")), nullptr);
+
+  // Replacing the value of an existing key doesn't need another index slot,
+  // even if the entry has to be moved.
+  EXPECT_STATUS_OK(serial_map.InsertOrAssign<int>(MCU_PSD("key1"), 11));
+  EXPECT_STATUS_OK(serial_map.InsertOrAssign<double>(MCU_PSD("key2"), 22));
+  EXPECT_THAT(serial_map.GetValue<int>(MCU_PSD("key1")), IsOkAndHolds(11));
+  EXPECT_THAT(serial_map.GetValue<double>(MCU_PSD("key2")), IsOkAndHolds(22));
+
+  EXPECT_TRUE(serial_map.Remove(MCU_PSD("key1")));
+  EXPECT_STATUS_OK(serial_map.Insert<int>(MCU_PSD("key3"), 3));
+  EXPECT_THAT(KeysInSerialMap(serial_map),
+              ElementsAre(MCU_PSD("key2"), MCU_PSD("key3")));
+}
+
+TEST(SerialMapTest, IndexedMapMatchesUnindexedMap) {
+  // Perform a random sequence of operations on an indexed and an unindexed map,
+  // with a std::map as the model of the expected contents, thus exercising the
+  // maintenance of the index as entries are moved by RemoveEntry.
+  SerialMap<uint16_t, 1000> unindexed_map;
+  SerialMap<uint16_t, 1000, 40> indexed_map;
+  std::map<uint16_t, std::string> expected_contents;
+  absl::BitGen bitgen;
+
+  auto verify_contents = [&]() {
+    for (uint16_t key = 0; key < 50; ++key) {
+      auto iter = expected_contents.find(key);
+      if (iter == expected_contents.end()) {
+        ASSERT_EQ(unindexed_map.Find(key), nullptr);
+        ASSERT_EQ(indexed_map.Find(key), nullptr);
+      } else {
+        ASSERT_THAT(unindexed_map.GetValue<StringView>(key),
+                    IsOkAndHolds(iter->second));
+        ASSERT_THAT(indexed_map.GetValue<StringView>(key),
+                    IsOkAndHolds(iter->second));
+      }
+    }
+    ASSERT_EQ(KeysInSerialMap(indexed_map), KeysInSerialMap(unindexed_map));
+  };
+
+  for (int i = 0; i < 2000 && !TestHasFailed(); ++i) {
+    const uint16_t key = absl::Uniform<uint16_t>(bitgen, 0, 50);
+    const std::string value(absl::Uniform<size_t>(bitgen, 0, 5),
+                            'a' + (i % 26));
+    if (absl::Bernoulli(bitgen, 0.3)) {
+      const bool expected = expected_contents.erase(key) > 0;
+      EXPECT_EQ(unindexed_map.Remove(key), expected);
+      EXPECT_EQ(indexed_map.Remove(key), expected);
+    } else if (expected_contents.size() < 40 ||
+               expected_contents.count(key) > 0) {
+      expected_contents[key] = value;
+      EXPECT_STATUS_OK(
+          InsertOrAssignStdStringView(unindexed_map, key, value));
+      EXPECT_STATUS_OK(InsertOrAssignStdStringView(indexed_map, key, value));
+    } else {
+      EXPECT_STATUS_OK(
+          InsertOrAssignStdStringView(unindexed_map, key, value));
+      EXPECT_THAT(InsertOrAssignStdStringView(indexed_map, key, value),
+                  StatusIs(StatusCode::kResourceExhausted));
+      EXPECT_TRUE(unindexed_map.Remove(key));
+    }
+    verify_contents();
+  }
+}
+
 }  // namespace
 }  // namespace test
 }  // namespace mcucore
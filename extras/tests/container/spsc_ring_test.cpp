@@ -0,0 +1,175 @@
+#include "container/spsc_ring.h"
+
+#include <stdint.h>
+
+#include <thread>  // NOLINT
+#include <vector>
+
+#include "container/array_view.h"
+#include "gmock/gmock.h"
+#include "gtest/gtest.h"
+
+namespace mcucore {
+namespace test {
+namespace {
+
+using ::testing::ElementsAre;
+
+template <typename T>
+std::vector<T> ToVector(const ArrayView<const T>& view) {
+  return std::vector<T>(view.begin(), view.end());
+}
+
+TEST(SpscRingTest, Empty) {
+  SpscRing<int, 4> ring;
+  EXPECT_EQ(ring.capacity(), 4);
+  EXPECT_EQ(ring.size(), 0);
+  EXPECT_TRUE(ring.empty());
+  EXPECT_FALSE(ring.full());
+  int value = -1;
+  EXPECT_FALSE(ring.Pop(value));
+  EXPECT_EQ(value, -1);
+  EXPECT_EQ(ring.PeekContiguous().size(), 0);
+}
+
+TEST(SpscRingTest, PushAndPop) {
+  SpscRing<int, 4> ring;
+  // Go around the ring many times, so that the indices wrap around.
+  int next_push = 0, next_pop = 0;
+  for (int round = 0; round < 200; ++round) {
+    const int count = 1 + round % 4;
+    for (int i = 0; i < count; ++i) {
+      EXPECT_TRUE(ring.Push(next_push++));
+    }
+    EXPECT_EQ(ring.size(), count);
+    EXPECT_EQ(ring.full(), count == 4);
+    if (ring.full()) {
+      EXPECT_FALSE(ring.Push(-1));
+    }
+    for (int i = 0; i < count; ++i) {
+      int value = -1;
+      EXPECT_TRUE(ring.Pop(value));
+      EXPECT_EQ(value, next_pop++);
+    }
+    EXPECT_TRUE(ring.empty());
+  }
+}
+
+TEST(SpscRingTest, PushNAndPopN) {
+  SpscRing<uint8_t, 8> ring;
+  uint8_t input[] = {1, 2, 3, 4, 5};
+  EXPECT_EQ(ring.PushN(MakeArrayView(input)), 5);
+  // Only 3 more fit.
+  EXPECT_EQ(ring.PushN(MakeArrayView(input)), 3);
+  EXPECT_TRUE(ring.full());
+  EXPECT_EQ(ring.PushN(MakeArrayView(input)), 0);
+
+  uint8_t output[6] = {};
+  EXPECT_EQ(ring.PopN(MakeArrayView(output)), 6);
+  EXPECT_THAT(output, ElementsAre(1, 2, 3, 4, 5, 1));
+  EXPECT_EQ(ring.size(), 2);
+
+  // Wrap around the end of the array.
+  EXPECT_EQ(ring.PushN(MakeArrayView(input)), 5);
+  EXPECT_EQ(ring.PopN(MakeArrayView(output)), 6);
+  EXPECT_THAT(output, ElementsAre(2, 3, 1, 2, 3, 4));
+  EXPECT_EQ(ring.PopN(MakeArrayView(output)), 1);
+  EXPECT_EQ(output[0], 5);
+  EXPECT_EQ(ring.PopN(MakeArrayView(output)), 0);
+}
+
+TEST(SpscRingTest, PeekContiguousAndConsume) {
+  SpscRing<char, 8> ring;
+  for (char c : {'a', 'b', 'c', 'd', 'e', 'f'}) {
+    ASSERT_TRUE(ring.Push(c));
+  }
+  EXPECT_THAT(ToVector(ring.PeekContiguous()),
+              ElementsAre('a', 'b', 'c', 'd', 'e', 'f'));
+  ring.Consume(4);
+  EXPECT_THAT(ToVector(ring.PeekContiguous()), ElementsAre('e', 'f'));
+  for (char c : {'g', 'h', 'i', 'j'}) {
+    ASSERT_TRUE(ring.Push(c));
+  }
+  // 'i' and 'j' are at the start of the array, so aren't contiguous with the
+  // older elements.
+  EXPECT_THAT(ToVector(ring.PeekContiguous()), ElementsAre('e', 'f', 'g', 'h'));
+  ring.Consume(4);
+  EXPECT_THAT(ToVector(ring.PeekContiguous()), ElementsAre('i', 'j'));
+  ring.Consume(1);
+  char c;
+  EXPECT_TRUE(ring.Pop(c));
+  EXPECT_EQ(c, 'j');
+  EXPECT_TRUE(ring.empty());
+}
+
+// Transfers a sequence of values from a producer thread to a consumer thread,
+// checking that they arrive in order and without loss. Run under TSAN to check
+// for data races.
+TEST(SpscRingTest, ProducerAndConsumerThreads) {
+  constexpr uint32_t kNumValues = 100000;
+  SpscRing<uint32_t, 16> ring;
+
+  std::thread producer([&ring]() {
+    uint32_t next = 0;
+    uint32_t batch[5];
+    while (next < kNumValues) {
+      if (ring.full()) {
+        // Let the consumer run, which matters if there is only one core.
+        std::this_thread::yield();
+      } else if (next % 3 == 0) {
+        if (ring.Push(next)) {
+          ++next;
+        }
+      } else {
+        uint8_t count = 0;
+        while (count < 5 && next + count < kNumValues) {
+          batch[count] = next + count;
+          ++count;
+        }
+        next += ring.PushN(ArrayView<uint32_t>(batch, count));
+      }
+    }
+  });
+
+  uint32_t expected = 0;
+  uint32_t batch[7];
+  while (expected < kNumValues) {
+    if (ring.empty()) {
+      std::this_thread::yield();
+      continue;
+    }
+    switch (expected % 3) {
+      case 0: {
+        uint32_t value;
+        if (ring.Pop(value)) {
+          EXPECT_EQ(value, expected);
+          expected = value + 1;
+        }
+        break;
+      }
+      case 1: {
+        const auto count = ring.PopN(MakeArrayView(batch));
+        for (uint8_t ndx = 0; ndx < count; ++ndx) {
+          EXPECT_EQ(batch[ndx], expected);
+          expected = batch[ndx] + 1;
+        }
+        break;
+      }
+      case 2: {
+        const auto view = ring.PeekContiguous();
+        for (const auto value : view) {
+          EXPECT_EQ(value, expected);
+          expected = value + 1;
+        }
+        ring.Consume(view.size());
+        break;
+      }
+    }
+  }
+  producer.join();
+  EXPECT_TRUE(ring.empty());
+}
+
+}  // namespace
+}  // namespace test
+}  // namespace mcucore
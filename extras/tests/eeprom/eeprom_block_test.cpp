@@ -0,0 +1,113 @@
+#include "eeprom/eeprom_block.h"
+
+#include <cstdint>
+#include <cstring>
+#include <vector>
+
+#include "extras/host/eeprom/eeprom.h"
+#include "extras/test_tools/eeprom_test_utils.h"
+#include "gtest/gtest.h"
+#include "mcucore_platform.h"
+
+namespace mcucore {
+namespace test {
+namespace {
+
+// Counts the calls to the per-byte and block methods.
+class CountingEeprom : public EEPROMClass {
+ public:
+  uint8_t read(int idx) override {
+    ++byte_reads;
+    return EEPROMClass::read(idx);
+  }
+  void write(int idx, uint8_t val) override {
+    ++byte_writes;
+    EEPROMClass::write(idx, val);
+  }
+  void read_block(void* dst, int idx, size_t n) override {
+    ++block_reads;
+    EEPROMClass::read_block(dst, idx, n);
+  }
+  void update_block(const void* src, int idx, size_t n) override {
+    ++block_writes;
+    EEPROMClass::update_block(src, idx, n);
+  }
+
+  size_t byte_reads = 0;
+  size_t byte_writes = 0;
+  size_t block_reads = 0;
+  size_t block_writes = 0;
+};
+
+std::vector<uint8_t> FillWithPattern(EEPROMClass& eeprom) {
+  std::vector<uint8_t> bytes(eeprom.length());
+  for (size_t ndx = 0; ndx < bytes.size(); ++ndx) {
+    bytes[ndx] = static_cast<uint8_t>(ndx * 7 + 3);
+    eeprom.write(ndx, bytes[ndx]);
+  }
+  return bytes;
+}
+
+TEST(EepromBlockTest, ReadAndWriteBlock) {
+  CountingEeprom eeprom;
+  const uint8_t src[] = {10, 20, 0, 40, 50};
+  EepromStats stats;
+  EepromWriteBlock(eeprom, 200, src, sizeof src, &stats);
+  uint8_t dst[sizeof src] = {};
+  EepromReadBlock(eeprom, 200, dst, sizeof dst);
+  EXPECT_EQ(std::memcmp(dst, src, sizeof src), 0);
+  EXPECT_EQ(eeprom.block_reads, 2);
+  EXPECT_EQ(eeprom.byte_reads, 0);
+
+  // The block is written with update_block, but the zero byte was already
+  // zero, so isn't counted as written.
+  EXPECT_EQ(eeprom.block_writes, 1);
+  EXPECT_EQ(eeprom.byte_writes, 0);
+  EXPECT_EQ(stats.writes, 4);
+  EXPECT_EQ(stats.skips, 1);
+  EXPECT_EQ(stats.erases, 4);
+
+  // Writing the same values again doesn't write anything.
+  EepromWriteBlock(eeprom, 200, src, sizeof src, &stats);
+  EXPECT_EQ(eeprom.block_writes, 1);
+  EXPECT_EQ(stats.writes, 4);
+  EXPECT_EQ(stats.skips, 6);
+}
+
+TEST(EepromBlockTest, UpdateByte) {
+  CountingEeprom eeprom;
+  EepromStats stats;
+  EepromUpdateByte(eeprom, 7, 0x0F, &stats);  // Sets bits, so needs an erase.
+  EXPECT_EQ(eeprom.read(7), 0x0F);
+  EepromUpdateByte(eeprom, 7, 0x03, &stats);  // Only clears bits.
+  EXPECT_EQ(eeprom.read(7), 0x03);
+  EepromUpdateByte(eeprom, 7, 0x03, &stats);  // Unchanged.
+  EepromUpdateByte(eeprom, 7, 0x03);          // Unchanged, not counted.
+  EXPECT_EQ(eeprom.byte_writes, 2);
+  EXPECT_EQ(stats.writes, 2);
+  EXPECT_EQ(stats.skips, 1);
+  EXPECT_EQ(stats.erases, 1);
+}
+
+// Check that EepromMoveBlock handles overlapping moves in both directions, for
+// lengths that are and aren't multiples of the chunk size.
+TEST(EepromBlockTest, MoveBlock) {
+  for (const EepromAddrT length : {0, 1, 15, 16, 17, 40, 64}) {
+    for (const int delta : {-20, -16, -5, -1, 0, 1, 5, 16, 20}) {
+      EEPROMClass eeprom;
+      auto expected = FillWithPattern(eeprom);
+      const EepromAddrT from = 100;
+      const EepromAddrT to = from + delta;
+      EepromStats stats;
+      EepromMoveBlock(eeprom, from, to, length, &stats);
+      std::memmove(expected.data() + to, expected.data() + from, length);
+      EXPECT_EQ(ReadAllBytes(eeprom), expected)
+          << "length=" << length << ", delta=" << delta;
+      EXPECT_EQ(stats.writes + stats.skips, delta == 0 ? 0 : length);
+    }
+  }
+}
+
+}  // namespace
+}  // namespace test
+}  // namespace mcucore
@@ -0,0 +1,233 @@
+#include "eeprom/eeprom_tlv_async_writer.h"
+
+#include <string>
+#include <vector>
+
+#include "eeprom/eeprom_tag.h"
+#include "eeprom/eeprom_tlv.h"
+#include "eeprom/eeprom_tlv_index.h"
+#include "eeprom/eeprom_write_queue.h"
+#include "extras/host/eeprom/eeprom.h"
+#include "extras/test_tools/eeprom_example_domains.h"
+#include "extras/test_tools/status_or_test_utils.h"
+#include "extras/test_tools/status_test_utils.h"
+#include "gmock/gmock.h"
+#include "gtest/gtest.h"
+#include "status/status_code.h"
+
+namespace mcucore {
+namespace test {
+namespace {
+
+using ::testing::ElementsAre;
+
+EepromTag MakeTag(uint8_t id) { return EepromTag{MCU_DOMAIN(1), id}; }
+
+// Reads the entry from a copy of the EEPROM (e.g. as found after a power loss),
+// as the EEPROM itself mustn't be read while writes are pending.
+std::string ReadEntryString(EEPROMClass eeprom, EepromTag tag) {
+  auto status_or_tlv = EepromTlv::GetIfValid(eeprom);
+  if (!status_or_tlv.ok()) {
+    return "<invalid>";
+  }
+  uint8_t buffer[EepromTlv::kMaxBlockLength];
+  auto status_or_length =
+      status_or_tlv.value().ReadEntry(tag, buffer, sizeof buffer);
+  if (!status_or_length.ok()) {
+    return "<error>";
+  }
+  return std::string(reinterpret_cast<const char*>(buffer),
+                     status_or_length.value());
+}
+
+Status WriteEntryString(
+    EepromTlvAsyncWriter& writer, EepromTag tag, const std::string& s,
+    EepromTlvAsyncWriter::CommitCallback callback = nullptr,
+    void* callback_arg = nullptr) {
+  return writer.WriteEntry(tag, reinterpret_cast<const uint8_t*>(s.data()),
+                           s.size(), callback, callback_arg);
+}
+
+void RecordTag(EepromTag tag, void* arg) {
+  static_cast<std::vector<uint8_t>*>(arg)->push_back(tag.id);
+}
+
+TEST(EepromTlvAsyncWriterTest, CommitIsCrashConsistent) {
+  EEPROMClass eeprom;
+  auto tlv = EepromTlv::ClearAndInitializeEeprom(eeprom).value();
+  EXPECT_STATUS_OK(tlv.WriteEntry(MakeTag(1), nullptr, 0));
+  const std::string old_value = "old value";
+  EXPECT_STATUS_OK(tlv.WriteEntry(MakeTag(2),
+                                  reinterpret_cast<const uint8_t*>(
+                                      old_value.data()),
+                                  old_value.size()));
+
+  EepromWriteQueue<64> queue(eeprom);
+  EepromTlvAsyncWriter writer(tlv, queue);
+  std::vector<uint8_t> completed;
+  const std::string new_value = "a longer new value";
+  EXPECT_STATUS_OK(
+      WriteEntryString(writer, MakeTag(2), new_value, RecordTag, &completed));
+  EXPECT_FALSE(writer.Poll());
+
+  // Other modifications aren't permitted until the commit has completed.
+  EXPECT_THAT(WriteEntryString(writer, MakeTag(3), ""),
+              StatusIs(StatusCode::kFailedPrecondition));
+  EXPECT_THAT(tlv.WriteEntry(MakeTag(3), nullptr, 0),
+              StatusIs(StatusCode::kFailedPrecondition));
+  EXPECT_THAT(tlv.ReclaimUnusedSpace(),
+              StatusIs(StatusCode::kFailedPrecondition));
+
+  // Until the data, tag, length and journal have been written, a copy of the
+  // EEPROM holds the old value.
+  for (size_t ndx = 0; ndx < new_value.size() + 3 + 22; ++ndx) {
+    EXPECT_EQ(ReadEntryString(eeprom, MakeTag(2)), old_value) << ndx;
+    EXPECT_TRUE(queue.Tick());
+  }
+
+  // Once the journal has been written, it holds the new value, even before the
+  // beyond address and the CRC have been written, as the journal allows the
+  // commit to be completed after a power loss.
+  for (int ndx = 0; ndx < 6 + 3; ++ndx) {
+    EXPECT_EQ(ReadEntryString(eeprom, MakeTag(2)), new_value) << ndx;
+    EXPECT_TRUE(queue.Tick());
+  }
+
+  // As it does once the journal has been cleared, while the old entry is being
+  // marked as unused.
+  EXPECT_EQ(ReadEntryString(eeprom, MakeTag(2)), new_value);
+  EXPECT_FALSE(writer.Poll());
+  EXPECT_THAT(completed, ElementsAre());
+
+  EXPECT_TRUE(queue.Tick());
+  EXPECT_FALSE(queue.Tick());
+  EXPECT_TRUE(writer.Poll());
+  EXPECT_THAT(completed, ElementsAre(2));
+  EXPECT_TRUE(writer.Poll());
+  EXPECT_THAT(completed, ElementsAre(2));
+
+  // The old entry is now unused, so can be reclaimed.
+  EXPECT_THAT(tlv.ReclaimUnusedSpace(),
+              IsOkAndHolds(3 + old_value.size()));
+  EXPECT_EQ(ReadEntryString(eeprom, MakeTag(2)), new_value);
+  EXPECT_STATUS_OK(tlv.Validate(EepromTlv::kForce));
+}
+
+// Simulates a power loss after each byte written by each of a series of
+// asynchronous replacements of an entry, checking that the EEPROM is then
+// valid, and holds either the old or the new value of the entry.
+void VerifyRecoversFromPowerLoss(EepromTlvIndexBase* index) {
+  EEPROMClass eeprom;
+  auto tlv = EepromTlv::ClearAndInitializeEeprom(eeprom, index).value();
+  ASSERT_STATUS_OK(tlv.WriteEntry(
+      MakeTag(1), reinterpret_cast<const uint8_t*>("other"), 5));
+  EepromWriteQueue<64> queue(eeprom);
+  EepromTlvAsyncWriter writer(tlv, queue);
+  std::string old_value = "<unset>";
+  int power_losses = 0;
+  for (int replacement = 0; replacement < 20; ++replacement) {
+    const std::string new_value =
+        std::string(replacement % 7, 'a' + replacement) + "!";
+    ASSERT_STATUS_OK(WriteEntryString(writer, MakeTag(2), new_value));
+    bool more = true;
+    while (more) {
+      more = queue.Tick();
+      ++power_losses;
+
+      // Restarting after the power loss finds a valid EEPROM, with either the
+      // old or the new value of the entry, and the other entry unaffected.
+      EEPROMClass snapshot = eeprom;
+      auto status_or_tlv = EepromTlv::GetIfValid(snapshot);
+      ASSERT_STATUS_OK(status_or_tlv.status());
+      const std::string found = ReadEntryString(snapshot, MakeTag(2));
+      if (replacement == 0 && found == "<error>") {
+        // There was no old value.
+      } else if (more) {
+        ASSERT_TRUE(found == old_value || found == new_value) << found;
+      } else {
+        ASSERT_EQ(found, new_value);
+      }
+      ASSERT_EQ(ReadEntryString(snapshot, MakeTag(1)), "other");
+
+      // And new entries can be written.
+      auto snapshot_tlv = status_or_tlv.value();
+      ASSERT_STATUS_OK(snapshot_tlv.WriteEntry(MakeTag(3), nullptr, 0));
+      ASSERT_EQ(ReadEntryString(snapshot, MakeTag(2)), found);
+    }
+    ASSERT_TRUE(writer.Poll());
+    ASSERT_EQ(ReadEntryString(eeprom, MakeTag(2)), new_value);
+    if (replacement % 5 == 4) {
+      ASSERT_STATUS_OK(tlv.ReclaimUnusedSpace().status());
+    }
+    old_value = new_value;
+  }
+  EXPECT_GT(power_losses, 200);
+}
+
+TEST(EepromTlvAsyncWriterTest, RecoversFromPowerLoss) {
+  VerifyRecoversFromPowerLoss(nullptr);
+}
+
+TEST(EepromTlvAsyncWriterTest, RecoversFromPowerLossWithIndex) {
+  EepromTlvIndex<4> index;
+  VerifyRecoversFromPowerLoss(&index);
+}
+
+TEST(EepromTlvAsyncWriterDeathTest, NoReadsWhileWritesArePending) {
+  EEPROMClass eeprom;
+  auto tlv = EepromTlv::ClearAndInitializeEeprom(eeprom).value();
+  EepromWriteQueue<64> queue(eeprom);
+  EepromTlvAsyncWriter writer(tlv, queue);
+  EXPECT_STATUS_OK(WriteEntryString(writer, MakeTag(1), "abc"));
+  EXPECT_TRUE(EepromWriteQueueBase::HasPendingWritesTo(eeprom));
+  EXPECT_DEBUG_DEATH(tlv.FindEntry(MakeTag(1)), "writes are pending");
+  EXPECT_DEBUG_DEATH(tlv.Validate(), "writes are pending");
+  EXPECT_DEBUG_DEATH(tlv.Available(), "writes are pending");
+  queue.Flush();
+  EXPECT_FALSE(EepromWriteQueueBase::HasPendingWritesTo(eeprom));
+  EXPECT_TRUE(writer.Poll());
+  EXPECT_STATUS_OK(tlv.FindEntry(MakeTag(1)).status());
+}
+
+TEST(EepromTlvAsyncWriterTest, UpdatesIndex) {
+  EEPROMClass eeprom;
+  EepromTlvIndex<4> index;
+  auto tlv = EepromTlv::ClearAndInitializeEeprom(eeprom, &index).value();
+  EepromWriteQueue<64> queue(eeprom);
+  EepromTlvAsyncWriter writer(tlv, queue);
+  EXPECT_STATUS_OK(WriteEntryString(writer, MakeTag(1), "abc"));
+  queue.Flush();
+  EXPECT_TRUE(writer.Poll());
+  EXPECT_STATUS_OK(WriteEntryString(writer, MakeTag(1), "xyz"));
+  queue.Flush();
+  EXPECT_TRUE(writer.Poll());
+  EXPECT_EQ(index.size(), 1);
+  EXPECT_TRUE(index.complete());
+
+  uint8_t buffer[8];
+  EXPECT_THAT(tlv.ReadEntry(MakeTag(1), buffer, sizeof buffer),
+              IsOkAndHolds(3));
+  EXPECT_EQ(std::string(reinterpret_cast<const char*>(buffer), 3), "xyz");
+  EXPECT_EQ(ReadEntryString(eeprom, MakeTag(1)), "xyz");
+}
+
+TEST(EepromTlvAsyncWriterTest, QueueTooSmall) {
+  EEPROMClass eeprom;
+  auto tlv = EepromTlv::ClearAndInitializeEeprom(eeprom).value();
+  EepromWriteQueue<41> queue(eeprom);
+  EepromTlvAsyncWriter writer(tlv, queue);
+  EXPECT_THAT(WriteEntryString(writer, MakeTag(1), "12345678"),
+              StatusIs(StatusCode::kResourceExhausted));
+  EXPECT_TRUE(queue.idle());
+  EXPECT_TRUE(writer.Poll());
+
+  // The transaction was aborted, so the EepromTlv is still usable.
+  EXPECT_STATUS_OK(WriteEntryString(writer, MakeTag(1), "1234567"));
+  queue.Flush();
+  EXPECT_TRUE(writer.Poll());
+  EXPECT_EQ(ReadEntryString(eeprom, MakeTag(1)), "1234567");
+}
+
+}  // namespace
+}  // namespace test
+}  // namespace mcucore
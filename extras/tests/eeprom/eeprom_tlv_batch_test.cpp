@@ -0,0 +1,365 @@
+#include "eeprom/eeprom_tlv_batch.h"
+
+#include <map>
+#include <string>
+
+#include "eeprom/eeprom_region.h"
+#include "eeprom/eeprom_tag.h"
+#include "eeprom/eeprom_tlv.h"
+#include "eeprom/eeprom_tlv_index.h"
+#include "extras/host/eeprom/eeprom.h"
+#include "extras/test_tools/eeprom_example_domains.h"
+#include "extras/test_tools/eeprom_test_utils.h"
+#include "extras/test_tools/status_or_test_utils.h"
+#include "extras/test_tools/status_test_utils.h"
+#include "gtest/gtest.h"
+#include "status/status_code.h"
+
+namespace mcucore {
+namespace test {
+namespace {
+
+using Values = std::map<uint8_t, std::string>;
+
+EepromTag MakeTag(uint8_t id) { return EepromTag{MCU_DOMAIN(1), id}; }
+
+Status WriteString(EepromTlv& tlv, uint8_t id, const std::string& value) {
+  return tlv.WriteEntry(MakeTag(id),
+                        reinterpret_cast<const uint8_t*>(value.data()),
+                        value.size());
+}
+
+Status StageString(EepromTlvBatch& batch, uint8_t id,
+                   const std::string& value) {
+  return batch.WriteEntry(MakeTag(id),
+                          reinterpret_cast<const uint8_t*>(value.data()),
+                          value.size());
+}
+
+Status WriteStringFn(EepromRegion& region, const std::string& value) {
+  if (!region.WriteBytes(reinterpret_cast<const uint8_t*>(value.data()),
+                         value.size())) {
+    return ResourceExhaustedError();
+  }
+  return OkStatus();
+}
+
+Status FailingWriterFn(EepromRegion& region) {
+  region.WriteBytes({1, 2, 3});
+  return DataLossError();
+}
+
+std::string ReadString(const EepromTlv& tlv, uint8_t id) {
+  uint8_t buffer[EepromTlv::kMaxBlockLength];
+  auto status_or_length = tlv.ReadEntry(MakeTag(id), buffer, sizeof buffer);
+  if (!status_or_length.ok()) {
+    return "<error>";
+  }
+  return std::string(reinterpret_cast<const char*>(buffer),
+                     status_or_length.value());
+}
+
+bool HasValues(const EepromTlv& tlv, const Values& values) {
+  for (const auto& [id, value] : values) {
+    if (ReadString(tlv, id) != value) {
+      return false;
+    }
+  }
+  return true;
+}
+
+// Returns the number of bytes written among the beyond address and the CRC.
+int CountHeaderWrites(const EEPROMClass& before, const EEPROMClass& after) {
+  int count = 0;
+  for (int addr = 4; addr < EepromTlv::kFixedHeaderSize; ++addr) {
+    if (const_cast<EEPROMClass&>(before).read(addr) !=
+        const_cast<EEPROMClass&>(after).read(addr)) {
+      ++count;
+    }
+  }
+  return count;
+}
+
+TEST(EepromTlvBatchTest, CommitsAllEntriesTogether) {
+  EEPROMClass eeprom;
+  auto tlv = EepromTlv::ClearAndInitializeEeprom(eeprom).value();
+  ASSERT_STATUS_OK(WriteString(tlv, 1, "old one"));
+  ASSERT_STATUS_OK(WriteString(tlv, 2, "old two"));
+  const EEPROMClass before = eeprom;
+  tlv.ResetStats();
+
+  EepromTlvBatch batch(tlv);
+  EXPECT_STATUS_OK(StageString(batch, 1, "new one"));
+  EXPECT_STATUS_OK(batch.WriteEntryToCursor(MakeTag(3), 0, WriteStringFn,
+                                            std::string("three")));
+  EXPECT_STATUS_OK(StageString(batch, 4, ""));
+  EXPECT_EQ(batch.size(), 3);
+
+  // The staged entries aren't yet visible.
+  {
+    EEPROMClass snapshot = eeprom;
+    auto snapshot_tlv = EepromTlv::GetIfValid(snapshot).value();
+    EXPECT_TRUE(HasValues(snapshot_tlv, {{1, "old one"}, {2, "old two"}}));
+    EXPECT_THAT(snapshot_tlv.FindEntry(MakeTag(3)).status(),
+                StatusIs(StatusCode::kNotFound));
+  }
+  EXPECT_STATUS_OK(batch.Commit());
+  EXPECT_EQ(batch.size(), 0);
+  EXPECT_TRUE(HasValues(tlv, {{1, "new one"},
+                              {2, "old two"},
+                              {3, "three"},
+                              {4, ""}}));
+  EXPECT_STATUS_OK(tlv.Validate(EepromTlv::kForce));
+
+  // The beyond address and the CRC are written once, rather than per entry.
+  EXPECT_LE(CountHeaderWrites(before, eeprom), 6);
+
+  // The old version of entry 1 is no longer in use.
+  EXPECT_THAT(tlv.ReclaimUnusedSpace(), IsOkAndHolds(3 + 7));
+  auto reopened = EepromTlv::GetIfValid(eeprom).value();
+  EXPECT_TRUE(HasValues(reopened, {{1, "new one"},
+                                   {2, "old two"},
+                                   {3, "three"},
+                                   {4, ""}}));
+}
+
+TEST(EepromTlvBatchTest, LastStagedVersionWins) {
+  EEPROMClass eeprom;
+  EepromTlvIndex<4> index;
+  auto tlv = EepromTlv::ClearAndInitializeEeprom(eeprom, &index).value();
+  ASSERT_STATUS_OK(WriteString(tlv, 1, "a"));
+  {
+    EepromTlvBatch batch(tlv);
+    EXPECT_STATUS_OK(StageString(batch, 1, "b"));
+    EXPECT_STATUS_OK(StageString(batch, 2, "x"));
+    EXPECT_STATUS_OK(StageString(batch, 1, "c"));
+    EXPECT_STATUS_OK(batch.Commit());
+  }
+  EXPECT_TRUE(index.complete());
+  EXPECT_EQ(index.size(), 2);
+  EXPECT_TRUE(HasValues(tlv, {{1, "c"}, {2, "x"}}));
+  EXPECT_THAT(tlv.ReclaimUnusedSpace(), IsOkAndHolds(2 * (3 + 1)));
+
+  EepromTlvIndex<4> new_index;
+  auto reopened = EepromTlv::GetIfValid(eeprom, &new_index).value();
+  EXPECT_TRUE(new_index.complete());
+  EXPECT_TRUE(HasValues(reopened, {{1, "c"}, {2, "x"}}));
+}
+
+TEST(EepromTlvBatchTest, BlocksOtherModificationsUntilDone) {
+  EEPROMClass eeprom;
+  auto tlv = EepromTlv::ClearAndInitializeEeprom(eeprom).value();
+  {
+    EepromTlvBatch batch(tlv);
+    EXPECT_STATUS_OK(batch.Commit());  // Nothing staged.
+    EXPECT_STATUS_OK(StageString(batch, 1, "staged"));
+    EXPECT_THAT(WriteString(tlv, 2, "direct"),
+                StatusIs(StatusCode::kFailedPrecondition));
+    EXPECT_THAT(tlv.ReclaimUnusedSpace(),
+                StatusIs(StatusCode::kFailedPrecondition));
+
+    // Only one batch at a time.
+    EepromTlvBatch other_batch(tlv);
+    EXPECT_THAT(StageString(other_batch, 3, "other"),
+                StatusIs(StatusCode::kFailedPrecondition));
+    batch.Abort();
+    EXPECT_EQ(batch.size(), 0);
+    EXPECT_STATUS_OK(StageString(other_batch, 3, "other"));
+    // Destroying other_batch discards the staged entry.
+  }
+  EXPECT_STATUS_OK(WriteString(tlv, 2, "direct"));
+  EXPECT_TRUE(HasValues(tlv, {{2, "direct"}}));
+  EXPECT_THAT(tlv.FindEntry(MakeTag(1)).status(),
+              StatusIs(StatusCode::kNotFound));
+  EXPECT_THAT(tlv.FindEntry(MakeTag(3)).status(),
+              StatusIs(StatusCode::kNotFound));
+}
+
+TEST(EepromTlvBatchTest, FailedWriterDoesNotStageEntry) {
+  EEPROMClass eeprom;
+  auto tlv = EepromTlv::ClearAndInitializeEeprom(eeprom).value();
+  EepromTlvBatch batch(tlv);
+  EXPECT_THAT(batch.WriteEntryToCursor(MakeTag(1), 0, FailingWriterFn),
+              StatusIs(StatusCode::kDataLoss));
+  EXPECT_STATUS_OK(StageString(batch, 2, "two"));
+  EXPECT_THAT(batch.WriteEntryToCursor(MakeTag(3), 0, FailingWriterFn),
+              StatusIs(StatusCode::kDataLoss));
+  EXPECT_EQ(batch.size(), 1);
+  EXPECT_STATUS_OK(batch.Commit());
+  EXPECT_TRUE(HasValues(tlv, {{2, "two"}}));
+  EXPECT_THAT(tlv.FindEntry(MakeTag(1)).status(),
+              StatusIs(StatusCode::kNotFound));
+  EXPECT_STATUS_OK(tlv.Validate(EepromTlv::kForce));
+}
+
+TEST(EepromTlvBatchTest, ReclaimsSpaceOnlyForFirstEntry) {
+  // The last 22 bytes are reserved for the journal.
+  EEPROMClass eeprom(96);
+  auto tlv = EepromTlv::ClearAndInitializeEeprom(eeprom).value();
+  const std::string value(20, 'x');
+  ASSERT_STATUS_OK(WriteString(tlv, 1, value));
+  ASSERT_STATUS_OK(WriteString(tlv, 1, value));  // Superseded the first.
+
+  // There is room for another entry, but not before the journal, so the first
+  // entry is moved down.
+  EepromTlvBatch batch(tlv);
+  EXPECT_STATUS_OK(StageString(batch, 2, value));
+  EXPECT_THAT(StageString(batch, 3, value),
+              StatusIs(StatusCode::kResourceExhausted));
+  EXPECT_STATUS_OK(StageString(batch, 3, "y"));
+  EXPECT_STATUS_OK(batch.Commit());
+  EXPECT_TRUE(HasValues(tlv, {{1, value}, {2, value}, {3, "y"}}));
+  EXPECT_STATUS_OK(tlv.Validate(EepromTlv::kForce));
+}
+
+TEST(EepromTlvBatchTest, StagedEntriesEndBeforeJournal) {
+  EEPROMClass eeprom(96);
+  auto tlv = EepromTlv::ClearAndInitializeEeprom(eeprom).value();
+  EepromTlvBatch batch(tlv);
+  // The entries start at 10, and the journal at 74.
+  EXPECT_STATUS_OK(StageString(batch, 1, std::string(40, 'x')));
+  EXPECT_THAT(StageString(batch, 2, std::string(19, 'y')),
+              StatusIs(StatusCode::kResourceExhausted));
+  EXPECT_STATUS_OK(StageString(batch, 2, std::string(18, 'y')));
+  EXPECT_THAT(StageString(batch, 3, ""),
+              StatusIs(StatusCode::kResourceExhausted));
+  EXPECT_STATUS_OK(batch.Commit());
+  EXPECT_TRUE(
+      HasValues(tlv, {{1, std::string(40, 'x')}, {2, std::string(18, 'y')}}));
+  EXPECT_EQ(tlv.Available(), 22 - 3);
+}
+
+TEST(EepromTlvBatchTest, AllOrNoneAfterPowerLoss) {
+  const Values old_values = {{1, "one"}, {2, "two"}, {3, "three"}};
+  const Values new_values = {
+      {1, "uno"}, {2, "two"}, {3, "tres"}, {4, "cuatro"}, {5, "cinco"}};
+  int old_count = 0;
+  int new_count = 0;
+  for (int writes = 0;; ++writes) {
+    ASSERT_LT(writes, 1000);
+    PowerLossEeprom eeprom;
+    auto tlv = EepromTlv::ClearAndInitializeEeprom(eeprom).value();
+    for (const auto& [id, value] : old_values) {
+      ASSERT_STATUS_OK(WriteString(tlv, id, value));
+    }
+    eeprom.writes_remaining = writes;
+    bool completed = true;
+    try {
+      EepromTlvBatch batch(tlv);
+      for (const auto& [id, value] : new_values) {
+        if (id != 2) {
+          ASSERT_STATUS_OK(StageString(batch, id, value));
+        }
+      }
+      ASSERT_STATUS_OK(batch.Commit());
+    } catch (const PowerLoss&) {
+      completed = false;
+    }
+    eeprom.writes_remaining = -1;
+
+    auto status_or_tlv = EepromTlv::GetIfValid(eeprom);
+    ASSERT_STATUS_OK(status_or_tlv.status()) << writes;
+    // An interrupted marking of an old entry as unused doesn't expose its
+    // data under another tag.
+    ASSERT_THAT(status_or_tlv.value().FindEntry(MakeTag(255)).status(),
+                StatusIs(StatusCode::kNotFound));
+    if (HasValues(status_or_tlv.value(), new_values)) {
+      ++new_count;
+    } else {
+      ASSERT_TRUE(HasValues(status_or_tlv.value(), old_values)) << writes;
+      ASSERT_THAT(status_or_tlv.value().FindEntry(MakeTag(4)).status(),
+                  StatusIs(StatusCode::kNotFound));
+      ++old_count;
+    }
+    if (completed) {
+      ASSERT_TRUE(HasValues(status_or_tlv.value(), new_values));
+      break;
+    }
+  }
+  EXPECT_GT(old_count, 20);
+  EXPECT_GT(new_count, 1);
+}
+
+Status CommitStrings(EepromTlv& tlv, const Values& values) {
+  EepromTlvBatch batch(tlv);
+  for (const auto& [id, value] : values) {
+    MCU_RETURN_IF_ERROR(StageString(batch, id, value));
+  }
+  return batch.Commit();
+}
+
+// Once a batch has been committed, its journal mustn't be replayed, even if the
+// bytes of the journal reappear in the free space (e.g. because they're the
+// same as the data of a later entry which was later reclaimed).
+TEST(EepromTlvBatchTest, CompletedJournalIsNotReplayed) {
+  const Values batch_values = {{1, "one"}, {2, "two"}};
+  const Values values = {{1, "one"}, {2, "two"}, {3, "three"}};
+  for (int writes = 0;; ++writes) {
+    ASSERT_LT(writes, 1000);
+    // Capture the free space as it was when the commit was interrupted.
+    PowerLossEeprom interrupted;
+    {
+      auto tlv = EepromTlv::ClearAndInitializeEeprom(interrupted).value();
+      interrupted.writes_remaining = writes;
+      try {
+        ASSERT_STATUS_OK(CommitStrings(tlv, batch_values));
+        break;
+      } catch (const PowerLoss&) {
+      }
+      interrupted.writes_remaining = -1;
+    }
+
+    EEPROMClass eeprom;
+    auto tlv = EepromTlv::ClearAndInitializeEeprom(eeprom).value();
+    ASSERT_STATUS_OK(CommitStrings(tlv, batch_values));
+    ASSERT_STATUS_OK(WriteString(tlv, 3, "three"));
+    for (int addr = eeprom.length() - tlv.Available(); addr < eeprom.length();
+         ++addr) {
+      eeprom.write(addr, interrupted.read(addr));
+    }
+    auto status_or_tlv = EepromTlv::GetIfValid(eeprom);
+    ASSERT_STATUS_OK(status_or_tlv.status()) << writes;
+    ASSERT_TRUE(HasValues(status_or_tlv.value(), values)) << writes;
+  }
+}
+
+// Interrupting the writing of a journal doesn't revive the previous journal.
+TEST(EepromTlvBatchTest, InterruptedJournalWriteDoesNotReviveOldJournal) {
+  const Values old_values = {{1, "one"}, {2, "two"}, {3, "three"}};
+  const Values new_values = {{4, "four"}, {5, "five"}};
+  int new_count = 0;
+  for (int writes = 0;; ++writes) {
+    ASSERT_LT(writes, 1000);
+    PowerLossEeprom eeprom;
+    auto tlv = EepromTlv::ClearAndInitializeEeprom(eeprom).value();
+    ASSERT_STATUS_OK(CommitStrings(tlv, {{1, "one"}, {2, "two"}}));
+    ASSERT_STATUS_OK(WriteString(tlv, 3, "three"));
+    eeprom.writes_remaining = writes;
+    bool completed = true;
+    try {
+      ASSERT_STATUS_OK(CommitStrings(tlv, new_values));
+    } catch (const PowerLoss&) {
+      completed = false;
+    }
+    eeprom.writes_remaining = -1;
+
+    auto status_or_tlv = EepromTlv::GetIfValid(eeprom);
+    ASSERT_STATUS_OK(status_or_tlv.status()) << writes;
+    ASSERT_TRUE(HasValues(status_or_tlv.value(), old_values)) << writes;
+    if (HasValues(status_or_tlv.value(), new_values)) {
+      ++new_count;
+    } else {
+      ASSERT_THAT(status_or_tlv.value().FindEntry(MakeTag(4)).status(),
+                  StatusIs(StatusCode::kNotFound))
+          << writes;
+    }
+    if (completed) {
+      ASSERT_GT(new_count, 0);
+      break;
+    }
+  }
+}
+
+}  // namespace
+}  // namespace test
+}  // namespace mcucore
@@ -0,0 +1,339 @@
+#include "eeprom/eeprom_tlv_compactor.h"
+
+#include <map>
+#include <string>
+
+#include "eeprom/eeprom_tag.h"
+#include "eeprom/eeprom_tlv.h"
+#include "eeprom/eeprom_tlv_index.h"
+#include "extras/host/eeprom/eeprom.h"
+#include "extras/test_tools/eeprom_example_domains.h"
+#include "extras/test_tools/eeprom_test_utils.h"
+#include "extras/test_tools/status_or_test_utils.h"
+#include "extras/test_tools/status_test_utils.h"
+#include "gtest/gtest.h"
+#include "status/status_code.h"
+
+namespace mcucore {
+namespace test {
+namespace {
+
+using Values = std::map<uint8_t, std::string>;
+
+EepromTag MakeTag(uint8_t id) { return EepromTag{MCU_DOMAIN(1), id}; }
+
+void WriteValue(EepromTlv& tlv, uint8_t id, const std::string& value,
+                Values& values) {
+  EXPECT_STATUS_OK(tlv.WriteEntry(
+      MakeTag(id), reinterpret_cast<const uint8_t*>(value.data()),
+      value.size()));
+  values[id] = value;
+}
+
+// Returns true if eeprom holds a valid EepromTlv with exactly the values.
+bool HasValues(EEPROMClass& eeprom, const Values& values) {
+  auto status_or_tlv = EepromTlv::GetIfValid(eeprom);
+  if (!status_or_tlv.ok()) {
+    return false;
+  }
+  uint8_t buffer[EepromTlv::kMaxBlockLength];
+  for (uint8_t id = 1; id < 20; ++id) {
+    auto status_or_length =
+        status_or_tlv.value().ReadEntry(MakeTag(id), buffer, sizeof buffer);
+    auto iter = values.find(id);
+    if (iter == values.end()) {
+      if (status_or_length.ok()) {
+        return false;
+      }
+    } else if (!status_or_length.ok() ||
+               iter->second !=
+                   std::string(reinterpret_cast<const char*>(buffer),
+                               status_or_length.value())) {
+      return false;
+    }
+  }
+  return true;
+}
+
+// Writes entries with a mix of sizes, and then replaces or deletes some of
+// them, leaving unused entries of various sizes between the live ones. The
+// first unused entry is smaller than the entry after it, so that entry must be
+// copied to the end.
+Values MakeFragmentedEntries(EepromTlv& tlv) {
+  Values values;
+  WriteValue(tlv, 9, "nine", values);
+  WriteValue(tlv, 1, std::string(50, 'a'), values);
+  WriteValue(tlv, 2, std::string(40, 'b'), values);
+  WriteValue(tlv, 3, "three", values);
+  WriteValue(tlv, 4, std::string(20, 'd'), values);
+  WriteValue(tlv, 5, "", values);
+  WriteValue(tlv, 6, std::string(60, 'f'), values);
+  WriteValue(tlv, 7, "seven", values);
+  WriteValue(tlv, 2, "bee", values);
+  WriteValue(tlv, 6, "eff", values);
+  WriteValue(tlv, 8, std::string(30, 'h'), values);
+  EXPECT_STATUS_OK(tlv.DeleteEntry(MakeTag(4)));
+  values.erase(4);
+  EXPECT_STATUS_OK(tlv.DeleteEntry(MakeTag(8)));
+  values.erase(8);
+  EXPECT_STATUS_OK(tlv.DeleteEntry(MakeTag(9)));
+  values.erase(9);
+  return values;
+}
+
+TEST(EepromTlvCompactorTest, NothingToCompact) {
+  EEPROMClass eeprom;
+  auto tlv = EepromTlv::ClearAndInitializeEeprom(eeprom).value();
+  EepromTlvCompactor compactor(tlv);
+  EXPECT_FALSE(compactor.done());
+  EXPECT_THAT(compactor.Step(100), IsOkAndHolds(true));
+  EXPECT_TRUE(compactor.done());
+
+  Values values;
+  WriteValue(tlv, 1, "one", values);
+  WriteValue(tlv, 2, "two", values);
+  EXPECT_THAT(compactor.Step(100), IsOkAndHolds(true));
+  EXPECT_EQ(compactor.bytes_moved(), 0);
+  EXPECT_TRUE(HasValues(eeprom, values));
+}
+
+TEST(EepromTlvCompactorTest, CompactsLikeReclaimUnusedSpace) {
+  EEPROMClass eeprom;
+  auto tlv = EepromTlv::ClearAndInitializeEeprom(eeprom).value();
+  const Values values = MakeFragmentedEntries(tlv);
+
+  EEPROMClass reclaimed = eeprom;
+  auto reclaimed_tlv = EepromTlv::GetIfValid(reclaimed).value();
+  ASSERT_THAT(reclaimed_tlv.ReclaimUnusedSpace(), IsOk());
+
+  // The entries are valid between steps.
+  EepromTlvCompactor compactor(tlv);
+  int steps = 0;
+  while (!compactor.done()) {
+    ASSERT_LT(++steps, 20);
+    ASSERT_THAT(compactor.Step(1), IsOk());
+    EXPECT_TRUE(HasValues(eeprom, values)) << steps;
+    EXPECT_STATUS_OK(tlv.Validate(EepromTlv::kForce));
+  }
+  EXPECT_GT(steps, 3);
+  EXPECT_EQ(tlv.Available(), reclaimed_tlv.Available());
+  EXPECT_THAT(tlv.ReclaimUnusedSpace(), IsOkAndHolds(0));
+}
+
+TEST(EepromTlvCompactorTest, StepIsLimitedByMaxBytes) {
+  EEPROMClass eeprom;
+  auto tlv = EepromTlv::ClearAndInitializeEeprom(eeprom).value();
+  Values values;
+  for (uint8_t id = 1; id <= 6; ++id) {
+    WriteValue(tlv, id, std::string(10, 'a' + id), values);
+  }
+  EXPECT_STATUS_OK(tlv.DeleteEntry(MakeTag(1)));
+  values.erase(1);
+  const EepromAddrT entry_size = EepromTlv::kEntryHeaderSize + 10;
+
+  EepromTlvCompactor compactor(tlv);
+  // At least one entry is moved, even if max_bytes is smaller.
+  EXPECT_THAT(compactor.Step(1), IsOkAndHolds(false));
+  EXPECT_EQ(compactor.bytes_moved(), entry_size);
+  EXPECT_THAT(compactor.Step(entry_size), IsOkAndHolds(false));
+  EXPECT_EQ(compactor.bytes_moved(), 2 * entry_size);
+  EXPECT_THAT(compactor.Step(2 * entry_size + 1), IsOkAndHolds(false));
+  EXPECT_EQ(compactor.bytes_moved(), 4 * entry_size);
+  EXPECT_TRUE(HasValues(eeprom, values));
+  EXPECT_THAT(compactor.Step(1000), IsOkAndHolds(true));
+  EXPECT_EQ(compactor.bytes_moved(), 5 * entry_size);
+  EXPECT_TRUE(HasValues(eeprom, values));
+  EXPECT_EQ(tlv.Available(), eeprom.length() - EepromTlv::kFixedHeaderSize -
+                                 5 * entry_size - EepromTlv::kEntryHeaderSize);
+}
+
+TEST(EepromTlvCompactorTest, UpdatesIndex) {
+  EEPROMClass eeprom;
+  EepromTlvIndex<10> index;
+  auto tlv = EepromTlv::ClearAndInitializeEeprom(eeprom, &index).value();
+  const Values values = MakeFragmentedEntries(tlv);
+  EepromTlvCompactor compactor(tlv);
+  EXPECT_THAT(compactor.Step(1000), IsOkAndHolds(true));
+  EXPECT_TRUE(index.complete());
+  EXPECT_EQ(index.size(), values.size());
+  for (const auto& [id, value] : values) {
+    uint8_t buffer[EepromTlv::kMaxBlockLength];
+    EXPECT_THAT(tlv.ReadEntry(MakeTag(id), buffer, sizeof buffer),
+                IsOkAndHolds(value.size()));
+    EXPECT_EQ(std::string(reinterpret_cast<const char*>(buffer), value.size()),
+              value);
+  }
+}
+
+TEST(EepromTlvCompactorTest, NeedsRoomForJournal) {
+  EEPROMClass eeprom(64);
+  auto tlv = EepromTlv::ClearAndInitializeEeprom(eeprom).value();
+  Values values;
+  WriteValue(tlv, 1, "1234", values);
+  WriteValue(tlv, 2, std::string(40, 'x'), values);
+  EXPECT_STATUS_OK(tlv.DeleteEntry(MakeTag(1)));
+  values.erase(1);
+  EepromTlvCompactor compactor(tlv);
+  EXPECT_THAT(compactor.Step(100),
+              StatusIs(StatusCode::kResourceExhausted));
+  EXPECT_TRUE(HasValues(eeprom, values));
+  EXPECT_THAT(tlv.ReclaimUnusedSpace(), IsOkAndHolds(7));
+  EXPECT_TRUE(HasValues(eeprom, values));
+}
+
+// Restores the tag of the superseded entry at entry_addr, as if the commit of
+// the newer entry was interrupted before marking the older one as unused.
+void ReviveEntry(EEPROMClass& eeprom, EepromAddrT entry_addr, uint8_t id) {
+  const auto tag = MakeTag(id);
+  eeprom.write(entry_addr, tag.domain.value());
+  eeprom.write(entry_addr + 1, tag.id);
+}
+
+TEST(EepromTlvCompactorTest, DoesNotCopyStaleEntryToEnd) {
+  EEPROMClass eeprom;
+  auto tlv = EepromTlv::ClearAndInitializeEeprom(eeprom).value();
+  Values values;
+  WriteValue(tlv, 9, "x", values);
+  const EepromAddrT stale_entry_addr =
+      EepromTlv::kFixedHeaderSize + EepromTlv::kEntryHeaderSize + 1;
+  WriteValue(tlv, 1, "a stale value, too big to move down", values);
+  WriteValue(tlv, 1, "new", values);
+  EXPECT_STATUS_OK(tlv.DeleteEntry(MakeTag(9)));
+  values.erase(9);
+  ReviveEntry(eeprom, stale_entry_addr, 1);
+  EXPECT_TRUE(HasValues(eeprom, values));
+
+  EepromTlvCompactor compactor(tlv);
+  EXPECT_THAT(compactor.Step(1000), IsOkAndHolds(true));
+  EXPECT_TRUE(HasValues(eeprom, values));
+  EXPECT_THAT(tlv.ReclaimUnusedSpace(), IsOkAndHolds(0));
+}
+
+TEST(EepromTlvCompactorTest, DoesNotIndexStaleEntry) {
+  EEPROMClass eeprom;
+  {
+    auto tlv = EepromTlv::ClearAndInitializeEeprom(eeprom).value();
+    Values values;
+    WriteValue(tlv, 9, std::string(20, 'x'), values);
+    WriteValue(tlv, 1, "old", values);
+    WriteValue(tlv, 1, "new", values);
+    EXPECT_STATUS_OK(tlv.DeleteEntry(MakeTag(9)));
+  }
+  ReviveEntry(eeprom,
+              EepromTlv::kFixedHeaderSize + EepromTlv::kEntryHeaderSize + 20,
+              1);
+
+  EepromTlvIndex<4> index;
+  auto tlv = EepromTlv::GetIfValid(eeprom, &index).value();
+  EXPECT_FALSE(index.complete());
+  EepromTlvCompactor compactor(tlv);
+  int steps = 0;
+  while (!compactor.done()) {
+    ASSERT_LT(++steps, 10);
+    ASSERT_THAT(compactor.Step(1), IsOk());
+    uint8_t buffer[EepromTlv::kMaxBlockLength];
+    EXPECT_THAT(tlv.ReadEntry(MakeTag(1), buffer, sizeof buffer),
+                IsOkAndHolds(3));
+    EXPECT_EQ(std::string(reinterpret_cast<const char*>(buffer), 3), "new")
+        << steps;
+  }
+  EXPECT_TRUE(HasValues(eeprom, {{1, "new"}}));
+}
+
+bool SameContents(EEPROMClass& a, EEPROMClass& b) {
+  for (int ndx = 0; ndx < a.length(); ++ndx) {
+    if (a.read(ndx) != b.read(ndx)) {
+      return false;
+    }
+  }
+  return true;
+}
+
+// Simulates a power loss after each write of each step, confirming that the
+// entries are still valid (after recovery by GetIfValid), with the expected
+// values; the only exception is the window during which the CRC and beyond
+// address of a commit (i.e. of an entry copied to the end) are being written.
+TEST(EepromTlvCompactorTest, RecoversFromPowerLoss) {
+  PowerLossEeprom eeprom;
+  auto tlv = EepromTlv::ClearAndInitializeEeprom(eeprom).value();
+  const Values values = MakeFragmentedEntries(tlv);
+
+  // The CRC (4 bytes) and then the beyond address (2 bytes) of a commit are
+  // written separately, so there are at most 5 states in which they're
+  // inconsistent.
+  int failures = 0;
+  int recoveries = 0;
+  int steps = 0;
+  bool done = false;
+  while (!done) {
+    ASSERT_LT(++steps, 20);
+    for (int writes = 0;; ++writes) {
+      PowerLossEeprom snapshot = eeprom;
+      auto snapshot_tlv = EepromTlv::GetIfValid(snapshot).value();
+      EepromTlvCompactor compactor(snapshot_tlv);
+      snapshot.writes_remaining = writes;
+      try {
+        ASSERT_THAT(compactor.Step(1), IsOk());
+        // The step completed without losing power.
+        break;
+      } catch (const PowerLoss&) {
+      }
+      snapshot.writes_remaining = -1;
+      EEPROMClass before_recovery = snapshot;
+      if (!HasValues(snapshot, values)) {
+        ++failures;
+      } else if (!SameContents(snapshot, before_recovery)) {
+        ++recoveries;
+      }
+    }
+
+    EepromTlvCompactor compactor(tlv);
+    auto status_or_done = compactor.Step(1);
+    ASSERT_THAT(status_or_done, IsOk());
+    done = status_or_done.value();
+    EXPECT_TRUE(HasValues(eeprom, values));
+  }
+  EXPECT_LE(failures, 5);
+  EXPECT_GT(recoveries, 100);
+}
+
+TEST(EepromTlvCompactorTest, WriteEntryCompactsSafely) {
+  // The journal is at 106.
+  PowerLossEeprom eeprom(128);
+  auto tlv = EepromTlv::ClearAndInitializeEeprom(eeprom).value();
+  Values values;
+  WriteValue(tlv, 1, std::string(40, 'a'), values);
+  WriteValue(tlv, 1, std::string(40, 'b'), values);
+  const Values old_values = values;
+  const std::string value(30, 'c');
+  values[2] = value;
+
+  // The new entry doesn't fit, so writing it first moves the live entry down;
+  // that is safe to interrupt, as is the commit after it except for the brief
+  // window while the CRC and beyond address are written.
+  int failures = 0;
+  for (int writes = 0;; ++writes) {
+    ASSERT_LT(writes, 1000);
+    PowerLossEeprom snapshot = eeprom;
+    auto snapshot_tlv = EepromTlv::GetIfValid(snapshot).value();
+    snapshot.writes_remaining = writes;
+    try {
+      Values ignored;
+      WriteValue(snapshot_tlv, 2, value, ignored);
+      snapshot.writes_remaining = -1;
+      EXPECT_TRUE(HasValues(snapshot, values));
+      EXPECT_GE(snapshot_tlv.Available(), 30);
+      break;
+    } catch (const PowerLoss&) {
+    }
+    snapshot.writes_remaining = -1;
+    if (!HasValues(snapshot, old_values) && !HasValues(snapshot, values)) {
+      ++failures;
+    }
+  }
+  EXPECT_LE(failures, 5);
+}
+
+}  // namespace
+}  // namespace test
+}  // namespace mcucore
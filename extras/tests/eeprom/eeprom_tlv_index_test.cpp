@@ -0,0 +1,176 @@
+#include "eeprom/eeprom_tlv_index.h"
+
+#include <string>
+#include <vector>
+
+#include "absl/random/random.h"
+#include "eeprom/eeprom_tag.h"
+#include "eeprom/eeprom_tlv.h"
+#include "extras/host/eeprom/eeprom.h"
+#include "extras/test_tools/eeprom_example_domains.h"
+#include "extras/test_tools/status_or_test_utils.h"
+#include "extras/test_tools/status_test_utils.h"
+#include "extras/test_tools/test_has_failed.h"
+#include "gmock/gmock.h"
+#include "gtest/gtest.h"
+#include "status/status_code.h"
+
+namespace mcucore {
+namespace test {
+namespace {
+
+// Counts the bytes read, so we can confirm that the index avoids walking the
+// chain of entries.
+class CountingEeprom : public EEPROMClass {
+ public:
+  uint8_t read(int idx) override {
+    ++reads;
+    return EEPROMClass::read(idx);
+  }
+  void read_block(void* dst, int idx, size_t n) override {
+    reads += n;
+    EEPROMClass::read_block(dst, idx, n);
+  }
+
+  size_t reads = 0;
+};
+
+EepromTag MakeTag(uint8_t id) { return EepromTag{MCU_DOMAIN(1), id}; }
+
+std::string ReadEntryString(EepromTlv& tlv, EepromTag tag) {
+  uint8_t buffer[EepromTlv::kMaxBlockLength];
+  auto status_or_length = tlv.ReadEntry(tag, buffer, sizeof buffer);
+  if (!status_or_length.ok()) {
+    return "<error>";
+  }
+  return std::string(reinterpret_cast<const char*>(buffer),
+                     status_or_length.value());
+}
+
+Status WriteEntryString(EepromTlv& tlv, EepromTag tag, const std::string& s) {
+  return tlv.WriteEntry(tag, reinterpret_cast<const uint8_t*>(s.data()),
+                        s.size());
+}
+
+TEST(EepromTlvIndexTest, BuiltByGetIfValid) {
+  CountingEeprom eeprom;
+  {
+    auto tlv = EepromTlv::ClearAndInitializeEeprom(eeprom).value();
+    for (uint8_t id = 0; id < 10; ++id) {
+      EXPECT_STATUS_OK(
+          WriteEntryString(tlv, MakeTag(id), std::string(id, 'x')));
+    }
+    EXPECT_STATUS_OK(WriteEntryString(tlv, MakeTag(3), "three"));
+    EXPECT_STATUS_OK(tlv.DeleteEntry(MakeTag(4)));
+  }
+
+  EepromTlvIndex<16> index;
+  auto tlv = EepromTlv::GetIfValid(eeprom, &index).value();
+  EXPECT_EQ(index.size(), 9);
+  EXPECT_EQ(index.capacity(), 16);
+  EXPECT_TRUE(index.complete());
+
+  eeprom.reads = 0;
+  EXPECT_EQ(ReadEntryString(tlv, MakeTag(3)), "three");
+  EXPECT_EQ(ReadEntryString(tlv, MakeTag(9)), std::string(9, 'x'));
+  EXPECT_THAT(tlv.FindEntry(MakeTag(4)), StatusIs(StatusCode::kNotFound));
+  EXPECT_THAT(tlv.FindEntry(EepromTag{MCU_DOMAIN(DomainTwo), 3}),
+              StatusIs(StatusCode::kNotFound));
+  // Just the length and value bytes of the two entries that were found.
+  EXPECT_EQ(eeprom.reads, 1 + 5 + 1 + 9);
+}
+
+TEST(EepromTlvIndexTest, IncompleteWhenFull) {
+  EEPROMClass eeprom;
+  EepromTlvIndex<2> index;
+  auto tlv = EepromTlv::ClearAndInitializeEeprom(eeprom, &index).value();
+  EXPECT_TRUE(index.complete());
+  EXPECT_EQ(index.size(), 0);
+  for (uint8_t id = 0; id < 4; ++id) {
+    EXPECT_STATUS_OK(WriteEntryString(tlv, MakeTag(id), std::string(1, id)));
+  }
+  EXPECT_FALSE(index.complete());
+  EXPECT_EQ(index.size(), 2);
+
+  // Tags which aren't in the index are still found.
+  for (uint8_t id = 0; id < 4; ++id) {
+    EXPECT_EQ(ReadEntryString(tlv, MakeTag(id)), std::string(1, id));
+  }
+  EXPECT_STATUS_OK(tlv.DeleteEntry(MakeTag(0)));
+  EXPECT_STATUS_OK(tlv.DeleteEntry(MakeTag(3)));
+  EXPECT_THAT(tlv.FindEntry(MakeTag(0)), StatusIs(StatusCode::kNotFound));
+  EXPECT_THAT(tlv.FindEntry(MakeTag(3)), StatusIs(StatusCode::kNotFound));
+  EXPECT_EQ(ReadEntryString(tlv, MakeTag(2)), std::string(1, 2));
+
+  // Deleting the last entry reinitializes the EEPROM, and the index.
+  EXPECT_STATUS_OK(tlv.DeleteEntry(MakeTag(1)));
+  EXPECT_STATUS_OK(tlv.DeleteEntry(MakeTag(2)));
+  EXPECT_TRUE(index.complete());
+  EXPECT_EQ(index.size(), 0);
+}
+
+TEST(EepromTlvIndexTest, DuplicateTagsMakeIndexIncomplete) {
+  EEPROMClass eeprom;
+  {
+    auto tlv = EepromTlv::ClearAndInitializeEeprom(eeprom).value();
+    EXPECT_STATUS_OK(WriteEntryString(tlv, MakeTag(1), "a"));
+    EXPECT_STATUS_OK(WriteEntryString(tlv, MakeTag(2), "b"));
+  }
+  // Change the tag of the second entry to match the first, which EepromTlv
+  // would not do.
+  eeprom.write(EepromTlv::kFixedHeaderSize + EepromTlv::kEntryHeaderSize + 2,
+               1);
+  EepromTlvIndex<4> index;
+  auto tlv = EepromTlv::GetIfValid(eeprom, &index).value();
+  EXPECT_FALSE(index.complete());
+  EXPECT_EQ(ReadEntryString(tlv, MakeTag(1)), "b");
+  EXPECT_STATUS_OK(tlv.DeleteEntry(MakeTag(1)));
+  EXPECT_THAT(tlv.FindEntry(MakeTag(1)), StatusIs(StatusCode::kNotFound));
+}
+
+// Performs the same random sequence of operations on two EEPROMs, one with an
+// index and one without, and verifies that the contents of the EEPROMs remain
+// identical.
+void MatchesUnindexedTlv(EepromTlvIndexBase& index) {
+  EEPROMClass indexed_eeprom;
+  EEPROMClass unindexed_eeprom;
+  auto indexed_tlv =
+      EepromTlv::ClearAndInitializeEeprom(indexed_eeprom, &index).value();
+  auto unindexed_tlv =
+      EepromTlv::ClearAndInitializeEeprom(unindexed_eeprom).value();
+  absl::BitGen bitgen;
+  for (int i = 0; i < 1000 && !TestHasFailed(); ++i) {
+    const auto tag = MakeTag(absl::Uniform<uint8_t>(bitgen, 0, 12));
+    if (absl::Bernoulli(bitgen, 0.3)) {
+      EXPECT_EQ(indexed_tlv.DeleteEntry(tag), unindexed_tlv.DeleteEntry(tag));
+    } else {
+      const std::string value(absl::Uniform<size_t>(bitgen, 0, 40),
+                              'a' + (i % 26));
+      EXPECT_EQ(WriteEntryString(indexed_tlv, tag, value),
+                WriteEntryString(unindexed_tlv, tag, value));
+    }
+    for (uint8_t id = 0; id < 12; ++id) {
+      ASSERT_EQ(ReadEntryString(indexed_tlv, MakeTag(id)),
+                ReadEntryString(unindexed_tlv, MakeTag(id)));
+    }
+    for (int addr = 0; addr < indexed_eeprom.length(); ++addr) {
+      ASSERT_EQ(indexed_eeprom.read(addr), unindexed_eeprom.read(addr))
+          << "addr=" << addr << ", i=" << i;
+    }
+  }
+}
+
+TEST(EepromTlvIndexTest, CompleteIndexMatchesUnindexedTlv) {
+  EepromTlvIndex<16> index;
+  MatchesUnindexedTlv(index);
+  EXPECT_TRUE(index.complete());
+}
+
+TEST(EepromTlvIndexTest, IncompleteIndexMatchesUnindexedTlv) {
+  EepromTlvIndex<5> index;
+  MatchesUnindexedTlv(index);
+}
+
+}  // namespace
+}  // namespace test
+}  // namespace mcucore
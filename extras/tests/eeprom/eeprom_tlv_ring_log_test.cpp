@@ -0,0 +1,251 @@
+#include "eeprom/eeprom_tlv_ring_log.h"
+
+#include <algorithm>
+#include <string>
+#include <vector>
+
+#include "eeprom/eeprom_tag.h"
+#include "eeprom/eeprom_tlv.h"
+#include "extras/host/eeprom/eeprom.h"
+#include "extras/test_tools/eeprom_example_domains.h"
+#include "extras/test_tools/eeprom_test_utils.h"
+#include "extras/test_tools/status_or_test_utils.h"
+#include "extras/test_tools/status_test_utils.h"
+#include "gtest/gtest.h"
+#include "status/status_code.h"
+
+namespace mcucore {
+namespace test {
+namespace {
+
+// Counts the number of times each byte is written.
+class WearCountingEeprom : public ByteWritingEeprom {
+ public:
+  void write(int idx, uint8_t val) override {
+    ++write_counts.at(idx);
+    EEPROMClass::write(idx, val);
+  }
+
+  int MaxWriteCount() const {
+    return *std::max_element(write_counts.begin(), write_counts.end());
+  }
+
+  std::vector<int> write_counts = std::vector<int>(length());
+};
+
+EepromTag MakeTag(uint8_t id) { return EepromTag{MCU_DOMAIN(1), id}; }
+
+Status WriteString(EepromTlvRingLog& log, uint8_t id, const std::string& s) {
+  return log.WriteEntry(MakeTag(id), reinterpret_cast<const uint8_t*>(s.data()),
+                        s.size());
+}
+
+std::string ReadString(const EepromTlvRingLog& log, uint8_t id) {
+  uint8_t buffer[EepromTlvRingLog::kMaxBlockLength];
+  auto status_or_length = log.ReadEntry(MakeTag(id), buffer, sizeof buffer);
+  if (!status_or_length.ok()) {
+    return "<error>";
+  }
+  return std::string(reinterpret_cast<const char*>(buffer),
+                     status_or_length.value());
+}
+
+template <class LOG>
+Status WriteCounter(LOG& log, uint32_t value) {
+  return log.WriteEntry(MakeTag(1), reinterpret_cast<const uint8_t*>(&value),
+                        sizeof value);
+}
+
+uint32_t ReadCounter(const EepromTlvRingLog& log) {
+  uint32_t value = 0;
+  EXPECT_THAT(log.ReadEntry(MakeTag(1), reinterpret_cast<uint8_t*>(&value),
+                            sizeof value),
+              IsOkAndHolds(sizeof value));
+  return value;
+}
+
+TEST(EepromTlvRingLogTest, NotValidUntilInitialized) {
+  EEPROMClass eeprom;
+  EXPECT_THAT(EepromTlvRingLog::GetIfValid(eeprom).status(),
+              StatusIs(StatusCode::kNotFound));
+  EXPECT_STATUS_OK(EepromTlvRingLog::Get(eeprom).status());
+  EXPECT_STATUS_OK(EepromTlvRingLog::GetIfValid(eeprom).status());
+
+  EEPROMClass tiny_eeprom(EepromTlvRingLog::kHeaderSlots *
+                          EepromTlvRingLog::kHeaderSlotSize);
+  EXPECT_THAT(EepromTlvRingLog::ClearAndInitializeEeprom(tiny_eeprom).status(),
+              StatusIs(StatusCode::kInvalidArgument));
+}
+
+TEST(EepromTlvRingLogTest, WriteReadAndReopen) {
+  EEPROMClass eeprom;
+  auto log = EepromTlvRingLog::ClearAndInitializeEeprom(eeprom).value();
+  EXPECT_EQ(log.record_count(), 0);
+  EXPECT_THAT(log.FindEntry(MakeTag(1)), StatusIs(StatusCode::kNotFound));
+
+  EXPECT_STATUS_OK(WriteString(log, 1, "one"));
+  EXPECT_STATUS_OK(WriteString(log, 2, ""));
+  EXPECT_STATUS_OK(WriteString(log, 1, "uno"));
+  EXPECT_EQ(log.record_count(), 3);
+  EXPECT_EQ(ReadString(log, 1), "uno");
+  EXPECT_EQ(ReadString(log, 2), "");
+
+  uint8_t buffer[2];
+  EXPECT_THAT(log.ReadEntry(MakeTag(1), buffer, sizeof buffer),
+              StatusIs(StatusCode::kFailedPrecondition));
+  EXPECT_THAT(log.WriteEntry(EepromTag{internal::MakeEepromDomain(0), 1},
+                             buffer, 0),
+              StatusIs(StatusCode::kInvalidArgument));
+
+  auto reopened = EepromTlvRingLog::GetIfValid(eeprom).value();
+  EXPECT_EQ(reopened.record_count(), 3);
+  EXPECT_EQ(ReadString(reopened, 1), "uno");
+  EXPECT_EQ(ReadString(reopened, 2), "");
+}
+
+TEST(EepromTlvRingLogTest, KeepsEntriesWhileWrapping) {
+  EEPROMClass eeprom;
+  auto log = EepromTlvRingLog::ClearAndInitializeEeprom(eeprom).value();
+  EXPECT_STATUS_OK(WriteString(log, 2, "written once"));
+  EXPECT_STATUS_OK(WriteString(log, 3, "deleted"));
+  EXPECT_STATUS_OK(log.DeleteEntry(MakeTag(3)));
+  for (uint32_t value = 0; value < 1000; ++value) {
+    ASSERT_STATUS_OK(WriteCounter(log, value));
+    if (value % 97 == 0) {
+      log = EepromTlvRingLog::GetIfValid(eeprom).value();
+    }
+    ASSERT_EQ(ReadCounter(log), value);
+    ASSERT_EQ(ReadString(log, 2), "written once");
+    ASSERT_THAT(log.FindEntry(MakeTag(3)), StatusIs(StatusCode::kNotFound));
+  }
+  // The log holds only the most recent records.
+  EXPECT_LT(log.record_count(), 40);
+}
+
+TEST(EepromTlvRingLogTest, DeleteEntry) {
+  EEPROMClass eeprom;
+  auto log = EepromTlvRingLog::ClearAndInitializeEeprom(eeprom).value();
+  EXPECT_THAT(log.DeleteEntry(MakeTag(1)), StatusIs(StatusCode::kNotFound));
+  EXPECT_STATUS_OK(WriteString(log, 1, "abc"));
+  EXPECT_STATUS_OK(log.DeleteEntry(MakeTag(1)));
+  EXPECT_THAT(log.FindEntry(MakeTag(1)), StatusIs(StatusCode::kNotFound));
+  EXPECT_THAT(log.DeleteEntry(MakeTag(1)), StatusIs(StatusCode::kNotFound));
+
+  auto reopened = EepromTlvRingLog::GetIfValid(eeprom).value();
+  EXPECT_THAT(reopened.FindEntry(MakeTag(1)), StatusIs(StatusCode::kNotFound));
+  EXPECT_STATUS_OK(WriteString(reopened, 1, "def"));
+  EXPECT_EQ(ReadString(reopened, 1), "def");
+}
+
+TEST(EepromTlvRingLogTest, ClearDiscardsOldRecords) {
+  EEPROMClass eeprom;
+  auto log = EepromTlvRingLog::ClearAndInitializeEeprom(eeprom).value();
+  for (uint32_t value = 0; value < 100; ++value) {
+    ASSERT_STATUS_OK(WriteCounter(log, value));
+  }
+  log = EepromTlvRingLog::ClearAndInitializeEeprom(eeprom).value();
+  EXPECT_EQ(log.record_count(), 0);
+  log = EepromTlvRingLog::GetIfValid(eeprom).value();
+  EXPECT_EQ(log.record_count(), 0);
+  EXPECT_THAT(log.FindEntry(MakeTag(1)), StatusIs(StatusCode::kNotFound));
+}
+
+TEST(EepromTlvRingLogTest, Full) {
+  EEPROMClass eeprom;
+  auto log = EepromTlvRingLog::ClearAndInitializeEeprom(eeprom).value();
+  const std::string value(100, 'x');
+  uint8_t id = 1;
+  Status status;
+  while (status.ok()) {
+    status = WriteString(log, id++, value);
+  }
+  EXPECT_THAT(status, StatusIs(StatusCode::kResourceExhausted));
+  EXPECT_GT(id, 3);
+
+  // The entries written before the log became full are still there, and
+  // remain so after failing to replace one.
+  EXPECT_THAT(WriteString(log, 1, "y"),
+              StatusIs(StatusCode::kResourceExhausted));
+  log = EepromTlvRingLog::GetIfValid(eeprom).value();
+  for (uint8_t old_id = 1; old_id < id - 1; ++old_id) {
+    EXPECT_EQ(ReadString(log, old_id), value);
+  }
+  EXPECT_THAT(log.FindEntry(MakeTag(id - 1)), StatusIs(StatusCode::kNotFound));
+}
+
+TEST(EepromTlvRingLogTest, ReplacesEntriesWhenNearlyFull) {
+  EEPROMClass eeprom;
+  auto log = EepromTlvRingLog::ClearAndInitializeEeprom(eeprom).value();
+  const std::string value(40, 'x');
+  for (uint8_t id = 1; id <= 4; ++id) {
+    ASSERT_STATUS_OK(WriteString(log, id, value));
+  }
+  for (int round = 0; round < 20; ++round) {
+    for (uint8_t id = 1; id <= 4; ++id) {
+      const std::string new_value = value + std::to_string(round);
+      ASSERT_STATUS_OK(WriteString(log, id, new_value));
+      ASSERT_EQ(ReadString(log, id), new_value);
+    }
+  }
+  log = EepromTlvRingLog::GetIfValid(eeprom).value();
+  for (uint8_t id = 1; id <= 4; ++id) {
+    EXPECT_EQ(ReadString(log, id), value + "19");
+  }
+}
+
+TEST(EepromTlvRingLogTest, SpreadsWear) {
+  constexpr uint32_t kWrites = 2000;
+  WearCountingEeprom tlv_eeprom;
+  auto tlv = EepromTlv::ClearAndInitializeEeprom(tlv_eeprom).value();
+  WearCountingEeprom log_eeprom;
+  auto log = EepromTlvRingLog::ClearAndInitializeEeprom(log_eeprom).value();
+  for (uint32_t value = 0; value < kWrites; ++value) {
+    ASSERT_STATUS_OK(WriteCounter(tlv, value));
+    ASSERT_STATUS_OK(WriteCounter(log, value));
+  }
+  EXPECT_EQ(ReadCounter(log), kWrites - 1);
+
+  // Some bytes of the EepromTlv header are written by every commit, while
+  // the writes to the ring log are spread across the EEPROM.
+  EXPECT_GE(tlv_eeprom.MaxWriteCount(), kWrites);
+  EXPECT_LE(log_eeprom.MaxWriteCount() * 10, tlv_eeprom.MaxWriteCount());
+}
+
+TEST(EepromTlvRingLogTest, RecoversFromPowerLoss) {
+  PowerLossEeprom eeprom;
+  auto log = EepromTlvRingLog::ClearAndInitializeEeprom(eeprom).value();
+  ASSERT_STATUS_OK(WriteString(log, 2, "other"));
+  int power_losses = 0;
+  for (uint32_t value = 0; value < 300; ++value) {
+    for (int writes = 0;; ++writes) {
+      eeprom.writes_remaining = writes;
+      bool completed = true;
+      try {
+        ASSERT_STATUS_OK(WriteCounter(log, value));
+      } catch (const PowerLoss&) {
+        completed = false;
+        ++power_losses;
+      }
+      eeprom.writes_remaining = -1;
+
+      // Either the old or the new value of the counter is found after
+      // restarting, and the other entry is unaffected.
+      auto status_or_log = EepromTlvRingLog::GetIfValid(eeprom);
+      ASSERT_STATUS_OK(status_or_log.status());
+      log = status_or_log.value();
+      ASSERT_EQ(ReadString(log, 2), "other");
+      if (completed) {
+        ASSERT_EQ(ReadCounter(log), value);
+        break;
+      } else if (value > 0) {
+        const uint32_t found = ReadCounter(log);
+        ASSERT_TRUE(found == value - 1 || found == value) << found;
+      }
+    }
+  }
+  EXPECT_GT(power_losses, 1000);
+}
+
+}  // namespace
+}  // namespace test
+}  // namespace mcucore
@@ -2,6 +2,7 @@
 
 #include <algorithm>
 #include <cstdint>
+#include <cstring>
 #include <functional>
 #include <ostream>
 #include <string>
@@ -135,6 +136,7 @@ TEST(EepromTlvBasicsTest, WriteAndReadEntry) {
 class UnreadableEepromClass : public EEPROMClass {
  public:
   uint8_t read(int idx) override { return 0; }
+  void read_block(void* dst, int idx, size_t n) override { memset(dst, 0, n); }
 };
 
 TEST(EepromTlvGetOrDieDeathTest, DiesWithNoPrefix) {
@@ -154,6 +156,76 @@ TEST(EepromTlvGetIfValidTest, FailsWithWrongCrc) {
   EXPECT_THAT(EepromTlv::GetIfValid(eeprom), StatusIs(StatusCode::kDataLoss));
 }
 
+// Counts the bytes read, so we can confirm that validation is cached.
+class ReadCountingEeprom : public EEPROMClass {
+ public:
+  uint8_t read(int idx) override {
+    ++reads;
+    return EEPROMClass::read(idx);
+  }
+  void read_block(void* dst, int idx, size_t n) override {
+    reads += n;
+    EEPROMClass::read_block(dst, idx, n);
+  }
+
+  size_t reads = 0;
+};
+
+TEST(EepromTlvValidationTest, ValidationIsCached) {
+  ReadCountingEeprom eeprom;
+  auto eeprom_tlv = EepromTlv::ClearAndInitializeEeprom(eeprom).value();
+  const std::string value(100, 'x');
+  for (uint8_t id = 1; id <= 3; ++id) {
+    EXPECT_STATUS_OK(eeprom_tlv.WriteEntry(
+        EepromTag{MCU_DOMAIN(1), id},
+        reinterpret_cast<const uint8_t*>(value.data()), value.size()));
+  }
+
+  // Just the prefix, beyond address and CRC are read.
+  eeprom.reads = 0;
+  EXPECT_STATUS_OK(eeprom_tlv.Validate());
+  EXPECT_EQ(eeprom.reads, kAddressOfFirstEntry);
+
+  // All of the entries are read.
+  eeprom.reads = 0;
+  EXPECT_STATUS_OK(eeprom_tlv.Validate(EepromTlv::kForce));
+  EXPECT_GT(eeprom.reads, 3 * value.size());
+
+  // Another instance modifies the EEPROM, so the cached state is stale.
+  auto other_tlv = EepromTlv::GetIfValid(eeprom).value();
+  EXPECT_STATUS_OK(
+      other_tlv.WriteEntry(EepromTag{MCU_DOMAIN(1), 4}, nullptr, 0));
+  eeprom.reads = 0;
+  EXPECT_STATUS_OK(eeprom_tlv.Validate());
+  EXPECT_GT(eeprom.reads, 3 * value.size());
+}
+
+TEST(EepromTlvStatsTest, UnchangedBytesAreNotWritten) {
+  EEPROMClass eeprom;
+  auto eeprom_tlv = EepromTlv::ClearAndInitializeEeprom(eeprom).value();
+  EXPECT_GT(eeprom_tlv.stats().writes, 0);
+
+  // Initializing again doesn't change anything.
+  eeprom_tlv = EepromTlv::ClearAndInitializeEeprom(eeprom).value();
+  EXPECT_EQ(eeprom_tlv.stats().writes, 0);
+  EXPECT_EQ(eeprom_tlv.stats().skips, kAddressOfFirstEntry);
+
+  // Every byte of the new entry, and of the CRC and beyond address, is either
+  // written or skipped; the zero bytes in the value are already zero.
+  eeprom_tlv.ResetStats();
+  const uint8_t value[] = {1, 0, 0, 2};
+  EXPECT_STATUS_OK(
+      eeprom_tlv.WriteEntry(EepromTag{MCU_DOMAIN(1), 1}, value, sizeof value));
+  EXPECT_EQ(eeprom_tlv.stats().writes + eeprom_tlv.stats().skips,
+            3 + sizeof value + 4 + 2);
+  EXPECT_GE(eeprom_tlv.stats().skips, 2);
+
+  eeprom_tlv.ResetStats();
+  EXPECT_EQ(eeprom_tlv.stats().writes, 0);
+  EXPECT_EQ(eeprom_tlv.stats().skips, 0);
+  EXPECT_EQ(eeprom_tlv.stats().erases, 0);
+}
+
 StatusOr<EepromTlv> MakeEmpty(EEPROMClass& eeprom) {
   EepromTlv::ClearAndInitializeEeprom(eeprom);
   return EepromTlv::GetIfValid(eeprom);
@@ -484,8 +556,15 @@ TEST_F(EepromTlvTest, ValidateWithWrongEntryLength) {
   ++entry_data_length;
   eeprom_.put(entry_data_length_addr, entry_data_length);
 
-  // Should be invalid now.
+  // The stored beyond address and CRC haven't changed, so the cached result of
+  // the last validation is used, unless a full validation is forced.
+  EXPECT_STATUS_OK(eeprom_tlv_.Validate());
+  EXPECT_THAT(eeprom_tlv_.Validate(EepromTlv::kForce),
+              StatusIs(StatusCode::kDataLoss));
+
+  // Should be invalid now, including for a new instance.
   EXPECT_THAT(eeprom_tlv_.Validate(), StatusIs(StatusCode::kDataLoss));
+  EXPECT_THAT(EepromTlv::GetIfValid(eeprom_), StatusIs(StatusCode::kDataLoss));
 
   // And shouldn't be able to find the entry.
   EXPECT_THAT(FindEntry(MCU_DOMAIN(TestDomain4), 2),
@@ -557,6 +636,28 @@ TEST_F(EepromTlvTest, ReservedDomain) {
       StatusIs(StatusCode::kInvalidArgument, HasSubstr("Domain is reserved")));
 }
 
+TEST_F(EepromTlvTest, TornUnusedTagIsUnused) {
+  // Write the domain of the unused tag, but not the id, as if marking the entry
+  // as unused was interrupted by a power loss.
+  ASSERT_STATUS_OK_AND_ASSIGN(
+      const auto data_addr,
+      WriteStringEntryToCursor(MCU_DOMAIN(1), 5, "five"));
+  ASSERT_STATUS_OK(WriteAndReadStdString(MCU_DOMAIN(1), 6, "six"));
+  eeprom_.write(data_addr - kSizeOfEntryHeader, 0);
+
+  ASSERT_STATUS_OK_AND_ASSIGN(auto tlv, EepromTlv::GetIfValid(eeprom_));
+  EXPECT_THAT(tlv.FindEntry(EepromTag{MCU_DOMAIN(1), 5}),
+              StatusIs(StatusCode::kNotFound));
+  EXPECT_THAT(tlv.FindEntry(EepromTag{internal::MakeEepromDomain(0), 5}),
+              StatusIs(StatusCode::kNotFound));
+  EXPECT_THAT(tlv.DeleteEntry(EepromTag{internal::MakeEepromDomain(0), 5}),
+              StatusIs(StatusCode::kNotFound));
+  EXPECT_THAT(ReadStdString(MCU_DOMAIN(1), 6), IsOkAndHolds("six"));
+  EXPECT_THAT(tlv.ReclaimUnusedSpace(),
+              IsOkAndHolds(kSizeOfEntryHeader + 4));
+  EXPECT_THAT(ReadStdString(MCU_DOMAIN(1), 6), IsOkAndHolds("six"));
+}
+
 TEST_F(EepromTlvTest, NestedTransactionFails) {
   const EepromTag outer_tag{MCU_DOMAIN(1), 1};
   const EepromTag nested_tag{MCU_DOMAIN(1), 2};
@@ -591,6 +692,95 @@ TEST_F(EepromTlvTest, AbortTransaction) {
               StatusIs(StatusCode::kUnknown, "FailToWriteFn"));
 }
 
+using IdAndValue = std::pair<uint8_t, std::string>;
+
+std::vector<IdAndValue> CollectEntries(const EepromTlv& tlv,
+                                       EepromDomain domain) {
+  std::vector<IdAndValue> entries;
+  EXPECT_STATUS_OK(tlv.ForEachEntry(
+      domain, [&entries](EepromTag tag, EepromRegionReader& reader) {
+        entries.emplace_back(tag.id, GetStdString(reader));
+        return OkStatus();
+      }));
+  return entries;
+}
+
+TEST_F(EepromTlvTest, ForEachEntryVisitsNewestEntries) {
+  EXPECT_THAT(CollectEntries(eeprom_tlv_, MCU_DOMAIN(1)), testing::IsEmpty());
+  ASSERT_STATUS_OK(WriteAndReadStdString(MCU_DOMAIN(1), 1, "a"));
+  ASSERT_STATUS_OK(WriteAndReadStdString(MCU_DOMAIN(TestDomain2), 1, "x"));
+  ASSERT_STATUS_OK(WriteAndReadStdString(MCU_DOMAIN(1), 2, "b"));
+  ASSERT_STATUS_OK(WriteAndReadStdString(MCU_DOMAIN(1), 1, "aa"));
+  ASSERT_STATUS_OK(WriteAndReadStdString(MCU_DOMAIN(1), 3, ""));
+  ASSERT_STATUS_OK(DeleteEntry(MCU_DOMAIN(1), 2));
+
+  EXPECT_THAT(CollectEntries(eeprom_tlv_, MCU_DOMAIN(1)),
+              testing::ElementsAre(IdAndValue{1, "aa"}, IdAndValue{3, ""}));
+  EXPECT_THAT(CollectEntries(eeprom_tlv_, MCU_DOMAIN(TestDomain2)),
+              testing::ElementsAre(IdAndValue{1, "x"}));
+  EXPECT_THAT(CollectEntries(eeprom_tlv_, MCU_DOMAIN(3)), testing::IsEmpty());
+}
+
+TEST_F(EepromTlvTest, ForEachEntrySkipsOlderDuplicates) {
+  // Restore the tag of the first entry after it has been marked as unused, as
+  // if the commit of the second entry was interrupted. The tags aren't covered
+  // by the CRC, so the EEPROM remains valid.
+  ASSERT_STATUS_OK_AND_ASSIGN(
+      const auto old_data_addr,
+      WriteStringEntryToCursor(MCU_DOMAIN(1), 1, "old"));
+  ASSERT_STATUS_OK(WriteAndReadStdString(MCU_DOMAIN(1), 2, "two"));
+  ASSERT_STATUS_OK(WriteAndReadStdString(MCU_DOMAIN(1), 1, "new"));
+  ASSERT_STATUS_OK(WriteAndReadStdString(MCU_DOMAIN(1), 3, "three"));
+  const EepromAddrT old_entry_addr = old_data_addr - kSizeOfEntryHeader;
+  eeprom_.write(old_entry_addr, MCU_DOMAIN(1).value());
+  eeprom_.write(old_entry_addr + 1, 1);
+  ASSERT_STATUS_OK(eeprom_tlv_.Validate(EepromTlv::kForce));
+
+  EXPECT_THAT(CollectEntries(eeprom_tlv_, MCU_DOMAIN(1)),
+              testing::ElementsAre(IdAndValue{2, "two"}, IdAndValue{1, "new"},
+                                   IdAndValue{3, "three"}));
+  EXPECT_THAT(ReadStdString(MCU_DOMAIN(1), 1), IsOkAndHolds("new"));
+}
+
+TEST_F(EepromTlvTest, EntryIterator) {
+  ASSERT_STATUS_OK(WriteAndReadStdString(MCU_DOMAIN(1), 7, "seven"));
+  ASSERT_STATUS_OK(WriteAndReadStdString(MCU_DOMAIN(3), 1, "other"));
+  EepromTlvEntryIterator iter(eeprom_tlv_, MCU_DOMAIN(1));
+  EXPECT_THAT(iter.Next(), IsOkAndHolds(true));
+  EXPECT_EQ(iter.tag(), (EepromTag{MCU_DOMAIN(1), 7}));
+  EXPECT_EQ(GetStdString(iter.reader()), "seven");
+  EXPECT_THAT(iter.Next(), IsOkAndHolds(false));
+  EXPECT_THAT(iter.Next(), IsOkAndHolds(false));
+
+  EepromTlvEntryIterator reserved_iter(eeprom_tlv_,
+                                       internal::MakeEepromDomain(0));
+  EXPECT_THAT(
+      reserved_iter.Next(),
+      StatusIs(StatusCode::kInvalidArgument, HasSubstr("Domain is reserved")));
+}
+
+TEST_F(EepromTlvTest, ForEachEntryStopsOnError) {
+  ASSERT_STATUS_OK(WriteAndReadStdString(MCU_DOMAIN(1), 1, "one"));
+  ASSERT_STATUS_OK(WriteAndReadStdString(MCU_DOMAIN(1), 2, "two"));
+  int calls = 0;
+  EXPECT_THAT(eeprom_tlv_.ForEachEntry(
+                  MCU_DOMAIN(1),
+                  [&calls](EepromTag tag, EepromRegionReader& reader) {
+                    ++calls;
+                    return UnknownError(MCU_PSV("Stop"));
+                  }),
+              StatusIs(StatusCode::kUnknown, "Stop"));
+  EXPECT_EQ(calls, 1);
+
+  PutBeyondAddr(eeprom_, GetBeyondAddr(eeprom_) + 1);
+  EXPECT_THAT(eeprom_tlv_.ForEachEntry(
+                  MCU_DOMAIN(1),
+                  [](EepromTag tag, EepromRegionReader& reader) {
+                    return OkStatus();
+                  }),
+              StatusIs(StatusCode::kDataLoss));
+}
+
 class DeleteSelectedEntriesTest : public EepromTlvTest {
  protected:
   static std::string MakeData(int index) {
@@ -0,0 +1,87 @@
+#include "eeprom/eeprom_write_queue.h"
+
+#include <vector>
+
+#include "extras/host/eeprom/eeprom.h"
+#include "gmock/gmock.h"
+#include "gtest/gtest.h"
+
+namespace mcucore {
+namespace test {
+namespace {
+
+using ::testing::ElementsAre;
+
+// Records the addresses written to, in order.
+class RecordingEeprom : public EEPROMClass {
+ public:
+  void write(int idx, uint8_t val) override {
+    writes.push_back(idx);
+    EEPROMClass::write(idx, val);
+  }
+
+  std::vector<int> writes;
+};
+
+TEST(EepromWriteQueueTest, WritesRunsInOrder) {
+  RecordingEeprom eeprom;
+  EepromWriteQueue<16, 3> queue(eeprom);
+  EXPECT_TRUE(queue.idle());
+  EXPECT_FALSE(queue.Tick());
+
+  const uint8_t run1[] = {1, 0, 2};
+  const uint8_t run2[] = {3, 4};
+  EXPECT_TRUE(queue.Enqueue(100, run1, sizeof run1));
+  EXPECT_TRUE(queue.Enqueue(20, run2, sizeof run2));
+  EXPECT_TRUE(queue.Enqueue(30, run2, 0));  // Empty runs are ignored.
+  EXPECT_FALSE(queue.idle());
+  EXPECT_THAT(eeprom.writes, ElementsAre());
+
+  // One byte per tick; the zero byte is skipped, as it is already zero.
+  EXPECT_TRUE(queue.Tick());
+  EXPECT_THAT(eeprom.writes, ElementsAre(100));
+  EXPECT_TRUE(queue.Tick());
+  EXPECT_TRUE(queue.Tick());
+  EXPECT_TRUE(queue.Tick());
+  EXPECT_THAT(eeprom.writes, ElementsAre(100, 102, 20));
+  EXPECT_FALSE(queue.Tick());
+  EXPECT_TRUE(queue.idle());
+  EXPECT_THAT(eeprom.writes, ElementsAre(100, 102, 20, 21));
+  EXPECT_EQ(eeprom.read(101), 0);
+  EXPECT_EQ(eeprom.read(102), 2);
+  EXPECT_EQ(eeprom.read(21), 4);
+  EXPECT_EQ(queue.stats().writes, 4);
+  EXPECT_EQ(queue.stats().skips, 1);
+}
+
+TEST(EepromWriteQueueTest, Capacity) {
+  EEPROMClass eeprom;
+  EepromWriteQueue<8, 2> queue(eeprom);
+  const uint8_t data[9] = {1, 2, 3, 4, 5, 6, 7, 8, 9};
+  EXPECT_FALSE(queue.CanEnqueue(9));
+  EXPECT_FALSE(queue.Enqueue(0, data, 9));
+  EXPECT_TRUE(queue.CanEnqueue(8, 2));
+  EXPECT_FALSE(queue.CanEnqueue(1, 3));
+  EXPECT_TRUE(queue.Enqueue(0, data, 5));
+  EXPECT_FALSE(queue.Enqueue(10, data, 4));
+  EXPECT_TRUE(queue.Enqueue(10, data, 3));
+  EXPECT_FALSE(queue.Enqueue(20, data, 1));  // No more runs.
+
+  // Only one queue at a time can have pending writes.
+  EepromWriteQueue<8, 2> other_queue(eeprom);
+  EXPECT_FALSE(other_queue.CanEnqueue(1));
+  EXPECT_FALSE(other_queue.Enqueue(30, data, 1));
+
+  // Space is reclaimed once the queue is idle.
+  queue.Flush();
+  EXPECT_TRUE(queue.idle());
+  EXPECT_EQ(eeprom.read(4), 5);
+  EXPECT_EQ(eeprom.read(12), 3);
+  EXPECT_TRUE(other_queue.Enqueue(30, data, 8));
+  other_queue.Flush();
+  EXPECT_TRUE(queue.CanEnqueue(8, 2));
+}
+
+}  // namespace
+}  // namespace test
+}  // namespace mcucore
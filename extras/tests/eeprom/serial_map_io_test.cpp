@@ -0,0 +1,153 @@
+#include "eeprom/serial_map_io.h"
+
+#include <string>
+#include <vector>
+
+#include "container/serial_map.h"
+#include "eeprom/eeprom_tag.h"
+#include "eeprom/eeprom_tlv.h"
+#include "extras/host/eeprom/eeprom.h"
+#include "extras/test_tools/eeprom_example_domains.h"
+#include "extras/test_tools/status_or_test_utils.h"
+#include "extras/test_tools/status_test_utils.h"
+#include "gmock/gmock.h"
+#include "gtest/gtest.h"
+#include "status/status_code.h"
+#include "strings/string_view.h"
+
+namespace mcucore {
+namespace test {
+namespace {
+
+using ::testing::ElementsAre;
+
+template <typename KEY, size_t SIZE, size_t INDEX_SIZE>
+std::vector<KEY> KeysInSerialMap(
+    const SerialMap<KEY, SIZE, INDEX_SIZE>& serial_map) {
+  std::vector<KEY> keys;
+  for (auto* entry = serial_map.First(); entry != nullptr;
+       entry = serial_map.Next(*entry)) {
+    keys.push_back(entry->GetKey());
+  }
+  return keys;
+}
+
+template <typename SERIAL_MAP, typename KEY>
+Status InsertStdString(SERIAL_MAP& serial_map, const KEY key,
+                       const std::string& str) {
+  return serial_map.Insert(key, str.length(),
+                           reinterpret_cast<const uint8_t*>(str.data()));
+}
+
+TEST(SerialMapIoTest, SaveAndLoad) {
+  EEPROMClass eeprom;
+  auto tlv = EepromTlv::ClearAndInitializeEeprom(eeprom).value();
+  const EepromTag tag{MCU_DOMAIN(1), 1};
+  const EepromTag other_tag{MCU_DOMAIN(DomainTwo), 2};
+
+  SerialMap<uint16_t, 100, 4> saved_map;
+  EXPECT_STATUS_OK(saved_map.Insert<float>(3, 3.5f));
+  EXPECT_STATUS_OK(saved_map.Insert<uint8_t>(1, 1));
+  EXPECT_STATUS_OK(saved_map.Insert(2, StringView("two")));
+  EXPECT_STATUS_OK(SaveSerialMap(saved_map, tlv, tag));
+
+  // The whole map is stored as a single EepromTlv entry.
+  const auto reader = tlv.FindEntry(tag).value();
+  EXPECT_EQ(reader.length(), 3 * 3 + 4 + 1 + 3);
+
+  // Loading replaces the existing contents, and rebuilds the index.
+  SerialMap<uint16_t, 100, 4> loaded_map;
+  EXPECT_STATUS_OK(loaded_map.Insert<int>(9, 9));
+  EXPECT_STATUS_OK(LoadSerialMap(loaded_map, tlv, tag));
+  EXPECT_THAT(KeysInSerialMap(loaded_map), ElementsAre(3, 1, 2));
+  EXPECT_THAT(loaded_map.GetValue<float>(3), IsOkAndHolds(3.5f));
+  EXPECT_THAT(loaded_map.GetValue<uint8_t>(1), IsOkAndHolds(1));
+  EXPECT_THAT(loaded_map.GetValue<StringView>(2), IsOkAndHolds("two"));
+  EXPECT_EQ(loaded_map.Find(9), nullptr);
+  EXPECT_STATUS_OK(loaded_map.Insert<int>(4, 4));
+
+  // An unindexed map can load the same entries.
+  SerialMap<uint16_t, 20> unindexed_map;
+  EXPECT_STATUS_OK(LoadSerialMap(unindexed_map, tlv, tag));
+  EXPECT_THAT(KeysInSerialMap(unindexed_map), ElementsAre(3, 1, 2));
+
+  // Saving again replaces the previously saved entries; saving an empty map is
+  // fine.
+  EXPECT_TRUE(saved_map.Remove(1));
+  EXPECT_STATUS_OK(SaveSerialMap(saved_map, tlv, tag));
+  EXPECT_STATUS_OK(LoadSerialMap(loaded_map, tlv, tag));
+  EXPECT_THAT(KeysInSerialMap(loaded_map), ElementsAre(3, 2));
+  saved_map.Clear();
+  EXPECT_EQ(saved_map.First(), nullptr);
+  EXPECT_STATUS_OK(SaveSerialMap(saved_map, tlv, tag));
+  EXPECT_STATUS_OK(LoadSerialMap(loaded_map, tlv, tag));
+  EXPECT_EQ(loaded_map.First(), nullptr);
+
+  EXPECT_THAT(LoadSerialMap(loaded_map, tlv, other_tag),
+              StatusIs(StatusCode::kNotFound));
+  EXPECT_STATUS_OK(tlv.Validate());
+}
+
+TEST(SerialMapIoTest, SaveAndLoadTooBig) {
+  EEPROMClass eeprom;
+  auto tlv = EepromTlv::ClearAndInitializeEeprom(eeprom).value();
+  const EepromTag tag{MCU_DOMAIN(1), 1};
+
+  SerialMap<uint8_t, 400> big_map;
+  const std::string value(120, 'x');
+  EXPECT_STATUS_OK(InsertStdString(big_map, 1, value));
+  EXPECT_STATUS_OK(InsertStdString(big_map, 2, value));
+  EXPECT_STATUS_OK(SaveSerialMap(big_map, tlv, tag));
+  EXPECT_STATUS_OK(InsertStdString(big_map, 3, value));
+  EXPECT_THAT(SaveSerialMap(big_map, tlv, tag),
+              StatusIs(StatusCode::kResourceExhausted, "Map too big to save"));
+
+  SerialMap<uint8_t, 200> small_map;
+  EXPECT_STATUS_OK(small_map.Insert<int>(9, 9));
+  EXPECT_THAT(LoadSerialMap(small_map, tlv, tag),
+              StatusIs(StatusCode::kResourceExhausted, "Saved map too big"));
+  EXPECT_THAT(small_map.GetValue<int>(9), IsOkAndHolds(9));
+}
+
+TEST(SerialMapIoTest, LoadCorruptEntries) {
+  EEPROMClass eeprom;
+  auto tlv = EepromTlv::ClearAndInitializeEeprom(eeprom).value();
+  const EepromTag tag{MCU_DOMAIN(1), 1};
+  SerialMap<uint8_t, 100, 4> serial_map;
+
+  // The last entry claims to have more bytes than were saved.
+  const uint8_t truncated[] = {1, 1, 'a', 2, 3, 'b', 'c'};
+  EXPECT_STATUS_OK(tlv.WriteEntry(tag, truncated, sizeof truncated));
+  EXPECT_STATUS_OK(serial_map.Insert<int>(9, 9));
+  EXPECT_THAT(LoadSerialMap(serial_map, tlv, tag),
+              StatusIs(StatusCode::kDataLoss, "Saved entry truncated"));
+  EXPECT_EQ(serial_map.First(), nullptr);
+  EXPECT_EQ(serial_map.Find(1), nullptr);
+
+  // Not even room for the header of an entry.
+  const uint8_t no_header[] = {1, 1, 'a', 2};
+  EXPECT_STATUS_OK(tlv.WriteEntry(tag, no_header, sizeof no_header));
+  EXPECT_THAT(LoadSerialMap(serial_map, tlv, tag),
+              StatusIs(StatusCode::kDataLoss, "Saved entry truncated"));
+
+  const uint8_t duplicated[] = {1, 1, 'a', 2, 0, 1, 1, 'b'};
+  EXPECT_STATUS_OK(tlv.WriteEntry(tag, duplicated, sizeof duplicated));
+  EXPECT_THAT(LoadSerialMap(serial_map, tlv, tag),
+              StatusIs(StatusCode::kDataLoss, "Saved key duplicated"));
+  EXPECT_EQ(serial_map.First(), nullptr);
+
+  // More entries than will fit in the index.
+  const uint8_t many[] = {1, 0, 2, 0, 3, 0, 4, 0, 5, 0};
+  EXPECT_STATUS_OK(tlv.WriteEntry(tag, many, sizeof many));
+  EXPECT_THAT(LoadSerialMap(serial_map, tlv, tag),
+              StatusIs(StatusCode::kDataLoss, "Map index full"));
+  EXPECT_EQ(serial_map.First(), nullptr);
+
+  // The map is still usable.
+  EXPECT_STATUS_OK(serial_map.Insert<int>(9, 9));
+  EXPECT_THAT(KeysInSerialMap(serial_map), ElementsAre(9));
+}
+
+}  // namespace
+}  // namespace test
+}  // namespace mcucore
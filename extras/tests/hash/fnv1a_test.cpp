@@ -69,6 +69,24 @@ TEST(Fnv1aTest, FixedStrings) {
   EXPECT_EQ(CalculateHash("10.1.2.3"), 0x3987d90a);
 }
 
+TEST(Fnv1aTest, HashOfBytes) {
+  // "Addr" as a little-endian uint32_t.
+  static_assert(Fnv1aHashOfBytes(0x72646441UL, 4) == 0xc1053e92, "");
+  static_assert(Fnv1aHashOfBytes(0, 0) == 2166136261, "");
+
+  for (const uint64_t value :
+       {0ULL, 1ULL, 0x80ULL, 0xFFFFULL, 0x123456789ABCDEFULL, ~0ULL}) {
+    for (uint8_t size = 0; size <= 8; ++size) {
+      std::vector<uint8_t> bytes;
+      for (uint8_t ndx = 0; ndx < size; ++ndx) {
+        bytes.push_back(static_cast<uint8_t>(value >> (8 * ndx)));
+      }
+      EXPECT_EQ(Fnv1aHashOfBytes(value, size), CalculateHash(bytes))
+          << value << " " << (size + 0);
+    }
+  }
+}
+
 TEST(Fnv1aTest, LowCollisionCount) {
   if (MCU_VLOG_IS_ON(4)) {
     GTEST_SKIP() << "Too slow with lots of logging enabled.";
@@ -125,6 +125,31 @@ TEST_F(JsonEncodersTest, ObjectWithEscapedStrings) {
                   "\"K\": \"\\b\\f\\n\\r\\t\"}");
 }
 
+TEST_F(JsonEncodersTest, ObjectWithUtf8Strings) {
+  // Valid UTF-8 is passed through unchanged, even when printed one byte at a
+  // time.
+  constexpr char kValidStr[] =
+      "\xC3\xA9t\xC3\xA9 \xE2\x82\xAC \xF0\x9F\x98\x80";
+  const PrintOneCharacterAtATime a_printable(kValidStr);
+
+  // Invalid sequences are replaced by an escaped U+FFFD (one per maximal
+  // subpart of an invalid sequence), including an incomplete sequence at the
+  // end.
+  constexpr char kInvalidStr[] = "a\x80" "b\xE2\x82" "c\xC0\xAF" "d\xF0\x9F";
+
+  auto func = [&](JsonObjectEncoder& object_encoder) {
+    object_encoder.AddStringProperty(StringView("v"), StringView(kValidStr));
+    object_encoder.AddStringProperty(StringView("p"), a_printable);
+    object_encoder.AddStringProperty(StringView("i"), StringView(kInvalidStr));
+  };
+  ConfirmEncoding(func,
+                  "{\"v\": \"\xC3\xA9t\xC3\xA9 \xE2\x82\xAC \xF0\x9F\x98\x80"
+                  "\", "
+                  "\"p\": \"\xC3\xA9t\xC3\xA9 \xE2\x82\xAC \xF0\x9F\x98\x80"
+                  "\", "
+                  "\"i\": \"a\\ufffdb\\ufffdc\\ufffd\\ufffdd\\ufffd\"}");
+}
+
 TEST_F(JsonEncodersTest, ObjectWithBooleanValues) {
   auto func = [](JsonObjectEncoder& object_encoder) {
     object_encoder.AddBooleanProperty(StringView("So true!"), true);
@@ -653,6 +653,18 @@ static_assert(is_bar<foo>().check() == false);
 
 }  // namespace test_enable_if
 
+////////////////////////////////////////////////////////////////////////////////
+//
+// conditional<bool B, class T, class F>
+
+namespace test_conditional {
+
+static_assert(is_same<conditional<true, int, char>::type, int>::value);
+static_assert(is_same<conditional<false, int, char>::type, char>::value);
+static_assert(is_same<conditional_t<(sizeof(int) > 1), int, char>, int>::value);
+
+}  // namespace test_conditional
+
 ////////////////////////////////////////////////////////////////////////////////
 //
 // is_signed<typename T>
@@ -50,6 +50,31 @@ TEST(UtilityTest, ForwardFunc) {
   EXPECT_EQ(CallWrite(Write, a, B(), c, move(d), 123), 123);
 }
 
+static_assert(is_same<make_index_sequence<0>, index_sequence<>>::value, "");
+static_assert(is_same<make_index_sequence<1>, index_sequence<0>>::value, "");
+static_assert(
+    is_same<make_index_sequence<5>, index_sequence<0, 1, 2, 3, 4>>::value, "");
+static_assert(make_index_sequence<200>::size() == 200, "");
+
+constexpr size_t Sum() { return 0; }
+
+template <typename... T>
+constexpr size_t Sum(size_t first, T... rest) {
+  return first + Sum(rest...);
+}
+
+template <size_t... I>
+constexpr size_t SumOfIndices(index_sequence<I...>) {
+  return Sum(I...);
+}
+
+TEST(UtilityTest, IndexSequence) {
+  EXPECT_EQ(SumOfIndices(make_index_sequence<0>()), 0);
+  EXPECT_EQ(SumOfIndices(make_index_sequence<1>()), 0);
+  EXPECT_EQ(SumOfIndices(make_index_sequence<7>()), 21);
+  EXPECT_EQ(SumOfIndices(make_index_sequence<100>()), 4950);
+}
+
 }  // namespace
 }  // namespace test
 }  // namespace mcucore
@@ -0,0 +1,114 @@
+#include "strings/progmem_compressed_string.h"
+
+#include <string>
+#include <string_view>
+
+#include "extras/test_tools/print_to_std_string.h"
+#include "extras/test_tools/print_value_to_std_string.h"
+#include "extras/test_tools/test_strings.h"
+#include "gmock/gmock.h"
+#include "gtest/gtest.h"
+#include "print/o_print_stream.h"
+#include "semistd/type_traits.h"
+#include "strings/progmem_string_data.h"
+
+namespace mcucore {
+namespace test {
+namespace {
+
+using ::mcucore::progmem_compressed_string::CountTokens;
+using ::mcucore::progmem_compressed_string::kMaxTokens;
+using ::mcucore::progmem_compressed_string::ProgmemCompressedStringData;
+
+TEST(ProgmemCompressedStringTest, DictionaryFitsInEncoding) {
+  EXPECT_GT(CountTokens(), 0);
+  EXPECT_LE(CountTokens(), kMaxTokens);
+}
+
+TEST(ProgmemCompressedStringTest, Empty) {
+  ProgmemCompressedString pcs;
+  EXPECT_TRUE(pcs.empty());
+  EXPECT_EQ(pcs.size(), 0);
+  EXPECT_EQ(PrintValueToStdString(pcs), "");
+
+  pcs = MCU_PSD_COMPRESSED("");
+  EXPECT_TRUE(pcs.empty());
+  EXPECT_EQ(pcs.compressed_size(), 0);
+  EXPECT_EQ(PrintValueToStdString(pcs), "");
+}
+
+TEST(ProgmemCompressedStringTest, AsciiWithoutTokensIsUnchanged) {
+  using Type = MCU_PSD_COMPRESSED_TYPE("xyz123");
+  EXPECT_TRUE((is_same<Type, ProgmemCompressedStringData<6, 'x', 'y', 'z', '1',
+                                                         '2', '3'>>::value));
+  auto pcs = MCU_PSD_COMPRESSED("xyz123");
+  EXPECT_EQ(pcs.size(), 6);
+  EXPECT_EQ(pcs.compressed_size(), 6);
+  EXPECT_EQ(PrintValueToStdString(pcs), "xyz123");
+}
+
+TEST(ProgmemCompressedStringTest, TokensAreCompressed) {
+  auto pcs = MCU_PSD_COMPRESSED("Invalid EEPROM entry length");
+  EXPECT_EQ(pcs.size(), 27);
+  // Four tokens and three spaces.
+  EXPECT_EQ(pcs.compressed_size(), 7);
+  EXPECT_EQ(PrintValueToStdString(pcs), "Invalid EEPROM entry length");
+}
+
+TEST(ProgmemCompressedStringTest, NonAsciiIsEscaped) {
+  auto pcs = MCU_PSD_COMPRESSED("\xC2\xB5s");
+  EXPECT_EQ(pcs.size(), 3);
+  EXPECT_EQ(pcs.compressed_size(), 5);
+  EXPECT_EQ(PrintValueToStdString(pcs), "\xC2\xB5s");
+}
+
+TEST(ProgmemCompressedStringTest, SameLiteralSharesStorage) {
+  using Type1 = MCU_PSD_COMPRESSED_TYPE("Missing header name");
+  using Type2 = MCU_PSD_COMPRESSED_TYPE_255("Missing header name");
+  EXPECT_TRUE((is_same<Type1, Type2>::value));
+  EXPECT_EQ(Type1::kData, Type2::kData);
+}
+
+TEST(ProgmemCompressedStringTest, LongStrings) {
+  const std::string_view kStrings[] = {
+      TEST_STR_64,
+      "The request header value is too long for the buffer; "
+      "expected at most 32 bytes, but the length was 63.",
+  };
+  {
+    auto pcs = MCU_PSD_COMPRESSED(TEST_STR_64);
+    EXPECT_EQ(pcs.size(), 64);
+    EXPECT_EQ(PrintValueToStdString(pcs), kStrings[0]);
+  }
+  {
+    auto pcs = MCU_PSD_COMPRESSED(
+        "The request header value is too long for the buffer; "
+        "expected at most 32 bytes, but the length was 63.");
+    EXPECT_EQ(pcs.size(), kStrings[1].size());
+    EXPECT_LT(pcs.compressed_size(), kStrings[1].size() * 2 / 3);
+    EXPECT_EQ(PrintValueToStdString(pcs), kStrings[1]);
+  }
+  {
+    auto pcs = MCU_PSD_COMPRESSED_255(TEST_STR_255);
+    EXPECT_EQ(pcs.size(), 255);
+    EXPECT_EQ(PrintValueToStdString(pcs), TEST_STR_255);
+  }
+}
+
+TEST(ProgmemCompressedStringTest, PrintToReturnsDecodedSize) {
+  auto pcs = MCU_PSD_COMPRESSED("Status: error reading the EEPROM");
+  PrintToStdString out;
+  EXPECT_EQ(pcs.printTo(out), pcs.size());
+  EXPECT_EQ(out.str(), "Status: error reading the EEPROM");
+}
+
+TEST(ProgmemCompressedStringTest, StreamCompressed) {
+  PrintToStdString out;
+  OPrintStream strm(out);
+  strm << MCU_PSD_COMPRESSED("Expected ") << 1 << MCU_PSD_COMPRESSED(" byte");
+  EXPECT_EQ(out.str(), "Expected 1 byte");
+}
+
+}  // namespace
+}  // namespace test
+}  // namespace mcucore
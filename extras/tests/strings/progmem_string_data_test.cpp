@@ -255,6 +255,33 @@ TEST(ProgmemStringDataTest, StringLiteralIsTooLong) {
   BAD_LENGTH_TEST(1025, 1024);
 }
 
+#if MCU_PSD_USE_FIXED_STRING
+TEST(ProgmemStringDataTest, FixedStringProducesSameTypes) {
+  // The C++ 20 implementation must produce exactly the same types as the C++ 11
+  // implementation, else strings wouldn't be shared between translation units
+  // compiled in different modes.
+  static_assert(
+      std::is_same<FixedStringLiteralType<32, "">, ProgmemStringData<>>::value);
+  static_assert(std::is_same<FixedStringLiteralType<32, "Hello">,
+                             _PSD_TYPE_32(_PSD_STRFRAG_TYPE, "Hello")>::value);
+  static_assert(std::is_same<FixedStringLiteralType<128, "\0abc\0">,
+                             ProgmemStringData<0, 'a', 'b', 'c', 0>>::value);
+  static_assert(std::is_same<FixedStringLiteralType<1024, TEST_STR_1024>,
+                             _PSD_TYPE_1024(_PSD_STRFRAG_TYPE,
+                                            TEST_STR_1024)>::value);
+  static_assert(std::is_same<FixedStringLiteralType<32, TEST_STR_33>,
+                             StringLiteralIsTooLong>::value);
+
+  static_assert(std::is_same<FixedStringBasenameType<64, "a/b\\c/def">,
+                             ProgmemStringData<'d', 'e', 'f'>>::value);
+  static_assert(std::is_same<FixedStringBasenameType<64, "abc/">,
+                             ProgmemStringData<>>::value);
+  static_assert(std::is_same<FixedStringBasenameType<256, __FILE__>,
+                             _PSD_TYPE_256(_PSD_PATHFRAG_TYPE,
+                                           __FILE__)>::value);
+}
+#endif  // MCU_PSD_USE_FIXED_STRING
+
 TEST(ProgmemStringDataTest, BasenameAfterForwardSlashes) {
   EXPECT_EQ(PrintValueToStdString(MCU_BASENAME_32("/" TEST_STR_18 "/abc.def")),
             "abc.def");
@@ -1,5 +1,6 @@
 #include "strings/progmem_string_view.h"
 
+#include <cctype>
 #include <cstring>
 #include <iosfwd>
 #include <limits>
@@ -319,6 +320,68 @@ TEST(ProgmemStringViewTest, LoweredEqual) {
   EXPECT_FALSE(ProgmemStringView(TEST_STR_32).LoweredEqual(TEST_STR_33, 33));
 }
 
+// The comparison kernels may compare a word at a time, so we exercise them with
+// strings of many lengths, and with the difference at every position, so that
+// both the word-at-a-time loop and the tail loop are covered.
+TEST(ProgmemStringViewTest, CompareAllLengthsAndPositions) {
+  const std::string lower(TEST_STR_64);
+  for (size_t size = 0; size <= lower.size(); ++size) {
+    const std::string flash = lower.substr(0, size);
+    const ProgmemStringView psv(flash.data(), size);
+    std::string upper = flash;
+    for (auto& c : upper) {
+      c = std::toupper(c);
+    }
+    const ProgmemStringView upper_psv(upper.data(), size);
+    EXPECT_EQ(psv, ProgmemStringView(lower.data(), size));
+    EXPECT_TRUE(psv.Equal(flash.data(), size));
+    EXPECT_TRUE(psv.CaseEqual(flash.data(), size));
+    EXPECT_TRUE(psv.CaseEqual(upper.data(), size));
+    EXPECT_TRUE(upper_psv.CaseEqual(flash.data(), size));
+    EXPECT_TRUE(psv.LoweredEqual(flash.data(), size));
+    EXPECT_TRUE(upper_psv.LoweredEqual(flash.data(), size));
+    EXPECT_EQ(psv.LoweredEqual(upper.data(), size), flash == upper);
+    EXPECT_EQ(psv == upper_psv, flash == upper);
+
+    for (size_t pos = 0; pos < size; ++pos) {
+      std::string other = flash;
+      other[pos] = static_cast<char>(other[pos] ^ 0x01);
+      EXPECT_FALSE(psv.Equal(other.data(), size));
+      EXPECT_FALSE(psv.CaseEqual(other.data(), size));
+      EXPECT_FALSE(psv.LoweredEqual(other.data(), size));
+      EXPECT_NE(psv, ProgmemStringView(other.data(), size));
+      EXPECT_FALSE(psv.IsPrefixOf(other.data(), size));
+    }
+  }
+}
+
+TEST(ProgmemStringViewTest, CaseFoldingIsLimitedToAsciiLetters) {
+  // Each pair differs only in the 0x20 bit, but only the letters should be
+  // treated as case-insensitively equal. The strings are long enough to be
+  // compared a word at a time.
+  const std::string flash = "@[`{\xC1\xDA\xC0\xDB_Az@[`{\xC1\xDA\xC0\xDB";
+  const ProgmemStringView psv(flash.data(), flash.size());
+  for (size_t pos = 0; pos < flash.size(); ++pos) {
+    std::string other = flash;
+    other[pos] = static_cast<char>(other[pos] ^ 0x20);
+    const char c = flash[pos];
+    const bool is_letter = ('A' <= c && c <= 'Z') || ('a' <= c && c <= 'z');
+    EXPECT_EQ(psv.CaseEqual(other.data(), other.size()), is_letter)
+        << "pos=" << pos;
+  }
+
+  // Only the 'A' should be lowered.
+  std::string lowered = flash;
+  lowered[flash.find('A')] = 'a';
+  EXPECT_TRUE(psv.LoweredEqual(lowered.data(), lowered.size()));
+  EXPECT_FALSE(psv.LoweredEqual(flash.data(), flash.size()));
+  for (size_t pos = 0; pos < lowered.size(); ++pos) {
+    std::string other = lowered;
+    other[pos] = static_cast<char>(other[pos] ^ 0x20);
+    EXPECT_FALSE(psv.LoweredEqual(other.data(), other.size())) << "pos=" << pos;
+  }
+}
+
 TEST(ProgmemStringViewTest, IsPrefixOf) {
   EXPECT_FALSE(ProgmemStringView(TEST_STR_32).IsPrefixOf(TEST_STR_31, 31));
   EXPECT_TRUE(ProgmemStringView(TEST_STR_32).IsPrefixOf(TEST_STR_32, 32));
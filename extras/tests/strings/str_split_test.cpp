@@ -0,0 +1,124 @@
+#include "strings/str_split.h"
+
+#include <string>
+#include <vector>
+
+#include "gmock/gmock.h"
+#include "gtest/gtest.h"
+#include "strings/progmem_string_data.h"
+#include "strings/progmem_string_view.h"
+#include "strings/string_view.h"
+
+namespace mcucore {
+namespace test {
+namespace {
+
+using ::testing::ElementsAre;
+using ::testing::IsEmpty;
+
+std::vector<std::string> Split(
+    const StringView& text, const StrSplitDelimiter& delimiter,
+    StrSplitOptions options = StrSplitOptions::kNone) {
+  std::vector<std::string> result;
+  for (StringView piece : StrSplit(text, delimiter, options)) {
+    result.emplace_back(piece.data(), piece.size());
+  }
+  return result;
+}
+
+TEST(StrSplitTest, ByChar) {
+  EXPECT_THAT(Split(StringView("a,b,c"), ','), ElementsAre("a", "b", "c"));
+  EXPECT_THAT(Split(StringView("abc"), ','), ElementsAre("abc"));
+  EXPECT_THAT(Split(StringView(",a,,b,"), ','),
+              ElementsAre("", "a", "", "b", ""));
+  EXPECT_THAT(Split(StringView(""), ','), ElementsAre(""));
+  EXPECT_THAT(Split(StringView(","), ','), ElementsAre("", ""));
+}
+
+TEST(StrSplitTest, ByAnyChar) {
+  EXPECT_THAT(Split(StringView("a=1;b=2,c"), ByAnyChar(StringView(";,"))),
+              ElementsAre("a=1", "b=2", "c"));
+  EXPECT_THAT(Split(StringView("a;,b"), ByAnyChar(StringView(";,"))),
+              ElementsAre("a", "", "b"));
+  // An empty set of chars never matches.
+  EXPECT_THAT(Split(StringView("a;b"), ByAnyChar(StringView(""))),
+              ElementsAre("a;b"));
+}
+
+TEST(StrSplitTest, ByProgmemString) {
+  EXPECT_THAT(Split(StringView("a; b;c; d"), MCU_PSV("; ")),
+              ElementsAre("a", "b;c", "d"));
+  EXPECT_THAT(Split(StringView("a\r\n\r\nb\r\n"), MCU_PSV("\r\n")),
+              ElementsAre("a", "", "b", ""));
+  // A partial delimiter at the end of the text is not a delimiter.
+  EXPECT_THAT(Split(StringView("ab\r"), MCU_PSV("\r\n")), ElementsAre("ab\r"));
+  EXPECT_THAT(Split(StringView("aaab"), MCU_PSV("aab")), ElementsAre("a", ""));
+}
+
+TEST(StrSplitTest, TrimOptionalWhitespace) {
+  EXPECT_THAT(Split(StringView(" text/html ,\tapplication/json , */* "), ',',
+                    StrSplitOptions::kTrimOptionalWhitespace),
+              ElementsAre("text/html", "application/json", "*/*"));
+  EXPECT_THAT(Split(StringView("a, ,b"), ',',
+                    StrSplitOptions::kTrimOptionalWhitespace),
+              ElementsAre("a", "", "b"));
+}
+
+TEST(StrSplitTest, SkipEmpty) {
+  EXPECT_THAT(Split(StringView(",a,,b,"), ',', StrSplitOptions::kSkipEmpty),
+              ElementsAre("a", "b"));
+  EXPECT_THAT(Split(StringView(""), ',', StrSplitOptions::kSkipEmpty),
+              IsEmpty());
+  EXPECT_THAT(Split(StringView(",,,"), ',', StrSplitOptions::kSkipEmpty),
+              IsEmpty());
+  EXPECT_THAT(Split(StringView(" , a ,\t, "), ',',
+                    StrSplitOptions::kTrimOptionalWhitespace |
+                        StrSplitOptions::kSkipEmpty),
+              ElementsAre("a"));
+  // Whitespace only pieces are not empty unless trimmed.
+  EXPECT_THAT(Split(StringView(" , a ,\t, "), ',', StrSplitOptions::kSkipEmpty),
+              ElementsAre(" ", " a ", "\t", " "));
+}
+
+TEST(StrSplitTest, PiecesReferToTheText) {
+  const StringView text("ab,cd");
+  auto range = StrSplit(text, ',');
+  auto it = range.begin();
+  ASSERT_NE(it, range.end());
+  EXPECT_EQ(it->data(), text.data());
+  EXPECT_EQ(it->size(), 2);
+  ++it;
+  ASSERT_NE(it, range.end());
+  EXPECT_EQ(it->data(), text.data() + 3);
+  EXPECT_EQ(*it, StringView("cd"));
+  ++it;
+  EXPECT_EQ(it, range.end());
+}
+
+TEST(StrSplitTest, CookiePairs) {
+  std::vector<std::string> names, values;
+  for (StringView pair :
+       StrSplit(StringView("a=1; b=2;c=; =4"), ';',
+                StrSplitOptions::kTrimOptionalWhitespace)) {
+    auto it = StrSplit(pair, '=').begin();
+    names.emplace_back(it->data(), it->size());
+    ++it;
+    values.emplace_back(it->data(), it->size());
+  }
+  EXPECT_THAT(names, ElementsAre("a", "b", "c", ""));
+  EXPECT_THAT(values, ElementsAre("1", "2", "", "4"));
+}
+
+TEST(StrSplitTest, TrimOptionalWhitespaceFunction) {
+  StringView view(" \t a b\t ");
+  TrimOptionalWhitespace(view);
+  EXPECT_EQ(view, StringView("a b"));
+
+  view = StringView(" \t ");
+  TrimOptionalWhitespace(view);
+  EXPECT_TRUE(view.empty());
+}
+
+}  // namespace
+}  // namespace test
+}  // namespace mcucore
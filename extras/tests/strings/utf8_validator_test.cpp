@@ -0,0 +1,128 @@
+#include "strings/utf8_validator.h"
+
+#include <string>
+
+#include "gtest/gtest.h"
+#include "strings/string_view.h"
+
+namespace mcucore {
+namespace test {
+namespace {
+
+bool IsValid(const std::string& str) {
+  return Utf8Validate(StringView(str.data(), str.size()));
+}
+
+// Returns the UTF-8 encoding of the code point, without checking whether it is
+// a valid code point.
+std::string EncodeCodePoint(uint32_t cp) {
+  std::string result;
+  if (cp < 0x80) {
+    result.push_back(static_cast<char>(cp));
+  } else if (cp < 0x800) {
+    result.push_back(static_cast<char>(0xC0 | (cp >> 6)));
+    result.push_back(static_cast<char>(0x80 | (cp & 0x3F)));
+  } else if (cp < 0x10000) {
+    result.push_back(static_cast<char>(0xE0 | (cp >> 12)));
+    result.push_back(static_cast<char>(0x80 | ((cp >> 6) & 0x3F)));
+    result.push_back(static_cast<char>(0x80 | (cp & 0x3F)));
+  } else {
+    result.push_back(static_cast<char>(0xF0 | (cp >> 18)));
+    result.push_back(static_cast<char>(0x80 | ((cp >> 12) & 0x3F)));
+    result.push_back(static_cast<char>(0x80 | ((cp >> 6) & 0x3F)));
+    result.push_back(static_cast<char>(0x80 | (cp & 0x3F)));
+  }
+  return result;
+}
+
+TEST(Utf8ValidatorTest, Ascii) {
+  EXPECT_TRUE(IsValid(""));
+  EXPECT_TRUE(IsValid("a"));
+  std::string str;
+  for (int c = 0; c < 128; ++c) {
+    str.push_back(static_cast<char>(c));
+    EXPECT_TRUE(IsValid(str));
+  }
+}
+
+TEST(Utf8ValidatorTest, AllCodePoints) {
+  for (uint32_t cp = 0; cp <= 0x10FFFF; ++cp) {
+    const bool is_surrogate = 0xD800 <= cp && cp <= 0xDFFF;
+    EXPECT_EQ(IsValid(EncodeCodePoint(cp)), !is_surrogate) << std::hex << cp;
+    if (!is_surrogate && cp % 0x1000 == 0x555) {
+      // Also check the code point surrounded by ASCII, long enough to exercise
+      // the word-at-a-time path.
+      const std::string ascii(17, 'x');
+      EXPECT_TRUE(IsValid(ascii + EncodeCodePoint(cp) + ascii)) << cp;
+    }
+  }
+  EXPECT_FALSE(IsValid(EncodeCodePoint(0x110000)));
+  EXPECT_FALSE(IsValid(EncodeCodePoint(0x1FFFFF)));
+}
+
+TEST(Utf8ValidatorTest, InvalidBytes) {
+  for (int b = 0x80; b <= 0xFF; ++b) {
+    // Every byte from 0x80 is invalid on its own.
+    std::string str(1, static_cast<char>(b));
+    EXPECT_FALSE(IsValid(str)) << b;
+    EXPECT_FALSE(IsValid(std::string(20, ' ') + str)) << b;
+  }
+  // Overlong encodings.
+  EXPECT_FALSE(IsValid("\xC0\x80"));
+  EXPECT_FALSE(IsValid("\xC1\xBF"));
+  EXPECT_FALSE(IsValid("\xE0\x80\x80"));
+  EXPECT_FALSE(IsValid("\xE0\x9F\xBF"));
+  EXPECT_FALSE(IsValid("\xF0\x80\x80\x80"));
+  EXPECT_FALSE(IsValid("\xF0\x8F\xBF\xBF"));
+  // Missing continuation bytes.
+  EXPECT_FALSE(IsValid("\xC3"));
+  EXPECT_FALSE(IsValid("\xE2\x82"));
+  EXPECT_FALSE(IsValid("\xE2\x82z"));
+  EXPECT_FALSE(IsValid("\xF0\x9F\x98"));
+  // Too many continuation bytes.
+  EXPECT_FALSE(IsValid("\xC3\xA9\xA9"));
+}
+
+TEST(Utf8ValidatorTest, Incremental) {
+  const std::string str = "abc \xC3\xA9 \xE2\x82\xAC \xF0\x9F\x98\x80 xyz";
+  // Split the string at every position, including in the middle of multi-byte
+  // sequences.
+  for (size_t split = 0; split <= str.size(); ++split) {
+    Utf8Validator validator;
+    EXPECT_TRUE(validator.IsComplete());
+    EXPECT_TRUE(validator.Feed(StringView(str.data(), split)));
+    EXPECT_FALSE(validator.HasError());
+    EXPECT_TRUE(validator.Feed(
+        StringView(str.data() + split, str.size() - split)));
+    EXPECT_TRUE(validator.IsComplete());
+  }
+
+  Utf8Validator validator;
+  EXPECT_TRUE(validator.FeedByte(0xF0));
+  EXPECT_TRUE(validator.InSequence());
+  EXPECT_TRUE(validator.FeedByte(0x9F));
+  EXPECT_TRUE(validator.FeedByte(0x98));
+  EXPECT_TRUE(validator.InSequence());
+  EXPECT_TRUE(validator.FeedByte(0x80));
+  EXPECT_TRUE(validator.IsComplete());
+  EXPECT_FALSE(validator.InSequence());
+}
+
+TEST(Utf8ValidatorTest, ErrorIsSticky) {
+  Utf8Validator validator;
+  EXPECT_FALSE(validator.Feed(StringView("a\x80")));
+  EXPECT_TRUE(validator.HasError());
+  EXPECT_FALSE(validator.IsComplete());
+  EXPECT_FALSE(validator.InSequence());
+  EXPECT_FALSE(validator.Feed(StringView("abc")));
+  EXPECT_FALSE(validator.FeedByte('a'));
+  EXPECT_TRUE(validator.HasError());
+
+  validator.Reset();
+  EXPECT_TRUE(validator.IsComplete());
+  EXPECT_TRUE(validator.Feed(StringView("abc")));
+}
+
+}  // namespace
+}  // namespace test
+}  // namespace mcucore
@@ -0,0 +1,55 @@
+#include "container/arena.h"
+
+#include "log/log.h"
+
+namespace mcucore {
+
+Arena::Arena(void* buffer, size_t size)
+    : buffer_(static_cast<uint8_t*>(buffer)),
+      size_(size),
+      used_(0),
+      high_water_mark_(0),
+      num_failures_(0) {
+  MCU_DCHECK(buffer != nullptr || size == 0);
+}
+
+void* Arena::Allocate(size_t size, size_t alignment) {
+  MCU_DCHECK_NE(alignment, 0);
+  MCU_DCHECK_EQ(alignment & (alignment - 1), 0)
+      << MCU_PSD("alignment must be a power of two");
+  const auto address = reinterpret_cast<uintptr_t>(buffer_ + used_);
+  const size_t padding = (alignment - (address & (alignment - 1))) &
+                         (alignment - 1);
+  if (padding > available() || size > available() - padding) {
+    MCU_VLOG(3) << MCU_PSD("Arena full") << MCU_NAME_VAL(size)
+                << MCU_NAME_VAL(used_);
+    ++num_failures_;
+    return nullptr;
+  }
+  uint8_t* result = buffer_ + used_ + padding;
+  used_ += padding + size;
+  if (used_ > high_water_mark_) {
+    high_water_mark_ = used_;
+  }
+  return result;
+}
+
+bool Arena::CopyString(const StringView& str, StringView& copy) {
+  char* ptr = static_cast<char*>(Allocate(str.size()));
+  if (ptr == nullptr) {
+    return false;
+  }
+  memcpy(ptr, str.data(), str.size());
+  copy = StringView(ptr, str.size());
+  return true;
+}
+
+void Arena::Rollback(const Marker& marker) {
+  MCU_DCHECK_LE(marker.used_, used_)
+      << MCU_PSD("Markers must be rolled back in LIFO order");
+  if (marker.used_ < used_) {
+    used_ = marker.used_;
+  }
+}
+
+}  // namespace mcucore
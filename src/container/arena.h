@@ -0,0 +1,164 @@
+#ifndef MCUCORE_SRC_CONTAINER_ARENA_H_
+#define MCUCORE_SRC_CONTAINER_ARENA_H_
+
+// Arena is a bump allocator over a caller supplied buffer, intended for scratch
+// memory whose lifetime is bounded by some unit of work, such as decoding and
+// responding to a single HTTP request. Allocation is just the rounding up of an
+// offset for alignment and the addition of the size, and everything allocated
+// since some point can be freed at once, in O(1), by rolling back to a Marker
+// (e.g. with an ArenaScope), or by calling Reset. There is no fragmentation,
+// and no per-allocation overhead.
+//
+// The arena never runs destructors, so it should only be used for types that
+// don't need them (e.g. chars, integers, structs of those, views).
+//
+// For example:
+//
+//    uint8_t buffer[256];
+//    Arena arena(buffer);
+//    ...
+//    void OnHeaderValue(const StringView& value) {
+//      StringView copy;
+//      if (arena.CopyString(value, copy)) {
+//        saved_values_[num_saved_values_++] = copy;
+//      }
+//    }
+//
+// Author: james.synge@gmail.com
+
+#include <new>  // pragma: keep standard include
+
+#include "mcucore_platform.h"
+#include "semistd/utility.h"
+#include "strings/string_view.h"
+#include "strings/tiny_string.h"
+
+namespace mcucore {
+
+class Arena {
+ public:
+  // Records the amount of the arena allocated at some point, so that later
+  // allocations can be freed by rolling back to that point.
+  class Marker {
+   private:
+    friend class Arena;
+    explicit Marker(size_t used) : used_(used) {}
+    size_t used_;
+  };
+
+  Arena(void* buffer, size_t size);
+
+  template <size_t N>
+  explicit Arena(uint8_t (&buffer)[N]) : Arena(buffer, N) {}
+
+  Arena(const Arena&) = delete;
+  Arena& operator=(const Arena&) = delete;
+
+  // Allocates size bytes, at an address that is a multiple of alignment, which
+  // must be a power of two. Returns nullptr if there isn't enough space.
+  void* Allocate(size_t size, size_t alignment = 1);
+
+  // Allocates and default constructs an array of count T instances. Returns
+  // nullptr if there isn't enough space.
+  template <typename T>
+  T* NewArray(size_t count) {
+    if (count > max_size() / sizeof(T)) {
+      ++num_failures_;
+      return nullptr;
+    }
+    void* ptr = Allocate(count * sizeof(T), alignof(T));
+    if (ptr == nullptr) {
+      return nullptr;
+    }
+    T* result = static_cast<T*>(ptr);
+    for (size_t ndx = 0; ndx < count; ++ndx) {
+      new (result + ndx) T();
+    }
+    return result;
+  }
+
+  // Allocates and constructs a single T instance with the specified arguments.
+  // Returns nullptr if there isn't enough space.
+  template <typename T, typename... Args>
+  T* New(Args&&... args) {
+    void* ptr = Allocate(sizeof(T), alignof(T));
+    if (ptr == nullptr) {
+      return nullptr;
+    }
+    return new (ptr) T(forward<Args>(args)...);
+  }
+
+  // Copies the characters of str into the arena, and sets copy to refer to
+  // them. Returns false if there isn't enough space, in which case copy is not
+  // modified. This allows, for example, a RequestDecoderListener to retain a
+  // token after the decoder's buffer has been reused.
+  bool CopyString(const StringView& str, StringView& copy);
+
+  template <uint8_t N>
+  bool CopyString(const TinyString<N>& str, StringView& copy) {
+    return CopyString(StringView(str.data(), str.size()), copy);
+  }
+
+  // Returns a Marker recording the current amount allocated.
+  Marker Mark() const { return Marker(used_); }
+
+  // Frees everything allocated since the marker was created. Markers must be
+  // rolled back in the reverse of the order in which they were created (i.e.
+  // LIFO), though some may be skipped.
+  void Rollback(const Marker& marker);
+
+  // Frees everything in the arena.
+  void Reset() { used_ = 0; }
+
+  // Returns the number of bytes allocated, including any padding for alignment.
+  size_t used() const { return used_; }
+
+  // Returns the number of bytes not allocated.
+  size_t available() const { return size_ - used_; }
+
+  // Returns the size of the buffer.
+  size_t max_size() const { return size_; }
+
+  // Returns the largest value of used() since construction or the last call
+  // to ResetStats. This can be used to size the buffer appropriately.
+  size_t high_water_mark() const { return high_water_mark_; }
+
+  // Returns the number of allocations that have failed due to a lack of space.
+  size_t num_failures() const { return num_failures_; }
+
+  void ResetStats() {
+    high_water_mark_ = used_;
+    num_failures_ = 0;
+  }
+
+ private:
+  uint8_t* const buffer_;
+  const size_t size_;
+  size_t used_;
+  size_t high_water_mark_;
+  size_t num_failures_;
+};
+
+// ArenaScope frees everything allocated in an arena during the lifetime of the
+// scope. For example:
+//
+//    void HandleRequest(Arena& arena, ...) {
+//      ArenaScope scope(arena);
+//      ... allocate per-request values from arena ...
+//    }  // All freed here.
+class ArenaScope {
+ public:
+  explicit ArenaScope(Arena& arena) : arena_(arena), marker_(arena.Mark()) {}
+  ~ArenaScope() { arena_.Rollback(marker_); }
+
+  ArenaScope(const ArenaScope&) = delete;
+  ArenaScope& operator=(const ArenaScope&) = delete;
+
+ private:
+  Arena& arena_;
+  const Arena::Marker marker_;
+};
+
+}  // namespace mcucore
+
+#endif  // MCUCORE_SRC_CONTAINER_ARENA_H_
@@ -0,0 +1,32 @@
+#include "container/bit_set.h"
+
+namespace mcucore {
+namespace bit_set_internal {
+namespace {
+
+// The number of bits set in each nibble value.
+constexpr uint8_t kNibbleBitCounts[16] AVR_PROGMEM = {
+    0, 1, 1, 2, 1, 2, 2, 3, 1, 2, 2, 3, 2, 3, 3, 4,
+};
+
+// The index of the lowest set bit in each nibble value; 4 for zero.
+constexpr uint8_t kNibbleTrailingZeros[16] AVR_PROGMEM = {
+    4, 0, 1, 0, 2, 0, 1, 0, 3, 0, 1, 0, 2, 0, 1, 0,
+};
+
+}  // namespace
+
+uint8_t PopCountByNibbles(uint8_t byte) {
+  return pgm_read_byte_near(kNibbleBitCounts + (byte & 0x0F)) +
+         pgm_read_byte_near(kNibbleBitCounts + (byte >> 4));
+}
+
+uint8_t CountTrailingZerosByNibbles(uint8_t byte) {
+  if ((byte & 0x0F) != 0) {
+    return pgm_read_byte_near(kNibbleTrailingZeros + (byte & 0x0F));
+  }
+  return 4 + pgm_read_byte_near(kNibbleTrailingZeros + (byte >> 4));
+}
+
+}  // namespace bit_set_internal
+}  // namespace mcucore
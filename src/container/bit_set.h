@@ -0,0 +1,268 @@
+#ifndef MCUCORE_SRC_CONTAINER_BIT_SET_H_
+#define MCUCORE_SRC_CONTAINER_BIT_SET_H_
+
+// BitSet<N> is a fixed size set of N bits, similar to std::bitset, for tracking
+// flags (e.g. which parameters have been seen in a request) in 1 bit each,
+// rather than in 1 byte per bool. Sets can be constructed at compile time with
+// BitSet<N>::Of(bit positions...), and combined using the set operators |, &,
+// ^ and - (difference).
+//
+// The bits are stored in words of 8 bits on AVR, and of 32 bits elsewhere,
+// where __builtin_ctz and __builtin_popcount are used for find_first, et al; on
+// AVR those are implemented with 16 entry (nibble) tables in PROGMEM.
+//
+// Author: james.synge@gmail.com
+
+#include "mcucore_platform.h"
+#include "semistd/utility.h"
+
+namespace mcucore {
+namespace bit_set_internal {
+
+#if !defined(ARDUINO_ARCH_AVR) && \
+    (defined(__GNUC__) || MCU_HAS_BUILTIN(__builtin_ctz))
+#define MCU_BIT_SET_USE_BUILTINS 1
+using Word = uint32_t;
+#else
+#define MCU_BIT_SET_USE_BUILTINS 0
+using Word = uint8_t;
+#endif
+
+// Table based implementations, used on AVR. Exposed here for testing.
+uint8_t PopCountByNibbles(uint8_t byte);
+uint8_t CountTrailingZerosByNibbles(uint8_t byte);  // byte must not be zero.
+
+inline uint8_t PopCount(Word word) {
+#if MCU_BIT_SET_USE_BUILTINS
+  return static_cast<uint8_t>(__builtin_popcount(word));
+#else
+  return PopCountByNibbles(word);
+#endif
+}
+
+// Returns the index of the lowest set bit of word, which must not be zero.
+inline uint8_t CountTrailingZeros(Word word) {
+#if MCU_BIT_SET_USE_BUILTINS
+  return static_cast<uint8_t>(__builtin_ctz(word));
+#else
+  return CountTrailingZerosByNibbles(word);
+#endif
+}
+
+constexpr size_t kBitsPerWord = 8 * sizeof(Word);
+
+// Returns the word with index word_ndx of a set of num_bits bits, with the
+// specified bits set; positions beyond the end of the set are ignored.
+constexpr Word WordWithBits(size_t /*num_bits*/, size_t /*word_ndx*/) {
+  return 0;
+}
+
+template <typename... Ts>
+constexpr Word WordWithBits(size_t num_bits, size_t word_ndx, size_t pos,
+                            Ts... more) {
+  return static_cast<Word>(
+      (pos < num_bits && pos / kBitsPerWord == word_ndx
+           ? Word(1) << (pos % kBitsPerWord)
+           : 0) |
+      WordWithBits(num_bits, word_ndx, more...));
+}
+
+}  // namespace bit_set_internal
+
+template <size_t N>
+class BitSet {
+  using Word = bit_set_internal::Word;
+  static constexpr size_t kBitsPerWord = bit_set_internal::kBitsPerWord;
+  static constexpr size_t kNumWords = (N + kBitsPerWord - 1) / kBitsPerWord;
+  using Indices = make_index_sequence<kNumWords>;
+
+ public:
+  static_assert(N > 0, "N must be greater than zero");
+
+  // Constructs an empty set.
+  constexpr BitSet() : words_{} {}
+
+  // Returns a set with the specified bits set; those not less than N are
+  // ignored.
+  template <typename... Ts>
+  static constexpr BitSet Of(Ts... positions) {
+    return BitSet(FromBits(), Indices(), static_cast<size_t>(positions)...);
+  }
+
+  // Returns a set with all N bits set.
+  static constexpr BitSet All() { return ~BitSet(); }
+
+  // Returns the number of bits in the set (i.e. N).
+  static constexpr size_t size() { return N; }
+
+  constexpr bool test(size_t pos) const {
+    return pos < N &&
+           ((words_[pos / kBitsPerWord] >> (pos % kBitsPerWord)) & 1) != 0;
+  }
+
+  void set(size_t pos) {
+    if (pos < N) {
+      words_[pos / kBitsPerWord] |= Word(1) << (pos % kBitsPerWord);
+    }
+  }
+  void set(size_t pos, bool value) {
+    if (value) {
+      set(pos);
+    } else {
+      reset(pos);
+    }
+  }
+  void reset(size_t pos) {
+    if (pos < N) {
+      words_[pos / kBitsPerWord] &=
+          static_cast<Word>(~(Word(1) << (pos % kBitsPerWord)));
+    }
+  }
+  // Clears all of the bits.
+  void reset() {
+    for (auto& word : words_) {
+      word = 0;
+    }
+  }
+
+  // Returns the number of bits which are set.
+  size_t count() const {
+    size_t result = 0;
+    for (const auto word : words_) {
+      result += bit_set_internal::PopCount(word);
+    }
+    return result;
+  }
+
+  bool any() const {
+    for (const auto word : words_) {
+      if (word != 0) {
+        return true;
+      }
+    }
+    return false;
+  }
+  bool none() const { return !any(); }
+
+  // Returns the position of the first set bit, or N if none are set.
+  size_t find_first() const { return find_next(0); }
+
+  // Returns the position of the first set bit at or after pos, or N if none.
+  size_t find_next(size_t pos) const {
+    if (pos >= N) {
+      return N;
+    }
+    size_t word_ndx = pos / kBitsPerWord;
+    Word word = words_[word_ndx] &
+                static_cast<Word>(~Word(0) << (pos % kBitsPerWord));
+    while (true) {
+      if (word != 0) {
+        return word_ndx * kBitsPerWord +
+               bit_set_internal::CountTrailingZeros(word);
+      } else if (++word_ndx >= kNumWords) {
+        return N;
+      }
+      word = words_[word_ndx];
+    }
+  }
+
+  // Calls func(pos) for each set bit, in ascending order.
+  template <typename F>
+  void for_each_set(F func) const {
+    for (size_t word_ndx = 0; word_ndx < kNumWords; ++word_ndx) {
+      Word word = words_[word_ndx];
+      while (word != 0) {
+        func(word_ndx * kBitsPerWord +
+             bit_set_internal::CountTrailingZeros(word));
+        word &= static_cast<Word>(word - 1);  // Clear the lowest set bit.
+      }
+    }
+  }
+
+  // Returns true if every bit set in this set is also set in other.
+  bool IsSubsetOf(const BitSet& other) const {
+    for (size_t ndx = 0; ndx < kNumWords; ++ndx) {
+      if ((words_[ndx] & ~other.words_[ndx]) != 0) {
+        return false;
+      }
+    }
+    return true;
+  }
+
+  // Set algebra.
+  constexpr BitSet operator|(const BitSet& other) const {
+    return Or(other, Indices());
+  }
+  constexpr BitSet operator&(const BitSet& other) const {
+    return And(other, Indices());
+  }
+  constexpr BitSet operator^(const BitSet& other) const {
+    return Xor(other, Indices());
+  }
+  // Returns the bits that are set in this set, but not in other.
+  constexpr BitSet operator-(const BitSet& other) const {
+    return AndNot(other, Indices());
+  }
+  constexpr BitSet operator~() const { return Not(Indices()); }
+
+  BitSet& operator|=(const BitSet& other) { return *this = *this | other; }
+  BitSet& operator&=(const BitSet& other) { return *this = *this & other; }
+  BitSet& operator^=(const BitSet& other) { return *this = *this ^ other; }
+  BitSet& operator-=(const BitSet& other) { return *this = *this - other; }
+
+  bool operator==(const BitSet& other) const {
+    for (size_t ndx = 0; ndx < kNumWords; ++ndx) {
+      if (words_[ndx] != other.words_[ndx]) {
+        return false;
+      }
+    }
+    return true;
+  }
+  bool operator!=(const BitSet& other) const { return !(*this == other); }
+
+ private:
+  struct FromBits {};
+  struct FromWords {};
+
+  template <size_t... I, typename... Ts>
+  constexpr BitSet(FromBits, index_sequence<I...>, Ts... positions)
+      : words_{bit_set_internal::WordWithBits(N, I, positions...)...} {}
+
+  template <typename... Ws>
+  constexpr explicit BitSet(FromWords, Ws... words)
+      : words_{static_cast<Word>(words)...} {}
+
+  // Returns the mask of the valid bits of the word with index word_ndx.
+  static constexpr Word ValidBits(size_t word_ndx) {
+    return (word_ndx + 1 < kNumWords || N % kBitsPerWord == 0)
+               ? static_cast<Word>(~Word(0))
+               : static_cast<Word>((Word(1) << (N % kBitsPerWord)) - 1);
+  }
+
+  template <size_t... I>
+  constexpr BitSet Or(const BitSet& other, index_sequence<I...>) const {
+    return BitSet(FromWords(), (words_[I] | other.words_[I])...);
+  }
+  template <size_t... I>
+  constexpr BitSet And(const BitSet& other, index_sequence<I...>) const {
+    return BitSet(FromWords(), (words_[I] & other.words_[I])...);
+  }
+  template <size_t... I>
+  constexpr BitSet Xor(const BitSet& other, index_sequence<I...>) const {
+    return BitSet(FromWords(), (words_[I] ^ other.words_[I])...);
+  }
+  template <size_t... I>
+  constexpr BitSet AndNot(const BitSet& other, index_sequence<I...>) const {
+    return BitSet(FromWords(), (words_[I] & ~other.words_[I])...);
+  }
+  template <size_t... I>
+  constexpr BitSet Not(index_sequence<I...>) const {
+    return BitSet(FromWords(), (~words_[I] & ValidBits(I))...);
+  }
+
+  Word words_[kNumWords];
+};
+
+}  // namespace mcucore
+
+#endif  // MCUCORE_SRC_CONTAINER_BIT_SET_H_
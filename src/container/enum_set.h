@@ -0,0 +1,97 @@
+#ifndef MCUCORE_SRC_CONTAINER_ENUM_SET_H_
+#define MCUCORE_SRC_CONTAINER_ENUM_SET_H_
+
+// EnumSet<E, kMaxEnumerator> is a set of enumerators of enum E, stored as a
+// BitSet with one bit per enumerator from 0 to kMaxEnumerator. For example, a
+// listener can record which kinds of token it has seen in a request:
+//
+//    using ETokenSet = EnumSet<http1::EToken, http1::EToken::kHeaderValue>;
+//    ETokenSet seen;
+//    ...
+//    seen.insert(token);
+//    ...
+//    constexpr auto kRequired = ETokenSet::Of(http1::EToken::kHttpMethod,
+//                                             http1::EToken::kPathSegment);
+//    if (!kRequired.IsSubsetOf(seen)) { ... }
+//
+// Author: james.synge@gmail.com
+
+#include "container/bit_set.h"
+#include "mcucore_platform.h"
+
+namespace mcucore {
+
+template <typename E, E kMaxEnumerator>
+class EnumSet {
+  using Bits = BitSet<static_cast<size_t>(kMaxEnumerator) + 1>;
+
+ public:
+  using value_type = E;
+
+  // Constructs an empty set.
+  constexpr EnumSet() : bits_() {}
+
+  // Returns a set containing the specified enumerators.
+  template <typename... Es>
+  static constexpr EnumSet Of(Es... values) {
+    return EnumSet(Bits::Of(static_cast<size_t>(values)...));
+  }
+
+  // Returns a set containing all of the enumerators from 0 to kMaxEnumerator.
+  static constexpr EnumSet All() { return EnumSet(Bits::All()); }
+
+  constexpr bool contains(E value) const {
+    return bits_.test(static_cast<size_t>(value));
+  }
+  void insert(E value) { bits_.set(static_cast<size_t>(value)); }
+  void erase(E value) { bits_.reset(static_cast<size_t>(value)); }
+  void clear() { bits_.reset(); }
+
+  size_t count() const { return bits_.count(); }
+  bool empty() const { return bits_.none(); }
+
+  // Calls func(E) for each enumerator in the set, in ascending order.
+  template <typename F>
+  void for_each(F func) const {
+    bits_.for_each_set([&func](size_t pos) { func(static_cast<E>(pos)); });
+  }
+
+  // Returns true if every enumerator in this set is also in other.
+  bool IsSubsetOf(const EnumSet& other) const {
+    return bits_.IsSubsetOf(other.bits_);
+  }
+
+  // Set algebra.
+  constexpr EnumSet operator|(const EnumSet& other) const {
+    return EnumSet(bits_ | other.bits_);
+  }
+  constexpr EnumSet operator&(const EnumSet& other) const {
+    return EnumSet(bits_ & other.bits_);
+  }
+  constexpr EnumSet operator^(const EnumSet& other) const {
+    return EnumSet(bits_ ^ other.bits_);
+  }
+  constexpr EnumSet operator-(const EnumSet& other) const {
+    return EnumSet(bits_ - other.bits_);
+  }
+  constexpr EnumSet operator~() const { return EnumSet(~bits_); }
+
+  EnumSet& operator|=(const EnumSet& other) { return *this = *this | other; }
+  EnumSet& operator&=(const EnumSet& other) { return *this = *this & other; }
+  EnumSet& operator-=(const EnumSet& other) { return *this = *this - other; }
+
+  bool operator==(const EnumSet& other) const { return bits_ == other.bits_; }
+  bool operator!=(const EnumSet& other) const { return bits_ != other.bits_; }
+
+  // Returns the underlying set of bits.
+  constexpr const Bits& bits() const { return bits_; }
+
+ private:
+  constexpr explicit EnumSet(const Bits& bits) : bits_(bits) {}
+
+  Bits bits_;
+};
+
+}  // namespace mcucore
+
+#endif  // MCUCORE_SRC_CONTAINER_ENUM_SET_H_
@@ -0,0 +1,381 @@
+#ifndef MCUCORE_SRC_CONTAINER_FLAT_HASH_MAP_H_
+#define MCUCORE_SRC_CONTAINER_FLAT_HASH_MAP_H_
+
+// FlatHashMap<K, V, N> is a fixed capacity hash map, with the N slots stored in
+// the instance itself (i.e. no heap allocation), intended for hot-path keyed
+// lookups, such as from a connection id to the state of that connection. N must
+// be a power of two, and at most 128.
+//
+// The map uses open addressing with Robin Hood linear probing (an entry which
+// is further from its home slot than the occupant of a slot takes that slot,
+// and the occupant moves on), which keeps probe sequences short even at high
+// load factors, and allows lookups to stop as soon as they reach an entry
+// closer to its home slot than the key being sought would be. Removal uses
+// backward shifting of the following entries, so there are no tombstones.
+//
+// The default hasher, Fnv1aHasher<K>, supports integral and enum keys, and can
+// be evaluated at compile time. Other keys require a hasher with the signature:
+//
+//    uint32_t operator()(const K& key) const;
+//
+// ProgmemFlatHashMap is a read-only variant whose slots are computed at compile
+// time from a table of entries, and are stored in PROGMEM, for static tables.
+//
+// Author: james.synge@gmail.com
+
+#include "hash/fnv1a.h"
+#include "log/log.h"
+#include "mcucore_platform.h"
+#include "semistd/type_traits.h"
+#include "semistd/utility.h"
+#include "status/status.h"
+
+namespace mcucore {
+
+// Hashes integral and enum keys with FNV-1a, as if the key's bytes were
+// appended to an Fnv1a instance on a little-endian processor.
+template <typename K>
+struct Fnv1aHasher {
+  using HashInput = conditional_t<(sizeof(K) <= 4), uint32_t, uint64_t>;
+
+  constexpr uint32_t operator()(const K& key) const {
+    return Fnv1aHashOfBytes(static_cast<HashInput>(key), sizeof(K));
+  }
+};
+
+template <typename K, typename V, size_t N, typename Hasher = Fnv1aHasher<K>>
+class FlatHashMap {
+ public:
+  static_assert(N > 0 && (N & (N - 1)) == 0, "N must be a power of two");
+  static_assert(N <= 128, "N is too large for a uint8_t probe length");
+
+  using key_type = K;
+  using mapped_type = V;
+  using size_type = size_t;
+
+  FlatHashMap() { Clear(); }
+
+  // Returns the number of entries in the map.
+  size_type size() const { return size_; }
+  bool empty() const { return size_ == 0; }
+  bool full() const { return size_ >= N; }
+  static constexpr size_type capacity() { return N; }
+
+  // Returns a pointer to the value for the key, or nullptr if not found.
+  V* Find(const K& key) {
+    const auto slot = FindSlot(key);
+    return slot < N ? &values_[slot] : nullptr;
+  }
+  const V* Find(const K& key) const {
+    const auto slot = FindSlot(key);
+    return slot < N ? &values_[slot] : nullptr;
+  }
+
+  bool Contains(const K& key) const { return FindSlot(key) < N; }
+
+  // Inserts an entry with the specified key and value. Returns OK if there
+  // wasn't already an entry with the same key, and there is room for another
+  // entry; else returns an error.
+  Status Insert(const K& key, const V& value) {
+    if (FindSlot(key) < N) {
+      return AlreadyExistsError(MCU_PSD("Key in map"));
+    }
+    return InsertNewKey(key, value);
+  }
+
+  // Inserts an entry, or replaces the value of an existing entry with the same
+  // key. Returns OK unless the map is full and the key is not in the map.
+  Status InsertOrAssign(const K& key, const V& value) {
+    const auto slot = FindSlot(key);
+    if (slot < N) {
+      values_[slot] = value;
+      return OkStatus();
+    }
+    return InsertNewKey(key, value);
+  }
+
+  // Removes the entry with the specified key. Returns true if such an entry was
+  // found, else false.
+  bool Remove(const K& key) {
+    auto slot = FindSlot(key);
+    if (slot >= N) {
+      return false;
+    }
+    // Shift back the following entries of the probe sequence, stopping at an
+    // empty slot or an entry that is in its home slot.
+    auto next = NextSlot(slot);
+    while (probe_lengths_[next] > 1) {
+      keys_[slot] = keys_[next];
+      values_[slot] = values_[next];
+      probe_lengths_[slot] = probe_lengths_[next] - 1;
+      slot = next;
+      next = NextSlot(next);
+    }
+    probe_lengths_[slot] = 0;
+    --size_;
+    return true;
+  }
+
+  // Removes all entries.
+  void Clear() {
+    for (size_type slot = 0; slot < N; ++slot) {
+      probe_lengths_[slot] = 0;
+    }
+    size_ = 0;
+  }
+
+  // Calls func(key, value) for each entry, in an unspecified order.
+  template <typename F>
+  void ForEach(F func) const {
+    for (size_type slot = 0; slot < N; ++slot) {
+      if (probe_lengths_[slot] != 0) {
+        func(keys_[slot], values_[slot]);
+      }
+    }
+  }
+
+ private:
+  static size_type HomeSlot(const K& key) { return Hasher()(key) & (N - 1); }
+  static size_type NextSlot(size_type slot) { return (slot + 1) & (N - 1); }
+
+  // Returns the slot containing the key, or N if not found.
+  size_type FindSlot(const K& key) const {
+    auto slot = HomeSlot(key);
+    for (uint8_t probe_length = 1; probe_length <= N; ++probe_length) {
+      const auto slot_probe_length = probe_lengths_[slot];
+      if (slot_probe_length < probe_length) {
+        // Empty, or the occupant is closer to its home slot than the key would
+        // be, so the key can't be any further along.
+        return N;
+      } else if (slot_probe_length == probe_length && keys_[slot] == key) {
+        return slot;
+      }
+      slot = NextSlot(slot);
+    }
+    return N;
+  }
+
+  Status InsertNewKey(K key, V value) {
+    if (full()) {
+      MCU_VLOG(3) << MCU_PSD("Map full") << MCU_NAME_VAL(size_);
+      return ResourceExhaustedError(MCU_PSD("Map full"));
+    }
+    auto slot = HomeSlot(key);
+    uint8_t probe_length = 1;
+    while (probe_lengths_[slot] != 0) {
+      if (probe_lengths_[slot] < probe_length) {
+        // Take from the rich: the occupant is closer to its home slot, so
+        // displace it, and continue with finding a slot for it.
+        Swap(key, keys_[slot]);
+        Swap(value, values_[slot]);
+        Swap(probe_length, probe_lengths_[slot]);
+      }
+      slot = NextSlot(slot);
+      ++probe_length;
+      MCU_DCHECK_LE(probe_length, N);
+    }
+    keys_[slot] = key;
+    values_[slot] = value;
+    probe_lengths_[slot] = probe_length;
+    ++size_;
+    return OkStatus();
+  }
+
+  template <typename T>
+  static void Swap(T& a, T& b) {
+    T t = move(a);
+    a = move(b);
+    b = move(t);
+  }
+
+  K keys_[N];
+  V values_[N];
+  // Zero if the slot is empty, else one more than the distance of the entry in
+  // the slot from its home slot.
+  uint8_t probe_lengths_[N];
+  size_type size_;
+};
+
+////////////////////////////////////////////////////////////////////////////////
+// Support for ProgmemFlatHashMap.
+
+// An entry in the table from which a ProgmemFlatHashMap is built.
+template <typename K, typename V>
+struct FlatHashMapEntry {
+  K key;
+  V value;
+};
+
+namespace flat_hash_map_internal {
+
+// The slots of a ProgmemFlatHashMap.
+template <typename K, typename V>
+struct ProgmemSlot {
+  K key;
+  V value;
+  bool occupied;
+};
+
+// For each of the N slots, zero if the slot is empty, else one more than the
+// index of the entry of the table in that slot.
+template <size_t N>
+struct SlotAssignment {
+  uint8_t entries[N];
+};
+
+template <size_t N, size_t... I>
+constexpr SlotAssignment<N> AssignSlot(const SlotAssignment<N>& assignment,
+                                       size_t slot, uint8_t value,
+                                       index_sequence<I...>) {
+  return SlotAssignment<N>{
+      {(I == slot ? value : assignment.entries[I])...}};
+}
+
+// Places entry `entry` in the first empty slot at or after `slot`; i.e. the
+// table is laid out as if the entries were inserted in order with linear
+// probing.
+template <size_t N>
+constexpr SlotAssignment<N> PlaceEntry(const SlotAssignment<N>& assignment,
+                                       size_t slot, size_t entry) {
+  return assignment.entries[slot] == 0
+             ? AssignSlot(assignment, slot, static_cast<uint8_t>(entry + 1),
+                          make_index_sequence<N>())
+             : PlaceEntry(assignment, (slot + 1) & (N - 1), entry);
+}
+
+template <typename Table, size_t N, typename Hasher>
+constexpr SlotAssignment<N> AssignSlots(const SlotAssignment<N>& assignment,
+                                        size_t entry, size_t num_entries) {
+  return entry >= num_entries
+             ? assignment
+             : AssignSlots<Table, N, Hasher>(
+                   PlaceEntry(assignment,
+                              Hasher()(Table::kEntries[entry].key) & (N - 1),
+                              entry),
+                   entry + 1, num_entries);
+}
+
+template <typename Table>
+constexpr bool KeyAppearsAfter(size_t entry, size_t other,
+                               size_t num_entries) {
+  return other >= num_entries
+             ? false
+             : (Table::kEntries[entry].key == Table::kEntries[other].key ||
+                KeyAppearsAfter<Table>(entry, other + 1, num_entries));
+}
+
+template <typename Table>
+constexpr bool HasDuplicateKeys(size_t entry, size_t num_entries) {
+  return entry >= num_entries
+             ? false
+             : (KeyAppearsAfter<Table>(entry, entry + 1, num_entries) ||
+                HasDuplicateKeys<Table>(entry + 1, num_entries));
+}
+
+template <typename K, typename V, typename Table, size_t N, typename Hasher,
+          typename Indices = make_index_sequence<N>>
+struct ProgmemSlots;
+
+template <typename K, typename V, typename Table, size_t N, typename Hasher,
+          size_t... I>
+struct ProgmemSlots<K, V, Table, N, Hasher, index_sequence<I...>> {
+  using Slot = ProgmemSlot<K, V>;
+  static constexpr size_t kNumEntries =
+      sizeof(Table::kEntries) / sizeof(Table::kEntries[0]);
+  static_assert(kNumEntries <= N, "Too many entries for N slots");
+  static_assert(kNumEntries < 255, "Too many entries");
+  static_assert(!HasDuplicateKeys<Table>(0, kNumEntries),
+                "Table has duplicate keys");
+
+  static constexpr SlotAssignment<N> kAssignment =
+      AssignSlots<Table, N, Hasher>(SlotAssignment<N>{{}}, 0, kNumEntries);
+
+  static constexpr Slot MakeSlot(uint8_t entry_plus_one) {
+    return entry_plus_one == 0
+               ? Slot{K(), V(), false}
+               : Slot{Table::kEntries[entry_plus_one - 1].key,
+                      Table::kEntries[entry_plus_one - 1].value, true};
+  }
+
+  static constexpr Slot kSlots[N] AVR_PROGMEM = {
+      MakeSlot(kAssignment.entries[I])...};
+};
+
+template <typename K, typename V, typename Table, size_t N, typename Hasher,
+          size_t... I>
+constexpr SlotAssignment<N>
+    ProgmemSlots<K, V, Table, N, Hasher, index_sequence<I...>>::kAssignment;
+
+template <typename K, typename V, typename Table, size_t N, typename Hasher,
+          size_t... I>
+constexpr ProgmemSlot<K, V>
+    ProgmemSlots<K, V, Table, N, Hasher, index_sequence<I...>>::kSlots[N];
+
+}  // namespace flat_hash_map_internal
+
+// A read-only hash map whose slots are computed at compile time and stored in
+// PROGMEM. Table must be a type with a static constexpr array member kEntries
+// of FlatHashMapEntry<K, V>, with unique keys; for example:
+//
+//    struct HandlerTable {
+//      static constexpr FlatHashMapEntry<EHttpHeader, uint8_t> kEntries[] = {
+//          {EHttpHeader::kContentLength, 1},
+//          {EHttpHeader::kContentType, 2},
+//      };
+//    };
+//    using HandlerMap = ProgmemFlatHashMap<EHttpHeader, uint8_t, HandlerTable,
+//                                          4>;
+//
+// K and V must be literal types which can be copied with memcpy_P, and Hasher
+// must be usable at compile time (e.g. Fnv1aHasher).
+template <typename K, typename V, typename Table, size_t N,
+          typename Hasher = Fnv1aHasher<K>>
+class ProgmemFlatHashMap {
+ public:
+  static_assert(N > 0 && (N & (N - 1)) == 0, "N must be a power of two");
+
+  using key_type = K;
+  using mapped_type = V;
+  using size_type = size_t;
+
+  static constexpr size_type size() { return Slots::kNumEntries; }
+  static constexpr size_type capacity() { return N; }
+
+  // Finds the entry with the specified key, and if found copies its value into
+  // value and returns true; else returns false.
+  static bool Find(const K& key, V& value) {
+    Slot slot;
+    if (FindSlot(key, slot)) {
+      value = slot.value;
+      return true;
+    }
+    return false;
+  }
+
+  static bool Contains(const K& key) {
+    Slot slot;
+    return FindSlot(key, slot);
+  }
+
+ private:
+  using Slots = flat_hash_map_internal::ProgmemSlots<K, V, Table, N, Hasher>;
+  using Slot = typename Slots::Slot;
+
+  static bool FindSlot(const K& key, Slot& slot) {
+    size_type ndx = Hasher()(key) & (N - 1);
+    for (size_type count = 0; count < N; ++count) {
+      memcpy_P(&slot, &Slots::kSlots[ndx], sizeof slot);
+      if (!slot.occupied) {
+        return false;
+      } else if (slot.key == key) {
+        return true;
+      }
+      ndx = (ndx + 1) & (N - 1);
+    }
+    return false;
+  }
+};
+
+}  // namespace mcucore
+
+#endif  // MCUCORE_SRC_CONTAINER_FLAT_HASH_MAP_H_
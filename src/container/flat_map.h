@@ -0,0 +1,328 @@
+#ifndef MCUCORE_SRC_CONTAINER_FLAT_MAP_H_
+#define MCUCORE_SRC_CONTAINER_FLAT_MAP_H_
+
+// FlatMap<K, V, N> is a fixed capacity map whose entries are kept sorted by key
+// in a pair of parallel Arrays, one of keys and one of values, supporting
+// lookups in O(log N) time. It is intended for tables of moderate size that
+// change rarely (e.g. device info or configuration keyed by small integers),
+// where SerialMap's linear scan would be too slow. Insertion and removal take
+// O(N) time, as the following entries must be moved; when building a map from
+// many entries, BuildFromUnsorted is faster than repeated calls to
+// InsertSorted.
+//
+// K and V must be trivially copyable (i.e. can be moved with memmove), and K
+// must support operator< and operator==.
+//
+// ProgmemFlatMap<K, V> provides lookups in a pair of parallel arrays of keys
+// and values stored in PROGMEM, where the keys are sorted.
+//
+// Author: james.synge@gmail.com
+
+#include <string.h>  // For memmove
+
+#include "container/array.h"
+#include "log/log.h"
+#include "mcucore_platform.h"
+#include "misc/progmem_ptr.h"
+#include "semistd/type_traits.h"
+#include "status/status.h"
+
+namespace mcucore {
+namespace flat_map_internal {
+
+// Returns true if the first count keys are in strictly ascending order. This
+// is constexpr so that it can be used to check a table with static_assert.
+template <typename K>
+constexpr bool IsStrictlySorted(const K* keys, size_t count) {
+  return count < 2 ||
+         (keys[0] < keys[1] && IsStrictlySorted(keys + 1, count - 1));
+}
+
+// Returns the index of the first of the count keys which is not less than key,
+// or count if all are less. get_key(ndx) returns the key at ndx.
+template <typename K, typename SIZE, typename GetKey>
+SIZE LowerBound(const K& key, SIZE count, GetKey get_key) {
+  SIZE first = 0;
+  while (count > 0) {
+    const SIZE step = count / 2;
+    if (get_key(first + step) < key) {
+      first += step + 1;
+      count -= step + 1;
+    } else {
+      count = step;
+    }
+  }
+  return first;
+}
+
+// Below this size, sorting is performed with insertion sort, which is faster
+// for small arrays, and is stable; above it, heapsort is used, which has
+// O(N log N) worst case time, and requires neither recursion nor extra memory.
+constexpr size_t kInsertionSortLimit = 16;
+
+template <typename K, typename V>
+void InsertionSort(K* keys, V* values, size_t count) {
+  for (size_t ndx = 1; ndx < count; ++ndx) {
+    const K key = keys[ndx];
+    const V value = values[ndx];
+    size_t hole = ndx;
+    while (hole > 0 && key < keys[hole - 1]) {
+      keys[hole] = keys[hole - 1];
+      values[hole] = values[hole - 1];
+      --hole;
+    }
+    keys[hole] = key;
+    values[hole] = value;
+  }
+}
+
+template <typename K, typename V>
+void SiftDown(K* keys, V* values, size_t root, size_t count) {
+  while (true) {
+    size_t child = 2 * root + 1;
+    if (child >= count) {
+      return;
+    }
+    if (child + 1 < count && keys[child] < keys[child + 1]) {
+      ++child;
+    }
+    if (!(keys[root] < keys[child])) {
+      return;
+    }
+    const K key = keys[root];
+    keys[root] = keys[child];
+    keys[child] = key;
+    const V value = values[root];
+    values[root] = values[child];
+    values[child] = value;
+    root = child;
+  }
+}
+
+template <typename K, typename V>
+void HeapSort(K* keys, V* values, size_t count) {
+  for (size_t root = count / 2; root > 0;) {
+    --root;
+    SiftDown(keys, values, root, count);
+  }
+  for (size_t end = count; end > 1;) {
+    --end;
+    const K key = keys[0];
+    keys[0] = keys[end];
+    keys[end] = key;
+    const V value = values[0];
+    values[0] = values[end];
+    values[end] = value;
+    SiftDown(keys, values, 0, end);
+  }
+}
+
+}  // namespace flat_map_internal
+
+template <typename K, typename V, size_t N>
+class FlatMap {
+ public:
+  static_assert(N > 0, "N must be greater than zero");
+  static_assert(N < 65535, "N is too large");
+
+  using key_type = K;
+  using mapped_type = V;
+  using size_type = conditional_t<(N < 255), uint8_t, uint16_t>;
+
+  FlatMap() : size_(0) {}
+
+  // Returns the number of entries in the map.
+  size_type size() const { return size_; }
+  bool empty() const { return size_ == 0; }
+  bool full() const { return size_ >= N; }
+  static constexpr size_type capacity() { return N; }
+
+  // Returns the index of the first entry whose key is not less than key, or
+  // size() if there is no such entry.
+  size_type lower_bound(const K& key) const {
+    return flat_map_internal::LowerBound(
+        key, size_, [this](size_type ndx) -> const K& { return keys_[ndx]; });
+  }
+
+  // Returns a pointer to the value for the key, or nullptr if not found.
+  V* Find(const K& key) {
+    const auto ndx = FindIndex(key);
+    return ndx < size_ ? &values_[ndx] : nullptr;
+  }
+  const V* Find(const K& key) const {
+    const auto ndx = FindIndex(key);
+    return ndx < size_ ? &values_[ndx] : nullptr;
+  }
+
+  bool Contains(const K& key) const { return FindIndex(key) < size_; }
+
+  // Accessors for the entries, in order of ascending key.
+  const K& key_at(size_type ndx) const {
+    MCU_DCHECK_LT(ndx, size_);
+    return keys_[ndx];
+  }
+  V& value_at(size_type ndx) {
+    MCU_DCHECK_LT(ndx, size_);
+    return values_[ndx];
+  }
+  const V& value_at(size_type ndx) const {
+    MCU_DCHECK_LT(ndx, size_);
+    return values_[ndx];
+  }
+
+  // Inserts an entry at its sorted position, moving the entries with larger
+  // keys to make room. Returns an error if the key is already present, or if
+  // the map is full.
+  Status InsertSorted(const K& key, const V& value) {
+    const auto ndx = lower_bound(key);
+    if (ndx < size_ && keys_[ndx] == key) {
+      return AlreadyExistsError(MCU_PSD("Key in map"));
+    } else if (full()) {
+      return ResourceExhaustedError(MCU_PSD("Map full"));
+    }
+    const size_t num_to_move = size_ - ndx;
+    memmove(&keys_[ndx] + 1, &keys_[ndx], num_to_move * sizeof(K));
+    memmove(&values_[ndx] + 1, &values_[ndx], num_to_move * sizeof(V));
+    keys_[ndx] = key;
+    values_[ndx] = value;
+    ++size_;
+    return OkStatus();
+  }
+
+  // Removes the entry with the specified key. Returns true if found.
+  bool Remove(const K& key) {
+    const auto ndx = FindIndex(key);
+    if (ndx >= size_) {
+      return false;
+    }
+    const size_t num_to_move = size_ - ndx - 1;
+    memmove(&keys_[ndx], &keys_[ndx] + 1, num_to_move * sizeof(K));
+    memmove(&values_[ndx], &values_[ndx] + 1, num_to_move * sizeof(V));
+    --size_;
+    return true;
+  }
+
+  // Removes all entries.
+  void Clear() { size_ = 0; }
+
+  // Replaces the contents of the map with the count entries in the parallel
+  // arrays keys and values, which need not be sorted. Returns an error if
+  // count is greater than N, or if there are duplicate keys, in which case the
+  // map is left empty.
+  Status BuildFromUnsorted(const K* keys, const V* values, size_t count) {
+    Clear();
+    if (count > N) {
+      return ResourceExhaustedError(MCU_PSD("Too many entries"));
+    }
+    const auto size = static_cast<size_type>(count);
+    for (size_type ndx = 0; ndx < size; ++ndx) {
+      keys_[ndx] = keys[ndx];
+      values_[ndx] = values[ndx];
+    }
+    if (size <= flat_map_internal::kInsertionSortLimit) {
+      flat_map_internal::InsertionSort(keys_.data(), values_.data(), size);
+    } else {
+      flat_map_internal::HeapSort(keys_.data(), values_.data(), size);
+    }
+    for (size_type ndx = 1; ndx < size; ++ndx) {
+      if (keys_[ndx - 1] == keys_[ndx]) {
+        return InvalidArgumentError(MCU_PSD("Duplicate key"));
+      }
+    }
+    size_ = size;
+    return OkStatus();
+  }
+
+  template <size_t M>
+  Status BuildFromUnsorted(const K (&keys)[M], const V (&values)[M]) {
+    return BuildFromUnsorted(keys, values, M);
+  }
+
+ private:
+  // Returns the index of the entry with the key, or size_ if not found.
+  size_type FindIndex(const K& key) const {
+    const auto ndx = lower_bound(key);
+    return (ndx < size_ && keys_[ndx] == key) ? ndx : size_;
+  }
+
+  Array<K, N> keys_;
+  Array<V, N> values_;
+  size_type size_;
+};
+
+// ProgmemFlatMap provides read-only lookups in a pair of parallel arrays stored
+// in PROGMEM, where the keys are in strictly ascending order. For example:
+//
+//    constexpr uint8_t kKeys[] AVR_PROGMEM = {1, 7, 9};
+//    constexpr int16_t kValues[] AVR_PROGMEM = {-1, 700, 9};
+//    static_assert(IsStrictlySorted(kKeys), "kKeys must be sorted");
+//    ...
+//    ProgmemFlatMap<uint8_t, int16_t> map(kKeys, kValues);
+//    int16_t value;
+//    if (map.Find(7, value)) { ... }
+template <typename K, typename V>
+class ProgmemFlatMap {
+ public:
+  using key_type = K;
+  using mapped_type = V;
+  using size_type = uint16_t;
+
+  constexpr ProgmemFlatMap(const K* keys, const V* values, size_type size)
+      : keys_(keys), values_(values), size_(size) {}
+
+  template <size_type M>
+  constexpr ProgmemFlatMap(const K (&keys)[M], const V (&values)[M])
+      : ProgmemFlatMap(keys, values, M) {}
+
+  constexpr size_type size() const { return size_; }
+  constexpr bool empty() const { return size_ == 0; }
+
+  // Returns the index of the first entry whose key is not less than key, or
+  // size() if there is no such entry.
+  size_type lower_bound(const K& key) const {
+    return flat_map_internal::LowerBound(
+        key, size_, [this](size_type ndx) { return key_at(ndx); });
+  }
+
+  // Finds the entry with the specified key, and if found copies its value into
+  // value and returns true; else returns false.
+  bool Find(const K& key, V& value) const {
+    const auto ndx = lower_bound(key);
+    if (ndx < size_ && key_at(ndx) == key) {
+      value = value_at(ndx);
+      return true;
+    }
+    return false;
+  }
+
+  bool Contains(const K& key) const {
+    const auto ndx = lower_bound(key);
+    return ndx < size_ && key_at(ndx) == key;
+  }
+
+  // Accessors for the entries, which copy them from PROGMEM.
+  K key_at(size_type ndx) const {
+    MCU_DCHECK_LT(ndx, size_);
+    return *ProgmemPtr<K>(reinterpret_cast<PGM_P>(keys_ + ndx));
+  }
+  V value_at(size_type ndx) const {
+    MCU_DCHECK_LT(ndx, size_);
+    return *ProgmemPtr<V>(reinterpret_cast<PGM_P>(values_ + ndx));
+  }
+
+ private:
+  const K* const keys_;
+  const V* const values_;
+  const size_type size_;
+};
+
+// Returns true if the keys are in strictly ascending order, as required by
+// FlatMap and ProgmemFlatMap.
+template <typename K, size_t M>
+constexpr bool IsStrictlySorted(const K (&keys)[M]) {
+  return flat_map_internal::IsStrictlySorted(keys, M);
+}
+
+}  // namespace mcucore
+
+#endif  // MCUCORE_SRC_CONTAINER_FLAT_MAP_H_
@@ -0,0 +1,232 @@
+#ifndef MCUCORE_SRC_CONTAINER_INTRUSIVE_HEAP_H_
+#define MCUCORE_SRC_CONTAINER_INTRUSIVE_HEAP_H_
+
+// IntrusiveHeap<T, &T::heap_index, N, Compare> is a binary min-heap of up to N
+// pointers to T instances, where each item records its own position in the
+// heap in a member of type IntrusiveHeapIndex. Knowing the position allows an
+// item to be removed, or re-positioned after its key has changed, in O(log n)
+// time, without searching the heap. This suits a queue of timers or deadlines:
+//
+//    struct Timer {
+//      bool operator<(const Timer& other) const {
+//        return deadline < other.deadline;
+//      }
+//      MillisT deadline;
+//      IntrusiveHeapIndex heap_index;
+//    };
+//    IntrusiveHeap<Timer, &Timer::heap_index, 8> timers;
+//    ...
+//    timers.Push(timer);
+//    ...
+//    timer.deadline = now + 100;
+//    timers.Update(timer);  // Deadline changed.
+//    ...
+//    while (!timers.empty() && timers.top()->deadline <= now) {
+//      Timer* expired = timers.Pop();
+//      ...
+//    }
+//
+// Compare(a, b) must return true if a should be closer to the top than b; the
+// default uses operator<. The heap doesn't allocate or own the items.
+//
+// Author: james.synge@gmail.com
+
+#include "log/log.h"
+#include "mcucore_platform.h"
+
+namespace mcucore {
+
+// The position of an item in an IntrusiveHeap, or kNotInHeap.
+class IntrusiveHeapIndex {
+ public:
+  static constexpr uint8_t kNotInHeap = 255;
+
+  IntrusiveHeapIndex() : value_(kNotInHeap) {}
+
+  // Copying an item doesn't copy its membership in a heap.
+  IntrusiveHeapIndex(const IntrusiveHeapIndex&) : IntrusiveHeapIndex() {}
+  IntrusiveHeapIndex& operator=(const IntrusiveHeapIndex&) { return *this; }
+
+  bool in_heap() const { return value_ != kNotInHeap; }
+  uint8_t value() const { return value_; }
+
+ private:
+  template <typename T, IntrusiveHeapIndex T::*, uint8_t, typename>
+  friend class IntrusiveHeap;
+
+  uint8_t value_;
+};
+
+namespace intrusive_heap_internal {
+
+struct Less {
+  template <typename T>
+  bool operator()(const T& a, const T& b) const {
+    return a < b;
+  }
+};
+
+}  // namespace intrusive_heap_internal
+
+template <typename T, IntrusiveHeapIndex T::*kIndex, uint8_t N,
+          typename Compare = intrusive_heap_internal::Less>
+class IntrusiveHeap {
+ public:
+  static_assert(N > 0 && N < IntrusiveHeapIndex::kNotInHeap,
+                "N must be in the range [1, 254]");
+
+  using value_type = T;
+  using size_type = uint8_t;
+
+  explicit IntrusiveHeap(Compare compare = Compare())
+      : compare_(compare), size_(0) {}
+
+  // Removes any remaining items, so that they can be added to another heap.
+  ~IntrusiveHeap() { Clear(); }
+
+  IntrusiveHeap(const IntrusiveHeap&) = delete;
+  IntrusiveHeap& operator=(const IntrusiveHeap&) = delete;
+
+  bool empty() const { return size_ == 0; }
+  bool full() const { return size_ >= N; }
+  size_type size() const { return size_; }
+  static constexpr size_type max_size() { return N; }
+
+  // Returns the item at the top of the heap, or nullptr if empty.
+  T* top() const { return empty() ? nullptr : items_[0]; }
+
+  // Returns true if item is in this heap.
+  bool Contains(const T& item) const {
+    const uint8_t pos = (item.*kIndex).value_;
+    return pos < size_ && items_[pos] == &item;
+  }
+
+  // Adds item, which must not be in a heap. Returns false if the heap is full.
+  bool Push(T& item) {
+    MCU_DCHECK(!(item.*kIndex).in_heap()) << MCU_PSD("Already in a heap");
+    if (full()) {
+      MCU_VLOG(3) << MCU_PSD("Heap full") << MCU_NAME_VAL(size_);
+      return false;
+    }
+    const size_type pos = size_++;
+    Place(item, pos);
+    SiftUp(pos);
+    return true;
+  }
+
+  // Removes and returns the item at the top of the heap, or returns nullptr if
+  // the heap is empty.
+  T* Pop() {
+    T* item = top();
+    if (item != nullptr) {
+      Remove(*item);
+    }
+    return item;
+  }
+
+  // Removes item, which must be in this heap.
+  void Remove(T& item) {
+    MCU_DCHECK(Contains(item)) << MCU_PSD("Not in heap");
+    if (!Contains(item)) {
+      return;
+    }
+    const size_type pos = (item.*kIndex).value_;
+    (item.*kIndex).value_ = IntrusiveHeapIndex::kNotInHeap;
+    const size_type last = --size_;
+    if (pos != last) {
+      // Fill the hole with the last item, which may belong above or below pos.
+      Place(*items_[last], pos);
+      Restore(pos);
+    }
+  }
+
+  // Restores the heap order after the key of item, which must be in this heap,
+  // has been changed; handles the key moving in either direction (i.e. both
+  // decrease-key and increase-key).
+  void Update(T& item) {
+    MCU_DCHECK(Contains(item)) << MCU_PSD("Not in heap");
+    if (Contains(item)) {
+      Restore((item.*kIndex).value_);
+    }
+  }
+
+  // Removes all of the items.
+  void Clear() {
+    for (size_type pos = 0; pos < size_; ++pos) {
+      (items_[pos]->*kIndex).value_ = IntrusiveHeapIndex::kNotInHeap;
+    }
+    size_ = 0;
+  }
+
+  // Calls func(T&) for each item, in no particular order. func must not modify
+  // the heap.
+  template <typename F>
+  void ForEach(F func) const {
+    for (size_type pos = 0; pos < size_; ++pos) {
+      func(*items_[pos]);
+    }
+  }
+
+ private:
+  void Place(T& item, size_type pos) {
+    items_[pos] = &item;
+    (item.*kIndex).value_ = pos;
+  }
+
+  bool Before(size_type a, size_type b) const {
+    return compare_(*items_[a], *items_[b]);
+  }
+
+  void Swap(size_type a, size_type b) {
+    T* item_a = items_[a];
+    Place(*items_[b], a);
+    Place(*item_a, b);
+  }
+
+  // Moves the item at pos up or down, as needed.
+  void Restore(size_type pos) {
+    if (pos > 0 && Before(pos, (pos - 1) / 2)) {
+      SiftUp(pos);
+    } else {
+      SiftDown(pos);
+    }
+  }
+
+  void SiftUp(size_type pos) {
+    while (pos > 0) {
+      const size_type parent = (pos - 1) / 2;
+      if (!Before(pos, parent)) {
+        break;
+      }
+      Swap(pos, parent);
+      pos = parent;
+    }
+  }
+
+  void SiftDown(size_type pos) {
+    while (true) {
+      // Use a wider type for the children, as 2 * pos + 2 can exceed 255.
+      const size_t left = 2 * static_cast<size_t>(pos) + 1;
+      if (left >= size_) {
+        break;
+      }
+      size_t best = left;
+      if (left + 1 < size_ && Before(left + 1, left)) {
+        best = left + 1;
+      }
+      if (!Before(best, pos)) {
+        break;
+      }
+      Swap(pos, best);
+      pos = static_cast<size_type>(best);
+    }
+  }
+
+  Compare compare_;
+  T* items_[N];
+  size_type size_;
+};
+
+}  // namespace mcucore
+
+#endif  // MCUCORE_SRC_CONTAINER_INTRUSIVE_HEAP_H_
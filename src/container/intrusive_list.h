@@ -0,0 +1,183 @@
+#ifndef MCUCORE_SRC_CONTAINER_INTRUSIVE_LIST_H_
+#define MCUCORE_SRC_CONTAINER_INTRUSIVE_LIST_H_
+
+// IntrusiveList<T, &T::node> is a doubly linked list of T instances, where the
+// links are stored in a member of T of type IntrusiveListNode. The list doesn't
+// allocate or own the items (they typically live in an ObjectPool or in static
+// storage), and any item can be unlinked or moved in O(1) time, which makes it
+// suitable for an LRU list of connections, or a queue of pending work items:
+//
+//    struct Connection {
+//      ...
+//      IntrusiveListNode lru_node;
+//    };
+//    IntrusiveList<Connection, &Connection::lru_node> lru;
+//    ...
+//    lru.MoveToBack(conn);  // conn was just used.
+//    ...
+//    Connection* victim = lru.PopFront();  // Least recently used.
+//
+// An item may be in multiple lists at once only if it has a separate node for
+// each list. The links are pointers, which take 2 bytes each on AVR.
+//
+// Author: james.synge@gmail.com
+
+#include "log/log.h"
+#include "mcucore_platform.h"
+
+namespace mcucore {
+
+// The links of an item in an IntrusiveList. A node which is not in a list has
+// null links.
+struct IntrusiveListNode {
+  IntrusiveListNode() : prev(nullptr), next(nullptr) {}
+
+  // Copying an item doesn't copy its membership in a list.
+  IntrusiveListNode(const IntrusiveListNode&) : IntrusiveListNode() {}
+  IntrusiveListNode& operator=(const IntrusiveListNode&) { return *this; }
+
+  bool linked() const { return next != nullptr; }
+
+  IntrusiveListNode* prev;
+  IntrusiveListNode* next;
+};
+
+template <typename T, IntrusiveListNode T::*kNode>
+class IntrusiveList {
+ public:
+  using value_type = T;
+
+  // The list is circular, with head_ as the sentinel node, so that insertion
+  // and removal don't need to special case the ends of the list.
+  IntrusiveList() : size_(0) { head_.prev = head_.next = &head_; }
+
+  // Unlinks any remaining items, so that they can be added to another list.
+  ~IntrusiveList() { Clear(); }
+
+  IntrusiveList(const IntrusiveList&) = delete;
+  IntrusiveList& operator=(const IntrusiveList&) = delete;
+
+  bool empty() const { return head_.next == &head_; }
+  size_t size() const { return size_; }
+
+  // Returns the first or last item, or nullptr if the list is empty.
+  T* front() const { return empty() ? nullptr : ItemOf(head_.next); }
+  T* back() const { return empty() ? nullptr : ItemOf(head_.prev); }
+
+  // Returns the item after (or before) item, or nullptr if item is the last
+  // (or first) item in the list. item must be in this list.
+  T* Next(const T& item) const {
+    const IntrusiveListNode* next = NodeOf(item).next;
+    return next == &head_ ? nullptr : ItemOf(next);
+  }
+  T* Prev(const T& item) const {
+    const IntrusiveListNode* prev = NodeOf(item).prev;
+    return prev == &head_ ? nullptr : ItemOf(prev);
+  }
+
+  // Adds item, which must not be in a list, at the start or end of the list.
+  void PushFront(T& item) { InsertAfter(head_, NodeOf(item)); }
+  void PushBack(T& item) { InsertAfter(*head_.prev, NodeOf(item)); }
+
+  // Adds item, which must not be in a list, after position, which must be in
+  // this list.
+  void InsertAfter(T& position, T& item) {
+    MCU_DCHECK(NodeOf(position).linked());
+    InsertAfter(NodeOf(position), NodeOf(item));
+  }
+
+  // Removes and returns the first or last item, or returns nullptr if empty.
+  T* PopFront() {
+    T* item = front();
+    if (item != nullptr) {
+      Remove(*item);
+    }
+    return item;
+  }
+  T* PopBack() {
+    T* item = back();
+    if (item != nullptr) {
+      Remove(*item);
+    }
+    return item;
+  }
+
+  // Removes item, which must be in this list.
+  void Remove(T& item) {
+    IntrusiveListNode& node = NodeOf(item);
+    MCU_DCHECK(node.linked()) << MCU_PSD("Not in list");
+    if (!node.linked()) {
+      return;
+    }
+    node.prev->next = node.next;
+    node.next->prev = node.prev;
+    node.prev = node.next = nullptr;
+    --size_;
+  }
+
+  // Moves item, which must be in this list, to the start or end of the list.
+  void MoveToFront(T& item) {
+    Remove(item);
+    PushFront(item);
+  }
+  void MoveToBack(T& item) {
+    Remove(item);
+    PushBack(item);
+  }
+
+  // Removes all of the items.
+  void Clear() {
+    while (PopFront() != nullptr) {
+    }
+  }
+
+  // Calls func(T&) for each item, from front to back. func must not modify
+  // the list, other than by removing the item it has been passed.
+  template <typename F>
+  void ForEach(F func) const {
+    IntrusiveListNode* node = head_.next;
+    while (node != &head_) {
+      IntrusiveListNode* next = node->next;
+      func(*ItemOf(node));
+      node = next;
+    }
+  }
+
+ private:
+  void InsertAfter(IntrusiveListNode& position, IntrusiveListNode& node) {
+    MCU_DCHECK(!node.linked()) << MCU_PSD("Already in a list");
+    if (node.linked()) {
+      return;
+    }
+    node.prev = &position;
+    node.next = position.next;
+    position.next->prev = &node;
+    position.next = &node;
+    ++size_;
+  }
+
+  static IntrusiveListNode& NodeOf(T& item) { return item.*kNode; }
+  static const IntrusiveListNode& NodeOf(const T& item) { return item.*kNode; }
+
+  // Returns the item whose node is *node, i.e. subtracts the offset of the node
+  // within T from the address of the node.
+  static T* ItemOf(const IntrusiveListNode* node) {
+    const char* node_ptr = reinterpret_cast<const char*>(node);
+    return reinterpret_cast<T*>(const_cast<char*>(node_ptr - NodeOffset()));
+  }
+
+  // Like offsetof, but for a pointer to member. The address is arbitrary, but
+  // suitably aligned, and never dereferenced; this compiles to a constant.
+  static size_t NodeOffset() {
+    constexpr uintptr_t kAddr = 256;
+    const T* item = reinterpret_cast<const T*>(kAddr);
+    return reinterpret_cast<uintptr_t>(&(item->*kNode)) - kAddr;
+  }
+
+  IntrusiveListNode head_;
+  size_t size_;
+};
+
+}  // namespace mcucore
+
+#endif  // MCUCORE_SRC_CONTAINER_INTRUSIVE_LIST_H_
@@ -0,0 +1,227 @@
+#ifndef MCUCORE_SRC_CONTAINER_LINK_TIME_TABLE_H_
+#define MCUCORE_SRC_CONTAINER_LINK_TIME_TABLE_H_
+
+// Support for tables (arrays) whose elements are defined in multiple source
+// files. The elements are constant, and on AVR are stored in PROGMEM. See
+// extras/docs/link-time-table.md for the motivation. Usage:
+//
+//    // In a header file, declare the table (at namespace scope):
+//    struct CommandHandler {
+//      const char* name;  // Pointer to a PROGMEM string on AVR.
+//      void (*handler)();
+//    };
+//    MCU_DECLARE_TABLE(CommandHandlers, CommandHandler);
+//
+//    // In exactly one source file, define the table (at namespace scope):
+//    MCU_DEFINE_TABLE(CommandHandlers);
+//
+//    // In any source file, add elements to the table (at namespace scope):
+//    MCU_REGISTER_IN_TABLE(CommandHandlers, {kResetName, &HandleReset});
+//
+//    // Access the elements:
+//    for (const CommandHandler& entry : CommandHandlers::Elements()) { ... }
+//
+// On all platforms Elements() returns a TableElements<element_type>, a forward
+// range with begin(), end(), size() and empty(). The order of the elements is
+// unspecified. On AVR the elements are in PROGMEM, so must be read with
+// memcpy_P or ProgmemPtr, not by dereferencing the pointers.
+//
+// On ELF platforms (e.g. the host, ARM) the table is assembled by the linker,
+// rather than at runtime, so registering an element costs no RAM and no startup
+// time, and the elements are contiguous. Each table is placed in a section
+// named mcu_table_<table>, and the linker provides the symbols
+// __start_mcu_table_... and __stop_mcu_table_..., which bound the table.
+//
+// AVR DOESN'T MEET THOSE GOALS: there, each element costs 4 bytes of RAM and a
+// static constructor, and the elements aren't contiguous. The AVR linker script
+// places all .progmem* sections in one output section, doesn't provide those
+// symbols, and (when linking with --gc-sections, as the Arduino IDE does)
+// discards sections which aren't referenced. So instead each element is in
+// PROGMEM as usual, and a node in RAM which points to the element is added by a
+// static constructor to a list of the elements of the table. Elements() must
+// not be called before static initialization is complete (e.g. by another
+// static constructor), and size() walks the list.
+//
+// NOTE: Elements registered in a file that is part of a static library are only
+// linked into the program if that object file is linked for some other reason
+// (or the library is linked with --whole-archive).
+//
+// NOTE: Linking with --gc-sections is supported: on ELF platforms the linker
+// keeps the sections of the tables because they're referenced by the
+// __start_/__stop_ symbols (unless linking with -z start-stop-gc), and on AVR
+// the nodes are referenced by their static constructors.
+//
+// Author: james.synge@gmail.com
+
+#include "log/log.h"
+#include "mcucore_platform.h"
+#include "misc/preproc.h"
+
+namespace mcucore {
+
+#ifdef ARDUINO_ARCH_AVR
+
+namespace link_time_table_internal {
+
+// A registered element of a table, added to the head of the table's list of
+// nodes when constructed.
+template <typename T>
+struct TableNode {
+  TableNode(const T* element, const TableNode*& head)
+      : element(element), next(head) {
+    head = this;
+  }
+
+  const T* const element;  // In PROGMEM.
+  const TableNode* const next;
+};
+
+}  // namespace link_time_table_internal
+
+// A forward range over the elements of a table, given the head of its list.
+template <typename T>
+class TableElements {
+ public:
+  using Node = link_time_table_internal::TableNode<T>;
+
+  class Iterator {
+   public:
+    explicit Iterator(const Node* node) : node_(node) {}
+
+    const T& operator*() const { return *node_->element; }
+    const T* operator->() const { return node_->element; }
+    Iterator& operator++() {
+      node_ = node_->next;
+      return *this;
+    }
+    bool operator==(const Iterator& other) const {
+      return node_ == other.node_;
+    }
+    bool operator!=(const Iterator& other) const {
+      return node_ != other.node_;
+    }
+
+   private:
+    const Node* node_;
+  };
+
+  explicit TableElements(const Node* head) : head_(head) {}
+
+  Iterator begin() const { return Iterator(head_); }
+  Iterator end() const { return Iterator(nullptr); }
+  bool empty() const { return head_ == nullptr; }
+
+  size_t size() const {
+    size_t result = 0;
+    for (auto node = head_; node != nullptr; node = node->next) {
+      ++result;
+    }
+    return result;
+  }
+
+ private:
+  const Node* const head_;
+};
+
+#else  // !ARDUINO_ARCH_AVR
+
+// A range over the elements of a table, from begin up to (but not including)
+// end. Either both are null (i.e. the table is empty), or neither is.
+template <typename T>
+class TableElements {
+ public:
+  using Iterator = const T*;
+
+  TableElements(const T* begin, const T* end)
+      : begin_(begin == nullptr || end == nullptr ? nullptr : begin),
+        end_(begin_ == nullptr ? nullptr : end) {
+    MCU_DCHECK(begin_ <= end_);
+  }
+
+  Iterator begin() const { return begin_; }
+  Iterator end() const { return end_; }
+  bool empty() const { return begin_ == end_; }
+  size_t size() const { return static_cast<size_t>(end_ - begin_); }
+
+ private:
+  const T* const begin_;
+  const T* const end_;
+};
+
+#endif  // ARDUINO_ARCH_AVR
+
+}  // namespace mcucore
+
+#ifdef ARDUINO_ARCH_AVR
+
+// Declares a table (actually a struct with static members) with the specified
+// name, whose elements are of type element_type. mcu_table_head_ is only for
+// use by MCU_REGISTER_IN_TABLE.
+#define MCU_DECLARE_TABLE(table, element_type_param)             \
+  struct table {                                                 \
+    using element_type = element_type_param;                     \
+    static ::mcucore::TableElements<element_type> Elements();    \
+    static const ::mcucore::link_time_table_internal::TableNode< \
+        element_type>* mcu_table_head_;                          \
+  }
+
+// The head is constant initialized, so is null before any of the static
+// constructors which add nodes to the list run.
+#define MCU_DEFINE_TABLE(table)                                              \
+  const ::mcucore::link_time_table_internal::TableNode<table::element_type>* \
+      table::mcu_table_head_ = nullptr;                                      \
+  ::mcucore::TableElements<table::element_type> table::Elements() {          \
+    return ::mcucore::TableElements<table::element_type>(mcu_table_head_);   \
+  }
+
+#define MCU_REGISTER_IN_TABLE(table, ...) \
+  MCU_REGISTER_IN_TABLE_INTERNAL(         \
+      table, MCU_PP_UNIQUE_NAME(mcu_table_element_), __VA_ARGS__)
+
+#define MCU_REGISTER_IN_TABLE_INTERNAL(table, element_name, ...)             \
+  static const table::element_type element_name PROGMEM = __VA_ARGS__;       \
+  static ::mcucore::link_time_table_internal::TableNode<table::element_type> \
+      MCU_PP_CONCAT_TOKENS(element_name, _node)(&element_name,               \
+                                                table::mcu_table_head_)
+
+#elif defined(__ELF__)
+
+// Declares a table (actually a struct with static members) with the specified
+// name, whose elements are of type element_type.
+#define MCU_DECLARE_TABLE(table, element_type_param)          \
+  struct table {                                              \
+    using element_type = element_type_param;                  \
+    static ::mcucore::TableElements<element_type> Elements(); \
+  }
+
+// The compiler may increase the alignment of a variable beyond that required by
+// its type (e.g. to 16 bytes for larger objects on x86_64), which would leave
+// gaps between the elements; specifying the alignment explicitly prevents that.
+#define MCU_TABLE_ELEMENT_ALIGNMENT_INTERNAL(table) \
+  __attribute__((aligned(alignof(table::element_type))))
+
+#define MCU_TABLE_SECTION_INTERNAL(table) \
+  __attribute__((section("mcu_table_" #table), used))
+
+// The symbols are weak so that an empty table (i.e. without a section) links.
+#define MCU_DEFINE_TABLE(table)                                     \
+  extern "C" const table::element_type __start_mcu_table_##table[]  \
+      __attribute__((weak));                                        \
+  extern "C" const table::element_type __stop_mcu_table_##table[]   \
+      __attribute__((weak));                                        \
+  ::mcucore::TableElements<table::element_type> table::Elements() { \
+    return ::mcucore::TableElements<table::element_type>(           \
+        __start_mcu_table_##table, __stop_mcu_table_##table);       \
+  }
+
+#define MCU_REGISTER_IN_TABLE(table, ...)                                 \
+  static const table::element_type MCU_PP_UNIQUE_NAME(mcu_table_element_) \
+      MCU_TABLE_SECTION_INTERNAL(table)                                   \
+          MCU_TABLE_ELEMENT_ALIGNMENT_INTERNAL(table) = __VA_ARGS__
+
+#endif  // ARDUINO_ARCH_AVR / __ELF__
+
+// On other platforms (e.g. Mach-O, which names the symbols differently) the
+// macros are not defined, so using them produces a compile error.
+
+#endif  // MCUCORE_SRC_CONTAINER_LINK_TIME_TABLE_H_
@@ -0,0 +1,145 @@
+#ifndef MCUCORE_SRC_CONTAINER_OBJECT_POOL_H_
+#define MCUCORE_SRC_CONTAINER_OBJECT_POOL_H_
+
+// ObjectPool<T, N> provides storage for up to N instances of T, such as
+// connection objects or per-client decoders, which are constructed when
+// acquired and destroyed when released, both in O(1) time (i.e. without
+// searching for a free slot).
+//
+// The free slots form a singly linked list, with the link (the index of the
+// next free slot) stored in the otherwise unused bytes of each free slot, so
+// the only overhead beyond the slots themselves is one bit per slot, recording
+// which slots are live (in use). That bitmap supports iterating over the live
+// objects, and detection of releasing an object twice.
+//
+// Author: james.synge@gmail.com
+
+#include <new>  // pragma: keep standard include
+
+#include "log/log.h"
+#include "mcucore_platform.h"
+#include "semistd/utility.h"
+
+namespace mcucore {
+
+template <typename T, uint8_t N>
+class ObjectPool {
+ public:
+  static_assert(N > 0 && N < 255, "N must be in the range [1, 254]");
+
+  using value_type = T;
+  using size_type = uint8_t;
+
+  ObjectPool() : free_head_(0), size_(0), high_water_mark_(0) {
+    for (size_type ndx = 0; ndx < N; ++ndx) {
+      SetNextFree(ndx, ndx + 1);  // The last one gets kNoSlot.
+    }
+    for (auto& bits : live_) {
+      bits = 0;
+    }
+  }
+
+  ~ObjectPool() {
+    ForEach([](T& obj) { obj.~T(); });
+  }
+
+  ObjectPool(const ObjectPool&) = delete;
+  ObjectPool& operator=(const ObjectPool&) = delete;
+
+  // Constructs an instance of T in a free slot, with the specified arguments,
+  // and returns a pointer to it. Returns nullptr if the pool is full.
+  template <typename... Args>
+  T* Acquire(Args&&... args) {
+    if (free_head_ == kNoSlot) {
+      MCU_VLOG(3) << MCU_PSD("Pool full") << MCU_NAME_VAL(size_);
+      return nullptr;
+    }
+    const size_type ndx = free_head_;
+    free_head_ = NextFree(ndx);
+    SetLive(ndx);
+    if (++size_ > high_water_mark_) {
+      high_water_mark_ = size_;
+    }
+    return new (slots_[ndx]) T(forward<Args>(args)...);
+  }
+
+  // Destroys obj, which must have been returned by Acquire, and not since
+  // released, and makes its slot available for reuse.
+  void Release(T* obj) {
+    const size_type ndx = IndexOf(obj);
+    MCU_DCHECK_LT(ndx, N) << MCU_PSD("Not in pool");
+    MCU_DCHECK(IsLive(ndx)) << MCU_PSD("Double release") << MCU_NAME_VAL(ndx);
+    if (ndx >= N || !IsLive(ndx)) {
+      return;
+    }
+    obj->~T();
+    ClearLive(ndx);
+    SetNextFree(ndx, free_head_);
+    free_head_ = ndx;
+    --size_;
+  }
+
+  // Returns true if obj is a live object in this pool.
+  bool Contains(const T* obj) const {
+    const size_type ndx = IndexOf(obj);
+    return ndx < N && IsLive(ndx);
+  }
+
+  // Calls func(T&) for each live object, in order of slot index. func may
+  // release the object it is passed, but not any other.
+  template <typename F>
+  void ForEach(F func) {
+    for (size_type byte_ndx = 0; byte_ndx < kBitmapSize; ++byte_ndx) {
+      uint8_t bits = live_[byte_ndx];
+      for (size_type ndx = byte_ndx * 8; bits != 0; ++ndx, bits >>= 1) {
+        if (bits & 1) {
+          func(*reinterpret_cast<T*>(slots_[ndx]));
+        }
+      }
+    }
+  }
+
+  // Returns the number of live objects.
+  size_type size() const { return size_; }
+  static constexpr size_type capacity() { return N; }
+  size_type available() const { return N - size_; }
+  bool empty() const { return size_ == 0; }
+  bool full() const { return size_ >= N; }
+
+  // Returns the largest number of objects that have been live at once.
+  size_type high_water_mark() const { return high_water_mark_; }
+
+ private:
+  static constexpr size_type kNoSlot = N;
+  static constexpr size_type kBitmapSize = (N + 7) / 8;
+
+  // Returns the index of the slot containing obj, or N if not in the pool.
+  size_type IndexOf(const T* obj) const {
+    const auto* ptr = reinterpret_cast<const uint8_t*>(obj);
+    const auto* base = &slots_[0][0];
+    if (ptr < base || ptr >= base + sizeof slots_ ||
+        (ptr - base) % sizeof(T) != 0) {
+      return N;
+    }
+    return static_cast<size_type>((ptr - base) / sizeof(T));
+  }
+
+  size_type NextFree(size_type ndx) const { return slots_[ndx][0]; }
+  void SetNextFree(size_type ndx, size_type next) { slots_[ndx][0] = next; }
+
+  bool IsLive(size_type ndx) const {
+    return (live_[ndx / 8] & (1 << (ndx % 8))) != 0;
+  }
+  void SetLive(size_type ndx) { live_[ndx / 8] |= (1 << (ndx % 8)); }
+  void ClearLive(size_type ndx) { live_[ndx / 8] &= ~(1 << (ndx % 8)); }
+
+  alignas(T) uint8_t slots_[N][sizeof(T)];
+  uint8_t live_[kBitmapSize];
+  size_type free_head_;
+  size_type size_;
+  size_type high_water_mark_;
+};
+
+}  // namespace mcucore
+
+#endif  // MCUCORE_SRC_CONTAINER_OBJECT_POOL_H_
@@ -15,6 +15,18 @@
 // paths may have different expectations regarding the set of parameters that
 // are supported or required, and where those values may vary in size.
 //
+// By default Find is a linear scan of the entries, decoding the header of each
+// entry until it finds the key. If INDEX_SIZE is non-zero, the map also holds a
+// side index of up to INDEX_SIZE entry offsets, sorted by the bytes of the keys
+// of those entries, so that Find (and hence Insert, GetValue, etc.) can use a
+// binary search instead. The index costs 1 byte per entry when SIZE <= 255,
+// else 2 bytes per entry; when the index is full, Insert returns an error.
+//
+// The entries are stored as if serialized, so can be saved (see
+// serialized_data) and later restored (see LoadSerialized) as a single block of
+// bytes; eeprom/serial_map_io.h uses this to save a whole map as the value of a
+// single EepromTlv entry.
+//
 // Author: james.synge@gmail.com
 
 #include <string.h>  // For memcpy, etc.
@@ -26,12 +38,90 @@
 #include "status/status.h"
 #include "status/status_or.h"
 #include "strings/progmem_string_data.h"
+#include "strings/progmem_string_view.h"
 #include "strings/string_view.h"
 
 namespace mcucore {
+namespace serial_map_internal {
+
+// A sorted array of the offsets of the entries of a SerialMap, ordered by the
+// bytes of the entries' keys (which are at the start of each entry).
+template <typename OFFSET, size_t N>
+class SortedOffsetIndex {
+ public:
+  static_assert(N <= 255, "N is too large");
+
+  size_t size() const { return size_; }
+  bool full() const { return size_ >= N; }
+  OFFSET at(size_t pos) const {
+    MCU_DCHECK_LT(pos, size_);
+    return offsets_[pos];
+  }
+
+  // Returns the position of the first offset whose key is not less than key.
+  size_t LowerBound(const uint8_t* data, const void* key,
+                    size_t key_size) const {
+    size_t low = 0;
+    size_t high = size_;
+    while (low < high) {
+      const size_t mid = low + (high - low) / 2;
+      if (memcmp(data + offsets_[mid], key, key_size) < 0) {
+        low = mid + 1;
+      } else {
+        high = mid;
+      }
+    }
+    return low;
+  }
+
+  // Inserts the offset of a new entry at the specified position.
+  void InsertAt(size_t pos, OFFSET offset) {
+    MCU_DCHECK(!full());
+    MCU_DCHECK_LE(pos, size_);
+    memmove(&offsets_[pos + 1], &offsets_[pos], (size_ - pos) * sizeof(OFFSET));
+    offsets_[pos] = offset;
+    ++size_;
+  }
+
+  // Removes the offset of an entry which has been removed from the map, and
+  // adjusts the offsets of the entries which followed it, which have been moved
+  // down by entry_size bytes.
+  void Remove(OFFSET offset, size_t entry_size) {
+    size_t found = size_;
+    for (size_t pos = 0; pos < size_; ++pos) {
+      if (offsets_[pos] == offset) {
+        found = pos;
+      } else if (offsets_[pos] > offset) {
+        offsets_[pos] -= entry_size;
+      }
+    }
+    MCU_DCHECK_LT(found, size_);
+    --size_;
+    memmove(&offsets_[found], &offsets_[found + 1],
+            (size_ - found) * sizeof(OFFSET));
+  }
+
+  void Clear() { size_ = 0; }
+
+ private:
+  OFFSET offsets_[N];
+  uint8_t size_{0};
+};
+
+// There is no index when N is zero.
+template <typename OFFSET>
+class SortedOffsetIndex<OFFSET, 0> {};
+
+}  // namespace serial_map_internal
+
+// The index is a base class so that it occupies no space when INDEX_SIZE is 0.
+template <typename KEY, size_t SIZE, size_t INDEX_SIZE = 0>
+class SerialMap : serial_map_internal::SortedOffsetIndex<
+                      conditional_t<(SIZE <= 255), uint8_t, uint16_t>,
+                      INDEX_SIZE> {
+  using Offset = conditional_t<(SIZE <= 255), uint8_t, uint16_t>;
+  using Index = serial_map_internal::SortedOffsetIndex<Offset, INDEX_SIZE>;
 
-template <typename KEY, size_t SIZE>
-class SerialMap {
  public:
   struct Entry {
     size_t EntrySize() const { return offsetof(Entry, value) + length; }
@@ -94,14 +184,7 @@ class SerialMap {
     return nullptr;
   }
 
-  const Entry* Find(const KEY key) const {
-    for (auto* entry = First(); entry != nullptr; entry = Next(*entry)) {
-      if (entry->HasKey(key)) {
-        return entry;
-      }
-    }
-    return nullptr;
-  }
+  const Entry* Find(const KEY key) const { return FindHelper(key, HasIndex()); }
 
   // Find an entry and read its value as a type T. Returns an error if not found
   // or if not the right size.
@@ -153,7 +236,80 @@ class SerialMap {
     return true;
   }
 
+  // Remove all of the entries.
+  void Clear() {
+    end_ = 0;
+    ClearIndex(HasIndex());
+  }
+
+  // Returns the bytes of the entries (serialized_size() of them), which can be
+  // saved and later restored by LoadSerialized.
+  const uint8_t* serialized_data() const { return data_; }
+  size_t serialized_size() const { return end_; }
+
+  // Replaces the entries of the map with `length` bytes previously returned by
+  // serialized_data(), which read_bytes (a function of the form
+  // bool(uint8_t* buffer, size_t length)) reads directly into the map. Then
+  // validates the chain of entries (and rebuilds the index); if the chain is
+  // not well formed, the map is left empty and an error is returned.
+  template <typename READER>
+  Status LoadSerialized(const size_t length, READER read_bytes) {
+    if (length > SIZE) {
+      MCU_VLOG(3) << MCU_PSD("Saved map too big") << MCU_NAME_VAL(length);
+      return ResourceExhaustedError(MCU_PSD("Saved map too big"));
+    }
+    Clear();
+    if (!read_bytes(data_, length)) {
+      return UnknownError(MCU_PSD("Reading saved map failed"));
+    }
+    return ValidateLoadedEntries(length);
+  }
+
  private:
+  using HasIndex = integral_constant<bool, (INDEX_SIZE > 0)>;
+
+  Index& index() { return *this; }
+  const Index& index() const { return *this; }
+
+  const Entry* FindHelper(const KEY key, false_type) const {
+    for (auto* entry = First(); entry != nullptr; entry = Next(*entry)) {
+      if (entry->HasKey(key)) {
+        return entry;
+      }
+    }
+    return nullptr;
+  }
+
+  const Entry* FindHelper(const KEY key, true_type) const {
+    const auto pos = index().LowerBound(data_, &key, sizeof(KEY));
+    if (pos < index().size()) {
+      const auto* entry =
+          reinterpret_cast<const Entry*>(&data_[index().at(pos)]);
+      if (entry->HasKey(key)) {
+        return entry;
+      }
+    }
+    return nullptr;
+  }
+
+  bool IndexIsFull(false_type) const { return false; }
+  bool IndexIsFull(true_type) const { return index().full(); }
+
+  void AddToIndex(const KEY, const size_t, false_type) {}
+  void AddToIndex(const KEY key, const size_t offset, true_type) {
+    const auto pos = index().LowerBound(data_, &key, sizeof(KEY));
+    index().InsertAt(pos, static_cast<Offset>(offset));
+  }
+
+  void ClearIndex(false_type) {}
+  void ClearIndex(true_type) { index().Clear(); }
+
+  void RemoveFromIndex(const size_t, const size_t, false_type) {}
+  void RemoveFromIndex(const size_t offset, const size_t entry_size,
+                       true_type) {
+    index().Remove(static_cast<Offset>(offset), entry_size);
+  }
+
   Entry* MutableFind(const KEY key) { return const_cast<Entry*>(Find(key)); }
 
   Status InsertOrAssignHelper(const KEY key, const uint8_t length,
@@ -180,12 +336,18 @@ class SerialMap {
       }
     }
     if (entry == nullptr) {
-      entry = reinterpret_cast<Entry*>(&data_[end_]);
+      if (IndexIsFull(HasIndex())) {
+        MCU_VLOG(3) << MCU_PSD("Map index full");
+        return ResourceExhaustedError(MCU_PSD("Map index full"));
+      }
+      const auto entry_offset = end_;
+      entry = reinterpret_cast<Entry*>(&data_[entry_offset]);
       entry->SetKey(key);
       entry->length = length;
       const auto new_end = end_ + entry->EntrySize();
       MCU_DCHECK_LE(new_end, SIZE);
       end_ = new_end;
+      AddToIndex(key, entry_offset, HasIndex());
       // TODO(jamessynge): If asan enabled, mark data after the entry as
       // unpoisoned.
     }
@@ -197,6 +359,7 @@ class SerialMap {
     const auto old_end = end_;
     const auto entry_offset = OffsetOfEntry(entry);
     MCU_DCHECK_LT(entry_offset, old_end);
+    RemoveFromIndex(entry_offset, entry.EntrySize(), HasIndex());
     const auto* next_ptr = Next(entry);
     if (next_ptr == nullptr) {
       // The easy case: there is no next entry, so we don't have any data to
@@ -215,6 +378,36 @@ class SerialMap {
     // entry as poisoned.
   }
 
+  // Walks the chain of entries in the first length bytes of data_ (i.e. just
+  // loaded by LoadSerialized), advancing end_ past each entry once it has been
+  // validated, and adding it to the index.
+  Status ValidateLoadedEntries(const size_t length) {
+    while (end_ < length) {
+      const auto remaining = length - end_;
+      const auto* entry = reinterpret_cast<const Entry*>(&data_[end_]);
+      if (remaining < offsetof(Entry, value) ||
+          remaining < entry->EntrySize()) {
+        return LoadFailed(MCU_PSD("Saved entry truncated"));
+      }
+      const KEY key = entry->GetKey();
+      if (Find(key) != nullptr) {
+        return LoadFailed(MCU_PSD("Saved key duplicated"));
+      } else if (IndexIsFull(HasIndex())) {
+        return LoadFailed(MCU_PSD("Map index full"));
+      }
+      const auto entry_offset = end_;
+      end_ += entry->EntrySize();
+      AddToIndex(key, entry_offset, HasIndex());
+    }
+    return OkStatus();
+  }
+
+  Status LoadFailed(ProgmemStringView message) {
+    MCU_VLOG(1) << message << MCU_PSD(" at offset ") << end_;
+    Clear();
+    return DataLossError(message);
+  }
+
   size_t OffsetOfEntry(const Entry& entry) const {
     const uint8_t* entry_ptr = reinterpret_cast<const uint8_t*>(&entry);
     return entry_ptr - data_;
@@ -225,6 +418,8 @@ class SerialMap {
 
   static_assert(SIZE < numeric_limits<decltype(end_)>::max(),
                 "max is reserved to mean overflow");
+  static_assert(INDEX_SIZE == 0 || SIZE <= numeric_limits<uint16_t>::max(),
+                "SIZE is too large for an index");
 };
 
 }  // namespace mcucore
@@ -0,0 +1,193 @@
+#ifndef MCUCORE_SRC_CONTAINER_SPSC_RING_H_
+#define MCUCORE_SRC_CONTAINER_SPSC_RING_H_
+
+// SpscRing<T, N> is a fixed capacity FIFO queue (ring buffer) for passing
+// elements from a single producer to a single consumer, where each may be
+// interrupted by the other; for example, from an ISR (the producer) to loop()
+// (the consumer), or in the other direction. No locking or disabling of
+// interrupts is required.
+//
+// N must be a power of two, and at most 128, so that the read and write indices
+// are single bytes, which can be read and written atomically on an AVR. The
+// indices are free running (i.e. they are only reduced modulo N when used to
+// access the elements), so the ring can hold N elements, rather than N-1.
+//
+// Only the producer may call the Push methods, and only the consumer may call
+// the Pop, Peek and Consume methods. The other methods may be called by either,
+// though the result may be out of date by the time it is used.
+//
+// Author: james.synge@gmail.com
+
+#include "container/array_view.h"
+#include "log/log.h"
+#include "mcucore_platform.h"
+
+#if MCU_HOST_TARGET
+#include <atomic>  // pragma: keep standard include
+#endif
+
+namespace mcucore {
+namespace spsc_ring_internal {
+
+#if MCU_HOST_TARGET
+
+// On the host the producer and consumer may be running on different cores, so
+// we need std::atomic to provide the necessary ordering of memory accesses.
+class RingIndex {
+ public:
+  RingIndex() : value_(0) {}
+
+  uint8_t LoadRelaxed() const { return value_.load(std::memory_order_relaxed); }
+  uint8_t LoadAcquire() const { return value_.load(std::memory_order_acquire); }
+  void StoreRelease(uint8_t value) {
+    value_.store(value, std::memory_order_release);
+  }
+
+ private:
+  std::atomic<uint8_t> value_;
+};
+
+#else  // !MCU_HOST_TARGET
+
+// On a single core microcontroller reads and writes of a byte are atomic, so we
+// just need to prevent the compiler from caching the index in a register, and
+// from moving accesses to the elements across accesses to the index.
+class RingIndex {
+ public:
+  RingIndex() : value_(0) {}
+
+  uint8_t LoadRelaxed() const { return value_; }
+  uint8_t LoadAcquire() const {
+    const uint8_t value = value_;
+    asm volatile("" ::: "memory");
+    return value;
+  }
+  void StoreRelease(uint8_t value) {
+    asm volatile("" ::: "memory");
+    value_ = value;
+  }
+
+ private:
+  volatile uint8_t value_;
+};
+
+#endif  // MCU_HOST_TARGET
+
+}  // namespace spsc_ring_internal
+
+template <typename T, uint8_t N>
+class SpscRing {
+ public:
+  static_assert(N > 0 && (N & (N - 1)) == 0, "N must be a power of two");
+  static_assert(N <= 128, "N must fit in a uint8_t, with room to spare");
+
+  using value_type = T;
+  using size_type = uint8_t;
+
+  SpscRing() = default;
+  SpscRing(const SpscRing&) = delete;
+  SpscRing& operator=(const SpscRing&) = delete;
+
+  static constexpr size_type capacity() { return N; }
+
+  // Returns the number of elements in the ring.
+  size_type size() const {
+    return static_cast<uint8_t>(write_index_.LoadAcquire() -
+                                read_index_.LoadAcquire());
+  }
+  bool empty() const { return size() == 0; }
+  bool full() const { return size() >= N; }
+
+  //////////////////////////////////////////////////////////////////////////////
+  // Producer methods.
+
+  // Appends value to the ring. Returns false if the ring is full.
+  bool Push(const T& value) {
+    const uint8_t write_index = write_index_.LoadRelaxed();
+    if (static_cast<uint8_t>(write_index - read_index_.LoadAcquire()) >= N) {
+      return false;
+    }
+    elements_[write_index & kMask] = value;
+    write_index_.StoreRelease(write_index + 1);
+    return true;
+  }
+
+  // Appends as many of the elements of values as will fit. Returns the number
+  // appended.
+  size_type PushN(const ArrayView<T>& values) {
+    const uint8_t write_index = write_index_.LoadRelaxed();
+    const uint8_t available = static_cast<uint8_t>(
+        N - static_cast<uint8_t>(write_index - read_index_.LoadAcquire()));
+    const size_type count = min(available, values.size());
+    for (size_type ndx = 0; ndx < count; ++ndx) {
+      elements_[(write_index + ndx) & kMask] = values[ndx];
+    }
+    write_index_.StoreRelease(write_index + count);
+    return count;
+  }
+
+  //////////////////////////////////////////////////////////////////////////////
+  // Consumer methods.
+
+  // Removes the oldest element from the ring, storing it in value. Returns
+  // false if the ring is empty.
+  bool Pop(T& value) {
+    const uint8_t read_index = read_index_.LoadRelaxed();
+    if (write_index_.LoadAcquire() == read_index) {
+      return false;
+    }
+    value = elements_[read_index & kMask];
+    read_index_.StoreRelease(read_index + 1);
+    return true;
+  }
+
+  // Removes as many elements as are available and will fit in values, oldest
+  // first. Returns the number removed.
+  size_type PopN(ArrayView<T> values) {
+    const uint8_t read_index = read_index_.LoadRelaxed();
+    const uint8_t available =
+        static_cast<uint8_t>(write_index_.LoadAcquire() - read_index);
+    const size_type count = min(available, values.size());
+    for (size_type ndx = 0; ndx < count; ++ndx) {
+      values[ndx] = elements_[(read_index + ndx) & kMask];
+    }
+    read_index_.StoreRelease(read_index + count);
+    return count;
+  }
+
+  // Returns a view of the oldest elements in the ring that are contiguous in
+  // memory (i.e. up to the end of the underlying array), allowing them to be
+  // used without copying. The elements remain in the ring until removed by
+  // Consume. To see all of the elements when they wrap around the end of the
+  // array, call Consume and then PeekContiguous again.
+  ArrayView<const T> PeekContiguous() const {
+    const uint8_t read_index = read_index_.LoadRelaxed();
+    const uint8_t available =
+        static_cast<uint8_t>(write_index_.LoadAcquire() - read_index);
+    const uint8_t offset = read_index & kMask;
+    const uint8_t to_end = N - offset;
+    return ArrayView<const T>(elements_ + offset, min(available, to_end));
+  }
+
+  // Removes the count oldest elements, which must have been returned by
+  // PeekContiguous.
+  void Consume(size_type count) {
+    const uint8_t read_index = read_index_.LoadRelaxed();
+    MCU_DCHECK_LE(count, static_cast<uint8_t>(write_index_.LoadAcquire() -
+                                              read_index));
+    read_index_.StoreRelease(read_index + count);
+  }
+
+ private:
+  static constexpr uint8_t kMask = N - 1;
+
+  // Written only by the consumer.
+  spsc_ring_internal::RingIndex read_index_;
+  // Written only by the producer.
+  spsc_ring_internal::RingIndex write_index_;
+  T elements_[N];
+};
+
+}  // namespace mcucore
+
+#endif  // MCUCORE_SRC_CONTAINER_SPSC_RING_H_
@@ -0,0 +1,133 @@
+#include "eeprom/eeprom_block.h"
+
+#include "mcucore_platform.h"
+
+#ifdef ARDUINO_ARCH_AVR
+#include <avr/eeprom.h>
+#endif
+
+namespace mcucore {
+namespace {
+
+using eeprom_block_internal::kChunkSize;
+
+// Records in stats (if not null) whether old_value, the current value of a
+// byte, needs to be changed to new_value. Returns true if it does.
+bool CountUpdate(const uint8_t old_value, const uint8_t new_value,
+                 EepromStats* const stats) {
+  if (old_value == new_value) {
+    if (stats != nullptr) {
+      ++stats->skips;
+    }
+    return false;
+  }
+  if (stats != nullptr) {
+    ++stats->writes;
+    if ((old_value & new_value) != new_value) {
+      ++stats->erases;
+    }
+  }
+  return true;
+}
+
+// Writes new_value to addr if it differs from old_value, the current value.
+void UpdateIfChanged(EEPROMClass& eeprom, const EepromAddrT addr,
+                     const uint8_t old_value, const uint8_t new_value,
+                     EepromStats* const stats) {
+  if (CountUpdate(old_value, new_value, stats)) {
+    eeprom.write(addr, new_value);
+  }
+}
+
+}  // namespace
+
+void EepromReadBlock(EEPROMClass& eeprom, const EepromAddrT addr,
+                     uint8_t* const dst, const EepromAddrT length) {
+#if MCU_HOST_TARGET
+  eeprom.read_block(dst, addr, length);
+#elif defined(ARDUINO_ARCH_AVR)
+  eeprom_read_block(dst, reinterpret_cast<const void*>(addr), length);
+#else
+  for (EepromAddrT ndx = 0; ndx < length; ++ndx) {
+    dst[ndx] = eeprom.read(addr + ndx);
+  }
+#endif
+}
+
+void EepromUpdateByte(EEPROMClass& eeprom, const EepromAddrT addr,
+                      const uint8_t value, EepromStats* const stats) {
+  UpdateIfChanged(eeprom, addr, eeprom.read(addr), value, stats);
+}
+
+void EepromWriteBlock(EEPROMClass& eeprom, EepromAddrT addr, const uint8_t* src,
+                      EepromAddrT length, EepromStats* const stats) {
+  // Read the current values a chunk at a time, so that we only need to write
+  // those bytes that are changing.
+  uint8_t current[kChunkSize];
+  while (length > 0) {
+    const EepromAddrT chunk = length < kChunkSize ? length : kChunkSize;
+    EepromReadBlock(eeprom, addr, current, chunk);
+#if MCU_HOST_TARGET
+    // The host EEPROMClass updates the whole chunk at once (i.e. memcpy), so
+    // we just count the bytes which are changing.
+    bool changing = false;
+    for (EepromAddrT ndx = 0; ndx < chunk; ++ndx) {
+      changing |= CountUpdate(current[ndx], src[ndx], stats);
+    }
+    if (changing) {
+      eeprom.update_block(src, addr, chunk);
+    }
+#else
+    for (EepromAddrT ndx = 0; ndx < chunk; ++ndx) {
+      UpdateIfChanged(eeprom, addr + ndx, current[ndx], src[ndx], stats);
+    }
+#endif
+    addr += chunk;
+    src += chunk;
+    length -= chunk;
+  }
+}
+
+void EepromMoveBlock(EEPROMClass& eeprom, EepromAddrT from_addr,
+                     EepromAddrT to_addr, EepromAddrT length,
+                     EepromStats* const stats) {
+  if (from_addr == to_addr) {
+    return;
+  }
+#if MCU_HOST_TARGET
+  // The host EEPROMClass moves the whole block at once (i.e. memmove), so we
+  // just count the bytes which are changing, before they're changed.
+  if (stats != nullptr) {
+    uint8_t from_chunk[kChunkSize];
+    uint8_t to_chunk[kChunkSize];
+    for (EepromAddrT offset = 0; offset < length; offset += kChunkSize) {
+      const EepromAddrT remaining = length - offset;
+      const EepromAddrT chunk = remaining < kChunkSize ? remaining : kChunkSize;
+      EepromReadBlock(eeprom, from_addr + offset, from_chunk, chunk);
+      EepromReadBlock(eeprom, to_addr + offset, to_chunk, chunk);
+      for (EepromAddrT ndx = 0; ndx < chunk; ++ndx) {
+        CountUpdate(to_chunk[ndx], from_chunk[ndx], stats);
+      }
+    }
+  }
+  eeprom.move_block(from_addr, to_addr, length);
+#else
+  uint8_t buffer[kChunkSize];
+  // As with memmove, copy from the start when moving down, else from the end,
+  // so that overlapping bytes are read before they're overwritten.
+  const bool moving_down = to_addr < from_addr;
+  while (length > 0) {
+    const EepromAddrT chunk = length < kChunkSize ? length : kChunkSize;
+    length -= chunk;
+    const EepromAddrT offset = moving_down ? 0 : length;
+    EepromReadBlock(eeprom, from_addr + offset, buffer, chunk);
+    EepromWriteBlock(eeprom, to_addr + offset, buffer, chunk, stats);
+    if (moving_down) {
+      from_addr += chunk;
+      to_addr += chunk;
+    }
+  }
+#endif  // MCU_HOST_TARGET
+}
+
+}  // namespace mcucore
@@ -1,5 +1,6 @@
 #include "eeprom/eeprom_io.h"
 
+#include "eeprom/eeprom_block.h"
 #include "log/log.h"
 
 namespace mcucore {
@@ -7,7 +8,7 @@ namespace eeprom_io {
 
 int SaveName(int toAddress, const char* name) {
   while (*name != 0) {
-    EEPROM.put(toAddress++, *name++);
+    EepromUpdateByte(EEPROM, toAddress++, static_cast<uint8_t>(*name++));
   }
   return toAddress;
 }
@@ -15,7 +16,7 @@ int SaveName(int toAddress, const char* name) {
 int SaveName(int toAddress, const ProgmemStringView& name) {
   for (ProgmemStringView::size_type pos = 0; pos < name.size(); ++pos) {
     auto c = name.at(pos);
-    EEPROM.put(toAddress++, c);
+    EepromUpdateByte(EEPROM, toAddress++, static_cast<uint8_t>(c));
   }
   return toAddress;
 }
@@ -56,7 +57,7 @@ void PutBytes(int address, const uint8_t* src, size_t numBytes, Crc32* crc) {
     if (crc) {
       crc->appendByte(b);
     }
-    EEPROM.update(address++, b);
+    EepromUpdateByte(EEPROM, address++, b);
   }
 }
 
@@ -75,7 +76,8 @@ int PutCrc(int toAddress, const Crc32& crc) {
   static_assert(4 == sizeof value, "sizeof CRC value is not 4");
   MCU_VLOG(6) << MCU_PSD("PutCrc value ") << BaseHex << value << MCU_PSD(" to ")
               << BaseDec << toAddress;
-  EEPROM.put(toAddress, value);
+  EepromWriteBlock(EEPROM, toAddress, reinterpret_cast<const uint8_t*>(&value),
+                   sizeof value);
   MCU_CHECK(VerifyCrc(toAddress, crc));
   return toAddress + static_cast<int>(sizeof value);
 }
@@ -1,6 +1,7 @@
 #include "eeprom/eeprom_region.h"
 
 #include "container/flash_string_table.h"
+#include "eeprom/eeprom_block.h"
 #include "mcucore_platform.h"
 #include "strings/progmem_string_data.h"
 
@@ -43,16 +44,7 @@ bool EepromRegionReader::ReadBytes(uint8_t* ptr, const EepromAddrT length) {
   if (length > available()) {
     return false;
   }
-  EepromAddrT from = start_address_ + cursor_;
-  const EepromAddrT beyond = from + length;
-  MCU_DCHECK_LE(from, beyond);
-  while (from < beyond) {
-    *ptr++ = eeprom_->read(from++);
-  }
-  MCU_DCHECK_EQ(from, beyond);
-  if (from != beyond) {
-    return false;  // COV_NF_LINE
-  }
+  EepromReadBlock(*eeprom_, start_address_ + cursor_, ptr, length);
   cursor_ += length;
   return true;
 }
@@ -75,16 +67,7 @@ bool EepromRegion::WriteBytes(const uint8_t* ptr, const EepromAddrT length) {
   if (length > available()) {
     return false;
   }
-  EepromAddrT to = start_address_ + cursor_;
-  const EepromAddrT beyond = to + length;
-  MCU_DCHECK_LE(to, beyond);
-  while (to < beyond) {
-    eeprom_->write(to++, *ptr++);
-  }
-  MCU_DCHECK_EQ(to, beyond);
-  if (to != beyond) {
-    return false;  // COV_NF_LINE
-  }
+  EepromWriteBlock(*eeprom_, start_address_ + cursor_, ptr, length, stats_);
   cursor_ += length;
   return true;
 }
@@ -98,10 +81,18 @@ bool EepromRegion::WriteString(const ProgmemStringView psv) {
   if (size > available()) {
     return false;
   }
+  // Copy the string via a small RAM buffer, so that it can be written a block
+  // at a time.
+  uint8_t buffer[16];
   EepromAddrT to = start_address_ + cursor_;
-  for (ProgmemStringView::size_type ndx = 0; ndx < size; ++ndx) {
-    char c = psv.at(ndx);
-    eeprom_->write(to++, c);
+  ProgmemStringView::size_type ndx = 0;
+  while (ndx < size) {
+    uint8_t chunk = 0;
+    while (chunk < sizeof buffer && ndx < size) {
+      buffer[chunk++] = static_cast<uint8_t>(psv.at(ndx++));
+    }
+    EepromWriteBlock(*eeprom_, to, buffer, chunk, stats_);
+    to += chunk;
   }
   cursor_ += size;
   return true;
@@ -9,6 +9,7 @@
 //
 // Author: james.synge@gmail.com
 
+#include "eeprom/eeprom_block.h"
 #include "log/log.h"
 #include "mcucore_platform.h"
 #include "semistd/limits.h"
@@ -128,10 +129,11 @@ class EepromRegionReader {
 // Supports writing to and reading from EEPROM.
 class EepromRegion : public EepromRegionReader {
  public:
+  // If stats is not null, the writes to the EEPROM are counted in *stats.
   EepromRegion(EEPROMClass& eeprom, EepromAddrT start_address,
-               EepromAddrT length)
-      : EepromRegionReader(eeprom, start_address, length) {}
-  EepromRegion() : EepromRegionReader() {}
+               EepromAddrT length, EepromStats* stats = nullptr)
+      : EepromRegionReader(eeprom, start_address, length), stats_(stats) {}
+  EepromRegion() : EepromRegionReader(), stats_(nullptr) {}
   EepromRegion(const EepromRegion&) = default;
   EepromRegion& operator=(const EepromRegion&) = default;
 
@@ -144,7 +146,9 @@ class EepromRegion : public EepromRegionReader {
     if (sizeof(T) > available()) {
       return false;
     }
-    eeprom_->put(start_address_ + cursor_, value);
+    EepromWriteBlock(*eeprom_, start_address_ + cursor_,
+                     reinterpret_cast<const uint8_t*>(&value), sizeof(T),
+                     stats_);
     cursor_ += sizeof(T);
     return true;
   }
@@ -170,6 +174,9 @@ class EepromRegion : public EepromRegionReader {
 
   // As above, but the source string is in flash memory instead of RAM.
   bool WriteString(const ProgmemStringView psv);
+
+ private:
+  EepromStats* stats_;
 };
 
 }  // namespace mcucore
@@ -1,7 +1,13 @@
 #include "eeprom/eeprom_tlv.h"
 
+#include <string.h>
+
+#include "container/bit_set.h"
+#include "eeprom/eeprom_block.h"
 #include "eeprom/eeprom_region.h"
 #include "eeprom/eeprom_tag.h"
+#include "eeprom/eeprom_tlv_index.h"
+#include "eeprom/eeprom_write_queue.h"
 #include "hash/crc32.h"
 #include "log/log.h"
 #include "mcucore_platform.h"
@@ -82,17 +88,129 @@ EepromTag MakeUnusedTag() {
   return EepromTag{.domain = internal::MakeEepromDomain(0), .id = 255};
 }
 
-bool IsUnusedTag(EepromTag tag) {
-  return tag.domain.value() == 0 && tag.id == 255;
+// Returns true if the tag is in domain 0, not only if it is the unused tag: the
+// domain is written first when marking an entry as unused, so if that is
+// interrupted (e.g. by a power loss), the tag is in domain 0 but has the id of
+// the entry.
+bool IsUnusedTag(EepromTag tag) { return tag.domain.value() == 0; }
+
+// The largest unused entry that can be written.
+constexpr EepromAddrT kMaxUnusedEntrySize =
+    kOffsetOfEntryData + EepromTlv::kMaxBlockLength;
+
+// The most bytes moved by CompactToMakeRoom, which bounds the time it takes;
+// this is enough to move any one entry.
+constexpr EepromAddrT kMaxCompactionBytes =
+    kOffsetOfEntryData + EepromTlv::kMaxBlockLength;
+
+// MoveEntryDown, TruncateEntries, CommitBatch and StartAsyncCommit record the
+// change they are making in a journal at the very end of the EEPROM, with this
+// layout. The phase records how far a move has progressed, or that the entries
+// are being truncated (or extended by a batch), in which case the hole address
+// is the lower of the new and the old beyond addresses, and the entry address
+// is the higher. The new CRC is recorded once known, and is verified by
+// recomputing it. The checksum covers the fields before the phase.
+//
+// The magic is last, so that the journal isn't valid until all of it has been
+// written (the bytes are written in increasing address order). Clearing the
+// journal zeroes the magic and also corrupts the checksum, so that rewriting
+// the magic, either when writing the next journal or because an entry
+// overwrites the journal, doesn't revive a journal which was already
+// completed.
+constexpr uint16_t kJournalMagic = 0x4D4A;
+constexpr EepromAddrT kJournalOffsetOfHoleAddr = 0;
+constexpr EepromAddrT kJournalOffsetOfEntryAddr = 2;
+constexpr EepromAddrT kJournalOffsetOfEntryHeader = 4;
+constexpr EepromAddrT kJournalOffsetOfOldCrc = 7;
+constexpr EepromAddrT kJournalOffsetOfPhase = 11;
+constexpr EepromAddrT kJournalOffsetOfNewCrc = 12;
+constexpr EepromAddrT kJournalOffsetOfChecksum = 16;
+constexpr EepromAddrT kJournalOffsetOfMagic = 20;
+constexpr EepromAddrT kJournalSize = 22;
+constexpr uint8_t kJournalPhaseCopying = 0;
+constexpr uint8_t kJournalPhaseCopied = 1;
+constexpr uint8_t kJournalPhaseWritingCrc = 2;
+constexpr uint8_t kJournalPhaseTruncating = 3;
+constexpr uint8_t kJournalPhaseExtending = 4;
+
+// ClearJournal writes the last byte of the checksum and the magic.
+constexpr EepromAddrT kJournalOffsetOfClearedBytes =
+    kJournalOffsetOfMagic - 1;
+constexpr EepromAddrT kJournalClearedBytesSize =
+    kJournalSize - kJournalOffsetOfClearedBytes;
+
+static_assert(kJournalOffsetOfEntryAddr ==
+              kJournalOffsetOfHoleAddr + sizeof(EepromAddrT));
+static_assert(kJournalOffsetOfOldCrc ==
+              kJournalOffsetOfEntryHeader + kOffsetOfEntryData);
+static_assert(kJournalOffsetOfPhase ==
+              kJournalOffsetOfOldCrc + sizeof(uint32_t));
+static_assert(kJournalOffsetOfNewCrc == kJournalOffsetOfPhase + 1);
+static_assert(kJournalOffsetOfChecksum ==
+              kJournalOffsetOfNewCrc + sizeof(uint32_t));
+static_assert(kJournalOffsetOfMagic ==
+              kJournalOffsetOfChecksum + sizeof(uint32_t));
+static_assert(kJournalSize == kJournalOffsetOfMagic + sizeof(kJournalMagic));
+
+template <typename T>
+void PutJournalField(uint8_t* const journal, const EepromAddrT offset,
+                     const T value) {
+  memcpy(journal + offset, &value, sizeof value);
+}
+
+template <typename T>
+T GetJournalField(const uint8_t* const journal, const EepromAddrT offset) {
+  T value;
+  memcpy(&value, journal + offset, sizeof value);
+  return value;
+}
+
+uint32_t ComputeJournalChecksum(const uint8_t* const journal) {
+  Crc32 crc(kCrc32InitialValue);
+  for (EepromAddrT ndx = 0; ndx < kJournalOffsetOfPhase; ++ndx) {
+    crc.appendByte(journal[ndx]);
+  }
+  return crc.value();
+}
+
+// Fills cleared_bytes with the values which ClearJournal writes over the end
+// of the journal. The checksum is computed from the fields, rather than read,
+// so that clearing the journal again doesn't restore the checksum.
+void FillClearedJournalBytes(uint8_t* const cleared_bytes,
+                             const uint8_t* const journal) {
+  const uint32_t checksum = ComputeJournalChecksum(journal);
+  const uint8_t* const checksum_bytes =
+      reinterpret_cast<const uint8_t*>(&checksum);
+  cleared_bytes[0] = ~checksum_bytes[sizeof checksum - 1];
+  memset(cleared_bytes + 1, 0, sizeof kJournalMagic);
+}
+
+// Returns true if each of the size bytes of stored is equal to the
+// corresponding byte of either a or b, i.e. if stored may be the result of
+// interrupting the overwriting of a with b.
+bool IsPartiallyOverwritten(const uint8_t* const stored, const uint8_t* const a,
+                            const uint8_t* const b, const size_t size) {
+  for (size_t ndx = 0; ndx < size; ++ndx) {
+    if (stored[ndx] != a[ndx] && stored[ndx] != b[ndx]) {
+      return false;
+    }
+  }
+  return true;
 }
 
 }  // namespace
 
 EepromTlv::EepromTlv(EEPROMClass& eeprom) : eeprom_(&eeprom) {}
 
-StatusOr<EepromTlv> EepromTlv::GetIfValid(EEPROMClass& eeprom) {
+StatusOr<EepromTlv> EepromTlv::GetIfValid(EEPROMClass& eeprom,
+                                           EepromTlvIndexBase* const index) {
   EepromTlv instance(eeprom);
-  Status status = instance.Validate();
+  instance.RecoverInterruptedCompaction();
+  Status status = instance.Validate(kForce);
+  if (status.ok() && index != nullptr) {
+    instance.index_ = index;
+    status = instance.BuildIndex();
+  }
   if (status.ok()) {
     return instance;
   }
@@ -102,27 +220,12 @@ StatusOr<EepromTlv> EepromTlv::GetIfValid(EEPROMClass& eeprom) {
   return status;
 }
 
-StatusOr<EepromTlv> EepromTlv::ClearAndInitializeEeprom(EEPROMClass& eeprom) {
-#if 1
-  EepromRegion region(eeprom, 0, TLV_PREFIX_SIZE);
+StatusOr<EepromTlv> EepromTlv::ClearAndInitializeEeprom(
+    EEPROMClass& eeprom, EepromTlvIndexBase* const index) {
+  EepromTlv instance(eeprom);
+  EepromRegion region(eeprom, 0, TLV_PREFIX_SIZE, &instance.stats_);
   MCU_CHECK(region.WriteString(TLV_PREFIX_PSV));
   MCU_DCHECK_EQ(region.available(), 0);
-  for (int addr = 0; addr < TLV_PREFIX_SIZE; ++addr) {
-    const char c = TLV_PREFIX_PSV.at(addr);
-    eeprom.write(addr++, static_cast<uint8_t>(c));
-  }
-#elif 1
-  for (int addr = 0; addr < TLV_PREFIX_SIZE; ++addr) {
-    const char c = TLV_PREFIX_PSV.at(addr);
-    eeprom.write(addr++, static_cast<uint8_t>(c));
-  }
-#else
-  EepromAddrT addr = 0;
-  for (const char c : TLV_PREFIX_PSV) {
-    eeprom.write(addr++, static_cast<uint8_t>(c));
-  }
-#endif
-  EepromTlv instance(eeprom);
   MCU_DCHECK(instance.IsPrefixPresent());
 
 #ifdef MCU_ENABLE_DCHECK
@@ -137,36 +240,47 @@ StatusOr<EepromTlv> EepromTlv::ClearAndInitializeEeprom(EEPROMClass& eeprom) {
   MCU_DCHECK_EQ(instance.ReadBeyondAddr().value(), kAddrOfFirstEntry);
 
   MCU_RETURN_IF_ERROR(instance.Validate());
+  if (index != nullptr) {
+    index->Clear();
+    instance.index_ = index;
+  }
   return instance;
 }
 
-StatusOr<EepromTlv> EepromTlv::Get(EEPROMClass& eeprom) {
+StatusOr<EepromTlv> EepromTlv::Get(EEPROMClass& eeprom,
+                                   EepromTlvIndexBase* const index) {
   {
-    auto status_or_instance = GetIfValid(eeprom);
+    auto status_or_instance = GetIfValid(eeprom, index);
     if (status_or_instance.ok()) {
       return status_or_instance;
     }
   }
-  return ClearAndInitializeEeprom(eeprom);
+  return ClearAndInitializeEeprom(eeprom, index);
 }
 
-EepromTlv EepromTlv::GetOrDie(EEPROMClass& eeprom) {
-  auto status_or_instance = Get(eeprom);
+EepromTlv EepromTlv::GetOrDie(EEPROMClass& eeprom,
+                              EepromTlvIndexBase* const index) {
+  auto status_or_instance = Get(eeprom, index);
   MCU_CHECK_OK(status_or_instance.status());
   return status_or_instance.value();
 }
 
-Status EepromTlv::Validate() const {
+Status EepromTlv::Validate(const ValidationMode mode) const {
+  DCheckNoPendingWrites();
   if (!IsPrefixPresent()) {
     return MissingPrefixError();
   }
   MCU_ASSIGN_OR_RETURN(const auto beyond_addr, ReadBeyondAddr());
+  if (mode == kUseCache && IsValidationCached(beyond_addr)) {
+    return OkStatus();
+  }
   return ValidateCrc(beyond_addr);
 }
 
 StatusOr<EepromAddrT> EepromTlv::ReclaimUnusedSpace() {
   MCU_VLOG(3) << MCU_PSD("Reclaiming deleted EepromTlv entries.");
 
+  MCU_RETURN_IF_ERROR(ValidateNoTransactionIsActive());
   // Not safe to compact if ill-formed.
   MCU_RETURN_IF_ERROR(Validate());
   MCU_ASSIGN_OR_RETURN(const auto beyond_addr, ReadBeyondAddr());
@@ -182,7 +296,12 @@ StatusOr<EepromAddrT> EepromTlv::ReclaimUnusedSpace() {
     MCU_DCHECK_GE(src_addr, dst_addr);
     MCU_ASSIGN_OR_RETURN(const auto next_entry_addr, FindNext(src_addr));
     MCU_VLOG_VAR(9, next_entry_addr);
-    if (IsUnusedTag(ReadTag(src_addr))) {
+    const auto tag = ReadTag(src_addr);
+    if (!IsUnusedTag(tag) && index_ != nullptr) {
+      // The entry is about to be at dst_addr, if it isn't already.
+      index_->Set(tag, dst_addr);
+    }
+    if (IsUnusedTag(tag)) {
       // Entry is unused, so we don't need to copy its bytes.
       src_addr = next_entry_addr;
       MCU_VLOG(9) << MCU_PSD("skipping unused entry");
@@ -194,9 +313,10 @@ StatusOr<EepromAddrT> EepromTlv::ReclaimUnusedSpace() {
       MCU_VLOG(9) << MCU_PSD("copying used entry down by ")
                   << (src_addr - dst_addr) << MCU_PSD(" bytes");
       MCU_DCHECK_GT(src_addr, dst_addr);
-      while (src_addr < next_entry_addr) {
-        eeprom_->write(dst_addr++, eeprom_->read(src_addr++));
-      }
+      const EepromAddrT entry_length = next_entry_addr - src_addr;
+      EepromMoveBlock(*eeprom_, src_addr, dst_addr, entry_length, &stats_);
+      src_addr = next_entry_addr;
+      dst_addr += entry_length;
     }
   }
   MCU_DCHECK_GE(src_addr, dst_addr);
@@ -216,11 +336,367 @@ StatusOr<EepromAddrT> EepromTlv::ReclaimUnusedSpace() {
 
   WriteBeyondAddr(new_beyond_addr);
   WriteCrc(status_or_crc.value());
+  SetValidated(new_beyond_addr, status_or_crc.value());
   auto reclaimed_space = beyond_addr - new_beyond_addr;
   MCU_VLOG(3) << MCU_NAME_VAL(reclaimed_space);
   return reclaimed_space;
 }
 
+StatusOr<bool> EepromTlv::CompactOnce(const EepromAddrT max_bytes,
+                                      EepromAddrT& bytes_moved) {
+  bytes_moved = 0;
+  MCU_RETURN_IF_ERROR(ValidateNoTransactionIsActive());
+  // Not safe to compact if ill-formed.
+  MCU_RETURN_IF_ERROR(Validate());
+  MCU_ASSIGN_OR_RETURN(const auto beyond_addr, ReadBeyondAddr());
+  const EepromAddrT limit_addr = beyond_addr - kOffsetOfEntryData;
+
+  // Find the first unused entry, and the first live entry after it.
+  EepromAddrT hole_addr = 0;
+  auto addr = kAddrOfFirstEntry;
+  while (addr <= limit_addr) {
+    const bool unused = IsUnusedTag(ReadTag(addr));
+    if (unused && hole_addr == 0) {
+      hole_addr = addr;
+    } else if (!unused && hole_addr != 0) {
+      MCU_ASSIGN_OR_RETURN(const bool is_stale, HasNewerEntry(addr));
+      if (!is_stale) {
+        break;
+      }
+      // An older copy of an entry which wasn't marked as unused (e.g. because
+      // a commit was interrupted). Moving it would make it appear to be the
+      // newest copy, so instead mark it as unused, as the commit should have.
+      MCU_VLOG(5) << MCU_PSD("Marking stale entry at ") << addr
+                  << MCU_PSD(" as unused");
+      WriteTag(addr, MakeUnusedTag());
+    }
+    MCU_ASSIGN_OR_RETURN(addr, FindNext(addr));
+  }
+  if (hole_addr == 0) {
+    return true;
+  } else if (addr > limit_addr) {
+    // There are no live entries after hole_addr.
+    MCU_RETURN_IF_ERROR(TruncateEntries(hole_addr, beyond_addr));
+    return true;
+  }
+
+  const EepromAddrT entry_addr = addr;
+  const EepromAddrT entry_size =
+      kOffsetOfEntryData + ReadEntryDataLength(entry_addr);
+  if (entry_size > max_bytes) {
+    return false;
+  }
+  MCU_VLOG(5) << MCU_PSD("Compacting entry at ") << entry_addr
+              << MCU_PSD(", unused at ") << hole_addr;
+  if (entry_size <= entry_addr - hole_addr) {
+    MCU_RETURN_IF_ERROR(MoveEntryDown(hole_addr, entry_addr, beyond_addr));
+  } else {
+    MCU_RETURN_IF_ERROR(CopyEntryToEnd(entry_addr));
+  }
+  bytes_moved = entry_size;
+  return false;
+}
+
+Status EepromTlv::CompactToMakeRoom(const EepromAddrT limit_addr,
+                                    const EepromAddrT size) {
+  EepromAddrT budget = kMaxCompactionBytes;
+  bool done = false;
+  while (true) {
+    MCU_ASSIGN_OR_RETURN(const auto beyond_addr, ReadBeyondAddr());
+    if (beyond_addr <= limit_addr && limit_addr - beyond_addr >= size) {
+      return OkStatus();
+    } else if (done) {
+      return Status(StatusCode::kResourceExhausted);
+    }
+    EepromAddrT bytes_moved;
+    MCU_ASSIGN_OR_RETURN(done, CompactOnce(budget, bytes_moved));
+    if (!done && bytes_moved == 0) {
+      return ResourceExhaustedError(MCU_PSV("Compaction incomplete"));
+    }
+    budget -= bytes_moved;
+  }
+}
+
+Status EepromTlv::TruncateEntries(const EepromAddrT new_beyond_addr,
+                                  const EepromAddrT beyond_addr) {
+  MCU_ASSIGN_OR_RETURN(const auto crc, ComputeCrc(new_beyond_addr));
+  // If the journal doesn't fit, the entries are nearly full, and there is a
+  // window during which the EEPROM is invalid, as there is for a commit.
+  uint8_t journal[kJournalSize];
+  const bool journaled =
+      WriteJournal(journal, new_beyond_addr, beyond_addr, beyond_addr,
+                   kJournalPhaseTruncating, crc)
+          .ok();
+  FinishChangingBeyondAddr(new_beyond_addr, crc, journaled);
+  return OkStatus();
+}
+
+void EepromTlv::FinishChangingBeyondAddr(const EepromAddrT new_beyond_addr,
+                                         const uint32_t crc,
+                                         const bool journaled) {
+  WriteBeyondAddr(new_beyond_addr);
+  WriteCrc(crc);
+  SetValidated(new_beyond_addr, crc);
+  if (journaled) {
+    ClearJournal();
+  }
+}
+
+Status EepromTlv::MoveEntryDown(const EepromAddrT hole_addr,
+                                const EepromAddrT entry_addr,
+                                const EepromAddrT beyond_addr) {
+  uint8_t journal[kJournalSize];
+  MCU_RETURN_IF_ERROR(WriteJournal(journal, hole_addr, entry_addr, beyond_addr,
+                                   kJournalPhaseCopying, 0));
+  return FinishMoveEntryDown(journal, beyond_addr);
+}
+
+Status EepromTlv::FinishMoveEntryDown(uint8_t* const journal,
+                                      const EepromAddrT beyond_addr) {
+  const EepromAddrT journal_addr = JournalAddr();
+  const auto hole_addr =
+      GetJournalField<EepromAddrT>(journal, kJournalOffsetOfHoleAddr);
+  const auto entry_addr =
+      GetJournalField<EepromAddrT>(journal, kJournalOffsetOfEntryAddr);
+  const uint8_t* const entry_header = journal + kJournalOffsetOfEntryHeader;
+  const EepromAddrT data_length = entry_header[kOffsetOfEntryDataLength];
+  uint8_t& phase = journal[kJournalOffsetOfPhase];
+
+  if (phase == kJournalPhaseCopying) {
+    // The original entry is intact until the copy is complete (the space it
+    // is being copied to is entirely before it), so the copy can be repeated.
+    // The tag is written last, so that a partial copy isn't a live entry.
+    EepromMoveBlock(*eeprom_, entry_addr + kOffsetOfEntryData,
+                    hole_addr + kOffsetOfEntryData, data_length, &stats_);
+    WriteEntryDataLength(hole_addr, data_length);
+    EepromWriteBlock(*eeprom_, hole_addr, entry_header, sizeof(EepromTag),
+                     &stats_);
+    phase = kJournalPhaseCopied;
+    EepromUpdateByte(*eeprom_, journal_addr + kJournalOffsetOfPhase, phase,
+                     &stats_);
+  }
+
+  if (phase == kJournalPhaseCopied) {
+    // The space from the end of the copy to the end of the original entry is
+    // now unused; the CRC covers those bytes too, so must be recomputed, and
+    // is recorded so that it can be verified if writing it is interrupted.
+    WriteUnusedEntries(hole_addr + kOffsetOfEntryData + data_length,
+                       entry_addr - hole_addr);
+    MCU_ASSIGN_OR_RETURN(const auto new_crc, ComputeCrc(beyond_addr));
+    PutJournalField(journal, kJournalOffsetOfNewCrc, new_crc);
+    EepromWriteBlock(*eeprom_, journal_addr + kJournalOffsetOfNewCrc,
+                     journal + kJournalOffsetOfNewCrc, sizeof new_crc,
+                     &stats_);
+    phase = kJournalPhaseWritingCrc;
+    EepromUpdateByte(*eeprom_, journal_addr + kJournalOffsetOfPhase, phase,
+                     &stats_);
+  } else {
+    MCU_ASSIGN_OR_RETURN(const auto computed_crc, ComputeCrc(beyond_addr));
+    if (computed_crc !=
+        GetJournalField<uint32_t>(journal, kJournalOffsetOfNewCrc)) {
+      return WrongCrc();
+    }
+  }
+  const auto crc = GetJournalField<uint32_t>(journal, kJournalOffsetOfNewCrc);
+  WriteCrc(crc);
+  SetValidated(beyond_addr, crc);
+  ClearJournal();
+  // Only if the index records the original entry, i.e. it is the newest entry
+  // with its tag.
+  const auto tag = ReadTag(hole_addr);
+  if (index_ != nullptr && index_->Find(tag) == entry_addr) {
+    index_->Set(tag, hole_addr);
+  }
+  return OkStatus();
+}
+
+Status EepromTlv::CopyEntryToEnd(const EepromAddrT entry_addr) {
+  const auto tag = ReadTag(entry_addr);
+  const auto data_length = ReadEntryDataLength(entry_addr);
+  EepromRegion target_region;
+  MCU_RETURN_IF_ERROR(
+      StartTransaction(tag, data_length, target_region,
+                       /*reclaim_unused_space_if_needed=*/false));
+  EepromMoveBlock(*eeprom_, entry_addr + kOffsetOfEntryData,
+                  target_region.start_address(), data_length, &stats_);
+  return CommitTransaction(tag, target_region.start_address(), data_length);
+}
+
+StatusOr<bool> EepromTlv::HasNewerEntry(const EepromAddrT entry_addr) const {
+  const auto tag = ReadTag(entry_addr);
+  if (HasCompleteIndex()) {
+    return index_->Find(tag) != entry_addr;
+  }
+  MCU_ASSIGN_OR_RETURN(const auto beyond_addr, ReadBeyondAddr());
+  MCU_ASSIGN_OR_RETURN(auto addr, FindNext(entry_addr));
+  const EepromAddrT limit_addr = beyond_addr - kOffsetOfEntryData;
+  while (addr <= limit_addr) {
+    if (tag == ReadTag(addr)) {
+      return true;
+    }
+    MCU_ASSIGN_OR_RETURN(addr, FindNext(addr));
+  }
+  return false;
+}
+
+void EepromTlv::WriteUnusedEntries(EepromAddrT addr, EepromAddrT length) {
+  MCU_DCHECK_GE(length, kOffsetOfEntryData);
+  while (length > 0) {
+    EepromAddrT entry_size = length;
+    if (entry_size > kMaxUnusedEntrySize) {
+      // Don't leave less than an entry header for the next entry.
+      entry_size = kMaxUnusedEntrySize;
+      if (length - entry_size < kOffsetOfEntryData) {
+        entry_size = length - kOffsetOfEntryData;
+      }
+    }
+    WriteTag(addr, MakeUnusedTag());
+    WriteEntryDataLength(addr, entry_size - kOffsetOfEntryData);
+    addr += entry_size;
+    length -= entry_size;
+  }
+}
+
+Status EepromTlv::WriteJournal(uint8_t* const journal,
+                               const EepromAddrT hole_addr,
+                               const EepromAddrT entry_addr,
+                               const EepromAddrT beyond_addr,
+                               const uint8_t phase, const uint32_t new_crc) {
+  if (eeprom_length() - beyond_addr < kJournalSize) {
+    return ResourceExhaustedError(MCU_PSV("No room for journal"));
+  }
+  FillJournal(journal, hole_addr, entry_addr, phase, new_crc);
+  EepromWriteBlock(*eeprom_, JournalAddr(), journal, kJournalSize, &stats_);
+  return OkStatus();
+}
+
+void EepromTlv::FillJournal(uint8_t* const journal,
+                            const EepromAddrT hole_addr,
+                            const EepromAddrT entry_addr, const uint8_t phase,
+                            const uint32_t new_crc) const {
+  PutJournalField(journal, kJournalOffsetOfHoleAddr, hole_addr);
+  PutJournalField(journal, kJournalOffsetOfEntryAddr, entry_addr);
+  if (phase == kJournalPhaseTruncating || phase == kJournalPhaseExtending) {
+    memset(journal + kJournalOffsetOfEntryHeader, 0, kOffsetOfEntryData);
+  } else {
+    EepromReadBlock(*eeprom_, entry_addr,
+                    journal + kJournalOffsetOfEntryHeader, kOffsetOfEntryData);
+  }
+  PutJournalField(journal, kJournalOffsetOfOldCrc, ReadCrc());
+  journal[kJournalOffsetOfPhase] = phase;
+  PutJournalField(journal, kJournalOffsetOfNewCrc, new_crc);
+  PutJournalField(journal, kJournalOffsetOfChecksum,
+                  ComputeJournalChecksum(journal));
+  PutJournalField(journal, kJournalOffsetOfMagic, kJournalMagic);
+}
+
+void EepromTlv::ClearJournal() {
+  uint8_t journal[kJournalSize];
+  EepromReadBlock(*eeprom_, JournalAddr(), journal, kJournalSize);
+  uint8_t cleared_bytes[kJournalClearedBytesSize];
+  FillClearedJournalBytes(cleared_bytes, journal);
+  EepromWriteBlock(*eeprom_, JournalAddr() + kJournalOffsetOfClearedBytes,
+                   cleared_bytes, sizeof cleared_bytes, &stats_);
+}
+
+EepromAddrT EepromTlv::JournalAddr() const {
+  return eeprom_length() - kJournalSize;
+}
+
+void EepromTlv::RecoverInterruptedCompaction() {
+  if (eeprom_length() < kAddrOfFirstEntry + kJournalSize ||
+      !IsPrefixPresent()) {
+    return;
+  }
+  const EepromAddrT journal_addr = JournalAddr();
+  uint8_t journal[kJournalSize];
+  EepromReadBlock(*eeprom_, journal_addr, journal, kJournalSize);
+  const auto hole_addr =
+      GetJournalField<EepromAddrT>(journal, kJournalOffsetOfHoleAddr);
+  const auto entry_addr =
+      GetJournalField<EepromAddrT>(journal, kJournalOffsetOfEntryAddr);
+  const auto phase = journal[kJournalOffsetOfPhase];
+  // The journal is only written in the free space after the entries.
+  if (GetJournalField<uint16_t>(journal, kJournalOffsetOfMagic) !=
+          kJournalMagic ||
+      GetJournalField<uint32_t>(journal, kJournalOffsetOfChecksum) !=
+          ComputeJournalChecksum(journal) ||
+      phase > kJournalPhaseExtending || hole_addr < kAddrOfFirstEntry ||
+      entry_addr <= hole_addr || entry_addr > journal_addr) {
+    return;
+  }
+
+  // The stored beyond address and CRC must be those from before the change,
+  // or after it, or partially overwritten with the latter; otherwise the
+  // journal is for a change which was completed before later changes were
+  // made (e.g. the journal was revived by an entry overwriting it), and must
+  // not be replayed.
+  uint8_t stored_fields[sizeof(EepromAddrT) + sizeof(uint32_t)];
+  uint8_t old_fields[sizeof stored_fields];
+  uint8_t new_fields[sizeof stored_fields];
+  static_assert(kAddrOfCrc == kAddrOfBeyondAddr + sizeof(EepromAddrT),
+                "The CRC must follow the beyond address");
+  EepromReadBlock(*eeprom_, kAddrOfBeyondAddr, stored_fields,
+                  sizeof stored_fields);
+  memcpy(old_fields + sizeof(EepromAddrT), journal + kJournalOffsetOfOldCrc,
+         sizeof(uint32_t));
+  memcpy(new_fields + sizeof(EepromAddrT), journal + kJournalOffsetOfNewCrc,
+         sizeof(uint32_t));
+
+  // Each phase can be repeated, so it doesn't matter if the change had in fact
+  // been completed.
+  if (phase == kJournalPhaseTruncating || phase == kJournalPhaseExtending) {
+    // The beyond address or the CRC may have been partially written, so
+    // confirm that the entries are those that were being truncated, or those
+    // of the batch being committed.
+    const EepromAddrT new_beyond_addr =
+        phase == kJournalPhaseTruncating ? hole_addr : entry_addr;
+    const EepromAddrT old_beyond_addr =
+        phase == kJournalPhaseTruncating ? entry_addr : hole_addr;
+    memcpy(old_fields, &old_beyond_addr, sizeof old_beyond_addr);
+    memcpy(new_fields, &new_beyond_addr, sizeof new_beyond_addr);
+    if (!IsPartiallyOverwritten(stored_fields, old_fields, new_fields,
+                                sizeof stored_fields)) {
+      MCU_VLOG(1) << MCU_PSD("Ignoring stale journal");
+    } else {
+      auto status_or_crc = ComputeCrc(new_beyond_addr);
+      if (status_or_crc.ok() &&
+          status_or_crc.value() ==
+              GetJournalField<uint32_t>(journal, kJournalOffsetOfNewCrc)) {
+        MCU_VLOG(1) << MCU_PSD(
+            "Completing interrupted change of beyond address");
+        FinishChangingBeyondAddr(new_beyond_addr, status_or_crc.value(),
+                                 /*journaled=*/true);
+      }
+    }
+  } else {
+    // A move doesn't change the beyond address, and doesn't change the CRC
+    // before the phase is kJournalPhaseWritingCrc.
+    auto status_or_beyond_addr = ReadBeyondAddr();
+    const EepromAddrT entry_size =
+        kOffsetOfEntryData +
+        journal[kJournalOffsetOfEntryHeader + kOffsetOfEntryDataLength];
+    memcpy(new_fields, stored_fields, sizeof(EepromAddrT));
+    memcpy(old_fields, stored_fields, sizeof(EepromAddrT));
+    if (phase != kJournalPhaseWritingCrc) {
+      memcpy(new_fields, old_fields, sizeof new_fields);
+    }
+    if (status_or_beyond_addr.ok() &&
+        status_or_beyond_addr.value() <= journal_addr &&
+        entry_addr - hole_addr >= entry_size &&
+        status_or_beyond_addr.value() - entry_addr >= entry_size &&
+        IsPartiallyOverwritten(stored_fields, old_fields, new_fields,
+                               sizeof stored_fields)) {
+      MCU_VLOG(1) << MCU_PSD("Completing interrupted move of entry at ")
+                  << entry_addr;
+      const auto status =
+          FinishMoveEntryDown(journal, status_or_beyond_addr.value());
+      MCU_VLOG_IF(1, !status.ok()) << status;
+    }
+  }
+  ClearJournal();
+}
+
 Status EepromTlv::WriteEntry(const EepromTag tag, const uint8_t* const data,
                              const size_t data_length) {
   if (data_length > kMaxBlockLength) {
@@ -241,6 +717,244 @@ Status EepromTlv::WriteEntry(const EepromTag tag, const uint8_t* const data,
                            target_region.cursor());
 }
 
+Status EepromTlv::StartAsyncCommit(const EepromTag tag,
+                                   const uint8_t* const data,
+                                   const size_t data_length,
+                                   EepromWriteQueueBase& queue,
+                                   EepromAddrT& entry_addr,
+                                   EepromAddrT& beyond_addr, uint32_t& crc) {
+  if (data_length > kMaxBlockLength) {
+    return InvalidArgumentError(MCU_PSV("Entry data too big"));
+  }
+  // The transaction remains active until FinishAsyncCommit is called once all
+  // of the writes have completed, so that nothing else modifies the EEPROM.
+  EepromRegion target_region;
+  MCU_RETURN_IF_ERROR(
+      StartTransaction(tag, data_length, target_region,
+                       /*reclaim_unused_space_if_needed=*/true));
+  const EepromAddrT new_entry_data_addr = target_region.start_address();
+  const EepromAddrT new_entry_addr = new_entry_data_addr - kOffsetOfEntryData;
+  const EepromAddrT new_beyond_addr = new_entry_data_addr + data_length;
+  const auto length = static_cast<BlockLengthT>(data_length);
+
+  // Find the older entries with the same tag, which must be marked as unused
+  // once the new entry has been committed. With a complete index there is at
+  // most one such entry, and we know where it is.
+  EepromAddrT old_entry_addr = 0;
+  uint8_t old_entries = 0;
+  if (HasCompleteIndex()) {
+    old_entry_addr = index_->Find(tag);
+    old_entries = old_entry_addr != 0 ? 1 : 0;
+  } else {
+    auto status_or_count =
+        ForEachEntryWithTag(tag, new_entry_addr, [](EepromAddrT) {});
+    if (!status_or_count.ok()) {
+      AbortTransaction();
+      return status_or_count.status();
+    }
+    old_entries = status_or_count.value();
+  }
+  // As for a batch, if there is room for the journal, a commit interrupted
+  // while writing the beyond address and the CRC is completed by
+  // RecoverInterruptedCompaction.
+  const bool journaled = eeprom_length() - new_beyond_addr >= kJournalSize;
+  const auto data_runs = data_length > 0 ? 1 : 0;
+  const auto journal_runs = journaled ? 2 : 0;
+  const auto journal_bytes =
+      journaled ? kJournalSize + kJournalClearedBytesSize : 0;
+  if (!queue.CanEnqueue(data_length + kOffsetOfEntryData +
+                            sizeof(EepromAddrT) + sizeof(uint32_t) +
+                            journal_bytes + 2 * old_entries,
+                        data_runs + 2 + journal_runs + old_entries)) {
+    AbortTransaction();
+    return ResourceExhaustedError(MCU_PSV("EepromWriteQueue full"));
+  }
+
+  // The CRC covers the length and the data of each entry, in that order.
+  Crc32 extended_crc(ReadCrc());
+  extended_crc.appendByte(length);
+  for (size_t ndx = 0; ndx < data_length; ++ndx) {
+    extended_crc.appendByte(data[ndx]);
+  }
+  crc = extended_crc.value();
+
+  // The queue writes the runs in the order they're enqueued, so enqueue them in
+  // the order that keeps the EEPROM valid at every point. The beyond address
+  // and the CRC are adjacent, so are written as a single run.
+  const uint8_t entry_header[kOffsetOfEntryData] = {tag.domain.value(), tag.id,
+                                                    length};
+  uint8_t header_fields[sizeof(EepromAddrT) + sizeof(uint32_t)];
+  static_assert(kAddrOfCrc == kAddrOfBeyondAddr + sizeof(EepromAddrT),
+                "The CRC must follow the beyond address");
+  memcpy(header_fields, &new_beyond_addr, sizeof new_beyond_addr);
+  memcpy(header_fields + sizeof new_beyond_addr, &crc, sizeof crc);
+  uint8_t journal[kJournalSize];
+  bool ok = queue.Enqueue(new_entry_data_addr, data, data_length) &&
+            queue.Enqueue(new_entry_addr, entry_header, sizeof entry_header);
+  if (journaled) {
+    FillJournal(journal, new_entry_addr, new_beyond_addr,
+                kJournalPhaseExtending, crc);
+    ok = ok && queue.Enqueue(JournalAddr(), journal, kJournalSize);
+  }
+  ok = ok && queue.Enqueue(kAddrOfBeyondAddr, header_fields,
+                           sizeof header_fields);
+  if (journaled) {
+    // As ClearJournal does.
+    uint8_t cleared_bytes[kJournalClearedBytesSize];
+    FillClearedJournalBytes(cleared_bytes, journal);
+    ok = ok && queue.Enqueue(JournalAddr() + kJournalOffsetOfClearedBytes,
+                             cleared_bytes, sizeof cleared_bytes);
+  }
+  const auto unused_tag = MakeUnusedTag();
+  const uint8_t unused_tag_bytes[2] = {unused_tag.domain.value(),
+                                       unused_tag.id};
+  if (old_entry_addr != 0) {
+    ok = ok && queue.Enqueue(old_entry_addr, unused_tag_bytes,
+                             sizeof unused_tag_bytes);
+  } else if (old_entries > 0) {
+    const auto status = ForEachEntryWithTag(
+        tag, new_entry_addr, [&](EepromAddrT entry_addr) {
+          ok = ok && queue.Enqueue(entry_addr, unused_tag_bytes,
+                                   sizeof unused_tag_bytes);
+        }).status();
+    MCU_DCHECK_OK(status);
+  }
+  // We checked that there was room for all of the runs.
+  MCU_DCHECK(ok) << MCU_PSD("Enqueue failed");
+
+  entry_addr = new_entry_addr;
+  beyond_addr = new_beyond_addr;
+  return OkStatus();
+}
+
+EepromTag EepromTlv::FinishAsyncCommit(const EepromAddrT entry_addr,
+                                       const EepromAddrT beyond_addr,
+                                       const uint32_t crc) {
+  MCU_DCHECK(transaction_is_active_);
+  transaction_is_active_ = false;
+  SetValidated(beyond_addr, crc);
+  MCU_DCHECK_OK(Validate(kForce));
+  const auto tag = ReadTag(entry_addr);
+  if (index_ != nullptr) {
+    index_->Set(tag, entry_addr);
+  }
+  return tag;
+}
+
+Status EepromTlv::StartBatch(const BlockLengthT minimum_length,
+                             EepromAddrT& first_entry_addr) {
+  MCU_RETURN_IF_ERROR(ValidateNoTransactionIsActive());
+  MCU_RETURN_IF_ERROR(Validate());
+  if (eeprom_length() < kAddrOfFirstEntry + kJournalSize) {
+    return ResourceExhaustedError(MCU_PSV("No room for batch journal"));
+  }
+  // The staged entries must end before the journal, so that the commit can
+  // always be journaled.
+  MCU_RETURN_IF_ERROR(
+      CompactToMakeRoom(JournalAddr(), kOffsetOfEntryData + minimum_length));
+  MCU_ASSIGN_OR_RETURN(first_entry_addr, ReadBeyondAddr());
+  transaction_is_active_ = true;
+  return OkStatus();
+}
+
+Status EepromTlv::StartBatchEntry(const EepromTag tag,
+                                  const BlockLengthT minimum_length,
+                                  const EepromAddrT entry_addr,
+                                  EepromRegion& target_region) {
+  MCU_DCHECK(transaction_is_active_);
+  if (IsReservedDomain(tag.domain)) {
+    return InvalidArgumentError(MCU_PSV("Domain is reserved"));
+  }
+  // Leave room for the journal written by CommitBatch.
+  const EepromAddrT limit_addr = JournalAddr();
+  const EepromAddrT data_addr = entry_addr + kOffsetOfEntryData;
+  if (data_addr > limit_addr || limit_addr - data_addr < minimum_length) {
+    return ResourceExhaustedError(MCU_PSV("No room for batch entry"));
+  }
+  const EepromAddrT available = limit_addr - data_addr;
+  target_region = EepromRegion(
+      *eeprom_, data_addr,
+      available > kMaxBlockLength ? kMaxBlockLength : available, &stats_);
+  return OkStatus();
+}
+
+void EepromTlv::FinishBatchEntry(const EepromAddrT entry_addr,
+                                 const EepromTag tag,
+                                 const BlockLengthT data_length) {
+  MCU_DCHECK(transaction_is_active_);
+  WriteEntryDataLength(entry_addr, data_length);
+  WriteTag(entry_addr, tag);
+}
+
+Status EepromTlv::CommitBatch(const EepromAddrT first_entry_addr,
+                              const EepromAddrT beyond_addr) {
+  MCU_DCHECK(transaction_is_active_);
+  transaction_is_active_ = false;
+  MCU_DCHECK(IsValidationCached(first_entry_addr));
+
+  // The CRC covers the length and data of each entry, but not the tag.
+  Crc32 crc(ReadCrc());
+  EepromAddrT addr = first_entry_addr;
+  while (addr < beyond_addr) {
+    MCU_ASSIGN_OR_RETURN(const auto next_entry_addr, FindNext(addr));
+    AppendToCrc(crc, addr + kOffsetOfEntryDataLength, next_entry_addr);
+    addr = next_entry_addr;
+  }
+  if (addr != beyond_addr) {
+    return WrongComputedBeyondAddr();  // COV_NF_LINE
+  }
+
+  // StartBatchEntry leaves room for the journal, so the commit can always be
+  // completed by RecoverInterruptedCompaction if interrupted.
+  uint8_t journal[kJournalSize];
+  MCU_RETURN_IF_ERROR(WriteJournal(journal, first_entry_addr, beyond_addr,
+                                   beyond_addr, kJournalPhaseExtending,
+                                   crc.value()));
+  FinishChangingBeyondAddr(beyond_addr, crc.value(), /*journaled=*/true);
+  MCU_DCHECK_OK(Validate(kForce));
+
+  // Mark the older versions of the entries as unused, including those which
+  // were superseded by a later entry in the batch.
+  for (addr = first_entry_addr; addr < beyond_addr;) {
+    const auto tag = ReadTag(addr);
+    if (HasCompleteIndex()) {
+      const auto old_entry_addr = index_->Find(tag);
+      if (old_entry_addr != 0) {
+        WriteTag(old_entry_addr, MakeUnusedTag());
+      }
+    } else {
+      MCU_RETURN_IF_ERROR(DeleteEntry(tag, addr, /*not_found_ok=*/true));
+    }
+    if (index_ != nullptr) {
+      index_->Set(tag, addr);
+    }
+    MCU_ASSIGN_OR_RETURN(addr, FindNext(addr));
+  }
+  return OkStatus();
+}
+
+void EepromTlv::AbortBatch() {
+  MCU_DCHECK(transaction_is_active_);
+  transaction_is_active_ = false;
+}
+
+template <typename F>
+StatusOr<uint8_t> EepromTlv::ForEachEntryWithTag(const EepromTag tag,
+                                                 const EepromAddrT beyond_addr,
+                                                 F func) const {
+  uint8_t count = 0;
+  auto addr = kAddrOfFirstEntry;
+  const EepromAddrT limit_addr = beyond_addr - kOffsetOfEntryData;
+  while (addr <= limit_addr) {
+    if (tag == ReadTag(addr)) {
+      func(addr);
+      ++count;
+    }
+    MCU_ASSIGN_OR_RETURN(addr, FindNext(addr));
+  }
+  return count;
+}
+
 StatusOr<EepromTlv::BlockLengthT> EepromTlv::ReadEntry(
     EepromTag tag, uint8_t* const buffer, size_t buffer_length) const {
   MCU_ASSIGN_OR_RETURN(auto region, FindEntry(tag));
@@ -254,6 +968,19 @@ StatusOr<EepromTlv::BlockLengthT> EepromTlv::ReadEntry(
 }
 
 StatusOr<EepromRegionReader> EepromTlv::FindEntry(const EepromTag tag) const {
+  DCheckNoPendingWrites();
+  if (IsReservedDomain(tag.domain)) {
+    // Don't expose unused entries.
+    return Status(StatusCode::kNotFound);
+  }
+  if (index_ != nullptr) {
+    const auto entry_addr = index_->Find(tag);
+    if (entry_addr != 0) {
+      return MakeEntryReader(entry_addr);
+    } else if (index_->complete()) {
+      return Status(StatusCode::kNotFound);
+    }
+  }
   MCU_ASSIGN_OR_RETURN(const auto beyond_addr, ReadBeyondAddr());
   EepromAddrT found = 0;
   auto addr = kAddrOfFirstEntry;
@@ -270,15 +997,44 @@ StatusOr<EepromRegionReader> EepromTlv::FindEntry(const EepromTag tag) const {
   } else if (found == 0) {
     return Status(StatusCode::kNotFound);
   }
+  return MakeEntryReader(found);
+}
 
-  MCU_ASSIGN_OR_RETURN(const auto next_entry_addr, FindNext(found));
-  BlockLengthT entry_data_length =
-      (next_entry_addr - found) - kOffsetOfEntryData;
-  eeprom_->get(found + kOffsetOfEntryDataLength, entry_data_length);
-  return EepromRegionReader(*eeprom_, found + kOffsetOfEntryData,
+StatusOr<EepromRegionReader> EepromTlv::MakeEntryReader(
+    const EepromAddrT entry_addr) const {
+  MCU_ASSIGN_OR_RETURN(const auto next_entry_addr, FindNext(entry_addr));
+  const BlockLengthT entry_data_length =
+      (next_entry_addr - entry_addr) - kOffsetOfEntryData;
+  return EepromRegionReader(*eeprom_, entry_addr + kOffsetOfEntryData,
                             entry_data_length);
 }
 
+Status EepromTlv::BuildIndex() {
+  MCU_DCHECK(index_ != nullptr);
+  index_->Clear();
+  MCU_ASSIGN_OR_RETURN(const auto beyond_addr, ReadBeyondAddr());
+  auto addr = kAddrOfFirstEntry;
+  const EepromAddrT limit_addr = beyond_addr - kOffsetOfEntryData;
+  while (addr <= limit_addr) {
+    const auto tag = ReadTag(addr);
+    if (!IsUnusedTag(tag)) {
+      if (index_->Find(tag) != 0) {
+        // Older versions of an entry are normally deleted when a newer version
+        // is committed, so this shouldn't happen. Since we can't rely on the
+        // index when deleting this tag, don't rely on it at all.
+        MCU_VLOG(2) << MCU_PSD("Duplicate tag ") << tag;
+        index_->MarkIncomplete();
+      }
+      index_->Set(tag, addr);
+    }
+    MCU_ASSIGN_OR_RETURN(addr, FindNext(addr));
+  }
+  if (addr != beyond_addr) {
+    return WrongComputedBeyondAddr();
+  }
+  return OkStatus();
+}
+
 StatusOr<EepromAddrT> EepromTlv::FindNext(EepromAddrT entry_addr) const {
   const auto entry_data_length_addr = entry_addr + kOffsetOfEntryDataLength;
 
@@ -305,11 +1061,29 @@ StatusOr<EepromAddrT> EepromTlv::FindNext(EepromAddrT entry_addr) const {
 }
 
 Status EepromTlv::DeleteEntry(const EepromTag tag) {
+  if (IsReservedDomain(tag.domain)) {
+    return Status(StatusCode::kNotFound);
+  }
   MCU_ASSIGN_OR_RETURN(const auto beyond_addr, ReadBeyondAddr());
-  MCU_ASSIGN_OR_RETURN(const bool found_other_tags,
-                       DeleteEntry(tag, beyond_addr, /*not_found_ok=*/false));
+  bool found_other_tags;
+  if (HasCompleteIndex()) {
+    MCU_RETURN_IF_ERROR(ValidateNoTransactionIsActive());
+    const auto entry_addr = index_->Find(tag);
+    if (entry_addr == 0) {
+      return Status(StatusCode::kNotFound);
+    }
+    WriteTag(entry_addr, MakeUnusedTag());
+    index_->Erase(tag);
+    found_other_tags = index_->size() > 0;
+  } else {
+    MCU_ASSIGN_OR_RETURN(found_other_tags,
+                         DeleteEntry(tag, beyond_addr, /*not_found_ok=*/false));
+    if (index_ != nullptr) {
+      index_->Erase(tag);
+    }
+  }
   if (!found_other_tags) {
-    auto status_or = ClearAndInitializeEeprom(*eeprom_);
+    auto status_or = ClearAndInitializeEeprom(*eeprom_, index_);
     MCU_DCHECK_OK(status_or);  // This shouldn't fail.
     return status_or.status();
   }
@@ -343,10 +1117,13 @@ StatusOr<EepromAddrT> EepromTlv::ReadBeyondAddr() const {
 }
 
 void EepromTlv::WriteBeyondAddr(const EepromAddrT beyond_addr) {
-  eeprom_->put(kAddrOfBeyondAddr, beyond_addr);
+  EepromWriteBlock(*eeprom_, kAddrOfBeyondAddr,
+                   reinterpret_cast<const uint8_t*>(&beyond_addr),
+                   sizeof beyond_addr, &stats_);
 }
 
 EepromAddrT EepromTlv::Available() const {
+  DCheckNoPendingWrites();
   auto status_or_beyond_addr = ReadBeyondAddr();
   if (!status_or_beyond_addr.ok()) {
     return 0;
@@ -359,7 +1136,10 @@ EepromAddrT EepromTlv::Available() const {
   return eeprom_length() - new_entry_data_addr;
 }
 
-void EepromTlv::WriteCrc(const uint32_t crc) { eeprom_->put(kAddrOfCrc, crc); }
+void EepromTlv::WriteCrc(const uint32_t crc) {
+  EepromWriteBlock(*eeprom_, kAddrOfCrc, reinterpret_cast<const uint8_t*>(&crc),
+                   sizeof crc, &stats_);
+}
 
 uint32_t EepromTlv::ReadCrc() const {
   uint32_t crc;
@@ -372,16 +1152,19 @@ StatusOr<uint32_t> EepromTlv::ComputeCrc(const EepromAddrT beyond_addr) const {
   auto addr = kAddrOfFirstEntry;
   const EepromAddrT limit_addr = beyond_addr - kOffsetOfEntryData;
   while (addr <= limit_addr) {
-#ifdef MCU_ENABLE_DCHECK
-    // Either the tag's domain is not reserved OR the tag is the unused tag.
+    // Either the tag's domain is not reserved OR the tag is unused (i.e. is in
+    // domain 0). A torn write (e.g. of the beyond address, during a power loss)
+    // can lead us to bytes which aren't an entry (e.g. erased bytes, in domain
+    // 255), so this is an error, not a DCHECK.
     const auto tag = ReadTag(addr);
-    MCU_DCHECK(!IsReservedDomain(tag.domain) || IsUnusedTag(tag));
-#endif
-    MCU_ASSIGN_OR_RETURN(const auto next_entry_addr, FindNext(addr));
-    addr += kOffsetOfEntryDataLength;
-    while (addr < next_entry_addr) {
-      computed_crc.appendByte(eeprom_->read(addr++));
+    if (IsReservedDomain(tag.domain) && !IsUnusedTag(tag)) {
+      MCU_VLOG(1) << MCU_PSD("Reserved tag at ") << addr;
+      return DataLossError(MCU_PSV("Reserved tag in entries"));
     }
+    MCU_ASSIGN_OR_RETURN(const auto next_entry_addr, FindNext(addr));
+    AppendToCrc(computed_crc, addr + kOffsetOfEntryDataLength,
+                next_entry_addr);
+    addr = next_entry_addr;
   }
   if (addr == beyond_addr) {
     return computed_crc.value();
@@ -396,23 +1179,49 @@ StatusOr<uint32_t> EepromTlv::ComputeCrc(const EepromAddrT beyond_addr) const {
 uint32_t EepromTlv::ComputeExtendedCrc(
     const EepromAddrT new_entry_addr, const EepromAddrT new_beyond_addr) const {
   Crc32 computed_crc(ReadCrc());
-  EepromAddrT addr = new_entry_addr + kOffsetOfEntryDataLength;
-  while (addr < new_beyond_addr) {
-    computed_crc.appendByte(eeprom_->read(addr++));
-  }
+  AppendToCrc(computed_crc, new_entry_addr + kOffsetOfEntryDataLength,
+              new_beyond_addr);
   return computed_crc.value();
 }
 
+void EepromTlv::AppendToCrc(Crc32& crc, EepromAddrT addr,
+                            const EepromAddrT beyond_addr) const {
+  uint8_t buffer[16];
+  while (addr < beyond_addr) {
+    const EepromAddrT remaining = beyond_addr - addr;
+    const EepromAddrT chunk =
+        remaining < sizeof buffer ? remaining : sizeof buffer;
+    EepromReadBlock(*eeprom_, addr, buffer, chunk);
+    for (EepromAddrT ndx = 0; ndx < chunk; ++ndx) {
+      crc.appendByte(buffer[ndx]);
+    }
+    addr += chunk;
+  }
+}
+
 Status EepromTlv::ValidateCrc(const EepromAddrT beyond_addr) const {
+  validated_beyond_addr_ = 0;
   MCU_ASSIGN_OR_RETURN(const auto computed_crc, ComputeCrc(beyond_addr));
   const uint32_t stored_crc = ReadCrc();
   if (computed_crc != stored_crc) {
     MCU_VLOG(1) << MCU_PSD("Crc wrong: ") << stored_crc << "!=" << computed_crc;
     return WrongCrc();
   }
+  SetValidated(beyond_addr, computed_crc);
   return OkStatus();
 }
 
+bool EepromTlv::IsValidationCached(const EepromAddrT beyond_addr) const {
+  return validated_beyond_addr_ != 0 && validated_beyond_addr_ == beyond_addr &&
+         validated_crc_ == ReadCrc();
+}
+
+void EepromTlv::SetValidated(const EepromAddrT beyond_addr,
+                             const uint32_t crc) const {
+  validated_beyond_addr_ = beyond_addr;
+  validated_crc_ = crc;
+}
+
 Status EepromTlv::StartTransaction(const EepromTag tag,
                                    const BlockLengthT minimum_length,
                                    EepromRegion& target_region,
@@ -424,31 +1233,36 @@ Status EepromTlv::StartTransaction(const EepromTag tag,
     return InvalidArgumentError(MCU_PSV("minimum_length too large"));
   }
   MCU_RETURN_IF_ERROR(ValidateNoTransactionIsActive());
+  // The CRC of the new entry is computed by extending the stored CRC, so the
+  // existing entries must be valid; this is cheap if they're known to be.
+  MCU_RETURN_IF_ERROR(Validate());
+  if (reclaim_unused_space_if_needed &&
+      eeprom_length() >= kAddrOfFirstEntry + kJournalSize) {
+    // Compaction needs room for the journal, so try to make room for the new
+    // entry before the journal, a journaled step at a time (i.e. safe to
+    // interrupt), and only for a bounded time. The journal's space is used for
+    // entries only if that fails.
+    const auto status = CompactToMakeRoom(JournalAddr(),
+                                          kOffsetOfEntryData + minimum_length);
+    if (!status.ok() && !IsResourceExhausted(status)) {
+      return status;
+    }
+  }
   MCU_ASSIGN_OR_RETURN(const auto new_entry_addr, ReadBeyondAddr());
-  MCU_DCHECK_OK(ValidateCrc(new_entry_addr));
   const auto new_entry_data_addr = new_entry_addr + kOffsetOfEntryData;
   const auto available = eeprom_length() - new_entry_data_addr;
-  if (available >= minimum_length) {
-    EepromAddrT length;
-    if (available > kMaxBlockLength) {
-      length = kMaxBlockLength;
-    } else {
-      length = available;
-    }
-    target_region = EepromRegion(*eeprom_, new_entry_data_addr, length);
-    transaction_is_active_ = true;
-    return OkStatus();
-  } else if (reclaim_unused_space_if_needed) {
-    // There isn't enough room, but we're allowed to reclaim unused space,
-    // so let's try.
-    MCU_ASSIGN_OR_RETURN(const auto reclaimed_space, ReclaimUnusedSpace());
-    if (available + reclaimed_space >= minimum_length) {
-      // Try again, but don't try reclaiming space again.
-      return StartTransaction(tag, minimum_length, target_region,
-                              /*reclaim_unused_space_if_needed=*/false);
-    }
+  if (available < minimum_length) {
+    return Status(StatusCode::kResourceExhausted);
   }
-  return Status(StatusCode::kResourceExhausted);
+  EepromAddrT length;
+  if (available > kMaxBlockLength) {
+    length = kMaxBlockLength;
+  } else {
+    length = available;
+  }
+  target_region = EepromRegion(*eeprom_, new_entry_data_addr, length, &stats_);
+  transaction_is_active_ = true;
+  return OkStatus();
 }
 
 Status EepromTlv::ValidateNoTransactionIsActive() const {
@@ -459,6 +1273,11 @@ Status EepromTlv::ValidateNoTransactionIsActive() const {
   return OkStatus();
 }
 
+void EepromTlv::DCheckNoPendingWrites() const {
+  MCU_DCHECK(!EepromWriteQueueBase::HasPendingWritesTo(*eeprom_))
+      << MCU_PSD("EEPROM read while writes are pending");
+}
+
 Status EepromTlv::CommitTransaction(const EepromTag tag,
                                     const EepromAddrT data_addr,
                                     const BlockLengthT data_length) {
@@ -474,7 +1293,7 @@ Status EepromTlv::CommitTransaction(const EepromTag tag,
   if (new_entry_data_addr != data_addr) {
     return InternalError(MCU_PSV("Commit wrong data_addr"));
   }
-  MCU_DCHECK_OK(ValidateCrc(new_entry_addr));
+  MCU_DCHECK(IsValidationCached(new_entry_addr));
 
   const auto new_beyond_addr = new_entry_data_addr + data_length;
   if (new_beyond_addr > eeprom_length()) {
@@ -509,13 +1328,26 @@ Status EepromTlv::CommitTransaction(const EepromTag tag,
   // update the stored CRC and the stored beyond addr.
   WriteCrc(extended_crc);
   WriteBeyondAddr(new_beyond_addr);
+  SetValidated(new_beyond_addr, extended_crc);
 
   // Validate should now
   MCU_DCHECK_OK(Validate());
 
   // 'Remove' any other entries with the same tag that appear before the new
-  // entry.
-  MCU_RETURN_IF_ERROR(DeleteEntry(tag, new_entry_addr, /*not_found_ok=*/true));
+  // entry. With a complete index there is at most one such entry, and we know
+  // where it is.
+  if (HasCompleteIndex()) {
+    const auto old_entry_addr = index_->Find(tag);
+    if (old_entry_addr != 0) {
+      WriteTag(old_entry_addr, MakeUnusedTag());
+    }
+  } else {
+    MCU_RETURN_IF_ERROR(
+        DeleteEntry(tag, new_entry_addr, /*not_found_ok=*/true));
+  }
+  if (index_ != nullptr) {
+    index_->Set(tag, new_entry_addr);
+  }
 
   // And a last step of paranoia.
   MCU_DCHECK_OK(Validate());
@@ -536,8 +1368,10 @@ EepromTag EepromTlv::ReadTag(EepromAddrT entry_addr) const {
 }
 
 void EepromTlv::WriteTag(EepromAddrT entry_addr, const EepromTag tag) {
-  eeprom_->write(entry_addr, tag.domain.value());
-  eeprom_->write(entry_addr + 1, tag.id);
+  // The domain is written first, so that if marking an entry as unused is
+  // interrupted, the entry is already unused (see IsUnusedTag).
+  EepromUpdateByte(*eeprom_, entry_addr, tag.domain.value(), &stats_);
+  EepromUpdateByte(*eeprom_, entry_addr + 1, tag.id, &stats_);
 }
 
 EepromTlv::BlockLengthT EepromTlv::ReadEntryDataLength(
@@ -550,7 +1384,8 @@ EepromTlv::BlockLengthT EepromTlv::ReadEntryDataLength(
 void EepromTlv::WriteEntryDataLength(EepromAddrT entry_addr,
                                      BlockLengthT data_length) {
   const auto entry_length_addr = entry_addr + kOffsetOfEntryDataLength;
-  eeprom_->put(entry_length_addr, data_length);
+  static_assert(sizeof data_length == 1, "BlockLengthT should be one byte");
+  EepromUpdateByte(*eeprom_, entry_length_addr, data_length, &stats_);
 }
 
 StatusOr<bool> EepromTlv::DeleteEntry(const EepromTag tag,
@@ -633,4 +1468,75 @@ void EepromTlv::InsertInto(OPrintStream& strm) const {
   strm << '}';
 }
 
+EepromTlvEntryIterator::EepromTlvEntryIterator(const EepromTlv& tlv,
+                                               const EepromDomain domain)
+    : tlv_(&tlv),
+      domain_(domain),
+      next_entry_addr_(0),
+      beyond_addr_(0),
+      id_(0) {}
+
+StatusOr<bool> EepromTlvEntryIterator::Next() {
+  tlv_->DCheckNoPendingWrites();
+  if (next_entry_addr_ == 0) {
+    MCU_RETURN_IF_ERROR(Start());
+  }
+  while (next_entry_addr_ < beyond_addr_) {
+    const auto entry_addr = next_entry_addr_;
+    MCU_ASSIGN_OR_RETURN(next_entry_addr_, tlv_->FindNext(entry_addr));
+    const auto tag = tlv_->ReadTag(entry_addr);
+    if (tag.domain != domain_) {
+      continue;
+    }
+    if (duplicated_ids_.test(tag.id)) {
+      MCU_ASSIGN_OR_RETURN(const bool has_newer_entry, HasNewerEntry(tag));
+      if (has_newer_entry) {
+        continue;
+      }
+    }
+    id_ = tag.id;
+    MCU_ASSIGN_OR_RETURN(reader_, tlv_->MakeEntryReader(entry_addr));
+    return true;
+  }
+  return false;
+}
+
+Status EepromTlvEntryIterator::Start() {
+  if (IsReservedDomain(domain_)) {
+    return InvalidArgumentError(MCU_PSV("Domain is reserved"));
+  }
+  MCU_RETURN_IF_ERROR(tlv_->Validate());
+  MCU_ASSIGN_OR_RETURN(beyond_addr_, tlv_->ReadBeyondAddr());
+  BitSet<256> seen_ids;
+  duplicated_ids_.reset();
+  auto addr = kAddrOfFirstEntry;
+  while (addr < beyond_addr_) {
+    const auto tag = tlv_->ReadTag(addr);
+    if (tag.domain == domain_) {
+      if (seen_ids.test(tag.id)) {
+        duplicated_ids_.set(tag.id);
+      }
+      seen_ids.set(tag.id);
+    }
+    MCU_ASSIGN_OR_RETURN(addr, tlv_->FindNext(addr));
+  }
+  if (addr != beyond_addr_) {
+    return WrongComputedBeyondAddr();  // COV_NF_LINE
+  }
+  next_entry_addr_ = kAddrOfFirstEntry;
+  return OkStatus();
+}
+
+StatusOr<bool> EepromTlvEntryIterator::HasNewerEntry(
+    const EepromTag tag) const {
+  auto addr = next_entry_addr_;
+  while (addr < beyond_addr_) {
+    if (tag == tlv_->ReadTag(addr)) {
+      return true;
+    }
+    MCU_ASSIGN_OR_RETURN(addr, tlv_->FindNext(addr));
+  }
+  return false;
+}
+
 }  // namespace mcucore
@@ -16,11 +16,23 @@
 //    in the CRC because that allows us to invalidate an entry by changing the
 //    tag, without the need to recompute the CRC.
 // 4) Entries, each of the format:
-//    a) EepromTag (i.e. domain followed by id)
+//    a) EepromTag (i.e. domain followed by id); an entry whose tag is in domain
+//       0, with any id, is unused (i.e. it has been deleted or replaced), and
+//       is never found.
 //    b) Entry length, of type EepromTlv::BlockLengthT; zero is valid, in which
 //       case the entry just indicates "I'm present", but has no data.
 //    c) Entry data, in whatever form the writer chose.
 //
+// VALIDATION
+//
+// Validating the CRC requires reading every byte of every entry, so an
+// EepromTlv instance records the beyond address and CRC at which the entries
+// were last known to be valid (i.e. after a full validation, or after an update
+// made by this instance), and Validate only repeats the full validation if the
+// stored beyond address or CRC no longer match those values, or if kForce is
+// specified. The full validation is performed when an instance is created by
+// GetIfValid, etc.
+//
 // The address of the Next-Entry-To-Write and the CRC are at the start so that:
 // *  We don't have to search all the entries to find them.
 // *  It's an O(1) operation to figure out where to write a new entry.
@@ -33,9 +45,54 @@
 // EepromTlv::FindEntry) must not be used after any mutating method of EepromTlv
 // has been called, as it may no longer represent the location of that entry or
 // of a valid entry.
+//
+// INDEX
+//
+// The methods which produce an EepromTlv instance accept an optional pointer to
+// an EepromTlvIndex, a RAM resident map from tag to entry address, which allows
+// entries to be found without walking the chain of entries; see
+// eeprom_tlv_index.h.
+//
+// COMPACTION
+//
+// ReclaimUnusedSpace compacts all of the entries in one call, which may take a
+// long time (e.g. many hundreds of milliseconds on AVR), and leaves the EEPROM
+// invalid if interrupted. EepromTlvCompactor instead compacts the entries one
+// at a time, leaving them valid between steps; see eeprom_tlv_compactor.h.
+//
+// Writing an entry doesn't call ReclaimUnusedSpace. Instead, if the new entry
+// wouldn't fit before the space needed for the journal at the end of the
+// EEPROM, the write first compacts the entries a step at a time, as
+// EepromTlvCompactor does, moving at most a few hundred bytes. If that doesn't
+// make room, the entry may use the journal's space, and once there is no room
+// at all the write fails with ResourceExhausted; call ReclaimUnusedSpace or
+// drive an EepromTlvCompactor to finish compacting.
+//
+// BATCHES
+//
+// Each commit rewrites the beyond address and the CRC. EepromTlvBatch instead
+// stages several entries after the existing entries, and then commits them all
+// by writing the beyond address and the CRC once, so that either all or none
+// of the entries are visible after a power loss; see eeprom_tlv_batch.h.
+//
+// ASYNCHRONOUS COMMITS
+//
+// EepromTlvAsyncWriter writes an entry by enqueuing the writes in an
+// EepromWriteQueue, rather than waiting for them to complete; see
+// eeprom_tlv_async_writer.h.
+//
+// ITERATION
+//
+// ForEachEntry and EepromTlvEntryIterator visit the most recently written entry
+// of each tag in a domain, in the order in which the entries are stored.
 
+#include "container/bit_set.h"
+#include "eeprom/eeprom_block.h"
 #include "eeprom/eeprom_region.h"
 #include "eeprom/eeprom_tag.h"
+#include "eeprom/eeprom_tlv_index.h"
+#include "eeprom/eeprom_write_queue.h"
+#include "hash/crc32.h"
 #include "log/log.h"
 #include "mcucore_platform.h"
 #include "status/status_or.h"
@@ -45,6 +102,11 @@ namespace test {
 class EepromTlvTest;
 }
 
+class EepromTlvAsyncWriter;
+class EepromTlvBatch;
+class EepromTlvCompactor;
+class EepromTlvEntryIterator;
+
 class EepromTlv {
  public:
   // We only have a modest amount of EEPROM altogether, so it doesn't make
@@ -57,15 +119,28 @@ class EepromTlv {
   static constexpr EepromAddrT kFixedHeaderSize = 4 + 4 + 2;
   static constexpr EepromAddrT kEntryHeaderSize = 2 + 1;
 
+  // Modes of Validate.
+  enum ValidationMode : uint8_t {
+    // Skip recomputing the CRC of the entries if the stored beyond address and
+    // CRC match those at which the entries were last known to be valid.
+    kUseCache,
+    // Always recompute the CRC of the entries.
+    kForce,
+  };
+
   // Gets an instance of EepromTlv, if the EEPROM contains data in the expected
-  // format.
-  static StatusOr<EepromTlv> GetIfValid(EEPROMClass& eeprom);
+  // format. If index is not null, it is built from the entries in the EEPROM,
+  // and used by the returned instance. First completes any step of compaction
+  // (see EepromTlvCompactor) which was interrupted by a power loss.
+  static StatusOr<EepromTlv> GetIfValid(EEPROMClass& eeprom,
+                                        EepromTlvIndexBase* index = nullptr);
   static StatusOr<EepromTlv> GetIfValid() { return GetIfValid(EEPROM); }
 
   // Format the EEPROM as an empty EepromTlv, and return an instance. Fails only
   // if the EEPROM can't be initialized (e.g. doesn't hold the expected values
   // after writing).
-  static StatusOr<EepromTlv> ClearAndInitializeEeprom(EEPROMClass& eeprom);
+  static StatusOr<EepromTlv> ClearAndInitializeEeprom(
+      EEPROMClass& eeprom, EepromTlvIndexBase* index = nullptr);
   static StatusOr<EepromTlv> ClearAndInitializeEeprom() {
     return ClearAndInitializeEeprom(EEPROM);
   }
@@ -73,17 +148,19 @@ class EepromTlv {
   // Get an EepromTlv instance for the EEPROM. If already valid, does not modify
   // the EEPROM; otherwise, uses ClearAndInitializeEeprom to make the EEPROM
   // represent an empty EepromTlv instance.
-  static StatusOr<EepromTlv> Get(EEPROMClass& eeprom);
+  static StatusOr<EepromTlv> Get(EEPROMClass& eeprom,
+                                 EepromTlvIndexBase* index = nullptr);
   static StatusOr<EepromTlv> Get() { return Get(EEPROM); }
 
   // Returns a valid EepromTlv instance, clearing the EEPROM if necessary. Fails
   // only if a non-initialized EEPROM can't be initialized.
-  static EepromTlv GetOrDie(EEPROMClass& eeprom);
+  static EepromTlv GetOrDie(EEPROMClass& eeprom,
+                            EepromTlvIndexBase* index = nullptr);
   static EepromTlv GetOrDie() { return GetOrDie(EEPROM); }
 
   // Returns an OK Status if the instance is valid, else an appropriate error
-  // Status.
-  Status Validate() const;
+  // Status. See VALIDATION above regarding the mode.
+  Status Validate(ValidationMode mode = kUseCache) const;
 
   // Remove any deleted entries by compacting the valid entries so there is no
   // unused space prior to the end of the valid entries.
@@ -104,6 +181,14 @@ class EepromTlv {
   // properly formatted, or if a block is not found with the specified tag.
   StatusOr<EepromRegionReader> FindEntry(EepromTag tag) const;
 
+  // Calls callback(tag, reader) for the most recently written entry of each tag
+  // in the domain, where reader is an EepromRegionReader for the data of the
+  // entry; see EepromTlvEntryIterator. If callback returns an error Status, the
+  // iteration stops and that error is returned. The callback must not modify
+  // the EepromTlv (see SAFETY above).
+  template <typename F>
+  Status ForEachEntry(EepromDomain domain, F callback) const;
+
   // Delete the entry (or entries) with the specified tag. Returns an error if
   // the EEPROM is not properly formatted, or if not entry is found with the
   // specified tag.
@@ -152,8 +237,18 @@ class EepromTlv {
   // testing easier.
   EepromAddrT Available() const;
 
+  // Returns the counts of the bytes written and skipped (because they were
+  // unchanged) by this instance, for measuring the time spent writing to the
+  // EEPROM and the wear on it.
+  const EepromStats& stats() const { return stats_; }
+  void ResetStats() { stats_ = EepromStats(); }
+
  private:
   friend class test::EepromTlvTest;
+  friend class EepromTlvAsyncWriter;
+  friend class EepromTlvBatch;
+  friend class EepromTlvCompactor;
+  friend class EepromTlvEntryIterator;
 
   // We use instance, rather than static, methods so that testing is easier.
   explicit EepromTlv(EEPROMClass& eeprom);
@@ -169,6 +264,17 @@ class EepromTlv {
   // Write the beyond address.
   void WriteBeyondAddr(EepromAddrT beyond_addr);
 
+  // Walk the entries, adding the live ones to index_, which must not be null.
+  Status BuildIndex();
+
+  // Returns true if index_ can be relied on to answer whether a tag is present.
+  bool HasCompleteIndex() const {
+    return index_ != nullptr && index_->complete();
+  }
+
+  // Returns a reader for the data of the entry at entry_addr.
+  StatusOr<EepromRegionReader> MakeEntryReader(EepromAddrT entry_addr) const;
+
   // Given the address of an entry, return the address of the next entry.
   StatusOr<EepromAddrT> FindNext(EepromAddrT entry_addr) const;
 
@@ -192,14 +298,27 @@ class EepromTlv {
   uint32_t ComputeExtendedCrc(EepromAddrT new_entry_addr,
                               EepromAddrT new_beyond_addr) const;
 
-  // Returns true if the CRC value matches that computed from the entries.
+  // Appends the bytes from addr up to, but not including, beyond_addr to crc,
+  // reading them a block at a time.
+  void AppendToCrc(Crc32& crc, EepromAddrT addr, EepromAddrT beyond_addr) const;
+
+  // Returns true if the CRC value matches that computed from the entries. If
+  // so, records beyond_addr and the CRC as the validated state.
   Status ValidateCrc(EepromAddrT beyond_addr) const;
 
+  // Returns true if beyond_addr and the stored CRC match the validated state.
+  bool IsValidationCached(EepromAddrT beyond_addr) const;
+
+  // Records that the entries up to beyond_addr are known to be valid, with the
+  // specified CRC.
+  void SetValidated(EepromAddrT beyond_addr, uint32_t crc) const;
+
   // If there is sufficient space, start a write transaction and update
   // target_region to represent the space into which the writer can write the
   // data of a new entry; target_region will have length that is at least
-  // minimum_length. If there is not sufficient space, then it will attempt to
-  // reclaim unused space in order to make sufficient space.
+  // minimum_length. If reclaim_unused_space_if_needed is true, first calls
+  // CompactToMakeRoom if the new entry wouldn't end before the journal (see
+  // COMPACTION above).
   Status StartTransaction(EepromTag tag, BlockLengthT minimum_length,
                           EepromRegion& target_region,
                           bool reclaim_unused_space_if_needed);
@@ -231,6 +350,128 @@ class EepromTlv {
 
   Status ValidateNoTransactionIsActive() const;
 
+  // Reading the EEPROM while an EepromWriteQueue has pending writes to it isn't
+  // safe (see EepromWriteQueueBase), so methods which read call this first.
+  void DCheckNoPendingWrites() const;
+
+  // Calls func(entry_addr) for each entry with the specified tag before
+  // beyond_addr, returning the number of such entries.
+  template <typename F>
+  StatusOr<uint8_t> ForEachEntryWithTag(EepromTag tag, EepromAddrT beyond_addr,
+                                        F func) const;
+
+  // Performs one step of incremental compaction: moves the first live entry
+  // after an unused entry to an earlier address, or removes the unused entries
+  // at the end; if that entry has been superseded by a later entry with the
+  // same tag, it is instead marked as unused. Sets bytes_moved to the size of
+  // the moved entry, or to zero if no entry was moved, which is also the case
+  // if the entry is larger than max_bytes. Returns true if there are no unused
+  // entries left.
+  StatusOr<bool> CompactOnce(EepromAddrT max_bytes, EepromAddrT& bytes_moved);
+
+  // Removes the unused entries from new_beyond_addr to beyond_addr, which are
+  // the last entries. If there is room, first records the truncation in the
+  // journal (see MoveEntryDown).
+  Status TruncateEntries(EepromAddrT new_beyond_addr, EepromAddrT beyond_addr);
+
+  // Writes the beyond address and CRC of the truncated (or extended) entries,
+  // and clears the journal if journaled is true.
+  void FinishChangingBeyondAddr(EepromAddrT new_beyond_addr, uint32_t crc,
+                                bool journaled);
+
+  // Starts an asynchronous commit (see EepromTlvAsyncWriter) by enqueuing in
+  // queue the writes of a new entry, ordered so that the EEPROM is valid
+  // whenever they might be interrupted. On success, the transaction remains
+  // active, and entry_addr, beyond_addr and crc are set to the values with
+  // which FinishAsyncCommit must be called once the writes have completed.
+  Status StartAsyncCommit(EepromTag tag, const uint8_t* data,
+                          size_t data_length, EepromWriteQueueBase& queue,
+                          EepromAddrT& entry_addr, EepromAddrT& beyond_addr,
+                          uint32_t& crc);
+
+  // Ends the transaction started by StartAsyncCommit, and updates the index, if
+  // any. Returns the tag of the committed entry.
+  EepromTag FinishAsyncCommit(EepromAddrT entry_addr, EepromAddrT beyond_addr,
+                              uint32_t crc);
+
+  // Starts a batch (see EepromTlvBatch) by preventing other modifications, and
+  // sets first_entry_addr to the address at which the entries of the batch are
+  // to be staged. First compacts the entries (see CompactToMakeRoom) if there
+  // isn't room for an entry of minimum_length before the journal.
+  Status StartBatch(BlockLengthT minimum_length, EepromAddrT& first_entry_addr);
+
+  // Updates target_region to represent the space into which the data of a
+  // staged entry at entry_addr can be written; it will have a length of at
+  // least minimum_length. The staged entries must end before the journal.
+  Status StartBatchEntry(EepromTag tag, BlockLengthT minimum_length,
+                         EepromAddrT entry_addr, EepromRegion& target_region);
+
+  // Writes the tag and length of the staged entry at entry_addr.
+  void FinishBatchEntry(EepromAddrT entry_addr, EepromTag tag,
+                        BlockLengthT data_length);
+
+  // Commits the staged entries from first_entry_addr to beyond_addr by writing
+  // the CRC and beyond address, after recording them in the journal. Then marks
+  // older entries with the same tags as unused.
+  Status CommitBatch(EepromAddrT first_entry_addr, EepromAddrT beyond_addr);
+
+  // Ends a batch without committing the staged entries.
+  void AbortBatch();
+
+  // Compacts the entries one at a time (as CompactOnce does, so that each step
+  // is journaled), until there are at least size bytes between the beyond
+  // address and limit_addr. Moves at most a few hundred bytes, so as to bound
+  // the time taken; returns ResourceExhausted if that isn't enough.
+  Status CompactToMakeRoom(EepromAddrT limit_addr, EepromAddrT size);
+
+  // Moves the live entry at entry_addr down to hole_addr, the start of the run
+  // of unused entries immediately before it, which must be at least as large
+  // as the entry; the space left after the moved entry becomes unused entries.
+  // First records the move in a journal in the free space at the end of the
+  // EEPROM, so that the move can be completed by RecoverInterruptedCompaction
+  // after a power loss.
+  Status MoveEntryDown(EepromAddrT hole_addr, EepromAddrT entry_addr,
+                       EepromAddrT beyond_addr);
+
+  // Performs the remaining phases of the move recorded in journal, updating
+  // the journal (in RAM and in the EEPROM) as it goes.
+  Status FinishMoveEntryDown(uint8_t* journal, EepromAddrT beyond_addr);
+
+  // Returns true if there is a later entry with the same tag as the entry at
+  // entry_addr.
+  StatusOr<bool> HasNewerEntry(EepromAddrT entry_addr) const;
+
+  // Appends a copy of the entry at entry_addr, which marks the original entry
+  // as unused. Used when an entry is larger than the unused space before it.
+  Status CopyEntryToEnd(EepromAddrT entry_addr);
+
+  // Writes the headers of unused entries which together fill length bytes,
+  // starting at addr.
+  void WriteUnusedEntries(EepromAddrT addr, EepromAddrT length);
+
+  // Fills in journal, and writes it to the EEPROM. Returns ResourceExhausted if
+  // the journal would overlap the entries.
+  Status WriteJournal(uint8_t* journal, EepromAddrT hole_addr,
+                      EepromAddrT entry_addr, EepromAddrT beyond_addr,
+                      uint8_t phase, uint32_t new_crc);
+
+  // Fills in journal, without writing it to the EEPROM.
+  void FillJournal(uint8_t* journal, EepromAddrT hole_addr,
+                   EepromAddrT entry_addr, uint8_t phase,
+                   uint32_t new_crc) const;
+
+  // Marks the journal as no longer needed.
+  void ClearJournal();
+
+  // Returns the address of the journal.
+  EepromAddrT JournalAddr() const;
+
+  // If the EEPROM holds the journal of a move, truncation or batch commit,
+  // completes it (it was interrupted, or only the clearing of the journal was),
+  // and then clears the journal. Called before validating the entries, as an
+  // interrupted move may leave the chain of entries broken.
+  void RecoverInterruptedCompaction();
+
   EepromAddrT eeprom_length() const {
     return const_cast<EEPROMClass&>(*eeprom_).length();
   }
@@ -239,9 +480,89 @@ class EepromTlv {
   // compile.
   EEPROMClass* eeprom_;
 
+  // Optional index of the entries, owned by the caller of GetIfValid, etc.
+  EepromTlvIndexBase* index_{nullptr};
+
+  // The beyond address and CRC at which the entries were last known to be
+  // valid. Zero is never a valid beyond address, so represents "unknown".
+  // Mutable because Validate is const.
+  mutable EepromAddrT validated_beyond_addr_{0};
+  mutable uint32_t validated_crc_{0};
+
+  // Counts of the bytes written by this instance.
+  EepromStats stats_;
+
   bool transaction_is_active_{false};
 };
 
+// Iterates over the most recently written entry of each tag in a domain, in the
+// order in which the entries are stored. For example:
+//
+//    EepromTlvEntryIterator iter(tlv, MCU_DOMAIN(Foo));
+//    while (true) {
+//      MCU_ASSIGN_OR_RETURN(const bool found, iter.Next());
+//      if (!found) {
+//        break;
+//      }
+//      MCU_RETURN_IF_ERROR(LoadSetting(iter.tag(), iter.reader()));
+//    }
+//
+// A commit marks the older version of an entry as unused after writing the new
+// version, so an older version remains if that is interrupted (e.g. by a power
+// loss). To avoid searching ahead for a newer version of every entry, the first
+// call to Next walks the headers of the entries (i.e. without reading the data)
+// and records in a bitmap (32 bytes) the ids which appear more than once in the
+// domain; only for entries with those ids is a newer version searched for.
+//
+// As for EepromRegionReader, the iterator must not be used after any mutating
+// method of the EepromTlv has been called.
+class EepromTlvEntryIterator {
+ public:
+  EepromTlvEntryIterator(const EepromTlv& tlv, EepromDomain domain);
+
+  // Advances to the next entry, returning false if there are no more entries.
+  // Returns an error if the domain is reserved, or if the EEPROM is not
+  // properly formatted.
+  StatusOr<bool> Next();
+
+  // The tag of the current entry, and a reader for its data. Valid only after
+  // Next has returned true.
+  EepromTag tag() const { return EepromTag{domain_, id_}; }
+  EepromRegionReader& reader() { return reader_; }
+
+ private:
+  // Validates the EepromTlv, and finds the ids which have more than one entry.
+  Status Start();
+
+  // Returns true if there is an entry with the tag after the current one.
+  StatusOr<bool> HasNewerEntry(EepromTag tag) const;
+
+  const EepromTlv* tlv_;
+  EepromDomain domain_;
+  EepromRegionReader reader_;
+
+  // Ids of the domain with more than one entry.
+  BitSet<256> duplicated_ids_;
+
+  // The address of the entry after the current one, or zero before the first
+  // call to Next.
+  EepromAddrT next_entry_addr_;
+  EepromAddrT beyond_addr_;
+  uint8_t id_;
+};
+
+template <typename F>
+Status EepromTlv::ForEachEntry(const EepromDomain domain, F callback) const {
+  EepromTlvEntryIterator iter(*this, domain);
+  while (true) {
+    MCU_ASSIGN_OR_RETURN(const bool found, iter.Next());
+    if (!found) {
+      return OkStatus();
+    }
+    MCU_RETURN_IF_ERROR(callback(iter.tag(), iter.reader()));
+  }
+}
+
 }  // namespace mcucore
 
 #endif  // MCUCORE_SRC_EEPROM_EEPROM_TLV_H_
@@ -0,0 +1,52 @@
+#include "eeprom/eeprom_tlv_async_writer.h"
+
+#include "eeprom/eeprom_tag.h"
+#include "eeprom/eeprom_tlv.h"
+#include "eeprom/eeprom_write_queue.h"
+#include "log/log.h"
+#include "mcucore_platform.h"
+#include "status/status.h"
+#include "strings/progmem_string_data.h"
+
+namespace mcucore {
+
+EepromTlvAsyncWriter::EepromTlvAsyncWriter(EepromTlv& tlv,
+                                           EepromWriteQueueBase& queue)
+    : tlv_(&tlv),
+      queue_(&queue),
+      callback_(nullptr),
+      callback_arg_(nullptr),
+      entry_addr_(0),
+      beyond_addr_(0),
+      crc_(0) {}
+
+Status EepromTlvAsyncWriter::WriteEntry(const EepromTag tag,
+                                        const uint8_t* const data,
+                                        const size_t data_length,
+                                        const CommitCallback callback,
+                                        void* const callback_arg) {
+  if (entry_addr_ != 0) {
+    return FailedPreconditionError(MCU_PSV("Commit in progress"));
+  }
+  MCU_RETURN_IF_ERROR(tlv_->StartAsyncCommit(tag, data, data_length, *queue_,
+                                             entry_addr_, beyond_addr_, crc_));
+  callback_ = callback;
+  callback_arg_ = callback_arg;
+  return OkStatus();
+}
+
+bool EepromTlvAsyncWriter::Poll() {
+  if (entry_addr_ == 0) {
+    return true;
+  } else if (!queue_->idle()) {
+    return false;
+  }
+  const auto tag = tlv_->FinishAsyncCommit(entry_addr_, beyond_addr_, crc_);
+  entry_addr_ = 0;
+  if (callback_ != nullptr) {
+    callback_(tag, callback_arg_);
+  }
+  return true;
+}
+
+}  // namespace mcucore
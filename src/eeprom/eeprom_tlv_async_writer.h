@@ -0,0 +1,84 @@
+#ifndef MCUCORE_SRC_EEPROM_EEPROM_TLV_ASYNC_WRITER_H_
+#define MCUCORE_SRC_EEPROM_EEPROM_TLV_ASYNC_WRITER_H_
+
+// EepromTlvAsyncWriter writes entries to an EepromTlv like
+// EepromTlv::WriteEntry, but rather than waiting for an entry to be written to
+// the EEPROM (about 3.4ms per byte on AVR), it enqueues the writes in an
+// EepromWriteQueue and returns once they're enqueued. For example:
+//
+//    EepromWriteQueue<64> write_queue;
+//    EepromTlvAsyncWriter async_writer(tlv, write_queue);
+//    ...
+//    MCU_RETURN_IF_ERROR(async_writer.WriteEntry(tag, data, size));
+//    ...
+//    void loop() {
+//      async_writer.Poll();  // Completes the commit once written.
+//      ...
+//    }
+//
+// The writes are ordered so that the EEPROM is valid whenever they might be
+// interrupted (e.g. by a power loss): the data, then the tag and length, then
+// a journal (as for EepromTlvBatch) recording the new beyond address and CRC,
+// then those fields, then the clearing of the journal, and finally the marking
+// of any older entry with the same tag as unused. If the EEPROM is nearly full,
+// with no room for the journal, there is a window while the beyond address and
+// CRC are written during which the EEPROM is invalid, as for EepromTlv.
+//
+// The state of the pending commit is held by this class, rather than by
+// EepromTlv, so that only sketches which write asynchronously pay for it.
+//
+// Author: james.synge@gmail.com
+
+#include "eeprom/eeprom_tag.h"
+#include "eeprom/eeprom_tlv.h"
+#include "eeprom/eeprom_write_queue.h"
+#include "mcucore_platform.h"
+#include "status/status.h"
+
+namespace mcucore {
+
+class EepromTlvAsyncWriter {
+ public:
+  // Called by Poll when the writes of the commit of the entry with the
+  // specified tag have completed.
+  using CommitCallback = void (*)(EepromTag tag, void* arg);
+
+  EepromTlvAsyncWriter(EepromTlv& tlv, EepromWriteQueueBase& queue);
+
+  EepromTlvAsyncWriter(const EepromTlvAsyncWriter&) = delete;
+  EepromTlvAsyncWriter& operator=(const EepromTlvAsyncWriter&) = delete;
+
+  // Enqueues the writes of an entry identified by `tag`, with `data_length`
+  // bytes of data. Returns ResourceExhausted, and enqueues nothing, if the
+  // queue doesn't have room for all of the writes.
+  //
+  // Until Poll reports that the commit has completed, the methods of the
+  // EepromTlv which modify the EEPROM fail (as if a transaction is active), as
+  // does WriteEntry. The EEPROM must not be read until then either (see
+  // EepromWriteQueueBase), so the methods of the EepromTlv which read entries
+  // must not be called; they DCHECK that there are no pending writes.
+  Status WriteEntry(EepromTag tag, const uint8_t* data, size_t data_length,
+                    CommitCallback callback = nullptr,
+                    void* callback_arg = nullptr);
+
+  // Returns true if there is no commit in progress. If the writes of the
+  // commit have all completed, finishes the commit (i.e. updates the index of
+  // the EepromTlv, if any), calls its callback, if any, and returns true.
+  bool Poll();
+
+ private:
+  EepromTlv* const tlv_;
+  EepromWriteQueueBase* const queue_;
+
+  // State of the pending commit, if any; entry_addr_ is zero if there is no
+  // such commit.
+  CommitCallback callback_;
+  void* callback_arg_;
+  EepromAddrT entry_addr_;
+  EepromAddrT beyond_addr_;
+  uint32_t crc_;
+};
+
+}  // namespace mcucore
+
+#endif  // MCUCORE_SRC_EEPROM_EEPROM_TLV_ASYNC_WRITER_H_
@@ -0,0 +1,80 @@
+#include "eeprom/eeprom_tlv_batch.h"
+
+#include "eeprom/eeprom_region.h"
+#include "eeprom/eeprom_tag.h"
+#include "eeprom/eeprom_tlv.h"
+#include "log/log.h"
+#include "mcucore_platform.h"
+#include "status/status.h"
+#include "strings/progmem_string_data.h"
+
+namespace mcucore {
+
+EepromTlvBatch::EepromTlvBatch(EepromTlv& tlv)
+    : tlv_(&tlv),
+      first_entry_addr_(0),
+      beyond_addr_(0),
+      entry_count_(0),
+      started_(false) {}
+
+EepromTlvBatch::~EepromTlvBatch() { Abort(); }
+
+Status EepromTlvBatch::WriteEntry(const EepromTag tag,
+                                  const uint8_t* const data,
+                                  const size_t data_length) {
+  if (data_length > EepromTlv::kMaxBlockLength) {
+    return InvalidArgumentError(MCU_PSV("Entry data too big"));
+  }
+  const auto length = static_cast<BlockLengthT>(data_length);
+  EepromRegion target_region;
+  MCU_RETURN_IF_ERROR(StartEntry(tag, length, target_region));
+  if (!target_region.WriteBytes(data, length)) {
+    return UnknownError(MCU_PSV("WriteBytes failed"));  // COV_NF_LINE
+  }
+  FinishEntry(tag, length);
+  return OkStatus();
+}
+
+Status EepromTlvBatch::Commit() {
+  if (!started_) {
+    return OkStatus();
+  }
+  started_ = false;
+  entry_count_ = 0;
+  if (beyond_addr_ == first_entry_addr_) {
+    tlv_->AbortBatch();
+    return OkStatus();
+  }
+  return tlv_->CommitBatch(first_entry_addr_, beyond_addr_);
+}
+
+void EepromTlvBatch::Abort() {
+  if (started_) {
+    MCU_VLOG_IF(2, entry_count_ > 0)
+        << MCU_PSD("Discarding staged entries: ") << entry_count_;
+    tlv_->AbortBatch();
+    started_ = false;
+    entry_count_ = 0;
+  }
+}
+
+Status EepromTlvBatch::StartEntry(const EepromTag tag,
+                                  const BlockLengthT minimum_length,
+                                  EepromRegion& target_region) {
+  if (!started_) {
+    MCU_RETURN_IF_ERROR(tlv_->StartBatch(minimum_length, first_entry_addr_));
+    beyond_addr_ = first_entry_addr_;
+    started_ = true;
+  }
+  return tlv_->StartBatchEntry(tag, minimum_length, beyond_addr_,
+                               target_region);
+}
+
+void EepromTlvBatch::FinishEntry(const EepromTag tag,
+                                 const BlockLengthT data_length) {
+  tlv_->FinishBatchEntry(beyond_addr_, tag, data_length);
+  beyond_addr_ += EepromTlv::kEntryHeaderSize + data_length;
+  ++entry_count_;
+}
+
+}  // namespace mcucore
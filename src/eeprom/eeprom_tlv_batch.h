@@ -0,0 +1,104 @@
+#ifndef MCUCORE_SRC_EEPROM_EEPROM_TLV_BATCH_H_
+#define MCUCORE_SRC_EEPROM_EEPROM_TLV_BATCH_H_
+
+// EepromTlvBatch writes several entries to an EepromTlv as a single commit,
+// rather than committing each entry separately (i.e. rewriting the beyond
+// address and the CRC for each). For example, when saving a page of settings:
+//
+//    EepromTlvBatch batch(tlv);
+//    MCU_RETURN_IF_ERROR(batch.WriteEntry(kBaudRateTag, &baud, sizeof baud));
+//    MCU_RETURN_IF_ERROR(batch.WriteEntryToCursor(kNameTag, 0, WriteName));
+//    ...
+//    MCU_RETURN_IF_ERROR(batch.Commit());
+//
+// The entries are staged after the existing entries, where they aren't yet
+// visible, and Commit writes the CRC and the beyond address just once. The
+// change is recorded first in the journal at the end of the EEPROM (see
+// EepromTlvCompactor), so that EepromTlv::GetIfValid can complete the commit if
+// it is interrupted (e.g. by a power loss); thus either all or none of the
+// entries are visible afterwards. The staged entries must end before the
+// journal, so that there is always room for it.
+//
+// While entries are staged, the methods of the EepromTlv which modify the
+// EEPROM fail (as if a transaction is active). If the batch is destroyed
+// without calling Commit, the staged entries are discarded. If there isn't room
+// for the first entry, the entries are first compacted a step at a time, as by
+// EepromTlvCompactor, moving at most a few hundred bytes; there is no
+// compaction for later entries, which instead fail with ResourceExhausted.
+//
+// Author: james.synge@gmail.com
+
+#include "eeprom/eeprom_region.h"
+#include "eeprom/eeprom_tag.h"
+#include "eeprom/eeprom_tlv.h"
+#include "mcucore_platform.h"
+#include "status/status.h"
+
+namespace mcucore {
+
+class EepromTlvBatch {
+ public:
+  using BlockLengthT = EepromTlv::BlockLengthT;
+
+  explicit EepromTlvBatch(EepromTlv& tlv);
+
+  // Discards any staged entries.
+  ~EepromTlvBatch();
+
+  EepromTlvBatch(const EepromTlvBatch&) = delete;
+  EepromTlvBatch& operator=(const EepromTlvBatch&) = delete;
+
+  // Stages `data_length` bytes as the value of an entry identified by `tag`.
+  Status WriteEntry(EepromTag tag, const uint8_t* data, size_t data_length);
+
+  // Stages an entry, as for EepromTlv::WriteEntryToCursor: calls
+  // writer_function with an EepromRegion instance, with a length of at least
+  // minimum_length, for writing the data of the entry. If the function returns
+  // an OK Status, the entry is staged with a length equal to the cursor of the
+  // region; otherwise the entry isn't staged, and the error is returned, but
+  // the previously staged entries remain staged.
+  template <typename WRITER, typename... ARGS>
+  Status WriteEntryToCursor(EepromTag tag, BlockLengthT minimum_length,
+                            WRITER writer_function, ARGS&&... writer_args) {
+    EepromRegion target_region;
+    MCU_RETURN_IF_ERROR(StartEntry(tag, minimum_length, target_region));
+    MCU_RETURN_IF_ERROR(writer_function(target_region, writer_args...));
+    FinishEntry(tag, static_cast<BlockLengthT>(target_region.cursor()));
+    return OkStatus();
+  }
+
+  // Commits the staged entries, if any, after which the batch is empty and may
+  // be reused. If an entry is staged more than once, the last one is the one
+  // committed.
+  Status Commit();
+
+  // Discards the staged entries, if any.
+  void Abort();
+
+  // Returns the number of staged entries.
+  uint8_t size() const { return entry_count_; }
+
+ private:
+  // Starts the batch if necessary, then updates target_region to represent the
+  // space into which the data of the next entry can be written.
+  Status StartEntry(EepromTag tag, BlockLengthT minimum_length,
+                    EepromRegion& target_region);
+
+  // Stages the entry whose data has been written.
+  void FinishEntry(EepromTag tag, BlockLengthT data_length);
+
+  EepromTlv* tlv_;
+
+  // The address of the first staged entry, and the address after the last.
+  EepromAddrT first_entry_addr_;
+  EepromAddrT beyond_addr_;
+
+  uint8_t entry_count_;
+
+  // True if the EepromTlv is reserved for staging the entries of this batch.
+  bool started_;
+};
+
+}  // namespace mcucore
+
+#endif  // MCUCORE_SRC_EEPROM_EEPROM_TLV_BATCH_H_
@@ -0,0 +1,32 @@
+#include "eeprom/eeprom_tlv_compactor.h"
+
+#include "eeprom/eeprom_block.h"
+#include "eeprom/eeprom_tlv.h"
+#include "mcucore_platform.h"
+#include "status/status_or.h"
+
+namespace mcucore {
+
+EepromTlvCompactor::EepromTlvCompactor(EepromTlv& tlv)
+    : tlv_(&tlv), bytes_moved_(0), done_(false) {}
+
+StatusOr<bool> EepromTlvCompactor::Step(const EepromAddrT max_bytes) {
+  constexpr EepromAddrT kMaxEntrySize =
+      EepromTlv::kEntryHeaderSize + EepromTlv::kMaxBlockLength;
+  EepromAddrT step_bytes = 0;
+  while (true) {
+    // The first move of a step isn't limited by max_bytes, so that every step
+    // makes progress.
+    const EepromAddrT limit =
+        step_bytes == 0 ? kMaxEntrySize : max_bytes - step_bytes;
+    EepromAddrT moved;
+    MCU_ASSIGN_OR_RETURN(done_, tlv_->CompactOnce(limit, moved));
+    bytes_moved_ += moved;
+    step_bytes += moved;
+    if (done_ || moved == 0 || step_bytes >= max_bytes) {
+      return done_;
+    }
+  }
+}
+
+}  // namespace mcucore
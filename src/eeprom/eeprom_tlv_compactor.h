@@ -0,0 +1,72 @@
+#ifndef MCUCORE_SRC_EEPROM_EEPROM_TLV_COMPACTOR_H_
+#define MCUCORE_SRC_EEPROM_EEPROM_TLV_COMPACTOR_H_
+
+// EepromTlvCompactor reclaims the space occupied by the unused entries of an
+// EepromTlv (i.e. deleted or superseded entries) incrementally, a few entries
+// per call of Step, so that compaction can be driven from loop() without
+// blocking it for the (potentially very long) time taken by
+// EepromTlv::ReclaimUnusedSpace. For example:
+//
+//    EepromTlvCompactor compactor(tlv);
+//    ...
+//    void loop() {
+//      if (!compaction_done) {
+//        // Move at most about 32 bytes per pass through the loop.
+//        auto status_or_done = compactor.Step(32);
+//        compaction_done = !status_or_done.ok() || status_or_done.value();
+//      }
+//      ...
+//    }
+//
+// Each step moves the first live entry which follows an unused entry into the
+// unused space before it, and then marks the space it vacated as unused; an
+// entry which is larger than the unused space before it is instead copied to
+// the end of the entries, using a normal commit. An older copy of an entry
+// which wasn't marked as unused (e.g. because a commit was interrupted) is
+// marked as unused rather than moved. Finally, the unused entries at the end
+// are removed. The entries are valid between steps, and a move or removal is
+// recorded in a 22 byte journal at the end of the EEPROM before it starts, so
+// that EepromTlv::GetIfValid can complete it if it is interrupted (e.g. by a
+// power loss). Copying an entry to the end is an ordinary commit, so has the
+// same brief window during which the CRC and the beyond address are being
+// written.
+//
+// The EepromTlv may be modified between steps; each step starts by finding the
+// first unused entry. A step fails with ResourceExhausted if there isn't room
+// at the end of the EEPROM for the journal or for the copied entry, in which
+// case EepromTlv::ReclaimUnusedSpace can be used instead.
+//
+// Author: james.synge@gmail.com
+
+#include "eeprom/eeprom_block.h"
+#include "eeprom/eeprom_tlv.h"
+#include "mcucore_platform.h"
+#include "status/status_or.h"
+
+namespace mcucore {
+
+class EepromTlvCompactor {
+ public:
+  explicit EepromTlvCompactor(EepromTlv& tlv);
+
+  // Moves entries until about max_bytes have been moved, or until compaction
+  // is complete. Always makes some progress, even if the next entry to be
+  // moved is larger than max_bytes; an entry is at most 258 bytes. Returns true
+  // if compaction is complete, i.e. there are no unused entries left.
+  StatusOr<bool> Step(EepromAddrT max_bytes);
+
+  // Returns true if the last step completed the compaction.
+  bool done() const { return done_; }
+
+  // Returns the number of bytes moved by all of the steps so far.
+  uint32_t bytes_moved() const { return bytes_moved_; }
+
+ private:
+  EepromTlv* tlv_;
+  uint32_t bytes_moved_;
+  bool done_;
+};
+
+}  // namespace mcucore
+
+#endif  // MCUCORE_SRC_EEPROM_EEPROM_TLV_COMPACTOR_H_
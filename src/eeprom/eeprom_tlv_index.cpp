@@ -0,0 +1,59 @@
+#include "eeprom/eeprom_tlv_index.h"
+
+#include "eeprom/eeprom_tag.h"
+#include "log/log.h"
+#include "mcucore_platform.h"
+
+namespace mcucore {
+
+EepromTlvIndexBase::EepromTlvIndexBase(Slot* slots, uint8_t capacity)
+    : slots_(slots), capacity_(capacity), size_(0), complete_(true) {}
+
+void EepromTlvIndexBase::Clear() {
+  size_ = 0;
+  complete_ = true;
+}
+
+EepromAddrT EepromTlvIndexBase::Find(const EepromTag tag) const {
+  const auto ndx = IndexOf(KeyOf(tag));
+  return ndx < size_ ? slots_[ndx].entry_addr : 0;
+}
+
+void EepromTlvIndexBase::Set(const EepromTag tag,
+                             const EepromAddrT entry_addr) {
+  MCU_DCHECK_NE(entry_addr, 0);
+  const auto key = KeyOf(tag);
+  auto ndx = IndexOf(key);
+  if (ndx >= size_) {
+    if (size_ >= capacity_) {
+      MCU_VLOG(2) << MCU_PSD("EepromTlvIndex full");
+      MarkIncomplete();
+      return;
+    }
+    ndx = size_++;
+    slots_[ndx].key = key;
+  }
+  slots_[ndx].entry_addr = entry_addr;
+}
+
+void EepromTlvIndexBase::Erase(const EepromTag tag) {
+  const auto ndx = IndexOf(KeyOf(tag));
+  if (ndx < size_) {
+    // Order doesn't matter, so move the last slot into the hole.
+    slots_[ndx] = slots_[--size_];
+  }
+}
+
+uint16_t EepromTlvIndexBase::KeyOf(const EepromTag tag) {
+  return (static_cast<uint16_t>(tag.domain.value()) << 8) | tag.id;
+}
+
+uint8_t EepromTlvIndexBase::IndexOf(const uint16_t key) const {
+  uint8_t ndx = 0;
+  while (ndx < size_ && slots_[ndx].key != key) {
+    ++ndx;
+  }
+  return ndx;
+}
+
+}  // namespace mcucore
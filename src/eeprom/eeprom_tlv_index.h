@@ -0,0 +1,101 @@
+#ifndef MCUCORE_SRC_EEPROM_EEPROM_TLV_INDEX_H_
+#define MCUCORE_SRC_EEPROM_EEPROM_TLV_INDEX_H_
+
+// EepromTlvIndex<N> is an optional, RAM resident index for an EepromTlv,
+// mapping up to N tags to the address of the newest entry with that tag.
+// Without an index, EepromTlv::FindEntry, ReadEntry and DeleteEntry must each
+// walk the entire chain of entries in EEPROM (the last entry with a tag is the
+// one that counts); with an index, the chain is walked once when the index is
+// built, and lookups then search (at most) N entries in RAM. For example:
+//
+//    EepromTlvIndex<32> tlv_index;
+//    auto tlv = EepromTlv::GetOrDie(EEPROM, &tlv_index);
+//    ... load the device's settings with tlv.ReadEntry(...) ...
+//
+// The index is built by EepromTlv::GetIfValid (and Get, etc.), and is kept up
+// to date by the EepromTlv methods which modify the EEPROM. The index must
+// outlive the EepromTlv (and all copies of it).
+//
+// If there are more tags in the EEPROM than will fit in the index (or the
+// EEPROM holds more than one live entry with the same tag), then the index is
+// marked as incomplete, and EepromTlv falls back to walking the chain when a
+// tag isn't found in the index.
+//
+// Each index entry takes 4 bytes of RAM.
+//
+// Author: james.synge@gmail.com
+
+#include "eeprom/eeprom_tag.h"
+#include "mcucore_platform.h"
+
+namespace mcucore {
+
+class EepromTlv;
+
+class EepromTlvIndexBase {
+ public:
+  EepromTlvIndexBase(const EepromTlvIndexBase&) = delete;
+  EepromTlvIndexBase& operator=(const EepromTlvIndexBase&) = delete;
+
+  // Number of tags in the index.
+  uint8_t size() const { return size_; }
+
+  // Maximum number of tags in the index.
+  uint8_t capacity() const { return capacity_; }
+
+  // Returns true if every live entry in the EEPROM is in the index, in which
+  // case a tag which is not in the index is not in the EEPROM.
+  bool complete() const { return complete_; }
+
+ protected:
+  struct Slot {
+    uint16_t key;
+    EepromAddrT entry_addr;
+  };
+
+  EepromTlvIndexBase(Slot* slots, uint8_t capacity);
+
+ private:
+  friend class EepromTlv;
+
+  // Empties the index, and marks it as complete, i.e. as representing an
+  // EepromTlv without any entries.
+  void Clear();
+
+  void MarkIncomplete() { complete_ = false; }
+
+  // Returns the address of the entry with the specified tag, or zero if the tag
+  // isn't in the index. Zero is never the address of an entry.
+  EepromAddrT Find(EepromTag tag) const;
+
+  // Records entry_addr as the address of the entry with the specified tag. If
+  // the tag is not already in the index and the index is full, the index is
+  // marked as incomplete instead.
+  void Set(EepromTag tag, EepromAddrT entry_addr);
+
+  // Removes the tag from the index, if present.
+  void Erase(EepromTag tag);
+
+  static uint16_t KeyOf(EepromTag tag);
+  uint8_t IndexOf(uint16_t key) const;
+
+  Slot* const slots_;
+  const uint8_t capacity_;
+  uint8_t size_;
+  bool complete_;
+};
+
+template <uint8_t N>
+class EepromTlvIndex : public EepromTlvIndexBase {
+ public:
+  static_assert(N > 0, "N must be greater than zero");
+
+  EepromTlvIndex() : EepromTlvIndexBase(slots_, N) {}
+
+ private:
+  Slot slots_[N];
+};
+
+}  // namespace mcucore
+
+#endif  // MCUCORE_SRC_EEPROM_EEPROM_TLV_INDEX_H_
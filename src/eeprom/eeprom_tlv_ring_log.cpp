@@ -0,0 +1,480 @@
+#include "eeprom/eeprom_tlv_ring_log.h"
+
+#include <string.h>
+
+#include "eeprom/eeprom_block.h"
+#include "eeprom/eeprom_region.h"
+#include "eeprom/eeprom_tag.h"
+#include "hash/crc32.h"
+#include "log/log.h"
+#include "mcucore_platform.h"
+#include "status/status.h"
+#include "status/status_code.h"
+#include "status/status_or.h"
+#include "strings/progmem_string_data.h"
+
+namespace mcucore {
+namespace {
+
+// Identifies a header slot as belonging to an EepromTlvRingLog ("RL").
+constexpr uint16_t kHeaderMagic = 0x4C52;
+
+// Offsets of the fields of a header slot.
+constexpr uint8_t kHeaderSeqOffset = 2;
+constexpr uint8_t kHeadAddrOffset = 6;
+constexpr uint8_t kHeadSeqOffset = 8;
+constexpr uint8_t kHeaderCrcOffset = 12;
+
+// Offsets of the fields of a record. The data follows the sequence number, and
+// is followed by the CRC.
+constexpr uint8_t kRecordDomainOffset = 0;
+constexpr uint8_t kRecordIdOffset = 1;
+constexpr uint8_t kRecordLengthOffset = 2;
+constexpr uint8_t kRecordSeqOffset = 3;
+constexpr uint8_t kRecordDataOffset = 7;
+
+// The tag of a wrap marker record, which is never the tag of an entry because
+// the domain is reserved.
+constexpr uint8_t kMarkerDomain = 255;
+constexpr uint8_t kMarkerId = 255;
+
+// Set in the sequence number field of a record which marks its entry as
+// deleted; the sequence numbers themselves are 31 bits.
+constexpr uint32_t kTombstoneBit = 0x80000000UL;
+constexpr uint32_t kSeqMask = 0x7FFFFFFFUL;
+
+// MakeRoom frees at least this fraction of the log at a time.
+constexpr EepromAddrT kGarbageCollectionDivisor = 4;
+
+uint32_t NextSeq(const uint32_t seq) { return (seq + 1) & kSeqMask; }
+
+template <typename T>
+void PutField(uint8_t* const buffer, const uint8_t offset, const T value) {
+  memcpy(buffer + offset, &value, sizeof value);
+}
+
+template <typename T>
+T GetField(const uint8_t* const buffer, const uint8_t offset) {
+  T value;
+  memcpy(&value, buffer + offset, sizeof value);
+  return value;
+}
+
+uint32_t ComputeBufferCrc(const uint8_t* const buffer, const uint8_t length) {
+  Crc32 crc;
+  for (uint8_t ndx = 0; ndx < length; ++ndx) {
+    crc.appendByte(buffer[ndx]);
+  }
+  return crc.value();
+}
+
+// The fields of a record which precede the data.
+struct RecordHeader {
+  bool IsMarker() const {
+    return domain == kMarkerDomain && id == kMarkerId;
+  }
+  bool IsTombstone() const { return (seq & kTombstoneBit) != 0; }
+  bool HasTag(const uint8_t other_domain, const uint8_t other_id) const {
+    return domain == other_domain && id == other_id;
+  }
+
+  uint8_t domain;
+  uint8_t id;
+  uint8_t length;
+  uint32_t seq;
+};
+
+RecordHeader ReadRecordHeader(EEPROMClass& eeprom, const EepromAddrT addr) {
+  uint8_t buffer[kRecordDataOffset];
+  EepromReadBlock(eeprom, addr, buffer, kRecordDataOffset);
+  RecordHeader header;
+  header.domain = buffer[kRecordDomainOffset];
+  header.id = buffer[kRecordIdOffset];
+  header.length = buffer[kRecordLengthOffset];
+  header.seq = GetField<uint32_t>(buffer, kRecordSeqOffset);
+  return header;
+}
+
+}  // namespace
+
+EepromTlvRingLog::EepromTlvRingLog(EEPROMClass& eeprom)
+    : eeprom_(&eeprom),
+      log_start_(kHeaderSlots * kHeaderSlotSize),
+      head_addr_(log_start_),
+      tail_addr_(log_start_),
+      max_record_size_(0),
+      head_seq_(0),
+      next_seq_(0),
+      header_seq_(0) {}
+
+StatusOr<EepromTlvRingLog> EepromTlvRingLog::GetIfValid(EEPROMClass& eeprom) {
+  EepromTlvRingLog instance(eeprom);
+  MCU_RETURN_IF_ERROR(instance.ReadHeader());
+  instance.FindTail();
+  return instance;
+}
+
+StatusOr<EepromTlvRingLog> EepromTlvRingLog::ClearAndInitializeEeprom(
+    EEPROMClass& eeprom) {
+  EepromTlvRingLog instance(eeprom);
+  if (instance.eeprom_length() <
+      instance.log_start_ + kRecordOverhead + kRecordOverhead) {
+    return InvalidArgumentError(MCU_PSV("EEPROM too small for log"));
+  }
+  uint32_t seq = 0;
+  if (instance.ReadHeader().ok()) {
+    instance.FindTail();
+    seq = instance.next_seq_;
+  }
+  // If there was no valid log, a record left over from an earlier one might
+  // have the first sequence number, so make sure that the first record isn't
+  // valid (a marker must have length zero).
+  const uint8_t invalid_record[] = {kMarkerDomain, kMarkerId, 255};
+  EepromWriteBlock(eeprom, instance.log_start_, invalid_record,
+                   sizeof invalid_record, &instance.stats_);
+  instance.tail_addr_ = instance.log_start_;
+  instance.max_record_size_ = 0;
+  instance.next_seq_ = seq;
+  instance.WriteHeader(instance.log_start_, seq);
+  return instance;
+}
+
+StatusOr<EepromTlvRingLog> EepromTlvRingLog::Get(EEPROMClass& eeprom) {
+  {
+    auto status_or_instance = GetIfValid(eeprom);
+    if (status_or_instance.ok()) {
+      return status_or_instance;
+    }
+  }
+  return ClearAndInitializeEeprom(eeprom);
+}
+
+Status EepromTlvRingLog::WriteEntry(const EepromTag tag,
+                                    const uint8_t* const data,
+                                    const size_t data_length) {
+  if (IsReservedDomain(tag.domain)) {
+    return InvalidArgumentError(MCU_PSV("Domain is reserved"));
+  }
+  if (data_length > kMaxBlockLength) {
+    return InvalidArgumentError(MCU_PSV("Entry data too big"));
+  }
+  const auto length = static_cast<BlockLengthT>(data_length);
+  MCU_RETURN_IF_ERROR(MakeRoom(kRecordOverhead + length));
+  AppendRecord(tag.domain.value(), tag.id, length, false, data, 0);
+  return OkStatus();
+}
+
+StatusOr<EepromTlvRingLog::BlockLengthT> EepromTlvRingLog::ReadEntry(
+    const EepromTag tag, uint8_t* const buffer,
+    const size_t buffer_length) const {
+  EepromRegionReader reader;
+  MCU_ASSIGN_OR_RETURN(reader, FindEntry(tag));
+  if (reader.length() > buffer_length) {
+    return FailedPreconditionError(MCU_PSV("Entry too big"));
+  }
+  EepromReadBlock(*eeprom_, reader.start_address(), buffer, reader.length());
+  return static_cast<BlockLengthT>(reader.length());
+}
+
+StatusOr<EepromRegionReader> EepromTlvRingLog::FindEntry(
+    const EepromTag tag) const {
+  const EepromAddrT addr = FindRecord(tag);
+  if (addr == 0) {
+    return Status(StatusCode::kNotFound);
+  }
+  const RecordHeader header = ReadRecordHeader(*eeprom_, addr);
+  return EepromRegionReader(*eeprom_, addr + kRecordDataOffset, header.length);
+}
+
+Status EepromTlvRingLog::DeleteEntry(const EepromTag tag) {
+  if (FindRecord(tag) == 0) {
+    return Status(StatusCode::kNotFound);
+  }
+  MCU_RETURN_IF_ERROR(MakeRoom(kRecordOverhead));
+  AppendRecord(tag.domain.value(), tag.id, 0, true, nullptr, 0);
+  return OkStatus();
+}
+
+Status EepromTlvRingLog::ReadHeader() {
+  bool found = false;
+  for (uint8_t slot = 0; slot < kHeaderSlots; ++slot) {
+    uint8_t buffer[kHeaderSlotSize];
+    EepromReadBlock(*eeprom_, slot * kHeaderSlotSize, buffer, kHeaderSlotSize);
+    if (GetField<uint16_t>(buffer, 0) != kHeaderMagic ||
+        GetField<uint32_t>(buffer, kHeaderCrcOffset) !=
+            ComputeBufferCrc(buffer, kHeaderCrcOffset)) {
+      continue;
+    }
+    const auto header_seq = GetField<uint32_t>(buffer, kHeaderSeqOffset);
+    const auto head_addr = GetField<EepromAddrT>(buffer, kHeadAddrOffset);
+    const auto head_seq = GetField<uint32_t>(buffer, kHeadSeqOffset);
+    if (head_addr < log_start_ || head_addr >= eeprom_length() ||
+        (head_seq & kTombstoneBit) != 0) {
+      MCU_VLOG(2) << MCU_PSD("Invalid ring log header") << MCU_NAME_VAL(slot);
+      continue;
+    }
+    if (found && header_seq <= header_seq_) {
+      continue;
+    }
+    found = true;
+    header_seq_ = header_seq;
+    head_addr_ = head_addr;
+    head_seq_ = head_seq;
+  }
+  if (!found) {
+    return NotFoundError(MCU_PSV("No valid ring log header"));
+  }
+  return OkStatus();
+}
+
+void EepromTlvRingLog::WriteHeader(const EepromAddrT head_addr,
+                                   const uint32_t head_seq) {
+  const uint32_t header_seq = header_seq_ + 1;
+  uint8_t buffer[kHeaderSlotSize];
+  PutField(buffer, 0, kHeaderMagic);
+  PutField(buffer, kHeaderSeqOffset, header_seq);
+  PutField(buffer, kHeadAddrOffset, head_addr);
+  PutField(buffer, kHeadSeqOffset, head_seq);
+  PutField(buffer, kHeaderCrcOffset,
+           ComputeBufferCrc(buffer, kHeaderCrcOffset));
+  const EepromAddrT slot_addr = (header_seq % kHeaderSlots) * kHeaderSlotSize;
+  EepromWriteBlock(*eeprom_, slot_addr, buffer, kHeaderSlotSize, &stats_);
+  header_seq_ = header_seq;
+  head_addr_ = head_addr;
+  head_seq_ = head_seq;
+}
+
+void EepromTlvRingLog::FindTail() {
+  EepromAddrT addr = head_addr_;
+  uint32_t seq = head_seq_;
+  while (IsValidRecord(addr, seq)) {
+    NoteRecordSize(kRecordOverhead + ReadRecordHeader(*eeprom_, addr).length);
+    addr = NextRecordAddr(addr);
+    seq = NextSeq(seq);
+  }
+  tail_addr_ = addr;
+  next_seq_ = seq;
+  MCU_VLOG(3) << MCU_NAME_VAL(head_addr_) << MCU_NAME_VAL(tail_addr_)
+              << MCU_NAME_VAL(record_count());
+}
+
+bool EepromTlvRingLog::IsValidRecord(const EepromAddrT addr,
+                                     const uint32_t seq) const {
+  if (addr < log_start_ || eeprom_length() - addr < kRecordOverhead) {
+    return false;
+  }
+  const RecordHeader header = ReadRecordHeader(*eeprom_, addr);
+  if ((header.seq & kSeqMask) != seq ||
+      (header.IsMarker() && header.length != 0) ||
+      eeprom_length() - addr < kRecordOverhead + header.length) {
+    return false;
+  }
+  uint32_t crc;
+  EepromReadBlock(*eeprom_, addr + kRecordDataOffset + header.length,
+                  reinterpret_cast<uint8_t*>(&crc), sizeof crc);
+  return crc == ComputeRecordCrc(addr, header.length);
+}
+
+EepromAddrT EepromTlvRingLog::RecordAddr(const EepromAddrT addr) const {
+  if (eeprom_length() - addr < kRecordOverhead) {
+    return log_start_;
+  }
+  return addr;
+}
+
+EepromAddrT EepromTlvRingLog::NextRecordAddr(const EepromAddrT addr) const {
+  const RecordHeader header = ReadRecordHeader(*eeprom_, addr);
+  if (header.IsMarker()) {
+    return log_start_;
+  }
+  return RecordAddr(addr + kRecordOverhead + header.length);
+}
+
+template <typename F>
+void EepromTlvRingLog::ForEachRecord(F func) const {
+  EepromAddrT addr = head_addr_;
+  for (uint32_t seq = head_seq_; seq != next_seq_; seq = NextSeq(seq)) {
+    func(addr, seq);
+    addr = NextRecordAddr(addr);
+  }
+}
+
+bool EepromTlvRingLog::IsLive(EepromAddrT addr, uint32_t seq) const {
+  const RecordHeader header = ReadRecordHeader(*eeprom_, addr);
+  if (header.IsMarker() || header.IsTombstone()) {
+    return false;
+  }
+  for (seq = NextSeq(seq); seq != next_seq_; seq = NextSeq(seq)) {
+    addr = NextRecordAddr(addr);
+    if (ReadRecordHeader(*eeprom_, addr).HasTag(header.domain, header.id)) {
+      return false;
+    }
+  }
+  return true;
+}
+
+EepromAddrT EepromTlvRingLog::RequiredSpace(
+    const EepromAddrT record_size) const {
+  return record_size +
+         (record_size > max_record_size_ ? record_size : max_record_size_);
+}
+
+void EepromTlvRingLog::NoteRecordSize(const EepromAddrT record_size) {
+  if (max_record_size_ < record_size) {
+    max_record_size_ = record_size;
+  }
+}
+
+bool EepromTlvRingLog::CanAppend(const EepromAddrT record_size,
+                                 const EepromAddrT head_addr,
+                                 const uint32_t head_seq) const {
+  const EepromAddrT addr = tail_addr_;
+  if (eeprom_length() - addr >= record_size) {
+    return IsFree(addr, addr + record_size, head_addr, head_seq);
+  }
+  // The record must follow a wrap marker, and mustn't overwrite it.
+  return log_start_ + record_size <= addr &&
+         IsFree(addr, addr + kRecordOverhead, head_addr, head_seq) &&
+         IsFree(log_start_, log_start_ + record_size, head_addr, head_seq);
+}
+
+bool EepromTlvRingLog::IsFree(const EepromAddrT start, const EepromAddrT beyond,
+                              const EepromAddrT head_addr,
+                              const uint32_t head_seq) const {
+  if (head_seq == next_seq_) {
+    return true;
+  } else if (head_addr < tail_addr_) {
+    return beyond <= head_addr || start >= tail_addr_;
+  } else {
+    return start >= tail_addr_ && beyond <= head_addr;
+  }
+}
+
+Status EepromTlvRingLog::MakeRoom(const EepromAddrT record_size) {
+  if (CanAppend(RequiredSpace(record_size), head_addr_, head_seq_)) {
+    return OkStatus();
+  }
+  // Free more than is needed right now, so that the header is written only a
+  // few times per trip around the log, rather than before most appends.
+  EepromAddrT goal = (eeprom_length() - log_start_) / kGarbageCollectionDivisor;
+  if (goal < RequiredSpace(record_size)) {
+    goal = RequiredSpace(record_size);
+  }
+  // Records appended while making room needn't be considered again.
+  const uint32_t end_seq = next_seq_;
+  EepromAddrT addr = head_addr_;
+  uint32_t seq = head_seq_;
+  while (!CanAppend(goal, addr, seq)) {
+    if (seq == next_seq_ && tail_addr_ != log_start_) {
+      // The log is empty, so restart it at the start of the log, where there is
+      // the most room.
+      WriteHeader(log_start_, seq);
+      addr = tail_addr_ = log_start_;
+      continue;
+    }
+    if (seq == end_seq) {
+      break;
+    }
+    const RecordHeader header = ReadRecordHeader(*eeprom_, addr);
+    if (IsLive(addr, seq)) {
+      // The newest version of an entry must be copied to the tail before the
+      // head can be advanced past it. If the copy would overwrite records
+      // which have been passed over, but which are still in the log according
+      // to the header, then the header must be written first.
+      const EepromAddrT copy_size = kRecordOverhead + header.length;
+      if (!CanAppend(copy_size, head_addr_, head_seq_)) {
+        WriteHeader(addr, seq);
+        if (!CanAppend(copy_size, addr, seq)) {
+          break;
+        }
+      }
+      AppendRecord(header.domain, header.id, header.length, false, nullptr,
+                   addr + kRecordDataOffset);
+    }
+    addr = NextRecordAddr(addr);
+    seq = NextSeq(seq);
+  }
+  if (seq != head_seq_) {
+    WriteHeader(addr, seq);
+  }
+  max_record_size_ = 0;
+  ForEachRecord([this](const EepromAddrT record_addr, uint32_t) {
+    NoteRecordSize(kRecordOverhead +
+                   ReadRecordHeader(*eeprom_, record_addr).length);
+  });
+  if (!CanAppend(RequiredSpace(record_size), head_addr_, head_seq_)) {
+    return ResourceExhaustedError(MCU_PSV("Ring log is full"));
+  }
+  return OkStatus();
+}
+
+void EepromTlvRingLog::AppendRecord(const uint8_t domain, const uint8_t id,
+                                    const BlockLengthT data_length,
+                                    const bool tombstone,
+                                    const uint8_t* const data,
+                                    const EepromAddrT data_addr) {
+  const EepromAddrT record_size = kRecordOverhead + data_length;
+  MCU_DCHECK(CanAppend(record_size, head_addr_, head_seq_));
+  EepromAddrT addr = tail_addr_;
+  if (eeprom_length() - addr < record_size) {
+    WriteRecord(addr, kMarkerDomain, kMarkerId, 0, next_seq_, nullptr, 0);
+    next_seq_ = NextSeq(next_seq_);
+    addr = log_start_;
+  }
+  NoteRecordSize(record_size);
+  const uint32_t seq = tombstone ? (next_seq_ | kTombstoneBit) : next_seq_;
+  tail_addr_ =
+      RecordAddr(WriteRecord(addr, domain, id, data_length, seq, data,
+                             data_addr));
+  next_seq_ = NextSeq(next_seq_);
+}
+
+EepromAddrT EepromTlvRingLog::WriteRecord(const EepromAddrT addr,
+                                          const uint8_t domain,
+                                          const uint8_t id,
+                                          const BlockLengthT data_length,
+                                          const uint32_t seq,
+                                          const uint8_t* const data,
+                                          const EepromAddrT data_addr) {
+  uint8_t buffer[kRecordDataOffset];
+  buffer[kRecordDomainOffset] = domain;
+  buffer[kRecordIdOffset] = id;
+  buffer[kRecordLengthOffset] = data_length;
+  PutField(buffer, kRecordSeqOffset, seq);
+  EepromWriteBlock(*eeprom_, addr, buffer, kRecordDataOffset, &stats_);
+  const EepromAddrT data_start = addr + kRecordDataOffset;
+  if (data != nullptr) {
+    EepromWriteBlock(*eeprom_, data_start, data, data_length, &stats_);
+  } else if (data_length > 0) {
+    EepromMoveBlock(*eeprom_, data_addr, data_start, data_length, &stats_);
+  }
+  // Writing the CRC commits the record.
+  const uint32_t crc = ComputeRecordCrc(addr, data_length);
+  EepromWriteBlock(*eeprom_, data_start + data_length,
+                   reinterpret_cast<const uint8_t*>(&crc), sizeof crc,
+                   &stats_);
+  return data_start + data_length + sizeof crc;
+}
+
+uint32_t EepromTlvRingLog::ComputeRecordCrc(
+    const EepromAddrT addr, const BlockLengthT data_length) const {
+  Crc32 crc;
+  const EepromAddrT beyond = addr + kRecordDataOffset + data_length;
+  for (EepromAddrT ndx = addr; ndx < beyond; ++ndx) {
+    crc.appendByte(eeprom_->read(ndx));
+  }
+  return crc.value();
+}
+
+EepromAddrT EepromTlvRingLog::FindRecord(const EepromTag tag) const {
+  EepromAddrT found_addr = 0;
+  ForEachRecord([&](const EepromAddrT addr, uint32_t) {
+    const RecordHeader header = ReadRecordHeader(*eeprom_, addr);
+    if (header.HasTag(tag.domain.value(), tag.id)) {
+      found_addr = header.IsTombstone() ? 0 : addr;
+    }
+  });
+  return found_addr;
+}
+
+}  // namespace mcucore
@@ -0,0 +1,232 @@
+#ifndef MCUCORE_SRC_EEPROM_EEPROM_TLV_RING_LOG_H_
+#define MCUCORE_SRC_EEPROM_EEPROM_TLV_RING_LOG_H_
+
+// EepromTlvRingLog stores Tag-Length-Value entries in EEPROM, like EepromTlv,
+// but as a log of records which is appended to circularly, so that the writes
+// are spread across the whole of the EEPROM. This suits entries which are
+// updated frequently (e.g. a counter), which with EepromTlv would wear out the
+// fixed header (i.e. the beyond address and the CRC, rewritten by every
+// commit), and the start of the entries, to which compaction moves them back.
+//
+// Author: james.synge@gmail.com
+//
+// EEPROM LAYOUT
+//
+// 1) kHeaderSlots header slots, each of the format:
+//    a) Magic number, identifying the slot as a header of this class.
+//    b) Header sequence number, incremented each time the header is written.
+//    c) The address of the oldest record (the head of the log).
+//    d) The sequence number of the oldest record.
+//    e) The CRC-32 of the above fields.
+//    Each time the header is written, it is written to the slot after the one
+//    last written, and so the valid slot with the highest header sequence
+//    number holds the current header.
+// 2) The log, in the remainder of the EEPROM, containing records of the format:
+//    a) EepromTag (i.e. domain followed by id)
+//    b) Data length, of type BlockLengthT.
+//    c) Sequence number, one greater than that of the preceding record; the
+//       high bit is set if the record marks the entry as deleted.
+//    d) Data.
+//    e) The CRC-32 of the above fields.
+//    A record that doesn't fit before the end of the EEPROM is instead written
+//    at the start of the log, after a wrap marker record (which has a reserved
+//    tag) at the end of the log, unless there isn't room for even that.
+//
+// COMMITS
+//
+// A record is committed when its CRC has been written; the header doesn't need
+// to be written. At boot, GetIfValid reads the header slots to find the head,
+// and then follows the chain of valid records with consecutive sequence
+// numbers, which ends just before the first record that is incomplete (e.g.
+// because it was being written when the power was lost), or is left over from
+// a previous trip around the log.
+//
+// The header is written only when the head of the log is advanced, in order to
+// make room for new records. When the oldest record is the newest version of
+// its entry, it is first appended to the log again. The header is written
+// before the space it occupied is reused, so that the log remains valid if the
+// power is lost.
+//
+// WEAR
+//
+// Each byte of the log is written once per trip around the log, plus a few
+// times for the header, which is spread across the slots. For a log of L bytes
+// and records of R bytes, that is once per L/R commits.
+
+#include "eeprom/eeprom_block.h"
+#include "eeprom/eeprom_region.h"
+#include "eeprom/eeprom_tag.h"
+#include "mcucore_platform.h"
+#include "status/status.h"
+#include "status/status_or.h"
+
+namespace mcucore {
+
+class EepromTlvRingLog {
+ public:
+  using BlockLengthT = uint8_t;
+  static constexpr EepromAddrT kMaxBlockLength = 255;
+  static constexpr uint8_t kHeaderSlots = 4;
+  static constexpr EepromAddrT kHeaderSlotSize = 2 + 4 + 2 + 4 + 4;
+  // The size of a record, excluding its data.
+  static constexpr EepromAddrT kRecordOverhead = 2 + 1 + 4 + 4;
+
+  // Gets an instance of EepromTlvRingLog, if the EEPROM contains a valid
+  // header.
+  static StatusOr<EepromTlvRingLog> GetIfValid(EEPROMClass& eeprom);
+  static StatusOr<EepromTlvRingLog> GetIfValid() { return GetIfValid(EEPROM); }
+
+  // Formats the EEPROM as an empty log, and returns an instance. The sequence
+  // numbers of the new log follow those of the old log, if valid, so that its
+  // records can't be mistaken for those of the new log.
+  static StatusOr<EepromTlvRingLog> ClearAndInitializeEeprom(
+      EEPROMClass& eeprom);
+  static StatusOr<EepromTlvRingLog> ClearAndInitializeEeprom() {
+    return ClearAndInitializeEeprom(EEPROM);
+  }
+
+  // Gets an instance for the EEPROM. If already valid, does not modify the
+  // EEPROM; otherwise, uses ClearAndInitializeEeprom to create an empty log.
+  static StatusOr<EepromTlvRingLog> Get(EEPROMClass& eeprom);
+  static StatusOr<EepromTlvRingLog> Get() { return Get(EEPROM); }
+
+  // Write `data_length` bytes as the value of an entry identified by `tag`.
+  // Returns ResourceExhausted if there isn't room in the log for the newest
+  // version of every entry, plus the new record, plus a copy of the largest
+  // record (which is needed for advancing the head of the log).
+  Status WriteEntry(EepromTag tag, const uint8_t* data, size_t data_length);
+
+  // Copy the value of the entry identified by `tag` into `buffer`, if the entry
+  // length is less than or equal to `buffer_length`. If successful, returns the
+  // number of bytes copied; if too long, returns FailedPrecondition; if not
+  // found, returns NotFound.
+  StatusOr<BlockLengthT> ReadEntry(EepromTag tag, uint8_t* buffer,
+                                   size_t buffer_length) const;
+
+  // Returns an EepromRegionReader for reading the data of the most recently
+  // written entry with the specified tag, or NotFound if there is no such
+  // entry. The reader must not be used after the log has been modified.
+  StatusOr<EepromRegionReader> FindEntry(EepromTag tag) const;
+
+  // Deletes the entry with the specified tag, by appending a record which marks
+  // it as deleted. Returns NotFound if there is no such entry.
+  Status DeleteEntry(EepromTag tag);
+
+  // Returns the number of records in the log, including superseded ones.
+  uint32_t record_count() const { return next_seq_ - head_seq_; }
+
+  // Returns the counts of the bytes written and skipped (because they were
+  // unchanged) by this instance.
+  const EepromStats& stats() const { return stats_; }
+  void ResetStats() { stats_ = EepromStats(); }
+
+ private:
+  explicit EepromTlvRingLog(EEPROMClass& eeprom);
+
+  // Reads the header slots, and sets the head of the log from the valid one
+  // with the highest header sequence number. Returns NotFound if there is none.
+  Status ReadHeader();
+
+  // Writes the header (to the slot after the last one written), recording that
+  // the log starts with the record at head_addr, with sequence number head_seq.
+  void WriteHeader(EepromAddrT head_addr, uint32_t head_seq);
+
+  // Follows the chain of valid records from the head, setting the tail.
+  void FindTail();
+
+  // Returns true if there is a valid record at addr with sequence number seq,
+  // ignoring the tombstone bit.
+  bool IsValidRecord(EepromAddrT addr, uint32_t seq) const;
+
+  // Returns addr, or the start of the log if there isn't room for a record at
+  // addr.
+  EepromAddrT RecordAddr(EepromAddrT addr) const;
+
+  // Returns the address after the record at addr, i.e. the start of the log if
+  // the record is a wrap marker.
+  EepromAddrT NextRecordAddr(EepromAddrT addr) const;
+
+  // Calls func(addr, seq) for each record from the head to the tail.
+  template <typename F>
+  void ForEachRecord(F func) const;
+
+  // Returns true if the record at addr (with sequence number seq) is the newest
+  // version of an entry which hasn't been deleted.
+  bool IsLive(EepromAddrT addr, uint32_t seq) const;
+
+  // Returns the space needed to append a new record of record_size bytes, which
+  // includes room for copying the largest record, so that the head of the log
+  // can always be advanced.
+  EepromAddrT RequiredSpace(EepromAddrT record_size) const;
+
+  // Updates max_record_size_ to account for a record of record_size bytes.
+  void NoteRecordSize(EepromAddrT record_size);
+
+  // Returns true if a record of record_size bytes can be appended without
+  // overwriting any record from the one at head_addr onwards, whose sequence
+  // number is head_seq.
+  bool CanAppend(EepromAddrT record_size, EepromAddrT head_addr,
+                 uint32_t head_seq) const;
+
+  // Returns true if [start, beyond) doesn't overlap the records from the one at
+  // head_addr onwards.
+  bool IsFree(EepromAddrT start, EepromAddrT beyond, EepromAddrT head_addr,
+              uint32_t head_seq) const;
+
+  // Advances the head of the log, copying records which are live to the tail,
+  // until a record of record_size bytes can be appended. Once started, it
+  // continues until a quarter of the log is free (if possible), so that the
+  // header is written only a few times per trip around the log.
+  Status MakeRoom(EepromAddrT record_size);
+
+  // Appends a record, which must fit (see CanAppend). The data is copied from
+  // data, if not null, else from the EEPROM at data_addr.
+  void AppendRecord(uint8_t domain, uint8_t id, BlockLengthT data_length,
+                    bool tombstone, const uint8_t* data, EepromAddrT data_addr);
+
+  // Writes a record at addr, and returns the address after it.
+  EepromAddrT WriteRecord(EepromAddrT addr, uint8_t domain, uint8_t id,
+                          BlockLengthT data_length, uint32_t seq,
+                          const uint8_t* data, EepromAddrT data_addr);
+
+  // Returns the CRC of the record at addr, excluding its CRC field.
+  uint32_t ComputeRecordCrc(EepromAddrT addr, BlockLengthT data_length) const;
+
+  // Returns the address of the newest record of the entry with the tag, or
+  // zero if not found (or deleted).
+  EepromAddrT FindRecord(EepromTag tag) const;
+
+  EepromAddrT eeprom_length() const {
+    return const_cast<EEPROMClass&>(*eeprom_).length();
+  }
+
+  // We use a ptr rather than a ref here to allow copy and move assignment to
+  // compile.
+  EEPROMClass* eeprom_;
+
+  // The start of the log, just after the header slots.
+  EepromAddrT log_start_;
+
+  // The head of the log (as recorded in the header), and the address after the
+  // last record (the tail).
+  EepromAddrT head_addr_;
+  EepromAddrT tail_addr_;
+
+  // The size of the largest record in the log.
+  EepromAddrT max_record_size_;
+
+  // The sequence numbers of the record at the head, and of the next record to
+  // be appended; equal if the log is empty.
+  uint32_t head_seq_;
+  uint32_t next_seq_;
+
+  // The header sequence number of the current header.
+  uint32_t header_seq_;
+
+  // Counts of the bytes written by this instance.
+  EepromStats stats_;
+};
+
+}  // namespace mcucore
+
+#endif  // MCUCORE_SRC_EEPROM_EEPROM_TLV_RING_LOG_H_
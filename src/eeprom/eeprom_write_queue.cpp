@@ -0,0 +1,205 @@
+#include "eeprom/eeprom_write_queue.h"
+
+#include "eeprom/eeprom_block.h"
+#include "log/log.h"
+#include "mcucore_platform.h"
+
+#ifdef ARDUINO_ARCH_AVR
+#include <avr/interrupt.h>
+#include <avr/io.h>
+#endif
+
+namespace mcucore {
+namespace {
+
+// The queue with pending writes, if any.
+EepromWriteQueueBase* volatile active_queue = nullptr;
+
+// Disables interrupts for the lifetime of the instance, so that the ISR can't
+// observe a partially updated queue.
+class InterruptsDisabled {
+ public:
+#ifdef ARDUINO_ARCH_AVR
+  InterruptsDisabled() : sreg_(SREG) { cli(); }
+  ~InterruptsDisabled() { SREG = sreg_; }
+
+ private:
+  const uint8_t sreg_;
+#else
+  // There are no interrupts to disable.
+  InterruptsDisabled() {}
+  ~InterruptsDisabled() {}
+#endif
+};
+
+#ifdef ARDUINO_ARCH_AVR
+
+// Starts writing value to addr, unless already equal to value. Must only be
+// called when the EEPROM isn't busy (i.e. EEPE is clear), as is the case in
+// the EE_READY ISR. Leaves the EE_READY interrupt enabled, so that the ISR is
+// called again once the write has completed.
+void StartByteWrite(EEPROMClass&, const EepromAddrT addr, const uint8_t value,
+                    EepromStats& stats) {
+  EEAR = addr;
+  EECR |= _BV(EERE);
+  const uint8_t old_value = EEDR;
+  if (old_value == value) {
+    ++stats.skips;
+    return;
+  }
+  ++stats.writes;
+  const bool erase = (old_value & value) != value;
+  if (erase) {
+    ++stats.erases;
+  }
+  EEDR = value;
+  // Erase and write (EEPM = 0b00), or just write (EEPM = 0b10) when no bit
+  // needs to change from 0 to 1, which takes about half as long.
+  EECR = (erase ? 0 : _BV(EEPM1)) | _BV(EERIE);
+  EECR |= _BV(EEMPE);
+  EECR |= _BV(EEPE);
+}
+
+void EnableReadyInterrupt() { EECR |= _BV(EERIE); }
+void DisableReadyInterrupt() { EECR &= ~_BV(EERIE); }
+
+#else  // !ARDUINO_ARCH_AVR
+
+void StartByteWrite(EEPROMClass& eeprom, const EepromAddrT addr,
+                    const uint8_t value, EepromStats& stats) {
+  EepromUpdateByte(eeprom, addr, value, &stats);
+}
+
+void EnableReadyInterrupt() {}
+void DisableReadyInterrupt() {}
+
+#endif  // ARDUINO_ARCH_AVR
+
+}  // namespace
+
+#ifdef ARDUINO_ARCH_AVR
+ISR(EE_READY_vect) {  // NOLINT
+  EepromWriteQueueBase* const queue = active_queue;
+  if (queue == nullptr) {
+    DisableReadyInterrupt();
+  } else {
+    queue->Tick();
+  }
+}
+#endif  // ARDUINO_ARCH_AVR
+
+EepromWriteQueueBase::EepromWriteQueueBase(EEPROMClass& eeprom, Run* runs,
+                                           uint8_t run_capacity, uint8_t* data,
+                                           EepromAddrT data_capacity)
+    : eeprom_(&eeprom),
+      runs_(runs),
+      data_(data),
+      data_capacity_(data_capacity),
+      run_capacity_(run_capacity),
+      run_head_(0),
+      run_offset_(0),
+      data_head_(0),
+      run_tail_(0),
+      data_tail_(0) {}
+
+EepromWriteQueueBase::~EepromWriteQueueBase() {
+  MCU_DCHECK(idle()) << MCU_PSD("Destroying busy queue");
+  InterruptsDisabled guard;
+  if (active_queue == this) {
+    Reset();
+  }
+}
+
+bool EepromWriteQueueBase::idle() const {
+  InterruptsDisabled guard;
+  return run_head_ == run_tail_;
+}
+
+bool EepromWriteQueueBase::CanEnqueue(const EepromAddrT length,
+                                      const uint8_t runs) const {
+  InterruptsDisabled guard;
+  if (active_queue != nullptr && active_queue != this) {
+    return false;
+  }
+  return runs <= run_capacity_ - run_tail_ &&
+         length <= data_capacity_ - data_tail_;
+}
+
+bool EepromWriteQueueBase::Enqueue(const EepromAddrT addr,
+                                   const uint8_t* const data,
+                                   const EepromAddrT length) {
+  if (length == 0) {
+    return true;
+  }
+  MCU_DCHECK_LE(length, 255) << MCU_PSD("Run too long");
+  MCU_DCHECK_LE(addr + length, eeprom_->length())
+      << MCU_PSD("Run extends beyond EEPROM");
+  if (length > 255) {
+    return false;
+  }
+  InterruptsDisabled guard;
+  if (!CanEnqueue(length)) {
+    MCU_VLOG(3) << MCU_PSD("EepromWriteQueue full") << MCU_NAME_VAL(length);
+    return false;
+  }
+  Run& run = runs_[run_tail_];
+  run.addr = addr;
+  run.length = static_cast<uint8_t>(length);
+  for (EepromAddrT ndx = 0; ndx < length; ++ndx) {
+    data_[data_tail_ + ndx] = data[ndx];
+  }
+  data_tail_ = data_tail_ + length;
+  run_tail_ = run_tail_ + 1;
+  active_queue = this;
+  EnableReadyInterrupt();
+  return true;
+}
+
+bool EepromWriteQueueBase::Tick() {
+  if (run_head_ == run_tail_) {
+    DisableReadyInterrupt();
+    return false;
+  }
+  const Run& run = runs_[run_head_];
+  StartByteWrite(*eeprom_, run.addr + run_offset_, data_[data_head_], stats_);
+  data_head_ = data_head_ + 1;
+  if (run_offset_ + 1 < run.length) {
+    run_offset_ = run_offset_ + 1;
+    return true;
+  }
+  run_offset_ = 0;
+  run_head_ = run_head_ + 1;
+  if (run_head_ != run_tail_) {
+    return true;
+  }
+  Reset();
+  return false;
+}
+
+void EepromWriteQueueBase::Flush() {
+#ifdef ARDUINO_ARCH_AVR
+  // The ISR does the work; interrupts must be enabled.
+  while (!idle()) {
+  }
+#else
+  while (Tick()) {
+  }
+#endif
+}
+
+bool EepromWriteQueueBase::HasPendingWritesTo(const EEPROMClass& eeprom) {
+  InterruptsDisabled guard;
+  return active_queue != nullptr && active_queue->eeprom_ == &eeprom;
+}
+
+void EepromWriteQueueBase::Reset() {
+  run_head_ = 0;
+  run_offset_ = 0;
+  data_head_ = 0;
+  run_tail_ = 0;
+  data_tail_ = 0;
+  active_queue = nullptr;
+  DisableReadyInterrupt();
+}
+
+}  // namespace mcucore
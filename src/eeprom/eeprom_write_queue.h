@@ -0,0 +1,133 @@
+#ifndef MCUCORE_SRC_EEPROM_EEPROM_WRITE_QUEUE_H_
+#define MCUCORE_SRC_EEPROM_EEPROM_WRITE_QUEUE_H_
+
+// EepromWriteQueue<kBytes, kRuns> buffers writes to EEPROM in RAM, so that the
+// caller doesn't have to wait (about 3.4ms per byte on AVR) for the writes to
+// complete. The writes are queued as runs of contiguous bytes, and are
+// performed in the order in which they were enqueued, one byte at a time; a
+// byte which already has the desired value isn't written.
+//
+// On AVR the queue is drained by the EE_READY interrupt service routine, so
+// loop() can continue running while the EEPROM is being written. On the host
+// (and on other platforms) there is no such interrupt; instead Tick() must be
+// called to write the next byte, which allows tests to deterministically
+// control when each byte is written. For example:
+//
+//    EepromWriteQueue<64> write_queue;
+//    EepromTlvAsyncWriter async_writer(tlv, write_queue);
+//    ...
+//    MCU_RETURN_IF_ERROR(async_writer.WriteEntry(tag, data, size));
+//    ...
+//    void loop() {
+//      async_writer.Poll();  // Completes the commit once written.
+//      ...
+//    }
+//
+// Only one queue at a time may have pending writes, as there is just one
+// EEPROM. The queue only reuses its buffers once all of the pending writes have
+// completed, i.e. once the queue is idle.
+//
+// The EEPROM must NOT be read while a queue has pending writes: on AVR the ISR
+// uses the same registers (EEAR, EEDR and EECR) as a read does, and may run in
+// the middle of a read, which would then return the wrong byte, or corrupt the
+// byte being written. HasPendingWritesTo allows readers to check (e.g. in a
+// DCHECK) that this rule is being followed.
+//
+// Each run takes 3 bytes of RAM, in addition to the bytes to be written.
+//
+// Author: james.synge@gmail.com
+
+#include "eeprom/eeprom_block.h"
+#include "mcucore_platform.h"
+
+namespace mcucore {
+
+class EepromWriteQueueBase {
+ public:
+  EepromWriteQueueBase(const EepromWriteQueueBase&) = delete;
+  EepromWriteQueueBase& operator=(const EepromWriteQueueBase&) = delete;
+
+  // Returns true if there are no pending writes.
+  bool idle() const;
+
+  // Returns true if `runs` runs, totalling `length` bytes, can currently be
+  // enqueued.
+  bool CanEnqueue(EepromAddrT length, uint8_t runs = 1) const;
+
+  // Appends a run of `length` bytes, to be written to EEPROM starting at addr.
+  // Returns false, and enqueues nothing, if there isn't room for the run, or if
+  // another queue has pending writes.
+  bool Enqueue(EepromAddrT addr, const uint8_t* data, EepromAddrT length);
+
+  // Writes (or skips, if unchanged) the next pending byte, if any. Returns true
+  // if there are more pending bytes. This is how the queue is drained on the
+  // host and on non-AVR platforms; on AVR it is called by the ISR.
+  bool Tick();
+
+  // Waits until all of the pending writes have completed.
+  void Flush();
+
+  // Returns true if some queue has pending writes to `eeprom`, in which case
+  // `eeprom` must not be read.
+  static bool HasPendingWritesTo(const EEPROMClass& eeprom);
+
+  // Counts of the bytes written and skipped by this queue. Only stable when the
+  // queue is idle.
+  const EepromStats& stats() const { return stats_; }
+
+ protected:
+  struct Run {
+    EepromAddrT addr;
+    uint8_t length;
+  };
+
+  EepromWriteQueueBase(EEPROMClass& eeprom, Run* runs, uint8_t run_capacity,
+                       uint8_t* data, EepromAddrT data_capacity);
+  ~EepromWriteQueueBase();
+
+ private:
+  // Marks the queue as empty, so that the buffers can be reused from the start.
+  void Reset();
+
+  EEPROMClass* const eeprom_;
+  Run* const runs_;
+  uint8_t* const data_;
+  const EepromAddrT data_capacity_;
+  const uint8_t run_capacity_;
+
+  // The runs_ in [run_head_, run_tail_) are pending, as are the data_ in
+  // [data_head_, data_tail_). run_offset_ is the number of bytes of the run at
+  // run_head_ which have been written. The head fields are modified by Tick,
+  // and hence by the ISR on AVR, as are all of them by Reset.
+  volatile uint8_t run_head_;
+  volatile uint8_t run_offset_;
+  volatile EepromAddrT data_head_;
+  volatile uint8_t run_tail_;
+  volatile EepromAddrT data_tail_;
+
+  EepromStats stats_;
+};
+
+// kBytes is the maximum number of bytes that can be pending, and kRuns is the
+// maximum number of runs. A commit by EepromTlvAsyncWriter::WriteEntry uses 5
+// runs (plus one for each old entry with the same tag), and 34 bytes more than
+// the size of the entry's data (plus 2 for each such old entry); if the EEPROM
+// doesn't have room for the journal of the commit, 2 fewer runs and 25 fewer
+// bytes.
+template <EepromAddrT kBytes, uint8_t kRuns = 6>
+class EepromWriteQueue : public EepromWriteQueueBase {
+ public:
+  static_assert(kBytes > 0, "kBytes must be greater than zero");
+  static_assert(kRuns > 0, "kRuns must be greater than zero");
+
+  explicit EepromWriteQueue(EEPROMClass& eeprom = EEPROM)
+      : EepromWriteQueueBase(eeprom, runs_, kRuns, data_, kBytes) {}
+
+ private:
+  Run runs_[kRuns];
+  uint8_t data_[kBytes];
+};
+
+}  // namespace mcucore
+
+#endif  // MCUCORE_SRC_EEPROM_EEPROM_WRITE_QUEUE_H_
@@ -0,0 +1,21 @@
+#include "eeprom/serial_map_io.h"
+
+#include "eeprom/eeprom_block.h"
+#include "eeprom/eeprom_region.h"
+#include "mcucore_platform.h"
+#include "status/status.h"
+#include "strings/progmem_string_data.h"
+
+namespace mcucore {
+namespace serial_map_io_internal {
+
+Status WriteSerializedEntries(EepromRegion& region, const uint8_t* const data,
+                              const size_t size) {
+  if (!region.WriteBytes(data, static_cast<EepromAddrT>(size))) {
+    return UnknownError(MCU_PSD("WriteBytes failed"));  // COV_NF_LINE
+  }
+  return OkStatus();
+}
+
+}  // namespace serial_map_io_internal
+}  // namespace mcucore
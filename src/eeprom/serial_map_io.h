@@ -0,0 +1,65 @@
+#ifndef MCUCORE_SRC_EEPROM_SERIAL_MAP_IO_H_
+#define MCUCORE_SRC_EEPROM_SERIAL_MAP_IO_H_
+
+// SaveSerialMap and LoadSerialMap save all of the entries of a SerialMap as the
+// value of a single EepromTlv entry, and load them back, so that saving a whole
+// map (e.g. a device's configuration) is one EepromTlv transaction with one CRC
+// update, rather than one per map entry.
+//
+// Author: james.synge@gmail.com
+
+#include "container/serial_map.h"
+#include "eeprom/eeprom_region.h"
+#include "eeprom/eeprom_tag.h"
+#include "eeprom/eeprom_tlv.h"
+#include "log/log.h"
+#include "mcucore_platform.h"
+#include "status/status.h"
+#include "status/status_or.h"
+#include "strings/progmem_string_data.h"
+
+namespace mcucore {
+namespace serial_map_io_internal {
+
+// Writes the serialized entries of a map to region.
+Status WriteSerializedEntries(EepromRegion& region, const uint8_t* data,
+                              size_t size);
+
+}  // namespace serial_map_io_internal
+
+// Writes all of the entries of serial_map to tlv as the value of a single entry
+// identified by tag. Fails if the entries occupy more than
+// EepromTlv::kMaxBlockLength bytes, or if the EepromTlv can't make room for
+// them.
+template <typename KEY, size_t SIZE, size_t INDEX_SIZE>
+Status SaveSerialMap(const SerialMap<KEY, SIZE, INDEX_SIZE>& serial_map,
+                     EepromTlv& tlv, const EepromTag tag) {
+  const size_t size = serial_map.serialized_size();
+  if (size > EepromTlv::kMaxBlockLength) {
+    MCU_VLOG(3) << MCU_PSD("Map too big to save") << MCU_NAME_VAL(size);
+    return ResourceExhaustedError(MCU_PSD("Map too big to save"));
+  }
+  return tlv.WriteEntryToCursor(
+      tag, static_cast<EepromTlv::BlockLengthT>(size),
+      serial_map_io_internal::WriteSerializedEntries,
+      serial_map.serialized_data(), size);
+}
+
+// Replaces the entries of serial_map with those saved by SaveSerialMap in the
+// entry of tlv identified by tag. The saved bytes are read directly into the
+// map, and then the chain of entries is validated (and the index rebuilt); if
+// the chain is not well formed, the map is left empty and an error is
+// returned.
+template <typename KEY, size_t SIZE, size_t INDEX_SIZE>
+Status LoadSerialMap(SerialMap<KEY, SIZE, INDEX_SIZE>& serial_map,
+                     const EepromTlv& tlv, const EepromTag tag) {
+  MCU_ASSIGN_OR_RETURN(auto reader, tlv.FindEntry(tag));
+  return serial_map.LoadSerialized(
+      reader.length(), [&reader](uint8_t* buffer, size_t length) {
+        return reader.ReadBytes(buffer, static_cast<EepromAddrT>(length));
+      });
+}
+
+}  // namespace mcucore
+
+#endif  // MCUCORE_SRC_EEPROM_SERIAL_MAP_IO_H_
@@ -36,6 +36,37 @@ class Fnv1a {
   uint32_t value_;
 };
 
+namespace fnv1a_internal {
+
+constexpr uint32_t kInitialValue = 2166136261UL;
+constexpr uint32_t kPrime = 0x01000193UL;  // 2^24 + 2^8 + 0x93
+
+// Matches the hack in Fnv1a::appendByte which avoids hashing to zero.
+constexpr uint32_t AvoidZero(uint32_t value, uint8_t v) {
+  return value == 0 ? (kInitialValue ^ v) : value;
+}
+
+constexpr uint32_t AppendByte(uint32_t value, uint8_t v) {
+  return AvoidZero(static_cast<uint32_t>((value ^ v) * kPrime), v);
+}
+
+}  // namespace fnv1a_internal
+
+// Returns the hash computed by Fnv1a after appending the `size` low-order bytes
+// of value, least significant byte first (i.e. the bytes of the value in memory
+// on a little-endian processor, such as the AVR). This is constexpr so that it
+// can be used to compute hashes at compile time.
+template <typename T>
+constexpr uint32_t Fnv1aHashOfBytes(
+    T value, uint8_t size,
+    uint32_t hash = fnv1a_internal::kInitialValue) {
+  return size == 0 ? hash
+                   : Fnv1aHashOfBytes(
+                         static_cast<T>(value >> 8), size - 1,
+                         fnv1a_internal::AppendByte(
+                             hash, static_cast<uint8_t>(value & 0xFF)));
+}
+
 }  // namespace mcucore
 
 #endif  // MCUCORE_SRC_HASH_FNV1A_H_
@@ -8,6 +8,7 @@
 #include "print/counting_print.h"
 #include "print/o_print_stream.h"
 #include "strings/progmem_string_view.h"
+#include "strings/utf8_validator.h"
 
 namespace mcucore {
 namespace {
@@ -50,20 +51,25 @@ void PrintCharJsonEscaped(Print& out, const char c) {
 // applied. Note that this does NOT add double quotes before and after the
 // output. This class also does NOT count the length of strings because the
 // callers don't need that, so we don't waste the time or space doing so.
+//
+// Multi-byte UTF-8 sequences are held back until complete, and then forwarded
+// unchanged; a sequence which is not valid UTF-8 is replaced by an escaped
+// U+FFFD REPLACEMENT CHARACTER.
 class PrintJsonEscaped : public Print {
  public:
-  explicit PrintJsonEscaped(Print& wrapped) : wrapped_(wrapped) {}
+  explicit PrintJsonEscaped(Print& wrapped)
+      : wrapped_(wrapped), pending_size_(0) {}
 
   // These are the two abstract virtual methods in Arduino's Print class. I'm
-  // treating the uint8_t 'b' as an ASCII char.
+  // treating the uint8_t 'b' as an ASCII char or a byte of a UTF-8 sequence.
   size_t write(uint8_t b) override {
-    PrintCharJsonEscaped(wrapped_, static_cast<char>(b));
+    WriteByte(b);
     return 1;  // Not necessarily correct.
   }
 
   size_t write(const uint8_t* buffer, size_t size) override {
     for (size_t ndx = 0; ndx < size; ++ndx) {
-      PrintCharJsonEscaped(wrapped_, static_cast<char>(buffer[ndx]));
+      WriteByte(buffer[ndx]);
     }
     return size;  // Not necessarily correct.
   }
@@ -71,14 +77,55 @@ class PrintJsonEscaped : public Print {
   // Export the other write methods.
   using Print::write;
 
+  // Replaces any incomplete UTF-8 sequence at the end of the string.
+  void FinishString() {
+    if (pending_size_ > 0) {
+      PrintReplacementChar();
+    }
+  }
+
  private:
+  void WriteByte(uint8_t b) {
+    if (pending_size_ == 0 && b < 0x80) {
+      PrintCharJsonEscaped(wrapped_, static_cast<char>(b));
+      return;
+    }
+    if (!utf8_validator_.FeedByte(b)) {
+      // b can't follow the pending bytes (if any). Replace them, then process
+      // b on its own.
+      const bool had_pending = pending_size_ > 0;
+      PrintReplacementChar();
+      if (had_pending) {
+        WriteByte(b);
+      }
+    } else if (utf8_validator_.IsComplete()) {
+      wrapped_.write(pending_, pending_size_);
+      wrapped_.write(b);
+      pending_size_ = 0;
+    } else {
+      pending_[pending_size_++] = b;
+    }
+  }
+
+  void PrintReplacementChar() {
+    MCU_VLOG(4) << MCU_PSD("Invalid UTF-8 sequence");
+    MCU_PSV("\\ufffd").printTo(wrapped_);
+    utf8_validator_.Reset();
+    pending_size_ = 0;
+  }
+
   Print& wrapped_;
+  Utf8Validator utf8_validator_;
+  // The leading bytes of an incomplete UTF-8 sequence.
+  uint8_t pending_[3];
+  uint8_t pending_size_;
 };
 
 void PrintJsonEscapedStringTo(const Printable& value, Print& raw_output) {
   PrintJsonEscaped out(raw_output);
   raw_output.print('"');
   value.printTo(out);
+  out.FinishString();
   raw_output.print('"');
 }
 
@@ -126,6 +126,13 @@ MillisT ElapsedMillis(MillisT start_time);
 #define MCU_HAS_FEATURE(x) 0
 #endif
 
+// Test for the has_builtin intrinsic offered by some compilers.
+#ifdef __has_builtin
+#define MCU_HAS_BUILTIN(x) __has_builtin(x)
+#else
+#define MCU_HAS_BUILTIN(x) 0
+#endif
+
 // MCU_HAVE_MEMORY_SANITIZER
 //
 // MemorySanitizer (MSan) is a detector of uninitialized reads. It consists of
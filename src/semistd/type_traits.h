@@ -511,6 +511,28 @@ struct enable_if<true, T> {
 template <bool B, class T = void>
 using enable_if_t = typename enable_if<B, T>::type;
 
+////////////////////////////////////////////////////////////////////////////////
+//
+// conditional<bool B, class T, class F>
+//
+// Provides member typedef type, which is defined as T if B is true, or as F if
+// B is false.
+//
+// Based on https://en.cppreference.com/w/cpp/types/conditional
+
+template <bool B, class T, class F>
+struct conditional {
+  typedef T type;
+};
+
+template <class T, class F>
+struct conditional<false, T, F> {
+  typedef F type;
+};
+
+template <bool B, class T, class F>
+using conditional_t = typename conditional<B, T, F>::type;
+
 ////////////////////////////////////////////////////////////////////////////////
 //
 // is_signed<typename T>
@@ -28,6 +28,53 @@ constexpr remove_reference_t<T>&& move(T&& t) {
   return static_cast<remove_reference_t<T>&&>(t);
 }
 
+// A compile-time sequence of integers, typically used for expanding a
+// parameter pack of indices (e.g. when initializing an array from a constexpr
+// function of the index).
+template <class T, T... Ints>
+struct integer_sequence {
+  using value_type = T;
+  static constexpr size_t size() { return sizeof...(Ints); }
+};
+
+template <size_t... Ints>
+using index_sequence = integer_sequence<size_t, Ints...>;
+
+namespace utility_internal {
+
+template <class Seq1, class Seq2>
+struct ConcatIndexSequences;
+
+template <size_t... I1, size_t... I2>
+struct ConcatIndexSequences<index_sequence<I1...>, index_sequence<I2...>> {
+  using type = index_sequence<I1..., (sizeof...(I1) + I2)...>;
+};
+
+// Produces index_sequence<0, ..., N-1> with a recursion depth of log2(N),
+// rather than N.
+template <size_t N>
+struct MakeIndexSequence {
+  using type = typename ConcatIndexSequences<
+      typename MakeIndexSequence<N / 2>::type,
+      typename MakeIndexSequence<N - N / 2>::type>::type;
+};
+
+template <>
+struct MakeIndexSequence<0> {
+  using type = index_sequence<>;
+};
+
+template <>
+struct MakeIndexSequence<1> {
+  using type = index_sequence<0>;
+};
+
+}  // namespace utility_internal
+
+template <size_t N>
+using make_index_sequence =
+    typename utility_internal::MakeIndexSequence<N>::type;
+
 }  // namespace mcucore
 
 #endif  // MCUCORE_SRC_SEMISTD_UTILITY_H_
@@ -0,0 +1,49 @@
+#include "strings/progmem_compressed_string.h"
+
+#include "mcucore_platform.h"
+#include "print/has_print_to.h"
+#include "print/print_misc.h"
+
+namespace mcucore {
+namespace progmem_compressed_string {
+
+// 'Define' the storage for the dictionary.
+constexpr char TokenDictionary::kTokens[] AVR_PROGMEM;
+
+namespace {
+
+// Prints the token with the specified index in the dictionary.
+size_t PrintToken(uint8_t index, Print& out) {
+  PGM_P token = TokenDictionary::kTokens;
+  while (index-- > 0) {
+    token += 1 + pgm_read_byte_near(token);
+  }
+  return PrintFlashStringOfLength(
+      reinterpret_cast<const __FlashStringHelper*>(token + 1),
+      pgm_read_byte_near(token), out);
+}
+
+}  // namespace
+}  // namespace progmem_compressed_string
+
+size_t ProgmemCompressedString::printTo(Print& out) const {
+  static_assert(has_print_to<decltype(*this)>{}, "has_print_to should be true");
+  using progmem_compressed_string::kEscapeCode;
+  using progmem_compressed_string::kFirstTokenCode;
+  size_t total = 0;
+  for (uint8_t offset = 0; offset < compressed_size_; ++offset) {
+    const uint8_t code = pgm_read_byte_near(ptr_ + offset);
+    if (code < kFirstTokenCode) {
+      total += out.write(code);
+    } else if (code == kEscapeCode) {
+      ++offset;
+      total += out.write(pgm_read_byte_near(ptr_ + offset));
+    } else {
+      total += progmem_compressed_string::PrintToken(code - kFirstTokenCode,
+                                                     out);
+    }
+  }
+  return total;
+}
+
+}  // namespace mcucore
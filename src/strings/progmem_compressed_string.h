@@ -0,0 +1,283 @@
+#ifndef MCUCORE_SRC_STRINGS_PROGMEM_COMPRESSED_STRING_H_
+#define MCUCORE_SRC_STRINGS_PROGMEM_COMPRESSED_STRING_H_
+
+// ProgmemCompressedString is a view of a string literal that is stored in
+// PROGMEM in a compressed form. It is intended for log and error messages,
+// which are printed rarely, but which can consume a large share of the flash of
+// a small part (e.g. the 32KB of an ATmega328).
+//
+// MCU_PSD_COMPRESSED(string_literal) compresses the literal at compile time,
+// replacing each run of characters that matches one of the tokens in a static
+// dictionary with a single byte. The dictionary is stored in PROGMEM just once,
+// and is shared by all compressed strings. The encoding of the compressed bytes
+// is:
+//
+//   0x00 - 0x7F: The ASCII character with that value.
+//   0x80 - 0xFE: Token number (byte - 0x80) in the dictionary.
+//   0xFF:        Escape; the following byte is a literal (non-ASCII) char.
+//
+// As with ProgmemStringData, the compressed bytes are stored in a static field
+// of a full specialization of a template, so multiple occurrences of the same
+// string literal are collapsed into a single array by the linker.
+//
+// ProgmemCompressedString::printTo decompresses directly into the Print
+// instance, without any buffer in RAM. This is slower than printing an
+// uncompressed string, so MCU_PSD_COMPRESSED should be used only for text that
+// isn't printed on a hot path.
+//
+// Author: james.synge@gmail.com
+
+#include "mcucore_platform.h"
+#include "strings/progmem_string_data.h"
+
+namespace mcucore {
+namespace progmem_compressed_string {
+
+// Encoding of the compressed bytes; see above.
+constexpr uint8_t kFirstTokenCode = 0x80;
+constexpr uint8_t kEscapeCode = 0xFF;
+constexpr int kMaxTokens = kEscapeCode - kFirstTokenCode;
+
+// The dictionary of tokens. Each token is stored as a length byte followed by
+// the chars of the token, and the list is terminated by a zero length (the NUL
+// at the end of the literal). When more than one token matches, the compressor
+// chooses the longest, so a token may be a prefix of another.
+//
+// WARNING: Changing the dictionary changes the encoding of every compressed
+// string, so the entire program must be recompiled after a change (this is the
+// normal case for a sketch).
+struct TokenDictionary {
+  static constexpr char kTokens[] AVR_PROGMEM =
+      "\x06" "EEPROM" "\x06" "Eeprom" "\x05" "Entry" "\x05" "entry"
+      "\x07" "Invalid" "\x07" "invalid" "\x08" "Expected" "\x08" "expected"
+      "\x07" "Missing" "\x07" "missing" "\x07" "Unknown" "\x07" "unknown"
+      "\x06" "Header" "\x06" "header" "\x07" "Request" "\x07" "request"
+      "\x05" "Value" "\x05" "value" "\x06" "Length" "\x06" "length"
+      "\x04" "Size" "\x04" "size" "\x06" "Failed" "\x06" "failed"
+      "\x05" "Error" "\x05" "error" "\x06" "Status" "\x06" "status"
+      "\x05" "Param" "\x05" "param" "\x04" "Path" "\x04" "path"
+      "\x04" "Name" "\x04" "name" "\x05" "Bytes" "\x05" "bytes"
+      "\x06" "Buffer" "\x06" "buffer" "\x06" "Offset" "\x06" "offset"
+      "\x07" "Address" "\x07" "address" "\x04" "Addr" "\x04" "addr"
+      "\x06" "Beyond" "\x06" "beyond" "\x03" "Crc" "\x03" "CRC"
+      "\x05" "Range" "\x05" "range" "\x04" "Data" "\x04" "data"
+      "\x05" "Start" "\x05" "start" "\x04" "Read" "\x04" "read"
+      "\x05" "Write" "\x05" "write" "\x06" "String" "\x06" "string"
+      "\x06" "Decode" "\x06" "decode" "\x05" "Token" "\x05" "token"
+      "\x05" "Query" "\x05" "query" "\x04" "HTTP" "\x04" "Http"
+      "\x06" "Method" "\x07" "Version" "\x06" "Should" "\x06" "should"
+      "\x05" "equal" "\x05" "Equal" "\x05" "empty" "\x05" "Empty"
+      "\x04" "MCU_" "\x05" "CHECK" "\x05" "check" "\x04" "Json"
+      "\x04" "JSON" "\x06" "Object" "\x05" "Array" "\x05" "array"
+      "\x04" "Time" "\x04" "time" "\x06" "Domain" "\x03" "Tag"
+      "\x03" "tag" "\x04" "full" "\x04" "Full" "\x05" "Timer"
+      "\x05" "timer" "\x07" "Counter" "\x07" "counter" "\x04" "Mode"
+      "\x04" "mode" "\x04" "true" "\x05" "false" "\x04" "null"
+      "\x03" "the" "\x03" "The" "\x04" "tion" "\x03" "ing" "\x03" "not"
+      "\x03" "Not" "\x03" "too" "\x03" "for" "\x03" "and" "\x03" "ent"
+      "\x03" "ver" "\x02" ", " "\x02" ": " "\x02" "ti" "\x02" "er"
+      "\x02" "re" "\x02" "in" "\x02" "on" "\x02" "an" "\x02" "ed"
+      "\x02" "es" "\x02" "or" "\x02" "at" "\x02" "st" "\x02" "en";
+};
+
+// Returns true if the first token_size chars of token match the start of text,
+// which has text_size chars.
+constexpr bool TokenMatches(const char* token, int token_size,
+                            const char* text, int text_size) {
+  return token_size == 0 ||
+         (text_size > 0 && *token == *text &&
+          TokenMatches(token + 1, token_size - 1, text + 1, text_size - 1));
+}
+
+// Returns (index << 8) | size for the longest token matching the start of text,
+// or 0 if there is no such token.
+constexpr int FindLongestToken(const char* text, int text_size,
+                               const char* token = TokenDictionary::kTokens,
+                               int index = 0, int best = 0) {
+  return *token == 0
+             ? best
+             : FindLongestToken(
+                   text, text_size, token + 1 + *token, index + 1,
+                   (*token > (best & 0xFF) &&
+                    TokenMatches(token + 1, *token, text, text_size))
+                       ? ((index << 8) | *token)
+                       : best);
+}
+
+// The kinds of steps taken by the compressor.
+enum class StepKind : uint8_t { kEnd, kToken, kAscii, kEscaped };
+
+// Marks the value returned by NextStep as describing a token.
+constexpr long kTokenStep = 0x10000;
+
+// Returns the value describing the next step taken when compressing text,
+// which has text_size chars: -1 at the end of the text, kTokenStep plus the
+// result of FindLongestToken if a token matches, else the unsigned value of the
+// first char.
+constexpr long NextStep(const char* text, int text_size) {
+  return text_size <= 0 ? -1
+         : FindLongestToken(text, text_size) != 0
+             ? kTokenStep + FindLongestToken(text, text_size)
+             : static_cast<long>(static_cast<uint8_t>(*text));
+}
+
+constexpr StepKind KindOfStep(long step) {
+  return step < 0            ? StepKind::kEnd
+         : step >= kTokenStep ? StepKind::kToken
+         : step < 0x80       ? StepKind::kAscii
+                             : StepKind::kEscaped;
+}
+
+// Returns the number of tokens in the dictionary.
+constexpr int CountTokens(const char* token = TokenDictionary::kTokens) {
+  return *token == 0 ? 0 : 1 + CountTokens(token + 1 + *token);
+}
+
+static_assert(CountTokens() <= kMaxTokens, "Too many tokens");
+
+// Full specializations of this template define static, constexpr storage for
+// compressed string literals. DecodedSize is the number of chars in the string
+// literal before compression.
+template <uint8_t DecodedSize, uint8_t... B>
+struct ProgmemCompressedStringData final {
+  // Each char outside of ASCII takes 2 bytes, so the compressed string can be
+  // longer than the string literal.
+  static_assert(sizeof...(B) <= 255,
+                "ProgmemCompressedString supports at most 255 compressed "
+                "bytes");
+
+  // There is always at least one element so that an empty string doesn't
+  // produce a zero length array.
+  static constexpr uint8_t const kData[1 + sizeof...(B)] AVR_PROGMEM = {B...,
+                                                                        0};
+
+  static constexpr uint8_t compressed_size() { return sizeof...(B); }
+  static constexpr uint8_t size() { return DecodedSize; }
+};
+
+template <uint8_t DecodedSize, uint8_t... B>
+constexpr uint8_t const
+    ProgmemCompressedStringData<DecodedSize, B...>::kData[1 + sizeof...(B)]
+        AVR_PROGMEM;
+
+// Sequence of compressed bytes produced so far by the compressor.
+template <uint8_t... B>
+struct CompressedBytes final {};
+
+// Compresses the chars of PSD (a ProgmemStringData type), starting at Pos, and
+// appending to the bytes in Out. The `type` member of the final specialization
+// is the ProgmemCompressedStringData type.
+template <class PSD, int Pos, class Out,
+          long Step = NextStep(PSD::kData + Pos, PSD::size() - Pos),
+          StepKind Kind = KindOfStep(Step)>
+struct Compress;
+
+template <class PSD, int Pos, uint8_t... B, long Step>
+struct Compress<PSD, Pos, CompressedBytes<B...>, Step, StepKind::kEnd> {
+  using type = ProgmemCompressedStringData<PSD::size(), B...>;
+};
+
+template <class PSD, int Pos, uint8_t... B, long Step>
+struct Compress<PSD, Pos, CompressedBytes<B...>, Step, StepKind::kToken> {
+  using type = typename Compress<
+      PSD, Pos + (Step & 0xFF),
+      CompressedBytes<B..., static_cast<uint8_t>(kFirstTokenCode +
+                                                 ((Step >> 8) & 0xFF))>>::type;
+};
+
+template <class PSD, int Pos, uint8_t... B, long Step>
+struct Compress<PSD, Pos, CompressedBytes<B...>, Step, StepKind::kAscii> {
+  using type = typename Compress<
+      PSD, Pos + 1,
+      CompressedBytes<B..., static_cast<uint8_t>(Step)>>::type;
+};
+
+template <class PSD, int Pos, uint8_t... B, long Step>
+struct Compress<PSD, Pos, CompressedBytes<B...>, Step, StepKind::kEscaped> {
+  using type = typename Compress<
+      PSD, Pos + 1,
+      CompressedBytes<B..., kEscapeCode, static_cast<uint8_t>(Step)>>::type;
+};
+
+// Produces the ProgmemCompressedStringData type for the string literal stored
+// in PSD, a ProgmemStringData type.
+template <class PSD>
+struct CompressLiteral {
+  static_assert(PSD::size() <= 255,
+                "ProgmemCompressedString supports at most 255 chars");
+  using type = typename Compress<PSD, 0, CompressedBytes<>>::type;
+};
+
+}  // namespace progmem_compressed_string
+
+class ProgmemCompressedString {
+ public:
+  // Construct empty.
+  constexpr ProgmemCompressedString()
+      : ptr_(nullptr), compressed_size_(0), size_(0) {}
+
+  // Constructs from the type produced by MCU_PSD_COMPRESSED_TYPE.
+  template <uint8_t DecodedSize, uint8_t... B>
+  constexpr ProgmemCompressedString(  // NOLINT: Want this to be implicit.
+      progmem_compressed_string::ProgmemCompressedStringData<DecodedSize, B...>
+          data)
+      : ptr_(data.kData), compressed_size_(sizeof...(B)), size_(DecodedSize) {}
+
+  constexpr ProgmemCompressedString(const ProgmemCompressedString&) = default;
+  ProgmemCompressedString& operator=(const ProgmemCompressedString&) = default;
+
+  // Decompress the string into the provided Print instance. Returns the number
+  // of chars printed.
+  size_t printTo(Print& out) const;
+
+  // Returns the number of chars in the string after decompression.
+  constexpr uint8_t size() const { return size_; }
+
+  // Returns the number of bytes of PROGMEM used to store the string, not
+  // including the shared dictionary.
+  constexpr uint8_t compressed_size() const { return compressed_size_; }
+
+  // Returns true if the string is empty.
+  constexpr bool empty() const { return size_ == 0; }
+
+ private:
+  const uint8_t* ptr_;
+  uint8_t compressed_size_;
+  uint8_t size_;
+};
+
+}  // namespace mcucore
+
+////////////////////////////////////////////////////////////////////////////////
+// We define below macros MCU_PSD_COMPRESSED_nnn for various values of nnn,
+// which represents the maximum length of string literal (not including the
+// terminating null character) supported by the macro. These produce *values* of
+// type ProgmemCompressedString that can be printed at runtime.
+
+#define _PCS_NS ::mcucore::progmem_compressed_string
+
+#define MCU_PSD_COMPRESSED_TYPE_64(x) \
+  _PCS_NS::CompressLiteral<MCU_PSD_TYPE_64(x)>::type
+#define MCU_PSD_COMPRESSED_64(x) \
+  (::mcucore::ProgmemCompressedString(MCU_PSD_COMPRESSED_TYPE_64(x)()))
+
+#define MCU_PSD_COMPRESSED_TYPE_128(x) \
+  _PCS_NS::CompressLiteral<MCU_PSD_TYPE_128(x)>::type
+#define MCU_PSD_COMPRESSED_128(x) \
+  (::mcucore::ProgmemCompressedString(MCU_PSD_COMPRESSED_TYPE_128(x)()))
+
+// Max length 255 (not including trailing NUL), the longest that can be
+// represented by ProgmemCompressedString's uint8_t size.
+
+#define MCU_PSD_COMPRESSED_TYPE_255(x) \
+  _PCS_NS::CompressLiteral<MCU_PSD_TYPE_255(x)>::type
+#define MCU_PSD_COMPRESSED_255(x) \
+  (::mcucore::ProgmemCompressedString(MCU_PSD_COMPRESSED_TYPE_255(x)()))
+
+// Compressed strings are intended for longer messages than are typical for
+// MCU_PSD, hence the larger default maximum length.
+
+#define MCU_PSD_COMPRESSED_TYPE(x) MCU_PSD_COMPRESSED_TYPE_128(x)
+#define MCU_PSD_COMPRESSED(x) MCU_PSD_COMPRESSED_128(x)
+
+#endif  // MCUCORE_SRC_STRINGS_PROGMEM_COMPRESSED_STRING_H_
@@ -75,11 +75,32 @@
 // but after that the binary tree recursion method is used, which addresses the
 // difficulties with long __FILE__ strings.
 //
+// -----------------------------------------------------------------------------
+//
+// When compiled with C++ 20 or later (specifically, when class types are
+// supported as the types of non-type template parameters), the macros instead
+// pass the string literal as a template argument of type FixedString, and
+// produce the same ProgmemStringData<C...> type by expanding the chars of the
+// FixedString with an index sequence. This avoids the fragment machinery above,
+// which is the bulk of the compile time cost, while keeping the one definition
+// per literal semantics; in fact the types are the same as those produced by
+// the C++ 11 implementation, so translation units compiled in either mode share
+// storage. Define MCU_DISABLE_PSD_FIXED_STRING to use the C++ 11
+// implementation regardless of the language version.
+//
 // Author: james.synge@gmail.com
 
 #include "mcucore_platform.h"
 #include "misc/preproc.h"
 
+#if defined(__cpp_nontype_template_args) && \
+    __cpp_nontype_template_args >= 201911L && \
+    !defined(MCU_DISABLE_PSD_FIXED_STRING)
+#define MCU_PSD_USE_FIXED_STRING 1
+#else
+#define MCU_PSD_USE_FIXED_STRING 0
+#endif
+
 namespace mcucore {
 namespace progmem_string_data {
 
@@ -412,6 +433,74 @@ auto ProvideStorage(LengthCheck<LengthOk>, PathFragment<FoundSlash, C...>)
     -> decltype(ProvideStorage(LengthCheck<LengthOk>(),
                                StringFragment<C...>()));
 
+#if MCU_PSD_USE_FIXED_STRING
+////////////////////////////////////////////////////////////////////////////////
+// Support for using a string literal as a template argument, available starting
+// with C++ 20.
+
+// A string literal (of N chars, including the terminating null) in a form that
+// is usable as the type of a non-type template parameter.
+template <int N>
+struct FixedString final {
+  constexpr FixedString(const char (&str)[N]) {  // NOLINT: Must be implicit.
+    for (int i = 0; i < N; ++i) {
+      chars[i] = str[i];
+    }
+  }
+
+  // Returns the number of chars, not including the terminating null.
+  static constexpr int size() { return N - 1; }
+
+  // Returns the offset of the first char after the last slash (forward or
+  // backward), or zero if there are no slashes.
+  constexpr int BasenameOffset() const {
+    int offset = 0;
+    for (int i = 0; i < size(); ++i) {
+      if (chars[i] == '/' || chars[i] == '\\') {
+        offset = i + 1;
+      }
+    }
+    return offset;
+  }
+
+  char chars[N] = {};
+};
+
+// A sequence of offsets, produced by a compiler builtin so that we don't need to
+// recursively instantiate templates to produce it.
+template <typename T, T... I>
+struct IndexSequence final {};
+
+#if MCU_HAS_BUILTIN(__make_integer_seq)
+template <int N>
+using MakeIndexSequence = __make_integer_seq<IndexSequence, int, N>;
+#else
+template <int N>
+using MakeIndexSequence = IndexSequence<int, __integer_pack(N)...>;
+#endif
+
+// Expands the chars of S, starting at offset Start, into a StringFragment.
+template <FixedString S, int Start, int... I>
+auto FixedStringFragment(IndexSequence<int, I...>)
+    -> StringFragment<S.chars[Start + I]...>;
+
+// The ProgmemStringData type for the string literal S, or StringLiteralIsTooLong
+// if S is longer than MaxChars.
+template <int MaxChars, FixedString S>
+using FixedStringLiteralType = decltype(ProvideStorage(
+    LengthCheck<(S.size() <= MaxChars)>(),
+    FixedStringFragment<S, 0>(MakeIndexSequence<S.size()>())));
+
+// The ProgmemStringData type for the basename of the file path S, or
+// StringLiteralIsTooLong if S is longer than MaxChars.
+template <int MaxChars, FixedString S>
+using FixedStringBasenameType = decltype(ProvideStorage(
+    LengthCheck<(S.size() <= MaxChars)>(),
+    FixedStringFragment<S, S.BasenameOffset()>(
+        MakeIndexSequence<S.size() - S.BasenameOffset()>())));
+
+#endif  // MCU_PSD_USE_FIXED_STRING
+
 }  // namespace progmem_string_data
 }  // namespace mcucore
 
@@ -566,31 +655,39 @@ auto ProvideStorage(LengthCheck<LengthOk>, PathFragment<FoundSlash, C...>)
 // the literal string x. The others expand to values of such a type, which can
 // be printed or otherwise operated upon at runtime.
 
+#if MCU_PSD_USE_FIXED_STRING
+#define _PSD_LITERAL_TYPE(nnn, x) _PSD_NS::FixedStringLiteralType<nnn, x>
+#define _PSD_BASENAME_TYPE(nnn, x) _PSD_NS::FixedStringBasenameType<nnn, x>
+#else
+#define _PSD_LITERAL_TYPE(nnn, x) _PSD_TYPE_##nnn(_PSD_STRFRAG_TYPE, x)
+#define _PSD_BASENAME_TYPE(nnn, x) _PSD_TYPE_##nnn(_PSD_PATHFRAG_TYPE, x)
+#endif  // MCU_PSD_USE_FIXED_STRING
+
 // Max length 32:
 
-#define MCU_PSD_TYPE_32(x) _PSD_TYPE_32(_PSD_STRFRAG_TYPE, x)
+#define MCU_PSD_TYPE_32(x) _PSD_LITERAL_TYPE(32, x)
 #define MCU_PSD_32(x) (MCU_PSD_TYPE_32(x)())
 #define MCU_FLASHSTR_32(x) (MCU_PSD_TYPE_32(x)::ToFlashStringHelper())
 
-#define MCU_BASENAME_TYPE_32(x) _PSD_TYPE_32(_PSD_PATHFRAG_TYPE, x)
+#define MCU_BASENAME_TYPE_32(x) _PSD_BASENAME_TYPE(32, x)
 #define MCU_BASENAME_32(x) (MCU_BASENAME_TYPE_32(x)::ToFlashStringHelper())
 
 // Max length 64 (not including trailing NUL).
 
-#define MCU_PSD_TYPE_64(x) _PSD_TYPE_64(_PSD_STRFRAG_TYPE, x)
+#define MCU_PSD_TYPE_64(x) _PSD_LITERAL_TYPE(64, x)
 #define MCU_PSD_64(x) (MCU_PSD_TYPE_64(x)())
 #define MCU_FLASHSTR_64(x) (MCU_PSD_TYPE_64(x)::ToFlashStringHelper())
 
-#define MCU_BASENAME_TYPE_64(x) _PSD_TYPE_64(_PSD_PATHFRAG_TYPE, x)
+#define MCU_BASENAME_TYPE_64(x) _PSD_BASENAME_TYPE(64, x)
 #define MCU_BASENAME_64(x) (MCU_BASENAME_TYPE_64(x)::ToFlashStringHelper())
 
 // Max length 128 (not including trailing NUL).
 
-#define MCU_PSD_TYPE_128(x) _PSD_TYPE_128(_PSD_STRFRAG_TYPE, x)
+#define MCU_PSD_TYPE_128(x) _PSD_LITERAL_TYPE(128, x)
 #define MCU_PSD_128(x) (MCU_PSD_TYPE_128(x)())
 #define MCU_FLASHSTR_128(x) (MCU_PSD_TYPE_128(x)::ToFlashStringHelper())
 
-#define MCU_BASENAME_TYPE_128(x) _PSD_TYPE_128(_PSD_PATHFRAG_TYPE, x)
+#define MCU_BASENAME_TYPE_128(x) _PSD_BASENAME_TYPE(128, x)
 #define MCU_BASENAME_128(x) (MCU_BASENAME_TYPE_128(x)::ToFlashStringHelper())
 
 // Max length 255 (not including trailing NUL). This is defined to support
@@ -598,36 +695,36 @@ auto ProvideStorage(LengthCheck<LengthOk>, PathFragment<FoundSlash, C...>)
 // that ProgmemStringView can encode (i.e. it uses a single byte for the
 // length).
 
-#define MCU_PSD_TYPE_255(x) _PSD_TYPE_255(_PSD_STRFRAG_TYPE, x)
+#define MCU_PSD_TYPE_255(x) _PSD_LITERAL_TYPE(255, x)
 #define MCU_PSD_255(x) (MCU_PSD_TYPE_255(x)())
 
 // Max length 256 (not including trailing NUL).
 
-#define MCU_PSD_TYPE_256(x) _PSD_TYPE_256(_PSD_STRFRAG_TYPE, x)
+#define MCU_PSD_TYPE_256(x) _PSD_LITERAL_TYPE(256, x)
 #define MCU_PSD_256(x) (MCU_PSD_TYPE_256(x)())
 #define MCU_FLASHSTR_256(x) (MCU_PSD_TYPE_256(x)::ToFlashStringHelper())
 
-#define MCU_BASENAME_TYPE_256(x) _PSD_TYPE_256(_PSD_PATHFRAG_TYPE, x)
+#define MCU_BASENAME_TYPE_256(x) _PSD_BASENAME_TYPE(256, x)
 #define MCU_BASENAME_256(x) (MCU_BASENAME_TYPE_256(x)::ToFlashStringHelper())
 
 // Max length 512 (not including trailing NUL). There is no support here for
 // ProgmemStringView because it can't support such a long string.
 
-#define MCU_PSD_TYPE_512(x) _PSD_TYPE_512(_PSD_STRFRAG_TYPE, x)
+#define MCU_PSD_TYPE_512(x) _PSD_LITERAL_TYPE(512, x)
 #define MCU_PSD_512(x) (MCU_PSD_TYPE_512(x)())
 #define MCU_FLASHSTR_512(x) (MCU_PSD_TYPE_512(x)::ToFlashStringHelper())
 
-#define MCU_BASENAME_TYPE_512(x) _PSD_TYPE_512(_PSD_PATHFRAG_TYPE, x)
+#define MCU_BASENAME_TYPE_512(x) _PSD_BASENAME_TYPE(512, x)
 #define MCU_BASENAME_512(x) (MCU_BASENAME_TYPE_512(x)::ToFlashStringHelper())
 
 // Max length 1024 (not including trailing NUL). There is no support here for
 // ProgmemStringView because it can't support such a long string.
 
-#define MCU_PSD_TYPE_1024(x) _PSD_TYPE_1024(_PSD_STRFRAG_TYPE, x)
+#define MCU_PSD_TYPE_1024(x) _PSD_LITERAL_TYPE(1024, x)
 #define MCU_PSD_1024(x) (MCU_PSD_TYPE_1024(x)())
 #define MCU_FLASHSTR_1024(x) (MCU_PSD_TYPE_1024(x)::ToFlashStringHelper())
 
-#define MCU_BASENAME_TYPE_1024(x) _PSD_TYPE_1024(_PSD_PATHFRAG_TYPE, x)
+#define MCU_BASENAME_TYPE_1024(x) _PSD_BASENAME_TYPE(1024, x)
 #define MCU_BASENAME_1024(x) (MCU_BASENAME_TYPE_1024(x)::ToFlashStringHelper())
 
 ////////////////////////////////////////////////////////////////////////////////
@@ -3,6 +3,8 @@
 // NOTE: There is no use of logging.h here because that introduces an include
 // cycle, and hence a BUILD dependency sycle.
 
+#include <string.h>
+
 #include "mcucore_platform.h"
 #include "print/has_print_to.h"
 #include "print/print_misc.h"
@@ -14,6 +16,113 @@ inline char pgm_read_char_near(PGM_P ptr) {
   auto byte = pgm_read_byte_near(reinterpret_cast<const uint8_t*>(ptr));
   return static_cast<char>(byte);
 }
+
+// Returns c lower-cased if it is an ASCII upper case letter, else returns c.
+inline char LowerAsciiChar(const char c) {
+  return ('A' <= c && c <= 'Z') ? (c | static_cast<char>(0x20)) : c;
+}
+
+// The comparison kernels below are selected based on the target. On AVR,
+// PROGMEM is in a separate address space, so we must use the LPM instruction
+// (i.e. pgm_read_byte and the avr-libc *_P functions) to read it. Elsewhere
+// (i.e. on the host, and on non-AVR Arduino boards), PROGMEM is ordinary
+// memory, so we can compare the strings a word at a time.
+
+#ifdef ARDUINO_ARCH_AVR
+
+inline bool ProgmemEqualKernel(PGM_P a, PGM_P b, uint8_t size) {
+  for (uint8_t offset = 0; offset < size; ++offset) {
+    if (pgm_read_char_near(a + offset) != pgm_read_char_near(b + offset)) {
+      return false;
+    }
+  }
+  return true;
+}
+
+inline bool CaseEqualKernel(const char* ram, PGM_P flash, uint8_t size) {
+  return 0 == strncasecmp_P(ram, flash, size);
+}
+
+inline bool LoweredEqualKernel(const char* ram, PGM_P flash, uint8_t size) {
+  for (uint8_t offset = 0; offset < size; ++offset) {
+    if (LowerAsciiChar(pgm_read_char_near(flash + offset)) != ram[offset]) {
+      return false;
+    }
+  }
+  return true;
+}
+
+#else  // !ARDUINO_ARCH_AVR
+
+// SWAR (SIMD Within A Register) support: we operate on all of the bytes of a
+// word in parallel.
+#if UINTPTR_MAX > 0xFFFFFFFF
+using SwarWord = uint64_t;
+#else
+using SwarWord = uint32_t;
+#endif
+
+// 0x0101...01 and 0x8080...80, respectively.
+constexpr SwarWord kSwarOnes = static_cast<SwarWord>(~SwarWord{0}) / 0xFF;
+constexpr SwarWord kSwarHighBits = kSwarOnes * 0x80;
+
+inline SwarWord LoadSwarWord(const char* ptr) {
+  SwarWord word;
+  memcpy(&word, ptr, sizeof word);
+  return word;
+}
+
+// Returns word with each ASCII upper case letter (byte) lower-cased. Bytes with
+// the high bit set are not letters, and are returned unchanged. The additions
+// can't carry from one byte into the next because the high bit of each byte is
+// cleared first.
+inline SwarWord LowerAsciiWord(const SwarWord word) {
+  const SwarWord low_bits = word & ~kSwarHighBits;
+  const SwarWord above_z = low_bits + kSwarOnes * (0x7F - 'Z');
+  const SwarWord at_or_above_a = low_bits + kSwarOnes * (0x80 - 'A');
+  const SwarWord is_upper = at_or_above_a & ~above_z & ~word & kSwarHighBits;
+  // Move the high bit (0x80) of each upper case letter to the 0x20 position.
+  return word | (is_upper >> 2);
+}
+
+inline bool ProgmemEqualKernel(PGM_P a, PGM_P b, uint8_t size) {
+  return 0 == memcmp(a, b, size);
+}
+
+inline bool CaseEqualKernel(const char* ram, PGM_P flash, uint8_t size) {
+  size_t offset = 0;
+  for (; size - offset >= sizeof(SwarWord); offset += sizeof(SwarWord)) {
+    if (LowerAsciiWord(LoadSwarWord(ram + offset)) !=
+        LowerAsciiWord(LoadSwarWord(flash + offset))) {
+      return false;
+    }
+  }
+  for (; offset < size; ++offset) {
+    if (LowerAsciiChar(ram[offset]) != LowerAsciiChar(flash[offset])) {
+      return false;
+    }
+  }
+  return true;
+}
+
+inline bool LoweredEqualKernel(const char* ram, PGM_P flash, uint8_t size) {
+  size_t offset = 0;
+  for (; size - offset >= sizeof(SwarWord); offset += sizeof(SwarWord)) {
+    if (LoadSwarWord(ram + offset) !=
+        LowerAsciiWord(LoadSwarWord(flash + offset))) {
+      return false;
+    }
+  }
+  for (; offset < size; ++offset) {
+    if (ram[offset] != LowerAsciiChar(flash[offset])) {
+      return false;
+    }
+  }
+  return true;
+}
+
+#endif  // ARDUINO_ARCH_AVR
+
 }  // namespace
 
 size_t ProgmemStringView::printTo(Print& out) const {
@@ -27,12 +136,7 @@ bool ProgmemStringView::operator==(const ProgmemStringView& other) const {
     if (ptr_ == other.ptr_) {
       return true;
     }
-    for (size_type offset = 0; offset < size_; ++offset) {
-      if (at(offset) != other.at(offset)) {
-        return false;
-      }
-    }
-    return true;
+    return ProgmemEqualKernel(ptr_, other.ptr_, size_);
   }
   return false;
 }
@@ -53,7 +157,7 @@ bool ProgmemStringView::CaseEqual(const char* other,
   if (size_ != other_size) {
     return false;
   }
-  return 0 == strncasecmp_P(other, ptr_, size_);
+  return CaseEqualKernel(other, ptr_, size_);
 }
 
 bool ProgmemStringView::LoweredEqual(const char* other,
@@ -61,14 +165,7 @@ bool ProgmemStringView::LoweredEqual(const char* other,
   if (size_ != other_size) {
     return false;
   }
-  for (size_type offset = 0; offset < size_; ++offset) {
-    const char c = at(offset);
-    const char lc_c = isUpperCase(c) ? (c | static_cast<char>(0x20)) : c;
-    if (lc_c != other[offset]) {
-      return false;
-    }
-  }
-  return true;
+  return LoweredEqualKernel(other, ptr_, size_);
 }
 
 bool ProgmemStringView::IsPrefixOf(const char* other,
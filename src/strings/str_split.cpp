@@ -0,0 +1,105 @@
+#include "strings/str_split.h"
+
+#include <string.h>
+
+#include "log/log.h"
+#include "mcucore_platform.h"
+#include "strings/string_compare.h"
+
+namespace mcucore {
+namespace {
+
+bool IsOptionalWhitespace(const char c) { return c == ' ' || c == '\t'; }
+
+}  // namespace
+
+constexpr StrSplitDelimiter::size_type StrSplitDelimiter::kNotFound;
+
+StrSplitDelimiter::size_type StrSplitDelimiter::Find(const StringView& text,
+                                                     size_type& length) const {
+  const char* const start = text.data();
+  const char* const limit = start + text.size();
+  if (kind_ == kChar) {
+    const void* found = memchr(start, char_, text.size());
+    if (found == nullptr) {
+      return kNotFound;
+    }
+    length = 1;
+    return static_cast<const char*>(found) - start;
+  } else if (kind_ == kAnyChar) {
+    for (const char* ptr = start; ptr < limit; ++ptr) {
+      if (chars_.contains(*ptr)) {
+        length = 1;
+        return ptr - start;
+      }
+    }
+    return kNotFound;
+  }
+  MCU_DCHECK_EQ(kind_, kProgmemString);
+  MCU_DCHECK_NE(progmem_str_.size(), 0);
+  if (progmem_str_.size() == 0) {
+    return kNotFound;
+  }
+  // Use memchr to find candidate positions (i.e. those which match the first
+  // char of the delimiter), and only then compare the rest of the delimiter.
+  const char first = progmem_str_.at(0);
+  const char* ptr = start;
+  while (limit - ptr >= progmem_str_.size()) {
+    const void* found = memchr(ptr, first, limit - ptr);
+    if (found == nullptr) {
+      break;
+    }
+    ptr = static_cast<const char*>(found);
+    const size_type pos = ptr - start;
+    if (StartsWith(StringView(ptr, text.size() - pos), progmem_str_)) {
+      length = progmem_str_.size();
+      return pos;
+    }
+    ++ptr;
+  }
+  return kNotFound;
+}
+
+StrSplitIterator::StrSplitIterator(const StringView& text,
+                                   const StrSplitDelimiter& delimiter,
+                                   StrSplitOptions options)
+    : remaining_(text),
+      delimiter_(delimiter),
+      options_(options),
+      at_end_(false),
+      last_(false) {
+  Advance();
+}
+
+void StrSplitIterator::Advance() {
+  while (!last_) {
+    StrSplitDelimiter::size_type length = 0;
+    const auto pos = delimiter_.Find(remaining_, length);
+    if (pos == StrSplitDelimiter::kNotFound) {
+      piece_ = remaining_;
+      last_ = true;
+    } else {
+      piece_ = remaining_.prefix(pos);
+      remaining_.remove_prefix(pos + length);
+    }
+    if (HasOption(options_, StrSplitOptions::kTrimOptionalWhitespace)) {
+      TrimOptionalWhitespace(piece_);
+    }
+    if (!(piece_.empty() &&
+          HasOption(options_, StrSplitOptions::kSkipEmpty))) {
+      return;
+    }
+  }
+  at_end_ = true;
+}
+
+void TrimOptionalWhitespace(StringView& view) {
+  while (!view.empty() && IsOptionalWhitespace(view.front())) {
+    view.remove_prefix(1);
+  }
+  while (!view.empty() && IsOptionalWhitespace(view.back())) {
+    view.remove_suffix(1);
+  }
+}
+
+}  // namespace mcucore
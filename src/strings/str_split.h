@@ -0,0 +1,172 @@
+#ifndef MCUCORE_SRC_STRINGS_STR_SPLIT_H_
+#define MCUCORE_SRC_STRINGS_STR_SPLIT_H_
+
+// StrSplit splits a StringView into pieces separated by a delimiter, yielding
+// each piece as a StringView (i.e. without copying or allocating), and is
+// intended for parsing multi-field values such as HTTP header values (e.g.
+// Accept lists, Cookie pairs) or comma-separated Alpaca parameter values. For
+// example:
+//
+//    for (StringView item : StrSplit(value, ',',
+//                                    StrSplitOptions::kTrimOptionalWhitespace |
+//                                    StrSplitOptions::kSkipEmpty)) {
+//      ...
+//    }
+//
+// The split is lazy: each piece is found when the iterator is advanced, and the
+// text is scanned just once from start to end.
+//
+// The delimiter may be:
+//
+// * A single char (e.g. ','), found with memchr.
+// * Any one of a set of chars, specified with ByAnyChar(StringView), e.g.
+//   ByAnyChar(StringView(",;")).
+// * A string stored in PROGMEM, specified with a ProgmemStringView (e.g.
+//   MCU_PSV("; ")), which is matched in its entirety.
+//
+// Author: james.synge@gmail.com
+
+#include "mcucore_platform.h"
+#include "strings/progmem_string_view.h"
+#include "strings/string_view.h"
+
+namespace mcucore {
+
+// Options controlling the pieces produced by StrSplit; these can be combined
+// with operator|.
+enum class StrSplitOptions : uint8_t {
+  kNone = 0,
+  // Removes leading and trailing spaces and horizontal tabs (i.e. OWS, optional
+  // whitespace, in HTTP terms) from each piece.
+  kTrimOptionalWhitespace = 1,
+  // Skips pieces which are empty (after trimming, if requested).
+  kSkipEmpty = 2,
+};
+
+constexpr StrSplitOptions operator|(StrSplitOptions a, StrSplitOptions b) {
+  return static_cast<StrSplitOptions>(static_cast<uint8_t>(a) |
+                                      static_cast<uint8_t>(b));
+}
+
+constexpr bool HasOption(StrSplitOptions options, StrSplitOptions option) {
+  return (static_cast<uint8_t>(options) & static_cast<uint8_t>(option)) != 0;
+}
+
+// Describes the delimiter between pieces. This is a single (non-template) class
+// rather than a family of delimiter types so that there is only one copy of the
+// splitting code in the program.
+class StrSplitDelimiter {
+ public:
+  using size_type = StringView::size_type;
+
+  // Value returned by Find when there is no delimiter in the text.
+  static constexpr size_type kNotFound = StringView::kMaxSize;
+
+  // A single char delimiter.
+  constexpr StrSplitDelimiter(char c)  // NOLINT: Want this to be implicit.
+      : kind_(kChar), char_(c), chars_(), progmem_str_() {}
+
+  // A multi-char delimiter stored in PROGMEM, which must not be empty.
+  constexpr StrSplitDelimiter(  // NOLINT: Want this to be implicit.
+      const ProgmemStringView& str)
+      : kind_(kProgmemString), char_(0), chars_(), progmem_str_(str) {}
+
+  // A delimiter which is any one of the chars in chars. Prefer ByAnyChar.
+  static constexpr StrSplitDelimiter AnyCharOf(const StringView& chars) {
+    return StrSplitDelimiter(chars);
+  }
+
+  // Returns the position of the first delimiter in text, and stores its length
+  // in length; returns kNotFound if there is no delimiter in text.
+  size_type Find(const StringView& text, size_type& length) const;
+
+ private:
+  enum Kind : uint8_t { kChar, kAnyChar, kProgmemString };
+
+  explicit constexpr StrSplitDelimiter(const StringView& chars)
+      : kind_(kAnyChar), char_(0), chars_(chars), progmem_str_() {}
+
+  Kind kind_;
+  char char_;
+  StringView chars_;
+  ProgmemStringView progmem_str_;
+};
+
+// Returns a delimiter which matches any one of the chars.
+constexpr StrSplitDelimiter ByAnyChar(const StringView& chars) {
+  return StrSplitDelimiter::AnyCharOf(chars);
+}
+
+// Iterates over the pieces of a StringView. An iterator constructed with the
+// default constructor is the end iterator.
+class StrSplitIterator {
+ public:
+  StrSplitIterator() : delimiter_(0), options_(), at_end_(true), last_(true) {}
+  StrSplitIterator(const StringView& text, const StrSplitDelimiter& delimiter,
+                   StrSplitOptions options);
+
+  const StringView& operator*() const { return piece_; }
+  const StringView* operator->() const { return &piece_; }
+
+  StrSplitIterator& operator++() {
+    Advance();
+    return *this;
+  }
+
+  // Iterators are only compared with the end iterator (e.g. in a range-based
+  // for loop), so it is sufficient to compare whether they are at the end.
+  bool operator==(const StrSplitIterator& other) const {
+    return at_end_ == other.at_end_ &&
+           (at_end_ || piece_.data() == other.piece_.data());
+  }
+  bool operator!=(const StrSplitIterator& other) const {
+    return !(*this == other);
+  }
+
+ private:
+  // Finds the next piece, or sets at_end_ if there are no more.
+  void Advance();
+
+  StringView remaining_;
+  StringView piece_;
+  StrSplitDelimiter delimiter_;
+  StrSplitOptions options_;
+  // True when there are no more pieces.
+  bool at_end_;
+  // True when piece_ is the last piece (i.e. there was no delimiter after it).
+  bool last_;
+};
+
+// The range returned by StrSplit, for use in range-based for loops.
+class StrSplitRange {
+ public:
+  StrSplitRange(const StringView& text, const StrSplitDelimiter& delimiter,
+                StrSplitOptions options)
+      : text_(text), delimiter_(delimiter), options_(options) {}
+
+  StrSplitIterator begin() const {
+    return StrSplitIterator(text_, delimiter_, options_);
+  }
+  StrSplitIterator end() const { return StrSplitIterator(); }
+
+ private:
+  StringView text_;
+  StrSplitDelimiter delimiter_;
+  StrSplitOptions options_;
+};
+
+// Returns a range of the pieces of text separated by delimiter. Note that,
+// like absl::StrSplit, splitting an empty string produces a single empty piece
+// unless StrSplitOptions::kSkipEmpty is specified.
+inline StrSplitRange StrSplit(
+    const StringView& text, const StrSplitDelimiter& delimiter,
+    StrSplitOptions options = StrSplitOptions::kNone) {
+  return StrSplitRange(text, delimiter, options);
+}
+
+// Removes leading and trailing spaces and horizontal tabs from view.
+void TrimOptionalWhitespace(StringView& view);
+
+}  // namespace mcucore
+
+#endif  // MCUCORE_SRC_STRINGS_STR_SPLIT_H_
@@ -0,0 +1,137 @@
+#include "strings/utf8_validator.h"
+
+#include <string.h>
+
+#include "mcucore_platform.h"
+
+namespace mcucore {
+namespace {
+
+// The class of each byte value from 0x80 to 0xFF (all ASCII bytes are in class
+// 0), determined by which states may be followed by that byte:
+//
+//   0: 00..7F        ASCII
+//   1: 80..8F        Continuation byte
+//   2: 90..9F        Continuation byte
+//   3: A0..BF        Continuation byte
+//   4: C0..C1 F5..FF Never valid
+//   5: C2..DF        Lead byte of 2 byte sequence
+//   6: E0            Lead byte of 3 byte sequence, second byte A0..BF
+//   7: E1..EC EE..EF Lead byte of 3 byte sequence
+//   8: ED            Lead byte of 3 byte sequence, second byte 80..9F
+//   9: F0            Lead byte of 4 byte sequence, second byte 90..BF
+//  10: F1..F3        Lead byte of 4 byte sequence
+//  11: F4            Lead byte of 4 byte sequence, second byte 80..8F
+constexpr uint8_t kNumByteClasses = 12;
+constexpr uint8_t kByteClasses[128] AVR_PROGMEM = {
+    1, 1,  1,  1,  1,  1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1,  // 80..8F
+    2, 2,  2,  2,  2,  2, 2, 2, 2, 2, 2, 2, 2, 2, 2, 2,  // 90..9F
+    3, 3,  3,  3,  3,  3, 3, 3, 3, 3, 3, 3, 3, 3, 3, 3,  // A0..AF
+    3, 3,  3,  3,  3,  3, 3, 3, 3, 3, 3, 3, 3, 3, 3, 3,  // B0..BF
+    4, 4,  5,  5,  5,  5, 5, 5, 5, 5, 5, 5, 5, 5, 5, 5,  // C0..CF
+    5, 5,  5,  5,  5,  5, 5, 5, 5, 5, 5, 5, 5, 5, 5, 5,  // D0..DF
+    6, 7,  7,  7,  7,  7, 7, 7, 7, 7, 7, 7, 7, 8, 7, 7,  // E0..EF
+    9, 10, 10, 10, 11, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4,  // F0..FF
+};
+
+// The next state, indexed by the current state plus the class of the next byte.
+// The states are:
+//
+//   0: Accept (i.e. not in a multi-byte sequence).
+//  12: Reject (i.e. invalid UTF-8 has been found).
+//  24: Expecting one more continuation byte.
+//  36: Expecting two more continuation bytes.
+//  48: After E0, expecting A0..BF.
+//  60: After ED, expecting 80..9F.
+//  72: After F0, expecting 90..BF.
+//  84: After F1..F3, expecting 80..BF.
+//  96: After F4, expecting 80..8F.
+constexpr uint8_t kTransitions[9 * kNumByteClasses] AVR_PROGMEM = {
+    0,  12, 12, 12, 12, 24, 48, 36, 60, 72, 84, 96,  // Accept
+    12, 12, 12, 12, 12, 12, 12, 12, 12, 12, 12, 12,  // Reject
+    12, 0,  0,  0,  12, 12, 12, 12, 12, 12, 12, 12,  // Need 1
+    12, 24, 24, 24, 12, 12, 12, 12, 12, 12, 12, 12,  // Need 2
+    12, 12, 12, 24, 12, 12, 12, 12, 12, 12, 12, 12,  // After E0
+    12, 24, 24, 12, 12, 12, 12, 12, 12, 12, 12, 12,  // After ED
+    12, 12, 36, 36, 12, 12, 12, 12, 12, 12, 12, 12,  // After F0
+    12, 36, 36, 36, 12, 12, 12, 12, 12, 12, 12, 12,  // After F1..F3
+    12, 36, 12, 12, 12, 12, 12, 12, 12, 12, 12, 12,  // After F4
+};
+
+static_assert(Utf8Validator::kReject == kNumByteClasses,
+              "kReject must be the second state");
+
+inline uint8_t NextState(uint8_t state, uint8_t b) {
+  const uint8_t byte_class =
+      b < 0x80 ? 0 : pgm_read_byte_near(kByteClasses + (b - 0x80));
+  return pgm_read_byte_near(kTransitions + state + byte_class);
+}
+
+#ifndef ARDUINO_ARCH_AVR
+#if UINTPTR_MAX > 0xFFFFFFFF
+using AsciiWord = uint64_t;
+#else
+using AsciiWord = uint32_t;
+#endif
+constexpr AsciiWord kHighBits = static_cast<AsciiWord>(0x8080808080808080ULL);
+
+// Returns the number of leading ASCII bytes in data, examining a word at a
+// time; the result may be less than the true number by up to
+// sizeof(AsciiWord) - 1.
+size_t SkipAsciiWords(const uint8_t* data, size_t size) {
+  size_t offset = 0;
+  while (size - offset >= 2 * sizeof(AsciiWord)) {
+    AsciiWord w1, w2;
+    memcpy(&w1, data + offset, sizeof w1);
+    memcpy(&w2, data + offset + sizeof w1, sizeof w2);
+    if (((w1 | w2) & kHighBits) != 0) {
+      break;
+    }
+    offset += 2 * sizeof(AsciiWord);
+  }
+  while (size - offset >= sizeof(AsciiWord)) {
+    AsciiWord w;
+    memcpy(&w, data + offset, sizeof w);
+    if ((w & kHighBits) != 0) {
+      break;
+    }
+    offset += sizeof(AsciiWord);
+  }
+  return offset;
+}
+#endif  // !ARDUINO_ARCH_AVR
+
+}  // namespace
+
+constexpr uint8_t Utf8Validator::kAccept;
+constexpr uint8_t Utf8Validator::kReject;
+
+bool Utf8Validator::Feed(const uint8_t* data, size_t size) {
+  uint8_t state = state_;
+  size_t offset = 0;
+  while (offset < size && state != kReject) {
+#ifndef ARDUINO_ARCH_AVR
+    if (state == kAccept) {
+      offset += SkipAsciiWords(data + offset, size - offset);
+      if (offset >= size) {
+        break;
+      }
+    }
+#endif  // !ARDUINO_ARCH_AVR
+    state = NextState(state, data[offset++]);
+  }
+  state_ = state;
+  return state != kReject;
+}
+
+bool Utf8Validator::FeedByte(uint8_t b) {
+  state_ = NextState(state_, b);
+  return state_ != kReject;
+}
+
+bool Utf8Validate(const StringView& text) {
+  Utf8Validator validator;
+  return validator.Feed(text) && validator.IsComplete();
+}
+
+}  // namespace mcucore
@@ -0,0 +1,62 @@
+#ifndef MCUCORE_SRC_STRINGS_UTF8_VALIDATOR_H_
+#define MCUCORE_SRC_STRINGS_UTF8_VALIDATOR_H_
+
+// Utf8Validator checks whether a sequence of bytes is well-formed UTF-8 (i.e.
+// no overlong encodings, no surrogates, nothing beyond U+10FFFF). The bytes may
+// be fed to it in several pieces, split at arbitrary positions (e.g. in the
+// middle of a multi-byte sequence), which allows it to be used by Print
+// wrappers and by RequestDecoderListener implementations, which receive text in
+// pieces (see OnPartialText).
+//
+// The validation is performed by a small DFA whose tables are stored in
+// PROGMEM. On the host, runs of ASCII bytes are skipped a machine word at a
+// time, so the DFA is only used for non-ASCII text.
+//
+// Author: james.synge@gmail.com
+
+#include "mcucore_platform.h"
+#include "strings/string_view.h"
+
+namespace mcucore {
+
+class Utf8Validator {
+ public:
+  // The states of the DFA are multiples of the number of byte classes, so that
+  // the next state can be found without a multiplication.
+  static constexpr uint8_t kAccept = 0;
+  static constexpr uint8_t kReject = 12;
+
+  Utf8Validator() : state_(kAccept) {}
+
+  // Feeds the next byte(s) of the text into the validator. Returns false if the
+  // text is not valid UTF-8, including if it was found to be invalid by an
+  // earlier call.
+  bool Feed(const uint8_t* data, size_t size);
+  bool Feed(const StringView& text) { return Feed(text.bytes(), text.size()); }
+  bool FeedByte(uint8_t b);
+
+  // Returns true if the bytes fed so far are not valid UTF-8 (or the prefix of
+  // valid UTF-8).
+  bool HasError() const { return state_ == kReject; }
+
+  // Returns true if the bytes fed so far are valid UTF-8, and don't end in the
+  // middle of a multi-byte sequence.
+  bool IsComplete() const { return state_ == kAccept; }
+
+  // Returns true if the bytes fed so far are valid UTF-8, but end in the middle
+  // of a multi-byte sequence.
+  bool InSequence() const { return state_ != kAccept && state_ != kReject; }
+
+  // Returns the validator to its initial state.
+  void Reset() { state_ = kAccept; }
+
+ private:
+  uint8_t state_;
+};
+
+// Returns true if text is entirely valid UTF-8.
+bool Utf8Validate(const StringView& text);
+
+}  // namespace mcucore
+
+#endif  // MCUCORE_SRC_STRINGS_UTF8_VALIDATOR_H_